@@ -0,0 +1,812 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       batch.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Sharded batch runs and merging of partial results
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See batch.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "bioplib/macros.h"
+#include "batch.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXBUFF    (BAT_MAXNAME + 64)
+#define INITRECS   256
+#define MODE_HBOND "hbond"
+#define MODE_IFACE "interface"
+
+/* A structure name and the partial file it came from                   */
+typedef struct
+{
+   char *Name;
+   int  Part;
+}  MERGENAME;
+
+/************************************************************************/
+/* Prototypes
+*/
+static int  CompareRecs(const void *a, const void *b);
+static int  ComparePairs(const void *a, const void *b);
+static int  CompareNames(const void *a, const void *b);
+static BOOL CheckDuplicates(BATCH *batch, int *first, int NParts,
+                            char **files);
+static char *ModeLabel(char *mode);
+static BOOL ReadHeaderWord(FILE *fp, char *key, char *value, int len,
+                           char *filename);
+
+
+/************************************************************************/
+/*>unsigned long long ShardHash(char *name)
+   ----------------------------------------
+   64-bit FNV-1a hash of the base name (the part after any /) of a 
+   file name
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses FNVHash64()   By: agent
+*/
+unsigned long long ShardHash(char *name)
+{
+   char *base;
+
+   if((base = strrchr(name, '/')) != NULL)
+      name = base + 1;
+
+   return(FNVHash64(FNV64_INIT, name, strlen(name)));
+}
+
+
+/************************************************************************/
+/*>BOOL ParseShard(char *spec, int *shard, int *NShards)
+   -----------------------------------------------------
+   Parses a shard specification i/N with 0 <= i < N
+
+   18.10.26 Original   By: agent
+*/
+BOOL ParseShard(char *spec, int *shard, int *NShards)
+{
+   char extra;
+   
+   if((sscanf(spec, "%d/%d%c", shard, NShards, &extra) != 2) ||
+      (*NShards < 1) || (*shard < 0) || (*shard >= *NShards))
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL InShard(char *name, int shard, int NShards)
+   ------------------------------------------------
+   Does the structure in file name belong to this shard?
+
+   18.10.26 Original   By: agent
+*/
+BOOL InShard(char *name, int shard, int NShards)
+{
+   if(NShards <= 1)
+      return(TRUE);
+   return((int)(ShardHash(name) % (unsigned long long)NShards) == shard);
+}
+
+
+/************************************************************************/
+/*>BATCH *CreateBatch(char *program, char *mode, char *options,
+                      int shard, int NShards)
+   ------------------------------------------------------------
+   Creates an empty set of batch results. options should list the 
+   command line options which affect the results (used to check that
+   partials may be merged). Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+   18.10.26 Copies the strings with snprintf()   By: agent
+*/
+BATCH *CreateBatch(char *program, char *mode, char *options,
+                   int shard, int NShards)
+{
+   BATCH *batch;
+
+   if((batch = (BATCH *)calloc(1, sizeof(BATCH)))==NULL)
+      return(NULL);
+
+   snprintf(batch->Program, BAT_MAXWORD, "%s", program);
+   snprintf(batch->Mode,    BAT_MAXWORD, "%s", mode);
+   snprintf(batch->Options, BAT_MAXOPT,  "%s", options);
+   batch->Shard   = shard;
+   batch->NShards = NShards;
+
+   return(batch);
+}
+
+
+/************************************************************************/
+/*>void FreeBatch(BATCH *batch)
+   ----------------------------
+   Frees a set of batch results
+
+   18.10.26 Original   By: agent
+*/
+void FreeBatch(BATCH *batch)
+{
+   int i;
+   
+   if(batch == NULL)
+      return;
+
+   for(i=0; i<batch->NRecs; i++)
+      free(batch->Recs[i].Pairs);
+   free(batch->Recs);
+   free(batch);
+}
+
+
+/************************************************************************/
+/*>BATCHREC *AddBatchRecord(BATCH *batch, char *name, REAL energy, 
+                            int NHBonds)
+   ---------------------------------------------------------------
+   Adds the result for one structure. Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+BATCHREC *AddBatchRecord(BATCH *batch, char *name, REAL energy, 
+                         int NHBonds)
+{
+   BATCHREC *rec;
+   
+   if(batch->NRecs == batch->MaxRecs)
+   {
+      int  max = batch->MaxRecs ? 2 * batch->MaxRecs : INITRECS;
+      void *p;
+      
+      if((p = realloc(batch->Recs, max * sizeof(BATCHREC)))==NULL)
+         return(NULL);
+      batch->Recs    = (BATCHREC *)p;
+      batch->MaxRecs = max;
+   }
+
+   rec = &(batch->Recs[batch->NRecs++]);
+   strncpy(rec->Name, name, BAT_MAXNAME-1);
+   rec->Name[BAT_MAXNAME-1] = '\0';
+   rec->Energy  = energy;
+   rec->NHBonds = NHBonds;
+   rec->NPairs  = 0;
+   rec->Pairs   = NULL;
+
+   return(rec);
+}
+
+
+/************************************************************************/
+/*>BOOL AddBatchPair(BATCHREC *rec, char ChainX, char ChainY, 
+                     REAL energy, int NHBonds)
+   ---------------------------------------------------------
+   Adds a chain pair total to the result for a structure
+
+   18.10.26 Original   By: agent
+*/
+BOOL AddBatchPair(BATCHREC *rec, char ChainX, char ChainY, REAL energy,
+                  int NHBonds)
+{
+   void *p;
+
+   if((p = realloc(rec->Pairs, (rec->NPairs+1) * sizeof(BATCHPAIR)))
+      ==NULL)
+      return(FALSE);
+   rec->Pairs = (BATCHPAIR *)p;
+   
+   rec->Pairs[rec->NPairs].ChainX  = ChainX;
+   rec->Pairs[rec->NPairs].ChainY  = ChainY;
+   rec->Pairs[rec->NPairs].Energy  = energy;
+   rec->Pairs[rec->NPairs].NHBonds = NHBonds;
+   rec->NPairs++;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void SortBatch(BATCH *batch)
+   ----------------------------
+   Sorts the records by name
+
+   18.10.26 Original   By: agent
+*/
+void SortBatch(BATCH *batch)
+{
+   if(batch->NRecs > 1)
+      qsort(batch->Recs, batch->NRecs, sizeof(BATCHREC), CompareRecs);
+}
+
+
+/************************************************************************/
+/*>BOOL WritePartial(BATCH *batch, char *filename)
+   -----------------------------------------------
+   Writes a partial result file. It is written to a temporary file 
+   and renamed so a partial file which exists is always complete.
+
+   18.10.26 Original   By: agent
+*/
+BOOL WritePartial(BATCH *batch, char *filename)
+{
+   FILE *fp;
+   char tmpfile[MAXBUFF];
+   int  i, j;
+
+   SortBatch(batch);
+   
+   snprintf(tmpfile, MAXBUFF, "%s.tmp", filename);
+   if((fp = fopen(tmpfile, "w"))==NULL)
+   {
+      fprintf(stderr,"Unable to write partial results: %s\n", tmpfile);
+      return(FALSE);
+   }
+
+   fprintf(fp, "#EHBPARTIAL %d\n", BAT_VERSION);
+   fprintf(fp, "#program %s\n",    batch->Program);
+   fprintf(fp, "#mode %s\n",       batch->Mode);
+   fprintf(fp, "#options %s\n",    batch->Options);
+   fprintf(fp, "#shard %d/%d\n",   batch->Shard, batch->NShards);
+   for(i=0; i<batch->NRecs; i++)
+   {
+      BATCHREC *rec = &(batch->Recs[i]);
+      
+      fprintf(fp, "S %d %a %s\n", rec->NHBonds, rec->Energy, rec->Name);
+      for(j=0; j<rec->NPairs; j++)
+      {
+         fprintf(fp, "P %d %d %d %a\n", 
+                 (int)rec->Pairs[j].ChainX, (int)rec->Pairs[j].ChainY,
+                 rec->Pairs[j].NHBonds, rec->Pairs[j].Energy);
+      }
+   }
+   fprintf(fp, "#end %d\n", batch->NRecs);
+
+   if((fclose(fp) != 0) || (rename(tmpfile, filename) != 0))
+   {
+      fprintf(stderr,"Unable to write partial results: %s\n", filename);
+      unlink(tmpfile);
+      return(FALSE);
+   }
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BATCH *ReadPartial(char *filename)
+   ----------------------------------
+   Reads a partial result file. Returns NULL (with a message) if it 
+   cannot be read or is incomplete.
+
+   18.10.26 Original   By: agent
+*/
+BATCH *ReadPartial(char *filename)
+{
+   FILE     *fp;
+   BATCH    *batch = NULL;
+   BATCHREC *rec   = NULL;
+   char     buffer[MAXBUFF],
+            program[BAT_MAXWORD],
+            mode[BAT_MAXWORD],
+            options[BAT_MAXOPT],
+            shard[BAT_MAXWORD];
+   int      version, 
+            ishard, NShards,
+            NEnd   = (-1),
+            line   = 5;
+   
+   if((fp = fopen(filename, "r"))==NULL)
+   {
+      fprintf(stderr,"Unable to read partial results: %s\n", filename);
+      return(NULL);
+   }
+
+   if(!fgets(buffer, MAXBUFF, fp) ||
+      (sscanf(buffer, "#EHBPARTIAL %d", &version) != 1) ||
+      (version != BAT_VERSION))
+   {
+      fprintf(stderr,"Not a version %d partial result file: %s\n",
+              BAT_VERSION, filename);
+      fclose(fp);
+      return(NULL);
+   }
+   
+   if(!ReadHeaderWord(fp, "#program ", program, BAT_MAXWORD, filename) ||
+      !ReadHeaderWord(fp, "#mode ",    mode,    BAT_MAXWORD, filename) ||
+      !ReadHeaderWord(fp, "#options ", options, BAT_MAXOPT,  filename) ||
+      !ReadHeaderWord(fp, "#shard ",   shard,   BAT_MAXWORD, filename) ||
+      !ParseShard(shard, &ishard, &NShards) ||
+      ((batch = CreateBatch(program, mode, options, ishard, NShards))
+       ==NULL))
+   {
+      fclose(fp);
+      return(NULL);
+   }
+
+   while(fgets(buffer, MAXBUFF, fp))
+   {
+      int  NHBonds, n, cx, cy;
+      REAL energy;
+
+      line++;
+      TERMINATE(buffer);
+      
+      if(!strncmp(buffer, "#end ", 5))
+      {
+         NEnd = atoi(buffer+5);
+         break;
+      }
+      else if((buffer[0] == 'S') && 
+              (sscanf(buffer, "S %d %la %n", &NHBonds, &energy, &n) >= 2))
+      {
+         if((rec = AddBatchRecord(batch, buffer+n, energy, NHBonds))
+            ==NULL)
+            break;
+      }
+      else if((buffer[0] == 'P') && (rec != NULL) &&
+              (sscanf(buffer, "P %d %d %d %la", &cx, &cy, &NHBonds,
+                      &energy) == 4))
+      {
+         if(!AddBatchPair(rec, (char)cx, (char)cy, energy, NHBonds))
+            break;
+      }
+      else
+      {
+         fprintf(stderr,"Bad line %d in partial result file: %s\n", 
+                 line, filename);
+         break;
+      }
+   }
+   fclose(fp);
+
+   if(NEnd != batch->NRecs)
+   {
+      fprintf(stderr,"Incomplete partial result file: %s\n", filename);
+      FreeBatch(batch);
+      return(NULL);
+   }
+   
+   return(batch);
+}
+
+
+/************************************************************************/
+/*>void PrintBatchReport(FILE *out, BATCH *batch)
+   ----------------------------------------------
+   Prints the result for each structure (sorted by name) and the 
+   totals over all structures, including the total for each chain 
+   pair if there are any.
+
+   18.10.26 Original   By: agent
+*/
+void PrintBatchReport(FILE *out, BATCH *batch)
+{
+   BATCHPAIR *all = NULL;
+   REAL      ETot  = (REAL)0.0,
+             EComp = (REAL)0.0,
+             *PComp = NULL;
+   char      *label;
+   int       NAll = 0,
+             NHBonds = 0,
+             i, j, k;
+
+   SortBatch(batch);
+   label = ModeLabel(batch->Mode);
+
+   for(i=0; i<batch->NRecs; i++)
+   {
+      BATCHREC *rec = &(batch->Recs[i]);
+      
+      fprintf(out, "%s %s = %f (%d HBonds)\n", rec->Name, label, 
+              rec->Energy, rec->NHBonds);
+      CompensatedAdd(&ETot, &EComp, rec->Energy);
+      NHBonds += rec->NHBonds;
+
+      for(j=0; j<rec->NPairs; j++)
+      {
+         BATCHPAIR *pair = &(rec->Pairs[j]);
+         
+         fprintf(out, "%s %c:%c %f %d\n", rec->Name,
+                 pair->ChainX, pair->ChainY, pair->Energy, 
+                 pair->NHBonds);
+
+         /* Accumulate the global total for this chain pair            */
+         for(k=0; k<NAll; k++)
+         {
+            if((all[k].ChainX == pair->ChainX) &&
+               (all[k].ChainY == pair->ChainY))
+               break;
+         }
+         if(k == NAll)
+         {
+            void *p;
+            
+            if((p = realloc(all, (NAll+1)*sizeof(BATCHPAIR)))!=NULL)
+               all = (BATCHPAIR *)p;
+            if((p == NULL) ||
+               ((p = realloc(PComp, (NAll+1)*sizeof(REAL)))==NULL))
+            {
+               fprintf(stderr,"No memory for chain pair totals\n");
+               break;
+            }
+            PComp = (REAL *)p;
+            all[k]         = *pair;
+            all[k].Energy  = (REAL)0.0;
+            all[k].NHBonds = 0;
+            PComp[k]       = (REAL)0.0;
+            NAll++;
+         }
+         CompensatedAdd(&(all[k].Energy), &(PComp[k]), pair->Energy);
+         all[k].NHBonds += pair->NHBonds;
+      }
+   }
+
+   fprintf(out, "Total %s = %f (%d structures, %d HBonds)\n", label,
+           ETot + EComp, batch->NRecs, NHBonds);
+
+   for(k=0; k<NAll; k++)
+      all[k].Energy += PComp[k];
+   if(NAll > 1)
+      qsort(all, NAll, sizeof(BATCHPAIR), ComparePairs);
+   for(k=0; k<NAll; k++)
+   {
+      fprintf(out, "Total %c:%c %f %d\n", all[k].ChainX, all[k].ChainY,
+              all[k].Energy, all[k].NHBonds);
+   }
+
+   free(all);
+   free(PComp);
+}
+
+
+/************************************************************************/
+/*>int MergeMain(int argc, char **argv, char *program)
+   ---------------------------------------------------
+   The merge subcommand:
+      program merge [-p merged] partial [partial ...]
+   Reads the partial result files from every shard of a run, checks
+   that they come from the same program, mode and options and that 
+   every shard is present exactly once, and prints the combined 
+   report. -p also writes the combined results as a partial file for
+   shard 0/1 (i.e. as an unsharded run would). argv[0] is "merge". 
+   Returns the exit status.
+
+   A structure may appear more than once in one partial file (if it
+   was given twice in that run) but not in two different files.
+
+   18.10.26 Original   By: agent
+   18.10.26 Only structures in different partial files are duplicates
+            By: agent
+*/
+int MergeMain(int argc, char **argv, char *program)
+{
+   BATCH *all  = NULL,
+         *part;
+   char  *outfile = NULL;
+   BOOL  *seen = NULL;
+   int   *first,
+         i, j;
+
+   argc--;
+   argv++;
+   if(argc && !strcmp(argv[0], "-p"))
+   {
+      if(argc < 2)
+         argc = 0;
+      else
+      {
+         outfile = argv[1];
+         argc -= 2;
+         argv += 2;
+      }
+   }
+   if(argc < 1)
+   {
+      fprintf(stderr,"\nUsage: %s merge [-p merged] partial \
+[partial ...]\n", program);
+      fprintf(stderr,"       Combines the partial result files from \
+every shard of a run\n");
+      fprintf(stderr,"       -p  Also write the combined results as a \
+partial file\n\n");
+      return(1);
+   }
+
+   /* Index of the first merged record from each partial file           */
+   if((first = (int *)malloc((argc+1) * sizeof(int)))==NULL)
+   {
+      fprintf(stderr,"No memory for merged results\n");
+      return(1);
+   }
+
+   for(i=0; i<argc; i++)
+   {
+      if((part = ReadPartial(argv[i]))==NULL)
+         return(1);
+
+      if(all == NULL)
+      {
+         if(strcmp(part->Program, program))
+         {
+            fprintf(stderr,"%s was written by %s not %s\n", argv[i],
+                    part->Program, program);
+            return(1);
+         }
+         if((all = CreateBatch(part->Program, part->Mode, part->Options,
+                               0, 1))==NULL ||
+            (seen = (BOOL *)calloc(part->NShards, sizeof(BOOL)))==NULL)
+         {
+            fprintf(stderr,"No memory for merged results\n");
+            return(1);
+         }
+         all->NShards = part->NShards;
+      }
+      else if(strcmp(part->Program, all->Program) ||
+              strcmp(part->Mode,    all->Mode)    ||
+              strcmp(part->Options, all->Options) ||
+              (part->NShards != all->NShards))
+      {
+         fprintf(stderr,"%s is not from the same run as %s\n", argv[i],
+                 argv[0]);
+         return(1);
+      }
+
+      if(seen[part->Shard])
+      {
+         fprintf(stderr,"Shard %d/%d given twice (%s)\n", part->Shard,
+                 part->NShards, argv[i]);
+         return(1);
+      }
+      seen[part->Shard] = TRUE;
+
+      /* Move the records across                                        */
+      first[i] = all->NRecs;
+      for(j=0; j<part->NRecs; j++)
+      {
+         BATCHREC *rec;
+         
+         if((rec = AddBatchRecord(all, part->Recs[j].Name, 
+                                  part->Recs[j].Energy,
+                                  part->Recs[j].NHBonds))==NULL)
+         {
+            fprintf(stderr,"No memory for merged results\n");
+            return(1);
+         }
+         rec->Pairs  = part->Recs[j].Pairs;
+         rec->NPairs = part->Recs[j].NPairs;
+         part->Recs[j].Pairs = NULL;
+      }
+      FreeBatch(part);
+   }
+
+   for(i=0; i<all->NShards; i++)
+   {
+      if(!seen[i])
+      {
+         fprintf(stderr,"Shard %d/%d is missing\n", i, all->NShards);
+         return(1);
+      }
+   }
+   
+   first[argc] = all->NRecs;
+   if(!CheckDuplicates(all, first, argc, argv))
+      return(1);
+
+   all->NShards = 1;
+   PrintBatchReport(stdout, all);
+   if((outfile != NULL) && !WritePartial(all, outfile))
+      return(1);
+
+   FreeBatch(all);
+   free(seen);
+   free(first);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>static BOOL CheckDuplicates(BATCH *batch, int *first, int NParts,
+                               char **files)
+   -----------------------------------------------------------------
+   Checks that no structure name appears in more than one of the
+   partial files which were merged into batch. The records from file
+   i are batch->Recs[first[i]] to batch->Recs[first[i+1]-1]. Returns
+   FALSE (with a message) if there is a duplicate.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL CheckDuplicates(BATCH *batch, int *first, int NParts,
+                            char **files)
+{
+   MERGENAME *names;
+   BOOL      ok = TRUE;
+   int       i, j, k;
+
+   if(batch->NRecs < 2)
+      return(TRUE);
+
+   if((names = (MERGENAME *)malloc(batch->NRecs * sizeof(MERGENAME)))
+      ==NULL)
+   {
+      fprintf(stderr,"No memory to check for duplicate structures\n");
+      return(FALSE);
+   }
+
+   for(i=0, k=0; i<NParts; i++)
+   {
+      for(j=first[i]; j<first[i+1]; j++, k++)
+      {
+         names[k].Name = batch->Recs[j].Name;
+         names[k].Part = i;
+      }
+   }
+
+   /* Sorted by name then file, so a name in two files is adjacent to
+      itself with a different file
+   */
+   qsort(names, batch->NRecs, sizeof(MERGENAME), CompareNames);
+   for(k=1; k<batch->NRecs; k++)
+   {
+      if((names[k].Part != names[k-1].Part) &&
+         !strcmp(names[k].Name, names[k-1].Name))
+      {
+         fprintf(stderr,"Structure %s appears in both %s and %s\n",
+                 names[k].Name, files[names[k-1].Part],
+                 files[names[k].Part]);
+         ok = FALSE;
+         break;
+      }
+   }
+
+   free(names);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>static BOOL ReadHeaderWord(FILE *fp, char *key, char *value, 
+                              int len, char *filename)
+   ------------------------------------------------------------
+   Reads a header line of a partial file which must start with key and
+   returns the rest of the line in value
+
+   18.10.26 Original   By: agent
+*/
+static BOOL ReadHeaderWord(FILE *fp, char *key, char *value, int len,
+                           char *filename)
+{
+   char buffer[MAXBUFF];
+   int  keylen = strlen(key);
+
+   if(!fgets(buffer, MAXBUFF, fp))
+      buffer[0] = '\0';
+   TERMINATE(buffer);
+   
+   /* An empty value loses its trailing space                          */
+   if(strncmp(buffer, key, keylen) &&
+      !(!strncmp(buffer, key, keylen-1) && (buffer[keylen-1] == '\0')))
+   {
+      fprintf(stderr,"Missing %s line in partial result file: %s\n",
+              key, filename);
+      return(FALSE);
+   }
+
+   if(buffer[keylen-1] == '\0')
+      value[0] = '\0';
+   else
+   {
+      strncpy(value, buffer+keylen, len-1);
+      value[len-1] = '\0';
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static char *ModeLabel(char *mode)
+   ----------------------------------
+   The label for the energies in a report
+
+   18.10.26 Original   By: agent
+*/
+static char *ModeLabel(char *mode)
+{
+   if(!strcmp(mode, MODE_HBOND))
+      return("HBond energy");
+   if(!strcmp(mode, MODE_IFACE))
+      return("Interface energy");
+   return("Energy");
+}
+
+
+/************************************************************************/
+/*>static int CompareRecs(const void *a, const void *b)
+   ----------------------------------------------------
+   qsort() comparison of records by name
+
+   18.10.26 Original   By: agent
+*/
+static int CompareRecs(const void *a, const void *b)
+{
+   return(strcmp(((BATCHREC *)a)->Name, ((BATCHREC *)b)->Name));
+}
+
+
+/************************************************************************/
+/*>static int ComparePairs(const void *a, const void *b)
+   -----------------------------------------------------
+   qsort() comparison of chain pairs
+
+   18.10.26 Original   By: agent
+*/
+static int ComparePairs(const void *a, const void *b)
+{
+   BATCHPAIR *pa = (BATCHPAIR *)a,
+             *pb = (BATCHPAIR *)b;
+
+   if(pa->ChainX != pb->ChainX)
+      return((int)pa->ChainX - (int)pb->ChainX);
+   return((int)pa->ChainY - (int)pb->ChainY);
+}
+
+
+/************************************************************************/
+/*>static int CompareNames(const void *a, const void *b)
+   -----------------------------------------------------
+   qsort() comparison of structure names, then partial file
+
+   18.10.26 Original   By: agent
+*/
+static int CompareNames(const void *a, const void *b)
+{
+   MERGENAME *x = (MERGENAME *)a,
+             *y = (MERGENAME *)b;
+   int       cmp;
+
+   if((cmp = strcmp(x->Name, y->Name)) != 0)
+      return(cmp);
+   return(x->Part - y->Part);
+}
@@ -0,0 +1,142 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       batch.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Sharded batch runs and merging of partial results
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Support for running ehb or ehb2 over a large set of structures in
+   several processes (or on several machines) and combining the 
+   results.
+
+   Structures are assigned to shards by a 64-bit FNV-1a hash of the 
+   base name of their file so every process given the same list 
+   agrees on the split without any communication, and the split does
+   not depend on the order of the list or the directory the files 
+   are in. --shard i/N selects shard i (0 <= i < N).
+
+   The results for each structure (total energy, number of HBonds and
+   optionally per chain pair totals) are collected in a BATCH. A BATCH
+   may be written as a self-describing partial result file recording
+   the program, mode, result-affecting options and shard. Energies are
+   written as C99 hex floats so they are read back exactly. The merge
+   subcommand reads the partials from all N shards, checks that they 
+   are compatible and complete, and prints the same report as a 
+   single unsharded run. Records are always reported (and written) 
+   sorted by name and global totals are compensated sums in that 
+   order, so the results do not depend on how the work was split.
+
+   Partial file format (one record per line):
+      #EHBPARTIAL 1
+      #program <program>
+      #mode <mode>
+      #options <options>
+      #shard <i>/<N>
+      S <nhbonds> <energy> <name>
+      P <chainX> <chainY> <nhbonds> <energy>   (chain pair of last S,
+                                               chains as char codes)
+      #end <number of S records>
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _BATCH_H
+#define _BATCH_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define BAT_MAXNAME  256   /* Max length of a structure name + 1        */
+#define BAT_MAXWORD  32    /* Max length of program and mode names + 1  */
+#define BAT_MAXOPT   256   /* Max length of the options string + 1      */
+#define BAT_VERSION  1     /* Partial file format version               */
+
+typedef struct
+{
+   REAL Energy;
+   int  NHBonds;
+   char ChainX,
+        ChainY;
+}  BATCHPAIR;
+
+typedef struct
+{
+   char      Name[BAT_MAXNAME];
+   BATCHPAIR *Pairs;
+   REAL      Energy;
+   int       NHBonds,
+             NPairs;
+}  BATCHREC;
+
+typedef struct
+{
+   char     Program[BAT_MAXWORD],
+            Mode[BAT_MAXWORD],
+            Options[BAT_MAXOPT];
+   BATCHREC *Recs;
+   int      Shard,
+            NShards,
+            NRecs,
+            MaxRecs;
+}  BATCH;
+
+/************************************************************************/
+/* Prototypes
+*/
+unsigned long long ShardHash(char *name);
+BOOL ParseShard(char *spec, int *shard, int *NShards);
+BOOL InShard(char *name, int shard, int NShards);
+BATCH *CreateBatch(char *program, char *mode, char *options,
+                   int shard, int NShards);
+void FreeBatch(BATCH *batch);
+BATCHREC *AddBatchRecord(BATCH *batch, char *name, REAL energy, 
+                         int NHBonds);
+BOOL AddBatchPair(BATCHREC *rec, char ChainX, char ChainY, REAL energy,
+                  int NHBonds);
+void SortBatch(BATCH *batch);
+BOOL WritePartial(BATCH *batch, char *filename);
+BATCH *ReadPartial(char *filename);
+void PrintBatchReport(FILE *out, BATCH *batch);
+int MergeMain(int argc, char **argv, char *program);
+
+#endif
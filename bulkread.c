@@ -0,0 +1,502 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       bulkread.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Reads many small files at once with io_uring
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See bulkread.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "bulkread.h"
+
+#if defined(__linux__) && defined(SYS_io_uring_setup) && \
+    defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#     include <linux/io_uring.h>
+#     define HAVE_IO_URING
+#  endif
+#endif
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define STAGE_FREE 0
+#define STAGE_OPEN 1
+#define STAGE_READ 2
+
+#ifdef HAVE_IO_URING
+#define LOADACQ(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STOREREL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL MapRings(BULKREAD *br, struct io_uring_params *params);
+static void QueueOpen(BULKREAD *br, int slot);
+static void QueueRead(BULKREAD *br, int slot);
+static void Complete(BULKREAD *br, int slot, int error);
+static void HandleCQE(BULKREAD *br, int slot, int res);
+#endif
+
+
+/************************************************************************/
+/*>BULKREAD *CreateBulkReader(int depth)
+   -------------------------------------
+   Creates a reader with up to depth files in flight. Returns NULL if
+   io_uring is not available or out of memory.
+
+   18.10.26 Original   By: agent
+*/
+BULKREAD *CreateBulkReader(int depth)
+{
+#ifdef HAVE_IO_URING
+   BULKREAD               *br;
+   struct io_uring_params params;
+   int                    i;
+
+   if((depth < 1) || (depth > BR_MAXDEPTH))
+      return(NULL);
+   
+   if((br = (BULKREAD *)calloc(1, sizeof(BULKREAD)))==NULL)
+      return(NULL);
+   br->RingFD = (-1);
+   br->Depth  = depth;
+   br->NFree  = depth;
+   if(((br->Slots     = (BRSLOT *)calloc(depth, sizeof(BRSLOT)))==NULL) ||
+      ((br->FreeSlots = (int *)malloc(depth * sizeof(int)))==NULL)     ||
+      ((br->Ready     = (int *)malloc(depth * sizeof(int)))==NULL))
+   {
+      FreeBulkReader(br);
+      return(NULL);
+   }
+   for(i=0; i<depth; i++)
+      br->FreeSlots[i] = depth - 1 - i;
+
+   /* Each slot has at most one operation outstanding so the rings 
+      never overflow. OPENAT and READ need Linux 5.6, which is also 
+      when IORING_FEAT_RW_CUR_POS appeared.
+   */
+   memset(&params, 0, sizeof(params));
+   if(((br->RingFD = (int)syscall(SYS_io_uring_setup, depth, &params))
+       < 0) ||
+      !(params.features & IORING_FEAT_RW_CUR_POS) ||
+      !MapRings(br, &params))
+   {
+      FreeBulkReader(br);
+      return(NULL);
+   }
+
+   return(br);
+#else
+   return(NULL);
+#endif
+}
+
+
+/************************************************************************/
+/*>void FreeBulkReader(BULKREAD *br)
+   ---------------------------------
+   Frees a reader, closing any files still open and freeing their
+   data
+
+   18.10.26 Original   By: agent
+*/
+void FreeBulkReader(BULKREAD *br)
+{
+   int i;
+
+   if(br == NULL)
+      return;
+
+   /* Closing the ring cancels anything still in flight                */
+   if(br->RingFD >= 0)
+      close(br->RingFD);
+   
+   for(i=0; (br->Slots != NULL) && (i<br->Depth); i++)
+   {
+      if(br->Slots[i].Stage != STAGE_FREE)
+      {
+         if(br->Slots[i].fd >= 0)
+            close(br->Slots[i].fd);
+         free(br->Slots[i].Data);
+      }
+   }
+
+   if(br->SQEs != NULL)
+      munmap(br->SQEs, br->SQEsSize);
+   if((br->CQRing != NULL) && (br->CQRing != br->SQRing))
+      munmap(br->CQRing, br->CQRingSize);
+   if(br->SQRing != NULL)
+      munmap(br->SQRing, br->SQRingSize);
+
+   free(br->Slots);
+   free(br->FreeSlots);
+   free(br->Ready);
+   free(br);
+}
+
+
+/************************************************************************/
+/*>BOOL BulkReadAdd(BULKREAD *br, char *filename, void *user)
+   ----------------------------------------------------------
+   Queues a file to be read. filename must stay valid until the file
+   is returned by BulkReadNext(). Returns FALSE if the reader is full.
+   Nothing is submitted to the kernel until BulkReadNext().
+
+   18.10.26 Original   By: agent
+*/
+BOOL BulkReadAdd(BULKREAD *br, char *filename, void *user)
+{
+#ifdef HAVE_IO_URING
+   BRSLOT *s;
+   int    slot;
+   
+   if(br->NFree == 0)
+      return(FALSE);
+   
+   slot        = br->FreeSlots[--(br->NFree)];
+   s           = &(br->Slots[slot]);
+   s->User     = user;
+   s->Filename = filename;
+   s->Data     = NULL;
+   s->Size     = 0;
+   s->Done     = 0;
+   s->fd       = (-1);
+   s->Error    = 0;
+   s->Stage    = STAGE_OPEN;
+   QueueOpen(br, slot);
+   
+   return(TRUE);
+#else
+   return(FALSE);
+#endif
+}
+
+
+/************************************************************************/
+/*>BOOL BulkReadNext(BULKREAD *br, void **user, char **data, 
+                     size_t *size, int *error)
+   ----------------------------------------------------------
+   Submits the queued operations and waits for the next file to be 
+   read. Its contents (with a NUL added) are returned in *data, which
+   the caller must free(), or the errno in *error (and *data is NULL).
+   Returns FALSE if there are no files in flight.
+
+   18.10.26 Original   By: agent
+*/
+BOOL BulkReadNext(BULKREAD *br, void **user, char **data, size_t *size,
+                  int *error)
+{
+#ifdef HAVE_IO_URING
+   struct io_uring_cqe *cqes = (struct io_uring_cqe *)br->CQEs;
+   BRSLOT              *s;
+   unsigned            head, tail;
+   int                 slot, ret;
+
+   while(br->NReady == 0)
+   {
+      if(!BulkReadBusy(br))
+         return(FALSE);
+
+      /* Submit and wait for at least one completion                   */
+      ret = (int)syscall(SYS_io_uring_enter, br->RingFD, br->NToSubmit,
+                         1, IORING_ENTER_GETEVENTS, NULL, 0);
+      if(ret < 0)
+      {
+         if((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY))
+            continue;
+         return(FALSE);
+      }
+      br->NToSubmit -= (ret < br->NToSubmit) ? ret : br->NToSubmit;
+
+      /* Handle everything that has completed                          */
+      head = *(br->CQHead);
+      tail = LOADACQ(br->CQTail);
+      for(; head != tail; head++)
+      {
+         struct io_uring_cqe *cqe = &(cqes[head & *(br->CQMask)]);
+         HandleCQE(br, (int)cqe->user_data, cqe->res);
+      }
+      STOREREL(br->CQHead, head);
+   }
+
+   slot    = br->Ready[--(br->NReady)];
+   s       = &(br->Slots[slot]);
+   *user   = s->User;
+   *data   = s->Data;
+   *size   = s->Done;
+   *error  = s->Error;
+   s->Data = NULL;
+   s->Stage = STAGE_FREE;
+   br->FreeSlots[(br->NFree)++] = slot;
+   
+   return(TRUE);
+#else
+   return(FALSE);
+#endif
+}
+
+
+#ifdef HAVE_IO_URING
+/************************************************************************/
+/*>static void HandleCQE(BULKREAD *br, int slot, int res)
+   ------------------------------------------------------
+   Moves a file on to its next stage when an operation completes
+
+   18.10.26 Original   By: agent
+*/
+static void HandleCQE(BULKREAD *br, int slot, int res)
+{
+   BRSLOT      *s = &(br->Slots[slot]);
+   struct stat st;
+
+   if(s->Stage == STAGE_OPEN)
+   {
+      if(res < 0)
+      {
+         Complete(br, slot, -res);
+         return;
+      }
+      s->fd = res;
+      if(fstat(s->fd, &st) != 0)
+      {
+         Complete(br, slot, errno);
+         return;
+      }
+      s->Size = (size_t)st.st_size;
+      if((s->Data = (char *)malloc(s->Size + 1))==NULL)
+      {
+         Complete(br, slot, ENOMEM);
+         return;
+      }
+      if(s->Size == 0)
+      {
+         Complete(br, slot, 0);
+         return;
+      }
+      s->Stage = STAGE_READ;
+      QueueRead(br, slot);
+   }
+   else if(s->Stage == STAGE_READ)
+   {
+      if((res == -EINTR) || (res == -EAGAIN))
+      {
+         QueueRead(br, slot);
+      }
+      else if(res < 0)
+      {
+         Complete(br, slot, -res);
+      }
+      else
+      {
+         /* A read of 0 means the file has shrunk since the fstat()     */
+         s->Done += (size_t)res;
+         if((res == 0) || (s->Done == s->Size))
+            Complete(br, slot, 0);
+         else
+            QueueRead(br, slot);
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>static void Complete(BULKREAD *br, int slot, int error)
+   -------------------------------------------------------
+   Finishes a file: closes it and puts it on the ready list
+
+   18.10.26 Original   By: agent
+*/
+static void Complete(BULKREAD *br, int slot, int error)
+{
+   BRSLOT *s = &(br->Slots[slot]);
+
+   if(s->fd >= 0)
+   {
+      close(s->fd);
+      s->fd = (-1);
+   }
+   if(error)
+   {
+      free(s->Data);
+      s->Data = NULL;
+      s->Done = 0;
+   }
+   else
+   {
+      s->Data[s->Done] = '\0';
+   }
+   s->Error = error;
+   br->Ready[(br->NReady)++] = slot;
+}
+
+
+/************************************************************************/
+/*>static void QueueOpen(BULKREAD *br, int slot)
+   ---------------------------------------------
+   Adds an openat of the slot's file to the submission queue
+
+   18.10.26 Original   By: agent
+*/
+static void QueueOpen(BULKREAD *br, int slot)
+{
+   struct io_uring_sqe *sqe;
+   unsigned            tail  = *(br->SQTail),
+                       index = tail & *(br->SQMask);
+
+   sqe = &(((struct io_uring_sqe *)br->SQEs)[index]);
+   memset(sqe, 0, sizeof(struct io_uring_sqe));
+   sqe->opcode     = IORING_OP_OPENAT;
+   sqe->fd         = AT_FDCWD;
+   sqe->addr       = (unsigned long)br->Slots[slot].Filename;
+   sqe->open_flags = O_RDONLY | O_CLOEXEC;
+   sqe->user_data  = (unsigned long)slot;
+
+   br->SQArray[index] = index;
+   STOREREL(br->SQTail, tail + 1);
+   br->NToSubmit++;
+}
+
+
+/************************************************************************/
+/*>static void QueueRead(BULKREAD *br, int slot)
+   ---------------------------------------------
+   Adds a read of the rest of the slot's file to the submission queue
+
+   18.10.26 Original   By: agent
+*/
+static void QueueRead(BULKREAD *br, int slot)
+{
+   BRSLOT              *s = &(br->Slots[slot]);
+   struct io_uring_sqe *sqe;
+   unsigned            tail  = *(br->SQTail),
+                       index = tail & *(br->SQMask);
+
+   sqe = &(((struct io_uring_sqe *)br->SQEs)[index]);
+   memset(sqe, 0, sizeof(struct io_uring_sqe));
+   sqe->opcode    = IORING_OP_READ;
+   sqe->fd        = s->fd;
+   sqe->addr      = (unsigned long)(s->Data + s->Done);
+   sqe->len       = (unsigned)(s->Size - s->Done);
+   sqe->off       = (unsigned long)s->Done;
+   sqe->user_data = (unsigned long)slot;
+
+   br->SQArray[index] = index;
+   STOREREL(br->SQTail, tail + 1);
+   br->NToSubmit++;
+}
+
+
+/************************************************************************/
+/*>static BOOL MapRings(BULKREAD *br, struct io_uring_params *params)
+   ------------------------------------------------------------------
+   Maps the submission and completion rings and the submission queue
+   entries into memory
+
+   18.10.26 Original   By: agent
+*/
+static BOOL MapRings(BULKREAD *br, struct io_uring_params *params)
+{
+   char *sq, *cq;
+
+   br->SQRingSize = params->sq_off.array + 
+                    params->sq_entries * sizeof(unsigned);
+   br->CQRingSize = params->cq_off.cqes + 
+                    params->cq_entries * sizeof(struct io_uring_cqe);
+   if(params->features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if(br->CQRingSize > br->SQRingSize)
+         br->SQRingSize = br->CQRingSize;
+      br->CQRingSize = br->SQRingSize;
+   }
+
+   sq = (char *)mmap(NULL, br->SQRingSize, PROT_READ|PROT_WRITE, 
+                     MAP_SHARED|MAP_POPULATE, br->RingFD, 
+                     IORING_OFF_SQ_RING);
+   if(sq == MAP_FAILED)
+      return(FALSE);
+   br->SQRing = sq;
+
+   if(params->features & IORING_FEAT_SINGLE_MMAP)
+   {
+      cq = sq;
+   }
+   else
+   {
+      cq = (char *)mmap(NULL, br->CQRingSize, PROT_READ|PROT_WRITE, 
+                        MAP_SHARED|MAP_POPULATE, br->RingFD, 
+                        IORING_OFF_CQ_RING);
+      if(cq == MAP_FAILED)
+         return(FALSE);
+   }
+   br->CQRing = cq;
+
+   br->SQEsSize = params->sq_entries * sizeof(struct io_uring_sqe);
+   br->SQEs     = mmap(NULL, br->SQEsSize, PROT_READ|PROT_WRITE,
+                       MAP_SHARED|MAP_POPULATE, br->RingFD, 
+                       IORING_OFF_SQES);
+   if(br->SQEs == MAP_FAILED)
+   {
+      br->SQEs = NULL;
+      return(FALSE);
+   }
+
+   br->SQHead  = (unsigned *)(sq + params->sq_off.head);
+   br->SQTail  = (unsigned *)(sq + params->sq_off.tail);
+   br->SQMask  = (unsigned *)(sq + params->sq_off.ring_mask);
+   br->SQArray = (unsigned *)(sq + params->sq_off.array);
+   br->CQHead  = (unsigned *)(cq + params->cq_off.head);
+   br->CQTail  = (unsigned *)(cq + params->cq_off.tail);
+   br->CQMask  = (unsigned *)(cq + params->cq_off.ring_mask);
+   br->CQEs    = (void *)(cq + params->cq_off.cqes);
+
+   return(TRUE);
+}
+#endif
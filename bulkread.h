@@ -0,0 +1,135 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       bulkread.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Reads many small files at once with io_uring
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Reads whole files into memory with up to Depth files in flight at
+   once through an io_uring (driven with the raw system calls, so 
+   liburing is not needed). Each file is opened with an asynchronous
+   openat, sized with fstat() and read with asynchronous reads (which
+   are resubmitted if short). All the operations queued since the 
+   last call are submitted with the wait for the next completion in a 
+   single io_uring_enter(), so one thread can keep many requests 
+   outstanding on the device.
+
+   CreateBulkReader() returns NULL if io_uring is not available (not 
+   compiled in, disabled, or a kernel older than 5.6). The caller 
+   should then fall back to reading the files itself, e.g. with a 
+   pool of threads.
+
+**************************************************************************
+
+   Usage:
+   ======
+   if((br = CreateBulkReader(depth)) != NULL)
+   {
+      while(more files && !BulkReadFull(br))
+         BulkReadAdd(br, filename, user);
+      while(BulkReadNext(br, &user, &data, &size, &error))
+      {
+         ...use data (NUL terminated) and free() it...
+         ...add more files...
+      }
+      FreeBulkReader(br);
+   }
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _BULKREAD_H
+#define _BULKREAD_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stddef.h>
+#include "bioplib/SysDefs.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define BR_MAXDEPTH 4096   /* Max files in flight                       */
+
+/* One file being read                                                  */
+typedef struct
+{
+   void   *User;
+   char   *Filename,
+          *Data;
+   size_t Size,
+          Done;
+   int    fd,
+          Stage,
+          Error;
+}  BRSLOT;
+
+typedef struct
+{
+   BRSLOT   *Slots;
+   int      *FreeSlots,
+            *Ready,           /* Slots finished but not yet collected   */
+            RingFD,
+            Depth,
+            NFree,
+            NReady,
+            NToSubmit;
+   /* The rings shared with the kernel                                 */
+   void     *SQRing,
+            *CQRing,
+            *SQEs;
+   size_t   SQRingSize,
+            CQRingSize,
+            SQEsSize;
+   unsigned *SQHead,
+            *SQTail,
+            *SQMask,
+            *SQArray,
+            *CQHead,
+            *CQTail,
+            *CQMask;
+   void     *CQEs;
+}  BULKREAD;
+
+#define BulkReadFull(br) ((br)->NFree == 0)
+#define BulkReadBusy(br) ((br)->NFree < (br)->Depth)
+
+/************************************************************************/
+/* Prototypes
+*/
+BULKREAD *CreateBulkReader(int depth);
+void FreeBulkReader(BULKREAD *br);
+BOOL BulkReadAdd(BULKREAD *br, char *filename, void *user);
+BOOL BulkReadNext(BULKREAD *br, void **user, char **data, size_t *size,
+                  int *error);
+
+#endif
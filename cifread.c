@@ -0,0 +1,484 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       cifread.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Streaming mmCIF coordinate reader
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See cifread.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   IsMMCIF() reads compressed files (zread.c)   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bioplib/macros.h"
+#include "cifread.h"
+#include "zread.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXCIFLINE 4096
+#define MAXCIFTAG  64  /* Max columns in the _atom_site loop            */
+#define ATOMSITE   "_atom_site."
+
+/* Columns of interest in the _atom_site loop                           */
+#define CIF_GROUP       0
+#define CIF_ID          1
+#define CIF_TYPE        2
+#define CIF_LATOM       3
+#define CIF_ALT         4
+#define CIF_LCOMP       5
+#define CIF_LASYM       6
+#define CIF_LSEQ        7
+#define CIF_INSERT      8
+#define CIF_X           9
+#define CIF_Y           10
+#define CIF_Z           11
+#define CIF_OCC         12
+#define CIF_BVAL        13
+#define CIF_ASEQ        14
+#define CIF_ACOMP       15
+#define CIF_AASYM       16
+#define CIF_AATOM       17
+#define CIF_MODEL       18
+#define NCIFCOL         19
+
+/* Missing values in mmCIF                                              */
+#define CIFNULL(s) ((s) == NULL || (((s)[0] == '?' || (s)[0] == '.') && \
+                                    (s)[1] == '\0'))
+
+/************************************************************************/
+/* Prototypes
+*/
+static int SplitCIFRow(char *line, char **tokens, int maxtok);
+static int CIFColumn(char *tag);
+static BOOL FillCIFAtom(PDB *p, char **col);
+static void SetString(char *dest, char *src, int len);
+static REAL CIFReal(char *str);
+
+/************************************************************************/
+/*>PDB *ReadMMCIF(FILE *fp, int *natoms)
+   -------------------------------------
+   Reads the atoms of the first model from an mmCIF file. Rows without
+   coordinates or a residue number are skipped. Returns NULL if there 
+   are no atoms or there is no memory.
+
+   18.10.26 Original   By: agent
+*/
+PDB *ReadMMCIF(FILE *fp, int *natoms)
+{
+   char buffer[MAXCIFLINE],
+        *tokens[MAXCIFTAG],
+        *col[NCIFCOL];
+   int  map[MAXCIFTAG],
+        NTags   = 0,
+        NTok,
+        i;
+   BOOL InLoop  = FALSE,
+        InAtoms = FALSE;
+   PDB  *pdb    = NULL,
+        *p      = NULL,
+        atom;
+   char model[16];
+
+   *natoms  = 0;
+   model[0] = '\0';
+   
+   while(fgets(buffer, MAXCIFLINE, fp))
+   {
+      if(!InAtoms)
+      {
+         if(!strncmp(buffer, "loop_", 5))
+         {
+            InLoop = TRUE;
+            NTags  = 0;
+            continue;
+         }
+         if(InLoop && !strncmp(buffer, ATOMSITE, strlen(ATOMSITE)))
+         {
+            if(NTags == MAXCIFTAG)
+               return(NULL);
+            TERMINATE(buffer);
+            map[NTags++] = CIFColumn(buffer + strlen(ATOMSITE));
+            continue;
+         }
+         if(!InLoop || !NTags || (buffer[0] == '_'))
+         {
+            if(buffer[0] != '_')
+               InLoop = FALSE;
+            continue;
+         }
+
+         /* This is the first data row of the _atom_site loop           */
+         InAtoms = TRUE;
+      }
+      else if((buffer[0] == '#') || (buffer[0] == '_') ||
+              !strncmp(buffer, "loop_", 5) || 
+              !strncmp(buffer, "data_", 5))
+      {
+         /* The loop ends at a comment, a new loop or a new item        */
+         break;
+      }
+
+      if((NTok = SplitCIFRow(buffer, tokens, MAXCIFTAG)) < NTags)
+         continue;
+
+      for(i=0; i<NCIFCOL; i++)
+         col[i] = NULL;
+      for(i=0; i<NTags; i++)
+      {
+         if(map[i] >= 0)
+            col[map[i]] = tokens[i];
+      }
+
+      /* Only read the first model                                      */
+      if(col[CIF_MODEL] != NULL)
+      {
+         if(model[0] == '\0')
+            SetString(model, col[CIF_MODEL], 16);
+         else if(strcmp(model, col[CIF_MODEL]))
+            break;
+      }
+
+      /* Rows without coordinates or a residue number are skipped     */
+      atom.next = NULL;
+      CLEAR_PDB(&atom);
+      if(!FillCIFAtom(&atom, col))
+         continue;
+
+      if(pdb == NULL)
+      {
+         INIT(pdb, PDB);
+         p = pdb;
+      }
+      else
+      {
+         ALLOCNEXT(p, PDB);
+      }
+      if(p == NULL)
+      {
+         FREELIST(pdb, PDB);
+         *natoms = 0;
+         return(NULL);
+      }
+      *p      = atom;
+      p->next = NULL;
+      (*natoms)++;
+   }
+
+   return(pdb);
+}
+
+
+/************************************************************************/
+/*>BOOL IsMMCIF(char *filename)
+   ----------------------------
+   Tests whether a file is mmCIF, i.e. the first line which isn't blank
+   or a comment starts with data_. The file may be compressed.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses ZOpen()   By: agent
+*/
+BOOL IsMMCIF(char *filename)
+{
+   FILE *fp;
+   char buffer[MAXCIFLINE];
+   BOOL cif = FALSE;
+
+   if((fp = ZOpen(filename))==NULL)
+      return(FALSE);
+
+   while(fgets(buffer, MAXCIFLINE, fp))
+   {
+      if((buffer[0] == '#') || (buffer[0] == '\n') || (buffer[0] == '\r'))
+         continue;
+      cif = !strncmp(buffer, "data_", 5);
+      break;
+   }
+   ZClose(fp);
+
+   return(cif);
+}
+
+
+/************************************************************************/
+/*>PDB *FindResidueChain(PDB *pdb, char *chain, int resnum, char insert)
+   ---------------------------------------------------------------------
+   As FindResidue() but the chain is a string so that multi-character
+   chain IDs from mmCIF may be used
+
+   18.10.26 Original   By: agent
+*/
+PDB *FindResidueChain(PDB *pdb, char *chain, int resnum, char insert)
+{
+   PDB *p;
+
+   for(p=pdb; p!=NULL; NEXT(p))
+   {
+      if((p->resnum == resnum) && (p->insert[0] == insert) &&
+         !strcmp(p->chain, chain))
+         return(p);
+   }
+
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>static BOOL FillCIFAtom(PDB *p, char **col)
+   -------------------------------------------
+   Fills in a PDB record from the columns of an _atom_site row
+
+   18.10.26 Original   By: agent
+*/
+static BOOL FillCIFAtom(PDB *p, char **col)
+{
+   char *atom  = col[CIF_AATOM] ? col[CIF_AATOM] : col[CIF_LATOM],
+        *resnam= col[CIF_ACOMP] ? col[CIF_ACOMP] : col[CIF_LCOMP],
+        *chain = col[CIF_AASYM] ? col[CIF_AASYM] : col[CIF_LASYM],
+        *seq   = CIFNULL(col[CIF_ASEQ]) ? col[CIF_LSEQ] : col[CIF_ASEQ];
+   int  len;
+
+   if((atom == NULL) || (col[CIF_X] == NULL) || (col[CIF_Y] == NULL) ||
+      (col[CIF_Z] == NULL) || CIFNULL(seq))
+      return(FALSE);
+
+   SetString(p->record_type, 
+             (col[CIF_GROUP] && !strcmp(col[CIF_GROUP], "HETATM")) ?
+             "HETATM" : "ATOM  ", 8);
+   
+   p->atnum  = col[CIF_ID] ? atoi(col[CIF_ID]) : 0;
+   p->resnum = atoi(seq);
+   p->x      = CIFReal(col[CIF_X]);
+   p->y      = CIFReal(col[CIF_Y]);
+   p->z      = CIFReal(col[CIF_Z]);
+   p->occ    = CIFNULL(col[CIF_OCC])  ? (REAL)1.0 
+                                      : CIFReal(col[CIF_OCC]);
+   p->bval   = CIFNULL(col[CIF_BVAL]) ? (REAL)0.0 
+                                      : CIFReal(col[CIF_BVAL]);
+   p->altpos = CIFNULL(col[CIF_ALT])  ? ' ' : col[CIF_ALT][0];
+   p->insert[0] = CIFNULL(col[CIF_INSERT]) ? ' ' : col[CIF_INSERT][0];
+   p->insert[1] = '\0';
+
+   SetString(p->chain, CIFNULL(chain) ? " " : chain, MAXCIFCHAIN);
+
+   /* Names are padded to 4 characters as ReadPDB() does               */
+   SetString(p->resnam, CIFNULL(resnam) ? "UNK" : resnam, 5);
+   for(len=strlen(p->resnam); len<4; len++)
+      p->resnam[len] = ' ';
+   p->resnam[4] = '\0';
+   
+   SetString(p->atnam, atom, 5);
+   for(len=strlen(p->atnam); len<4; len++)
+      p->atnam[len] = ' ';
+   p->atnam[4] = '\0';
+
+   /* The raw name is as it would appear in a PDB file: names of atoms
+      with a 1-letter element start in the second column
+   */
+   len = strlen(atom);
+   if((len < 4) && 
+      ((col[CIF_TYPE] == NULL) || (strlen(col[CIF_TYPE]) < 2)))
+   {
+      p->atnam_raw[0] = ' ';
+      SetString(p->atnam_raw+1, atom, 4);
+   }
+   else
+   {
+      SetString(p->atnam_raw, atom, 5);
+   }
+   for(len=strlen(p->atnam_raw); len<4; len++)
+      p->atnam_raw[len] = ' ';
+   p->atnam_raw[4] = '\0';
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static int SplitCIFRow(char *line, char **tokens, int maxtok)
+   -------------------------------------------------------------
+   Splits a line of an mmCIF loop into tokens in place. Tokens are
+   separated by white space and may be quoted with ' or " (a quote only
+   ends a token if followed by white space). Returns the number of 
+   tokens.
+
+   18.10.26 Original   By: agent
+*/
+static int SplitCIFRow(char *line, char **tokens, int maxtok)
+{
+   int  n = 0;
+   char *p = line,
+        quote;
+
+   while(*p && (n < maxtok))
+   {
+      while((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))
+         p++;
+      if(*p == '\0')
+         break;
+
+      if((*p == '\'') || (*p == '"'))
+      {
+         quote = *(p++);
+         tokens[n++] = p;
+         while(*p && !((*p == quote) && 
+                       ((p[1] == ' ') || (p[1] == '\t') || 
+                        (p[1] == '\n') || (p[1] == '\r') || 
+                        (p[1] == '\0'))))
+            p++;
+      }
+      else
+      {
+         tokens[n++] = p;
+         while(*p && (*p != ' ') && (*p != '\t') && 
+               (*p != '\n') && (*p != '\r'))
+            p++;
+      }
+      
+      if(*p)
+         *(p++) = '\0';
+   }
+
+   return(n);
+}
+
+
+/************************************************************************/
+/*>static int CIFColumn(char *tag)
+   -------------------------------
+   Returns the column number for an _atom_site tag (without the
+   _atom_site. prefix) or -1 if it isn't used
+
+   18.10.26 Original   By: agent
+*/
+static int CIFColumn(char *tag)
+{
+   static char *tags[NCIFCOL] = 
+   {
+      "group_PDB",     "id",            "type_symbol",   "label_atom_id",
+      "label_alt_id",  "label_comp_id", "label_asym_id", "label_seq_id",
+      "pdbx_PDB_ins_code", "Cartn_x",   "Cartn_y",       "Cartn_z",
+      "occupancy",     "B_iso_or_equiv", "auth_seq_id",  "auth_comp_id",
+      "auth_asym_id",  "auth_atom_id",  "pdbx_PDB_model_num"
+   };
+   int i;
+
+   /* Strip trailing white space                                        */
+   for(i=strlen(tag)-1; (i>=0) && ((tag[i] == ' ') || (tag[i] == '\r')); 
+       i--)
+      tag[i] = '\0';
+   
+   for(i=0; i<NCIFCOL; i++)
+   {
+      if(!strcmp(tag, tags[i]))
+         return(i);
+   }
+
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>static void SetString(char *dest, char *src, int len)
+   -----------------------------------------------------
+   Copies at most len-1 characters and terminates the string
+
+   18.10.26 Original   By: agent
+*/
+static void SetString(char *dest, char *src, int len)
+{
+   strncpy(dest, src, len-1);
+   dest[len-1] = '\0';
+}
+
+
+/************************************************************************/
+/*>static REAL CIFReal(char *str)
+   ------------------------------
+   Reads a plain decimal number as used for coordinates without going
+   through strtod(). Anything else (e.g. an exponent or too many 
+   digits) is passed to strtod().
+
+   18.10.26 Original   By: agent
+*/
+static REAL CIFReal(char *str)
+{
+   static double scale[] = {1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 
+                            1e7, 1e8, 1e9};
+   char   *p   = str;
+   BOOL   neg  = FALSE;
+   long   ival = 0,
+          fval = 0;
+   int    nfrac = 0;
+   double val;
+
+   if(*p == '-')
+   {
+      neg = TRUE;
+      p++;
+   }
+   else if(*p == '+')
+   {
+      p++;
+   }
+
+   while((*p >= '0') && (*p <= '9') && (ival < 100000000L))
+      ival = 10*ival + (*(p++) - '0');
+   if(*p == '.')
+   {
+      p++;
+      while((*p >= '0') && (*p <= '9') && (nfrac < 9))
+      {
+         fval = 10*fval + (*(p++) - '0');
+         nfrac++;
+      }
+   }
+   if(*p != '\0')
+      return((REAL)strtod(str, NULL));
+
+   /* Both parts are exact so the division is correctly rounded as
+      with strtod()
+   */
+   val = ((double)ival * scale[nfrac] + (double)fval) / scale[nfrac];
+   return((REAL)(neg ? -val : val));
+}
@@ -0,0 +1,79 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       cifread.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Streaming mmCIF coordinate reader
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   ReadMMCIF() reads the _atom_site loop of an mmCIF file into the same
+   PDB linked list as ReadPDB(). The file is read a line at a time and
+   each row is split in place, so memory use is just the atoms kept.
+   Reading stops at the end of the _atom_site loop. As with ReadPDB(),
+   only the first model is read.
+
+   The author (auth_*) chain, residue number, residue name and atom
+   name are used where present, otherwise the label_* ones. Chain IDs
+   of up to MAXCIFCHAIN-1 characters are kept whole and residue numbers
+   are not limited to 4 digits, so FindResidueChain() should be used to
+   look up residues by chain.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _CIFREAD_H
+#define _CIFREAD_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "bioplib/pdb.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXCIFCHAIN 8         /* Size of the chain field in a PDB record */
+
+/************************************************************************/
+/* Prototypes
+*/
+PDB *ReadMMCIF(FILE *fp, int *natoms);
+BOOL IsMMCIF(char *filename);
+PDB *FindResidueChain(PDB *pdb, char *chain, int resnum, char insert);
+
+#endif
@@ -0,0 +1,272 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       ecalcrun.c
+
+   Version:    V1.2
+   Date:       18.10.26
+   Function:   Run ecalc jobs concurrently with timeouts
+
+   Copyright:  (c) agent 2026
+               Code moved from ehb2.c is (c) Dr. Andrew C. R.
+               Martin
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See ecalcrun.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - ParseECalcOutput() moved from ehb2.c
+                    By: agent
+   V1.1  18.10.26   The process handling is shared with hbplusrun.c in
+                    jobrun.c   By: agent
+   V1.2  18.10.26   Corrected the ParseECalcOutput() comment   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bioplib/macros.h"
+#include "ecalcrun.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXBUFF  256
+
+/************************************************************************/
+/* Prototypes
+*/
+static void ExecECalc(void *data);
+static BOOL CollectECalc(void *data, int status);
+static void RemoveJobFiles(void *data);
+
+/************************************************************************/
+/* Globals
+*/
+static JOBTYPE sECalcType = {ExecECalc, CollectECalc, RemoveJobFiles};
+
+
+/************************************************************************/
+/*>ECALCRUN *CreateECalcRunner(int MaxJobs, REAL Timeout, int MaxTries)
+   --------------------------------------------------------------------
+   Creates a runner for up to MaxJobs concurrent ecalc jobs. Timeout is
+   the wall clock limit for one run in seconds (0 for none) and 
+   MaxTries the number of times a job is run before giving up. 
+   Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+ECALCRUN *CreateECalcRunner(int MaxJobs, REAL Timeout, int MaxTries)
+{
+   ECALCRUN *run;
+
+   if((run = (ECALCRUN *)malloc(sizeof(ECALCRUN)))==NULL)
+      return(NULL);
+
+   if((run->Runner = CreateJobRunner(ERUN_PROG, &sECalcType, MaxJobs, 
+                                     Timeout, MaxTries))==NULL)
+   {
+      free(run);
+      return(NULL);
+   }
+
+   return(run);
+}
+
+
+/************************************************************************/
+/*>void FreeECalcRunner(ECALCRUN *run)
+   -----------------------------------
+   Kills any jobs which are still running, removes their files and 
+   frees the runner
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+void FreeECalcRunner(ECALCRUN *run)
+{
+   if(run == NULL)
+      return;
+
+   FreeJobRunner(run->Runner);
+   free(run);
+}
+
+
+/************************************************************************/
+/*>BOOL StartECalcJob(ECALCRUN *run, int id, char *ControlFile,
+                      char *PDBFile, char *EnergyFile)
+   ------------------------------------------------------------
+   Starts ecalc on a control file which the caller has written (with
+   its PDB file). The output goes to EnergyFile. The runner takes 
+   charge of the three files and deletes them when the job is 
+   finished. There must be a free slot (see ECalcRunnerFull()). 
+   Returns FALSE if ecalc could not be started.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+BOOL StartECalcJob(ECALCRUN *run, int id, char *ControlFile,
+                   char *PDBFile, char *EnergyFile)
+{
+   ECALCJOB *job;
+
+   if((job = (ECALCJOB *)malloc(sizeof(ECALCJOB)))==NULL)
+      return(FALSE);
+
+   snprintf(job->ControlFile, ERUN_MAXFILE, "%s", ControlFile);
+   snprintf(job->PDBFile,     ERUN_MAXFILE, "%s", PDBFile);
+   snprintf(job->EnergyFile,  ERUN_MAXFILE, "%s", EnergyFile);
+   job->Energy = ERUN_FAILED;
+
+   if(!StartJob(run->Runner, id, job->ControlFile, job))
+   {
+      free(job);
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL NextECalcResult(ECALCRUN *run, int *id, REAL *energy)
+   ----------------------------------------------------------
+   Waits for the next job to finish. Failed runs are retried. Returns
+   FALSE if there are no jobs running; otherwise the job's identifier
+   is returned in id and its energy in energy (ERUN_FAILED if every 
+   try failed).
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+BOOL NextECalcResult(ECALCRUN *run, int *id, REAL *energy)
+{
+   void *data;
+   BOOL ok;
+
+   if(!NextJobResult(run->Runner, id, &data, &ok))
+      return(FALSE);
+
+   *energy = ok ? ((ECALCJOB *)data)->Energy : ERUN_FAILED;
+   free(data);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>REAL ParseECalcOutput(char *EnergyFile)
+   ---------------------------------------
+   Extracts the energy from the ecalc output. Returns ERUN_FAILED if 
+   the file could not be read or held no energy.
+
+   06.02.03 Original   By: ACRM
+   18.10.26 Closes the file. Checks that the energy was read   By: agent
+   18.10.26 Comment says ERUN_FAILED   By: agent
+*/
+REAL ParseECalcOutput(char *EnergyFile)
+{
+   FILE *fp;
+   char buffer[MAXBUFF];
+   REAL energy = ERUN_FAILED;
+   
+   if((fp=fopen(EnergyFile, "r"))!=NULL)
+   {
+      if((fgets(buffer, MAXBUFF, fp) == NULL) ||
+         (fgets(buffer, MAXBUFF, fp) == NULL) ||
+         (sscanf(buffer,"%*s %*s %*s %*s %lf", &energy) != 1))
+         energy = ERUN_FAILED;
+      fclose(fp);
+   }
+   
+   return(energy);
+}
+
+
+/************************************************************************/
+/*>static void ExecECalc(void *data)
+   ---------------------------------
+   Runs in the child: execs ecalc on a job's control file with its 
+   output going to the energy file
+
+   18.10.26 Original   (from LaunchJob())   By: agent
+*/
+static void ExecECalc(void *data)
+{
+   ECALCJOB *job = (ECALCJOB *)data;
+   int      fd;
+
+   if((fd = open(job->EnergyFile, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0)
+      _exit(127);
+   dup2(fd, 1);
+   close(fd);
+   execlp(ERUN_PROG, ERUN_PROG, job->ControlFile, (char *)NULL);
+}
+
+
+/************************************************************************/
+/*>static BOOL CollectECalc(void *data, int status)
+   ------------------------------------------------
+   A try succeeded if ecalc exited cleanly and its energy can be read
+
+   18.10.26 Original   (from NextECalcResult())   By: agent
+*/
+static BOOL CollectECalc(void *data, int status)
+{
+   ECALCJOB *job = (ECALCJOB *)data;
+
+   if(!WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+      return(FALSE);
+   job->Energy = ParseECalcOutput(job->EnergyFile);
+   return(job->Energy != ERUN_FAILED);
+}
+
+
+/************************************************************************/
+/*>static void RemoveJobFiles(void *data)
+   --------------------------------------
+   Deletes the files for a job
+
+   18.10.26 Original   By: agent
+   18.10.26 Called by the JOBRUN   By: agent
+*/
+static void RemoveJobFiles(void *data)
+{
+   ECALCJOB *job = (ECALCJOB *)data;
+
+   unlink(job->ControlFile);
+   unlink(job->PDBFile);
+   unlink(job->EnergyFile);
+}
@@ -0,0 +1,107 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       ecalcrun.h
+
+   Version:    V1.2
+   Date:       18.10.26
+   Function:   Run ecalc jobs concurrently with timeouts
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Runs up to a given number of ecalc processes at once through a 
+   job runner (jobrun.c). Each job has its own control, PDB and output
+   files. The caller writes these and then hands them to 
+   StartECalcJob(). ecalc is started with exec() (no shell) with its 
+   output redirected to the energy file. A job that times out, is 
+   killed by a signal, exits with non-zero status or gives unreadable
+   output is re-run up to MaxTries times in all. The job's files are
+   deleted once it is finished.
+
+**************************************************************************
+
+   Usage:
+   ======
+   run = CreateECalcRunner(MaxJobs, Timeout, MaxTries);
+   ...write the files for bond i...
+   if(ECalcRunnerFull(run)) NextECalcResult(run, &id, &energy);
+   StartECalcJob(run, i, ControlFile, PDBFile, EnergyFile);
+   ...
+   while(NextECalcResult(run, &id, &energy)) ...
+   FreeECalcRunner(run);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   The process handling is shared with hbplusrun.c in
+                    jobrun.c   By: agent
+   V1.2  18.10.26   Added ERUN_TRIES   By: agent
+
+*************************************************************************/
+#ifndef _ECALCRUN_H
+#define _ECALCRUN_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "jobrun.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define ERUN_MAXFILE 160            /* Max length of a job file name    */
+#define ERUN_FAILED  (REAL)-99999.999 /* Energy of a job which failed   */
+#define ERUN_PROG    "ecalc"
+#define ERUN_TRIES   2              /* Default runs of a failed job     */
+
+#define ECalcRunnerFull(run) JobRunnerFull((run)->Runner)
+#define ECalcRunnerBusy(run) JobRunnerBusy((run)->Runner)
+
+typedef struct
+{
+   char   ControlFile[ERUN_MAXFILE],
+          PDBFile[ERUN_MAXFILE],
+          EnergyFile[ERUN_MAXFILE];
+   REAL   Energy;                   /* Result of the last try           */
+}  ECALCJOB;
+
+typedef struct
+{
+   JOBRUN   *Runner;
+}  ECALCRUN;
+
+/************************************************************************/
+/* Prototypes
+*/
+ECALCRUN *CreateECalcRunner(int MaxJobs, REAL Timeout, int MaxTries);
+void FreeECalcRunner(ECALCRUN *run);
+BOOL StartECalcJob(ECALCRUN *run, int id, char *ControlFile,
+                   char *PDBFile, char *EnergyFile);
+BOOL NextECalcResult(ECALCRUN *run, int *id, REAL *energy);
+REAL ParseECalcOutput(char *EnergyFile);
+
+#endif
@@ -3,8 +3,8 @@
    Program:    ehb
    File:       ehb.c
    
-   Version:    V1.0
-   Date:       04.01.95
+   Version:    V1.19
+   Date:       18.10.26
    Function:   Calculate the hydrogen bond energy from the output of
                HBPlus
    
@@ -41,24 +41,122 @@
    Simple program to calculate the hydrogen bond energy using a list
    of HBonds as generated using the HBPlus program
 
+   Compile with -DFLOAT_KERNEL to hold the HBond geometry in single
+   precision and score it with the float kernel. HBPlus only gives
+   distances to 2 decimal places and angles to 1 so nothing is lost in
+   storage. Use -V to check the deviation on a given data set.
+
 **************************************************************************
 
    Usage:
    ======
-   ehb pdbfile
+   ehb [-V] [-x resid[,resid...] [-s file.hb2]] [--top K] [--below E]
+       [--hbstats file] [--matrix file] file.hb2
+   ehb -t [-p nthreads] [-l skin] [--stats] traj.pdb
+   ehb -t [-p nthreads] [-l skin] [--stats] topology.pdb traj.dcd
+   ehb -b|-i [--shard i/N] [--partial file] [--journal file]
+             [--top K] [--below E] [--hbstats file]
+             [-p nthreads [--readers n] [--iodepth n] [--stats]]
+             file.hb2 [file.hb2 ...]
+   ehb --diff ref.hb2 file.hb2 [file.hb2 ...]
+   ehb merge [-p merged] partial [partial ...]
+   ehb hbstats [-H] [-o merged] stats [stats ...]
+   ehb run [-i] [-j njobs] [--timeout secs] [--tries n] [--hbplus prog]
+           [--shard i/N] [--partial file] [--journal file]
+           [--top K] [--below E] [--hbstats file] file.pdb [file.pdb ...]
 
 **************************************************************************
 
    Revision History:
    =================
    V1.0   04.01.94 Original
+   V1.1   18.10.26 Split EHBond() into a per-bond kernel with the
+                   parameter-dependent constants precalculated. Added
+                   the incremental evaluator (bonds indexed by residue,
+                   compensated running total) and the -x/-s options
+                   By: agent
+   V1.2   18.10.26 Added trajectory mode (-t). Donor/acceptor geometry
+                   is calculated directly from the coordinates of each
+                   frame of a multi-model PDB file or DCD trajectory
+                   and frames are scored in parallel   By: agent
+   V1.3   18.10.26 Trajectory mode keeps a Verlet list of donor/acceptor
+                   pairs which is only rebuilt when an atom has moved
+                   more than half the skin distance (-l)   By: agent
+   V1.4   18.10.26 Added the single precision kernel. Compiling with
+                   -DFLOAT_KERNEL stores the bond geometry as floats
+                   and scores it in float arithmetic with compensated
+                   double accumulation of the total. -V reports the
+                   deviation of the float kernel from the double one
+                   By: agent
+   V1.5   18.10.26 ReadHBonds() stores cos(DHA), calculated in batches
+                   with a vectorisable polynomial, instead of the DHA
+                   angle in radians. The angles are no longer converted
+                   to radians as nothing uses them in that form   By: agent
+   V1.6   18.10.26 Added interface mode (-i). Only inter-chain HBonds are
+                   scored and totals are given for each pair of chains.
+                   Any number of HBPlus files (e.g. docking poses) may be
+                   given   By: agent
+   V1.7   18.10.26 Added batch mode (-b) giving the total for each of a
+                   list of HBPlus files. Batch and interface runs may 
+                   be split with --shard i/N and write a partial result
+                   file with --partial; 'ehb merge' combines them 
+                   (batch.c)   By: agent
+   V1.8   18.10.26 Batch and interface runs may keep a journal of the
+                   files done (--journal) and skip them when restarted
+                   (journal.c)   By: agent
+   V1.9   18.10.26 -p with -b or -i runs batch and interface modes as a
+                   pipeline of reader threads, compute threads and a 
+                   single writer connected by bounded lock-free queues
+                   (lfqueue.c). Added --readers and --stats   By: agent
+   V1.10  18.10.26 Pipeline readers read the files through io_uring 
+                   (bulkread.c) with up to --iodepth files in flight,
+                   falling back to blocking reads by a pool of reader
+                   threads where io_uring is not available. The HBPlus
+                   parser is ParseHBonds() which reads a FILE so that
+                   files in memory may be parsed with fmemopen()   By: agent
+   V1.11  18.10.26 HBPlus files may be gzip or zstd compressed 
+                   (zread.c)   By: agent
+   V1.12  18.10.26 Added 'ehb run' which runs HBPlus on a list of PDB 
+                   files, up to -j at a time, each in its own scratch
+                   directory (hbplusrun.c), and scores the output from
+                   memory as -b or -i would   By: agent
+   V1.13  18.10.26 Added bond queries. --top K lists the K strongest 
+                   bonds of a file or of a whole -b or run data set 
+                   using a bounded heap, and --below E lists the bonds
+                   with an energy <= E. ReadHBonds() also keeps the 
+                   residue names   By: agent
+   V1.14  18.10.26 Added --hbstats which collects mergeable histograms 
+                   and quantile sketches of the energy and geometry for
+                   each donor/acceptor class as the energy is 
+                   calculated (hbstats.c), and 'ehb hbstats' which 
+                   combines the files from the shards of a run   By: agent
+   V1.15  18.10.26 Added --matrix which writes the residue x residue 
+                   HBond energy matrix in binary CSR form (resmatrix.c)
+                   By: agent
+   V1.16  18.10.26 Added --diff which joins the bonds of each file with
+                   those of a reference through a hash table and lists
+                   the bonds gained, lost and changed   By: agent
+   V1.17  18.10.26 The energy kernel, parameters and the assignment of
+                   donors and acceptors in trajectory mode are those 
+                   shared with ehb2 and ehb3 (hbenergy.c)   By: agent
+   V1.18  18.10.26 --stats with -t reports how often the pair lists were
+                   built   By: agent
+   V1.19  18.10.26 The Usage for 'ehb run' says that it only scores as
+                   -b or -i would and that the .h file is not kept
+                   By: agent
 
 *************************************************************************/
 /* Includes
 */
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "bioplib/SysDefs.h"
 #include "bioplib/MathType.h"
@@ -67,46 +165,332 @@
 #include "bioplib/general.h"
 #include "bioplib/fsscanf.h"
 
+#include "batch.h"
+#include "journal.h"
+#include "lfqueue.h"
+#include "bulkread.h"
+#include "zread.h"
+#include "hbplusrun.h"
+#include "hbstats.h"
+#include "resmatrix.h"
+#include "hbenergy.h"
+#include "ehbutil.h"
+
 /************************************************************************/
 /* Defines and macros
 */
 #define MAXHBOND 10000
 #define MAXBUFF  160
+#define MAXXRES  64 /* Max residues which may be given with -x          */
 #define NSKIP    8  /* Number of header lines at start of HBPlus output */
+#define MAXTHREAD 256
+#define FRAMESPERTHREAD 64 /* Frames given to each thread per block     */
+#define DEFSKIN  1.0 /* Default Verlet list skin distance               */
+#define COSCHUNK 256 /* Angles converted to cosines per batch           */
+#define MAXCHAINPAIR 256 /* Max chain pairs in interface mode           */
+#define PIPEDEPTH 16 /* Capacity of the queues between pipeline stages  */
+#define IODEPTH   32 /* Default files in flight for each io_uring reader*/
+#define DIFFTOL   1.0e-6 /* Smaller changes in bond energy are ignored */
+
+/* Precision used to store the HBond geometry                          */
+#ifdef FLOAT_KERNEL
+typedef float HBREAL;
+#else
+typedef REAL  HBREAL;
+#endif
 
 typedef struct
 {
-   REAL CutOnHB,
-        CutOffHB,
-        CutOnHBAng,
-        CutOffHBAng;
-}  EPARAMS;
+   char   AtomD[8],
+          AtomA[8],
+          AtomH[8],
+          ResID_D[8],
+          ResID_A[8],
+          ResNam_D[4],
+          ResNam_A[4];
+   HBREAL DistDA,
+          AngDHA,          /* Angles are in degrees as given by HBPlus  */
+          CosDHA,          /* cos(AngDHA) - this is what is scored      */
+          DistHA,
+          AngHAAA,
+          AngDAAA;
+}  HBONDS;
 
+/* Incremental evaluator. Bonds are kept in slots which are chained
+   together per donor and per acceptor residue so that the bonds 
+   involving a residue may be found without scanning the whole list.
+   The running total is held as a Neumaier compensated sum.
+*/
 typedef struct
 {
-   char AtomD[8],
-        AtomA[8],
-        AtomH[8];
-   REAL DistDA,
-        AngDHA,
-        DistHA,
-        AngHAAA,
-        AngDAAA;
-}  HBONDS;
+   HBONDS  *HBonds;        /* Bond slots                                */
+   REAL    *Energy;        /* Energy of the bond in each slot           */
+   int     *ResD,          /* Residue index of donor for each slot      */
+           *ResA,          /* Residue index of acceptor for each slot   */
+           *NextD,         /* Next slot with the same donor residue     */
+           *NextA,         /* Next slot with the same acceptor residue  */
+           *FirstD,        /* First slot for each residue as donor      */
+           *FirstA;        /* First slot for each residue as acceptor   */
+   char    (*ResID)[8];    /* Residue hash table keys                   */
+   EPARAMS *eparams;
+   REAL    ETot,           /* Running total...                          */
+           EComp;          /* ...and its compensation term              */
+   int     MaxHBonds,
+           NSlots,         /* Slots used so far                         */
+           FreeSlot,       /* Head of list of released slots (via NextD)*/
+           HashSize,
+           NActive;
+}  EINCR;
+
+/* Atoms and donor/acceptor assignments for trajectory mode. These
+   are set up from the first model of a PDB file and do not change
+   between frames.
+*/
+typedef struct
+{
+   int  NAtoms,
+        NDonors,
+        NAcceptors,
+        *Donor,            /* Atom index of each donor                  */
+        *NH,               /* Number of hydrogens on each donor         */
+        (*DonorH)[MAXHPERD], /* Atom indices of those hydrogens         */
+        *Acceptor,         /* Atom index of each acceptor               */
+        *ResIndex;         /* Sequential residue number of each atom    */
+   char (*AtomName)[8],
+        (*ResID)[8];       /* HBPlus style residue ID of each atom      */
+}  TOPOLOGY;
+
+/* Per-thread work space for trajectory mode. Each thread keeps its own
+   Verlet list of donor/acceptor pairs within CutOffHB plus the skin
+   distance together with the coordinates at which it was built.
+*/
+typedef struct
+{
+   TOPOLOGY *topo;
+   EPARAMS  *eparams;
+   float    *xyz,          /* Coordinates of the first frame to score   */
+            *RefXYZ;       /* Coordinates when the pair list was built  */
+   REAL     *energy;       /* Energy for each frame                     */
+   int      NFrames,
+            MaxCells,
+            *CellHead,     /* Acceptor grid                             */
+            *CellNext,
+            NPairs,
+            MaxPairs,
+            *PairD,        /* Donor index of each listed pair           */
+            *PairA,        /* Acceptor index of each listed pair        */
+            NBuilds;       /* Number of times the list has been built   */
+   BOOL     HaveList;
+}  TRAJWORK;
+
+/* Interface mode total for one pair of chains (ChainX < ChainY)       */
+typedef struct
+{
+   REAL Energy,
+        EComp;
+   int  NHBonds;
+   char ChainX,
+        ChainY;
+}  CHAINPAIR;
+
+/* One file passing through the batch pipeline                          */
+typedef struct
+{
+   HBONDS    *HBonds;
+   CHAINPAIR Pairs[MAXCHAINPAIR];
+   REAL      Energy;
+   int       Seq,          /* Index of the file in the list             */
+             NHBonds,
+             NPairs;
+   BOOL      Done,         /* Already in the journal                    */
+             Error;        /* File could not be read                    */
+}  PIPEITEM;
+
+/* State shared by the pipeline threads                                 */
+typedef struct
+{
+   char       **Names;     /* Files to process                          */
+   BOOL       *Done;       /* Already in the journal                    */
+   EPARAMS    *eparams;
+   LFQUEUE    *Free,       /* Pool of unused items                      */
+              *ToCompute,  /* Readers -> compute threads                */
+              *ToWrite;    /* Compute threads -> writer                 */
+   PIPEITEM   EndMark;     /* Sent to the compute threads at the end    */
+   int        NNames,
+              NWorkers;
+   atomic_int NextName,    /* Next file for a reader to claim           */
+              NReadersLeft,
+              NUring,      /* Readers using io_uring                    */
+              NextStats,   /* Next of Stats for a compute thread        */
+              Abort;
+   HBSTATS    **Stats;     /* HBond statistics for each compute thread  */
+}  PIPELINE;
+
+/* Result of an 'ehb run' job waiting to be recorded in order           */
+typedef struct
+{
+   CHAINPAIR *Pairs;
+   REAL      Energy;
+   int       NHBonds,
+             NPairs;
+   BOOL      Finished,
+             Failed;       /* HBPlus failed                             */
+}  RUNRESULT;
+
+/* A bond found by a --top or --below query                             */
+typedef struct
+{
+   HBONDS Bond;
+   REAL   Energy;
+   int    Serial;          /* Number of the bond in its HBPlus file     */
+   char   File[MAXBUFF];
+}  BONDHIT;
+
+typedef struct
+{
+   BONDHIT *Hits;          /* Max-heap with the weakest kept bond at [0]*/
+   REAL    Below;
+   long    NBonds,         /* Bonds scored                              */
+           NMatch;         /* ...and within the threshold               */
+   int     K,              /* 0 to print bonds as they are found        */
+           NHits;
+   BOOL    UseBelow;
+}  BONDQUERY;
+
+/* Reference bonds for --diff, hashed on donor and acceptor residue and
+   atom
+*/
+typedef struct
+{
+   HBONDS *Bonds;
+   REAL   *Energy;
+   int    *Hash,           /* Open-addressed hash of bond indices       */
+          *Seen,           /* Last file in which each bond was matched  */
+          NBonds,
+          HashSize;
+}  BONDJOIN;
 
 /************************************************************************/
 /* Globals
 */
+BOOL gTrajectory = FALSE;
+BOOL gValidate   = FALSE;
+BOOL gInterface  = FALSE;
+BOOL gBatch      = FALSE;
+int  gShard      = 0;
+int  gNShards    = 1;
+char *gPartial   = NULL;
+char *gJournal   = NULL;
+int  gNThreads   = 0;
+int  gNReaders   = 1;
+BOOL gStats      = FALSE;
+int  gIODepth    = IODEPTH;
+REAL gSkin       = DEFSKIN;
+BOOL gRun        = FALSE;
+int  gNJobs      = 1;
+REAL gTimeout    = (REAL)0.0;
+int  gTries      = 2;
+char *gHBPlus    = HRUN_PROG;
+int  gTopK       = 0;
+BOOL gUseBelow   = FALSE;
+REAL gBelow      = (REAL)0.0;
+BONDQUERY *gQuery = NULL;
+char *gStatsFile = NULL;
+HBSTATS *gHBStats = NULL;
+char *gMatrixFile = NULL;
+char *gDiffRef   = NULL;
 
 /************************************************************************/
 /* Prototypes
 */
 int main(int argc, char **argv);
 int ReadHBonds(char *filename, HBONDS *HBonds);
-void SetDefaults(EPARAMS *eparams);
+int ReadHBondsBuffer(char *buffer, size_t size, char *name, 
+                     HBONDS *HBonds);
+int ParseHBonds(FILE *fp, HBONDS *HBonds);
 REAL EHBond(HBONDS *hbonds, int NHBonds, EPARAMS *eparams);
+REAL EHBondStats(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                 HBSTATS *stats);
+BOOL IsHBondRecord(HBONDS *hbond);
+REAL EOneHBond(HBONDS *hbond, EPARAMS *eparams);
+float EOneHBondF(HBONDS *hbond, EPARAMS *eparams);
+REAL BondEnergy(HBONDS *hbond, EPARAMS *eparams);
+void ValidatePrecision(HBONDS *HBonds, int NHBonds, EPARAMS *eparams);
+void VecCosDeg(REAL *deg, REAL *cosval, int n);
 void Usage(void);
-BOOL ParseCmdLine(int argc, char **argv, char *filename);
+BOOL ParseCmdLine(int argc, char **argv, char *filename, char *xres,
+                  char *subfile, char *trajfile, char ***files,
+                  int *NFiles);
+int DoTrajectory(char *topfile, char *trajfile, EPARAMS *eparams);
+BOOL ReadTopology(FILE *fp, TOPOLOGY *topo);
+void FreeTopology(TOPOLOGY *topo);
+BOOL ReadPDBFrame(FILE *fp, int NAtoms, float *xyz);
+BOOL OpenDCD(FILE *fp, int NAtoms, BOOL *swap, BOOL *UnitCell, 
+             BOOL *FourD);
+BOOL ReadDCDFrame(FILE *fp, int NAtoms, BOOL swap, BOOL UnitCell, 
+                  BOOL FourD, float *xyz, float *buffer);
+int ReadFortranRecord(FILE *fp, void *data, int maxlen, BOOL swap);
+void SwapBytes4(void *data, int n);
+void *TrajThread(void *arg);
+REAL FrameEnergy(TOPOLOGY *topo, float *xyz, EPARAMS *eparams, 
+                 TRAJWORK *work);
+BOOL ListNeedsRebuild(TOPOLOGY *topo, float *xyz, TRAJWORK *work);
+BOOL BuildPairList(TOPOLOGY *topo, float *xyz, REAL cutoff, 
+                   TRAJWORK *work);
+REAL ScorePairs(TOPOLOGY *topo, float *xyz, EPARAMS *eparams, 
+                TRAJWORK *work);
+BOOL BuildHBPlusResID(char *resspec, char *resid);
+int SplitResList(char *xres, char resids[][8], int maxres);
+EINCR *CreateIncremental(HBONDS *HBonds, int NHBonds, int MaxHBonds,
+                         EPARAMS *eparams);
+void FreeIncremental(EINCR *einc);
+REAL IncrementalTotal(EINCR *einc);
+REAL RemoveResidueBonds(EINCR *einc, char resids[][8], int NRes);
+REAL ReplaceResidueBonds(EINCR *einc, char resids[][8], int NRes,
+                         HBONDS *NewBonds, int NNew);
+BOOL AddIncrementalBond(EINCR *einc, HBONDS *hbond);
+int FindResIndex(EINCR *einc, char *resid, BOOL create);
+int DoBatch(char **files, int NFiles, HBONDS *HBonds, 
+            EPARAMS *eparams);
+void PrintInterface(BATCHREC *rec);
+BOOL RecordResult(BATCH *batch, JOURNAL *journal, char *filename,
+                  REAL energy, int NHBonds, CHAINPAIR *pairs, int NPairs);
+BOOL DoPipeline(char **files, int NFiles, EPARAMS *eparams, 
+                BATCH *batch, JOURNAL *journal);
+BOOL DoRun(char **files, int NFiles, HBONDS *HBonds, EPARAMS *eparams,
+           BATCH *batch, JOURNAL *journal, int *NFailed);
+BOOL GatherNames(char **files, int NFiles, JOURNAL *journal, 
+                 PIPELINE *pl);
+void FreeNames(PIPELINE *pl);
+void *PipeReader(void *arg);
+BOOL ClaimFile(PIPELINE *pl, PIPEITEM *item);
+void PipeReadBlocking(PIPELINE *pl);
+void PipeReadUring(PIPELINE *pl, BULKREAD *br);
+void *PipeWorker(void *arg);
+void PrintQueueStats(char *name, LFQUEUE *q);
+REAL InterfaceEnergy(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                     CHAINPAIR *pairs, int *NPairs);
+BONDQUERY *CreateBondQuery(int K, BOOL UseBelow, REAL Below);
+void FreeBondQuery(BONDQUERY *query);
+void QueryBonds(BONDQUERY *query, char *filename, HBONDS *HBonds, 
+                int NHBonds, EPARAMS *eparams);
+void PrintBondQuery(BONDQUERY *query);
+BOOL WriteEnergyMatrix(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                       char *filename);
+void PrintBondHit(BONDHIT *hit);
+int DoDiff(char *RefFile, char **files, int NFiles, HBONDS *HBonds,
+           EPARAMS *eparams);
+BONDJOIN *CreateBondJoin(HBONDS *HBonds, int NHBonds, EPARAMS *eparams);
+void FreeBondJoin(BONDJOIN *join);
+int FindJoinBond(BONDJOIN *join, HBONDS *hbond, int seen);
+unsigned long HashBondKey(HBONDS *hbond);
+BOOL SameBondKey(HBONDS *a, HBONDS *b);
+void DiffBonds(BONDJOIN *join, char *RefFile, char *filename, 
+               HBONDS *HBonds, int NHBonds, EPARAMS *eparams, int seen);
+void PrintDiffBond(char *label, HBONDS *hbond, REAL EOld, REAL ENew);
+int CompareHits(const void *a, const void *b);
+void SiftUpHit(BONDHIT *heap, int i);
+void SiftDownHit(BONDHIT *heap, int n, int i);
 
 /************************************************************************/
 /*>int main(int argc, char **argv)
@@ -114,22 +498,152 @@ BOOL ParseCmdLine(int argc, char **argv, char *filename);
    Main program to calculate HBond energy
 
    04.01.95 Original    By: ACRM
+   18.10.26 Added -x and -s handling via the incremental evaluator
+            By: agent
+   18.10.26 Added trajectory mode   By: agent
+   18.10.26 Added -V   By: agent
+   18.10.26 Added interface mode   By: agent
+   18.10.26 Added batch mode and the merge subcommand   By: agent
+   18.10.26 Added the run subcommand   By: agent
+   18.10.26 Added bond queries   By: agent
+   18.10.26 Added HBond statistics and the hbstats subcommand   By: agent
+   18.10.26 Added --matrix   By: agent
+   18.10.26 Added --diff   By: agent
 */
 int main(int argc, char **argv)
 {
    EPARAMS eparams;
    HBONDS  HBonds[MAXHBOND];
-   int     NHBonds;
+   int     NHBonds,
+           NFiles;
    REAL    HBondEnergy;
-   char    filename[MAXBUFF];
+   char    filename[MAXBUFF],
+           xres[MAXBUFF],
+           subfile[MAXBUFF],
+           trajfile[MAXBUFF],
+           **files;
 
-   if(ParseCmdLine(argc, argv, filename))
+   if((argc > 1) && !strcmp(argv[1], "merge"))
+      return(MergeMain(argc-1, argv+1, "ehb"));
+   if((argc > 1) && !strcmp(argv[1], "hbstats"))
+      return(HBStatsMain(argc-1, argv+1, "ehb"));
+
+   /* ehb run takes the same options as -b so is parsed in the same way */
+   if((argc > 1) && !strcmp(argv[1], "run"))
+   {
+      gRun = TRUE;
+      argc--;
+      argv++;
+   }
+
+   if(ParseCmdLine(argc, argv, filename, xres, subfile, trajfile,
+                   &files, &NFiles))
    {
       SetDefaults(&eparams);
-      NHBonds      = ReadHBonds(filename, HBonds);
-      HBondEnergy  = EHBond(HBonds, NHBonds, &eparams);
+      PrecalcParams(&eparams);
+
+      if((gTopK || gUseBelow) &&
+         ((gQuery = CreateBondQuery(gTopK, gUseBelow, gBelow))==NULL))
+      {
+         fprintf(stderr,"No memory for bond query\n");
+         return(1);
+      }
+      if((gStatsFile != NULL) &&
+         ((gHBStats = CreateHBStats(gShard, gNShards))==NULL))
+      {
+         fprintf(stderr,"No memory for HBond statistics\n");
+         return(1);
+      }
+
+      if(gTrajectory)
+         return(DoTrajectory(filename, trajfile, &eparams));
+
+      if(gDiffRef != NULL)
+         return(DoDiff(gDiffRef, files, NFiles, HBonds, &eparams));
+
+      if(gInterface || gBatch)
+         return(DoBatch(files, NFiles, HBonds, &eparams));
+      
+      if((NHBonds = ReadHBonds(filename, HBonds)) < 0)
+      {
+         fprintf(stderr,"Unable to read HBPlus file: %s\n", filename);
+         return(1);
+      }
+      HBondEnergy  = EHBondStats(HBonds, NHBonds, &eparams, gHBStats);
       
       printf("HBond energy = %f\n",HBondEnergy);
+
+      if(gHBStats != NULL)
+      {
+         PrintHBStats(stdout, gHBStats, FALSE);
+         if(!WriteHBStats(gHBStats, gStatsFile))
+            return(1);
+      }
+
+      if((gMatrixFile != NULL) && 
+         !WriteEnergyMatrix(HBonds, NHBonds, &eparams, gMatrixFile))
+         return(1);
+
+      if(gQuery != NULL)
+      {
+         QueryBonds(gQuery, filename, HBonds, NHBonds, &eparams);
+         PrintBondQuery(gQuery);
+      }
+
+      if(gValidate)
+         ValidatePrecision(HBonds, NHBonds, &eparams);
+
+      if(xres[0])
+      {
+         EINCR  *einc;
+         HBONDS *SubBonds = NULL;
+         char   resids[MAXXRES][8];
+         int    NRes,
+                NSub = 0;
+         REAL   NewEnergy;
+
+         if((NRes = SplitResList(xres, resids, MAXXRES))==0)
+         {
+            fprintf(stderr,"Invalid residue list: %s\n", xres);
+            return(1);
+         }
+         
+         if(subfile[0])
+         {
+            if((SubBonds=(HBONDS *)malloc(MAXHBOND*sizeof(HBONDS)))
+               ==NULL)
+            {
+               fprintf(stderr,"No memory for substitute HBonds\n");
+               return(1);
+            }
+            if((NSub = ReadHBonds(subfile, SubBonds)) < 0)
+            {
+               fprintf(stderr,"Unable to read HBPlus file: %s\n", 
+                       subfile);
+               return(1);
+            }
+         }
+
+         if((einc = CreateIncremental(HBonds, NHBonds, NHBonds+NSub,
+                                      &eparams))==NULL)
+         {
+            fprintf(stderr,"No memory for incremental evaluator\n");
+            return(1);
+         }
+
+         if(SubBonds != NULL)
+            NewEnergy = ReplaceResidueBonds(einc, resids, NRes, 
+                                            SubBonds, NSub);
+         else
+            NewEnergy = RemoveResidueBonds(einc, resids, NRes);
+         
+         printf("Modified energy = %f\n", NewEnergy);
+         printf("Delta = %f\n", NewEnergy - HBondEnergy);
+
+         FreeIncremental(einc);
+         if(SubBonds != NULL)
+            free(SubBonds);
+      }
    }
    else
    {
@@ -140,22 +654,173 @@ int main(int argc, char **argv)
 }
 
 /************************************************************************/
-/*>BOOL ParseCmdLine(int argc, char **argv, char *filename)
-   --------------------------------------------------------
+/*>BOOL ParseCmdLine(int argc, char **argv, char *filename, char *xres,
+                     char *subfile, char *trajfile, char ***files,
+                     int *NFiles)
+   --------------------------------------------------------------------
    Parse the command line.
    A very simple version, but allows for future expansion.
+   In interface and batch modes, files and NFiles are set to the list 
+   of HBPlus files.
 
    04.01.95 Original    By; ACRM
+   18.10.26 Added -x and -s   By: agent
+   18.10.26 Added -t and -p   By: agent
+   18.10.26 Added -l   By: agent
+   18.10.26 Added -V   By: agent
+   18.10.26 Added -i   By: agent
+   18.10.26 Added -b, --shard, --partial   By: agent
+   18.10.26 Added --journal   By: agent
+   18.10.26 Added --readers and --stats   By: agent
+   18.10.26 Added --iodepth   By: agent
+   18.10.26 Added run mode with -j, --timeout, --tries and --hbplus
+            By: agent
+   18.10.26 Added --top and --below   By: agent
+   18.10.26 Added --hbstats   By: agent
+   18.10.26 Added --matrix   By: agent
+   18.10.26 Added --diff   By: agent
 */
-BOOL ParseCmdLine(int argc, char **argv, char *filename)
+BOOL ParseCmdLine(int argc, char **argv, char *filename, char *xres,
+                  char *subfile, char *trajfile, char ***files,
+                  int *NFiles)
 {
    argc--;
    argv++;
+
+   xres[0]     = '\0';
+   subfile[0]  = '\0';
+   trajfile[0] = '\0';
    
-   while(argc && argv[0][0] == '-')
+   while(argc && argv[0][0] == '-' && argv[0][1])
    {
       switch(argv[0][1])
       {
+      case 'x':
+         argc--;
+         argv++;
+         if(!argc)
+            return(FALSE);
+         strncpy(xres, argv[0], MAXBUFF-1);
+         xres[MAXBUFF-1] = '\0';
+         break;
+      case 's':
+         argc--;
+         argv++;
+         if(!argc)
+            return(FALSE);
+         strncpy(subfile, argv[0], MAXBUFF-1);
+         subfile[MAXBUFF-1] = '\0';
+         break;
+      case 't':
+         gTrajectory = TRUE;
+         break;
+      case 'V':
+         gValidate = TRUE;
+         break;
+      case 'i':
+         gInterface = TRUE;
+         break;
+      case 'b':
+         gBatch = TRUE;
+         break;
+      case '-':
+         if(!strcmp(argv[0], "--stats"))
+         {
+            gStats = TRUE;
+            break;
+         }
+         if(argc < 2)
+            return(FALSE);
+         if(!strcmp(argv[0], "--shard"))
+         {
+            if(!ParseShard(argv[1], &gShard, &gNShards))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--partial"))
+         {
+            gPartial = argv[1];
+         }
+         else if(!strcmp(argv[0], "--journal"))
+         {
+            gJournal = argv[1];
+         }
+         else if(!strcmp(argv[0], "--readers"))
+         {
+            if(!sscanf(argv[1], "%d", &gNReaders) || (gNReaders < 1) ||
+               (gNReaders > MAXTHREAD))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--iodepth"))
+         {
+            if(!sscanf(argv[1], "%d", &gIODepth) || (gIODepth < 0) ||
+               (gIODepth > BR_MAXDEPTH))
+               return(FALSE);
+         }
+         else if(gRun && !strcmp(argv[0], "--timeout"))
+         {
+            if(!sscanf(argv[1], "%lf", &gTimeout) || (gTimeout < 0.0))
+               return(FALSE);
+         }
+         else if(gRun && !strcmp(argv[0], "--tries"))
+         {
+            if(!sscanf(argv[1], "%d", &gTries) || (gTries < 1))
+               return(FALSE);
+         }
+         else if(gRun && !strcmp(argv[0], "--hbplus"))
+         {
+            gHBPlus = argv[1];
+         }
+         else if(!strcmp(argv[0], "--top"))
+         {
+            if(!sscanf(argv[1], "%d", &gTopK) || (gTopK < 1))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--below"))
+         {
+            if(!sscanf(argv[1], "%lf", &gBelow))
+               return(FALSE);
+            gUseBelow = TRUE;
+         }
+         else if(!strcmp(argv[0], "--hbstats"))
+         {
+            gStatsFile = argv[1];
+         }
+         else if(!strcmp(argv[0], "--matrix"))
+         {
+            gMatrixFile = argv[1];
+         }
+         else if(!strcmp(argv[0], "--diff"))
+         {
+            gDiffRef = argv[1];
+         }
+         else
+         {
+            return(FALSE);
+         }
+         argc--;
+         argv++;
+         break;
+      case 'p':
+         argc--;
+         argv++;
+         if(!argc || !sscanf(argv[0], "%d", &gNThreads) || 
+            (gNThreads < 1) || (gNThreads > MAXTHREAD))
+            return(FALSE);
+         break;
+      case 'l':
+         argc--;
+         argv++;
+         if(!argc || !sscanf(argv[0], "%lf", &gSkin) || 
+            (gSkin < (REAL)0.0))
+            return(FALSE);
+         break;
+      case 'j':
+         argc--;
+         argv++;
+         if(!gRun || !argc || !sscanf(argv[0], "%d", &gNJobs) || 
+            (gNJobs < 1))
+            return(FALSE);
+         break;
       default:
          return(FALSE);
       }
@@ -164,8 +829,68 @@ BOOL ParseCmdLine(int argc, char **argv, char *filename)
       argv++;
    }
    
+   /* A trajectory may be given as a DCD file following the PDB file  */
+   if(gTrajectory && (argc == 2))
+   {
+      strcpy(trajfile, argv[1]);
+      argc--;
+   }
+   
+   /* Interface and batch modes take any number of HBPlus files        */
+   *files  = argv;
+   *NFiles = argc;
+
+   /* A query needs every bond of every file so can't resume from a 
+      journal. It is not defined for interfaces or trajectories
+   */
+   if((gTopK || gUseBelow) && 
+      (gInterface || gTrajectory || (gJournal != NULL)))
+      return(FALSE);
+
+   /* The same goes for HBond statistics                               */
+   if((gStatsFile != NULL) && 
+      (gInterface || gTrajectory || (gJournal != NULL)))
+      return(FALSE);
+
+   /* --diff compares any number of files with the reference and 
+      takes no other mode or output
+   */
+   if(gDiffRef != NULL)
+      return((argc >= 1) && !gRun && !gInterface && !gBatch && 
+             !gTrajectory && !gValidate && !xres[0] && 
+             (gNThreads == 0) && (gNShards == 1) && (gPartial == NULL) &&
+             (gJournal == NULL) && !gTopK && !gUseBelow && 
+             (gStatsFile == NULL) && (gMatrixFile == NULL));
+
+   /* The residue energy matrix is for a single structure             */
+   if((gMatrixFile != NULL) && 
+      (gRun || gInterface || gBatch || gTrajectory))
+      return(FALSE);
+
+   /* Run mode takes PDB files and is a batch run unless -i is given   */
+   if(gRun)
+   {
+      if((argc < 1) || gTrajectory || xres[0] || (gNThreads > 0) ||
+         (gInterface && gBatch))
+         return(FALSE);
+      gBatch = !gInterface;
+      return(TRUE);
+   }
+
+   if(gInterface || gBatch)
+      return((argc >= 1) && !gTrajectory && !xres[0] && 
+             !(gInterface && gBatch));
+
+   /* Sharding and partial results are only for lists of files         */
+   if((gNShards > 1) || (gPartial != NULL) || (gJournal != NULL))
+      return(FALSE);
+   
    if(argc != 1)
       return(FALSE);
+
+   /* -s only makes sense with -x                                       */
+   if(subfile[0] && !xres[0])
+      return(FALSE);
    
    strcpy(filename,argv[0]);
 
@@ -178,12 +903,172 @@ BOOL ParseCmdLine(int argc, char **argv, char *filename)
    Prints a usage message
 
    04.01.95 Original    By: ACRM
+   18.10.26 Added -x and -s   By: agent
+   18.10.26 Added -t and -p   By: agent
+   18.10.26 Added -l   By: agent
+   18.10.26 Added -V   By: agent
+   18.10.26 Added -i   By: agent
+   18.10.26 Added -b, --shard, --partial and merge   By: agent
+   18.10.26 Added --journal   By: agent
+   18.10.26 Added -p with -b/-i, --readers, --stats   By: agent
+   18.10.26 Added --iodepth   By: agent
+   18.10.26 Added run   By: agent
+   18.10.26 Added --top and --below   By: agent
+   18.10.26 Added --hbstats and hbstats   By: agent
+   18.10.26 Added --matrix   By: agent
+   18.10.26 Added --diff   By: agent
+   18.10.26 Added --stats with -t   By: agent
 */
 void Usage(void)
 {
-   fprintf(stderr,"\nEHB V1.0 (c) 1995, Dr. Andrew C.R. Martin, UCL.\n");
+   fprintf(stderr,"\nEHB V1.19 (c) 1995, Dr. Andrew C.R. Martin, UCL.\n");
+   fprintf(stderr,"V1.1 to V1.19 (c) 2026, agent\n");
 
-   fprintf(stderr,"\nUsage:  ehb file.hb2\n");
+   fprintf(stderr,"\nUsage:  ehb [-V] [-x resid[,resid...] [-s sub.hb2]] \
+[--top K] [--below E]\n");
+   fprintf(stderr,"            [--hbstats file] [--matrix file] \
+file.hb2\n");
+   fprintf(stderr,"        -V  Report the deviation of the single \
+precision kernel from\n");
+   fprintf(stderr,"            the double precision kernel\n");
+   fprintf(stderr,"        -x  Also report the energy with the HBonds \
+involving these\n");
+   fprintf(stderr,"            residues removed. Residues are given as \
+[c]nnn[i]\n");
+   fprintf(stderr,"        -s  Replace the removed HBonds with those \
+from this HBPlus file\n");
+   fprintf(stderr,"        --top   List the K strongest HBonds. With -b \
+or run, the K\n");
+   fprintf(stderr,"                strongest over all the files\n");
+   fprintf(stderr,"        --below List the HBonds with an energy <= E \
+(with --top, the\n");
+   fprintf(stderr,"                K strongest of these). Not with -i \
+or --journal\n");
+   fprintf(stderr,"        --hbstats Print the distributions of the \
+energy, D-A distance\n");
+   fprintf(stderr,"                  and D-H-A angle for each \
+donor/acceptor class and write\n");
+   fprintf(stderr,"                  them to this file for ehb hbstats. \
+With -b or run, over\n");
+   fprintf(stderr,"                  all the files. Not with -i or \
+--journal\n");
+   fprintf(stderr,"        --matrix  Write the donor x acceptor residue \
+HBond energy matrix\n");
+   fprintf(stderr,"                  to this file in binary CSR form \
+(see resmatread.h)\n");
+   fprintf(stderr,"\n        ehb -i file.hb2 [file.hb2 ...]\n");
+   fprintf(stderr,"        -i  Interface mode. Only HBonds between \
+different chains are\n");
+   fprintf(stderr,"            scored. The total and the energy for each \
+pair of chains are\n");
+   fprintf(stderr,"            printed for each file. A file name of - \
+reads the list of\n");
+   fprintf(stderr,"            files from standard input\n");
+   fprintf(stderr,"\n        ehb -b [--shard i/N] [--partial file] \
+[--journal file]\n");
+   fprintf(stderr,"               [-p nthreads [--readers n] \
+[--iodepth n] [--stats]]\n");
+   fprintf(stderr,"               [--top K] [--below E] \
+[--hbstats file]\n");
+   fprintf(stderr,"               file.hb2 [file.hb2 ...]\n");
+   fprintf(stderr,"        -b  Batch mode. The total energy of each \
+file and the total over\n");
+   fprintf(stderr,"            all files are printed\n");
+   fprintf(stderr,"        --shard   With -b or -i, only process the \
+files in shard i of N\n");
+   fprintf(stderr,"                  (0 <= i < N) as chosen by a hash \
+of the file name\n");
+   fprintf(stderr,"        --partial With -b or -i, also write the \
+results to this partial\n");
+   fprintf(stderr,"                  result file for ehb merge\n");
+   fprintf(stderr,"        --journal With -b or -i, record each file \
+as it is done in this\n");
+   fprintf(stderr,"                  journal. If the run is restarted \
+with the same journal,\n");
+   fprintf(stderr,"                  the files already done are \
+skipped\n");
+   fprintf(stderr,"        -p        With -b or -i, process the files \
+in a pipeline with\n");
+   fprintf(stderr,"                  this many compute threads\n");
+   fprintf(stderr,"        --readers Number of pipeline threads reading \
+files (Default: 1)\n");
+   fprintf(stderr,"        --iodepth Files each reader keeps in flight \
+with io_uring. 0 uses\n");
+   fprintf(stderr,"                  blocking reads (as does a system \
+without io_uring) and\n");
+   fprintf(stderr,"                  more --readers may then be needed \
+(Default: %d)\n", IODEPTH);
+   fprintf(stderr,"        --stats   Report the pipeline queue depths \
+at the end\n");
+   fprintf(stderr,"\n        ehb --diff ref.hb2 file.hb2 \
+[file.hb2 ...]\n");
+   fprintf(stderr,"            Compares the HBonds of each file with \
+those of ref.hb2 and\n");
+   fprintf(stderr,"            lists those gained, lost and changed \
+in energy, with the\n");
+   fprintf(stderr,"            change in energy of each and in total. \
+A file name of -\n");
+   fprintf(stderr,"            reads the list of files from standard \
+input\n");
+   fprintf(stderr,"\n        ehb merge [-p merged] partial \
+[partial ...]\n");
+   fprintf(stderr,"            Combines the partial result files from \
+all shards of a run\n");
+   fprintf(stderr,"            and prints the results. -p also writes \
+the merged results\n");
+   fprintf(stderr,"\n        ehb hbstats [-H] [-o merged] stats \
+[stats ...]\n");
+   fprintf(stderr,"            Combines the --hbstats files from all \
+shards of a run and\n");
+   fprintf(stderr,"            prints the statistics. -H also prints \
+the histograms and -o\n");
+   fprintf(stderr,"            writes the combined statistics\n");
+   fprintf(stderr,"\n        ehb run [-i] [-j njobs] [--timeout secs] \
+[--tries n] [--hbplus prog]\n");
+   fprintf(stderr,"                [--shard i/N] [--partial file] \
+[--journal file]\n");
+   fprintf(stderr,"                [--top K] [--below E] \
+[--hbstats file] file.pdb [file.pdb ...]\n");
+   fprintf(stderr,"            Runs HBPlus (prog -o file.pdb) on each \
+PDB file in its own\n");
+   fprintf(stderr,"            scratch directory and scores the .hb2 \
+output as -b (or -i)\n");
+   fprintf(stderr,"            would. The scratch directory is then \
+removed, .h file and\n");
+   fprintf(stderr,"            all, so the output can't be scored with \
+ehb2 or ehb3; run\n");
+   fprintf(stderr,"            HBPlus yourself for those. A file name \
+of - reads the list\n");
+   fprintf(stderr,"            of files from standard input\n");
+   fprintf(stderr,"        -j        Number of HBPlus jobs to run at \
+once (Default: 1)\n");
+   fprintf(stderr,"        --timeout Kill an HBPlus run after this many \
+seconds (Default: none)\n");
+   fprintf(stderr,"        --tries   Number of times to run HBPlus on a \
+file before giving\n");
+   fprintf(stderr,"                  up if it fails or times out \
+(Default: 2)\n");
+   fprintf(stderr,"        --hbplus  The HBPlus program (Default: \
+%s)\n", HRUN_PROG);
+   fprintf(stderr,"\n        ehb -t [-p nthreads] [-l skin] [--stats] \
+traj.pdb\n");
+   fprintf(stderr,"        ehb -t [-p nthreads] [-l skin] [--stats] \
+topology.pdb traj.dcd\n");
+   fprintf(stderr,"        -t  Trajectory mode. HBonds are found from \
+the coordinates of\n");
+   fprintf(stderr,"            each model of a PDB file (which must \
+include hydrogens) or\n");
+   fprintf(stderr,"            each frame of a DCD file, and the energy \
+of each frame is\n");
+   fprintf(stderr,"            printed\n");
+   fprintf(stderr,"        -p  Number of threads to use (Default: \
+number of CPUs)\n");
+   fprintf(stderr,"        -l  Skin distance for the donor/acceptor \
+pair list (Default: %.1f)\n", DEFSKIN);
+   fprintf(stderr,"            The list is rebuilt when an atom has moved \
+more than half this.\n");
+   fprintf(stderr,"        --stats Report how many times the pair \
+lists were built\n");
 
    fprintf(stderr,"\nCalculates the hydrogen bond energy from the list \
 of hydrogen bonds\n");
@@ -195,47 +1080,58 @@ Charmm and are\n");
 /************************************************************************/
 /*>int ReadHBonds(char *filename, HBONDS *HBonds)
    ----------------------------------------------
-   Reads the HBond list from HBPlus output
+   Reads the HBond list from HBPlus output. Returns -1 if the file 
+   cannot be opened or fails to decompress.
 
    04.01.95 Original    By: ACRM
+   18.10.26 Also stores the donor and acceptor residue IDs   By: agent
+   18.10.26 Reads via doubles so the geometry may be stored as floats
+            By: agent
+   18.10.26 Stores cos(DHA), calculated in batches of COSCHUNK. Angles
+            are left in degrees   By: agent
+   18.10.26 Parsing moved to ParseHBonds()   By: agent
+   18.10.26 May be compressed   By: agent
+   18.10.26 Returns -1 on failure   By: agent
 */
 int ReadHBonds(char *filename, HBONDS *HBonds)
 {
-   FILE *fp     = NULL;
-   int  NHBonds = 0,
-        i;
-   char buffer[MAXBUFF];
+   FILE *fp;
+   int  NHBonds = (-1);
    
-   /* Open the file for reading                                         */
-   if((fp=fopen(filename,"r"))!=NULL)
+   if((fp=ZOpen(filename))!=NULL)
    {
-      /* Skip the first NSKIP lines                                     */
-      for(i=0; i<NSKIP; i++)
-         fgets(buffer,MAXBUFF,fp);
+      NHBonds = ParseHBonds(fp, HBonds);
+      if(ZClose(fp))
+         NHBonds = (-1);
+   }
+   
+   return(NHBonds);
+}
 
-      while(fgets(buffer,MAXBUFF,fp))
-      {
-         fsscanf(buffer,"%10x%3s%11x%3s%5lf%13x%6lf%1x%5lf%6lf%6lf",
-                 HBonds[NHBonds].AtomD,
-                 HBonds[NHBonds].AtomA,
-                 &(HBonds[NHBonds].DistDA),
-                 &(HBonds[NHBonds].AngDHA),
-                 &(HBonds[NHBonds].DistHA),
-                 &(HBonds[NHBonds].AngHAAA),
-                 &(HBonds[NHBonds].AngDAAA));
 
-         HBonds[NHBonds].AngDHA  *= PI / (REAL)180.0;
-         HBonds[NHBonds].AngHAAA *= PI / (REAL)180.0;
-         HBonds[NHBonds].AngDAAA *= PI / (REAL)180.0;
-         
-         if((++NHBonds) >= MAXHBOND)
-         {
-            fprintf(stderr,"Too many HBonds, Increase MAXHBONDS\n");
-            return(0);
-         }
-      }
+/************************************************************************/
+/*>int ReadHBondsBuffer(char *buffer, size_t size, char *name, 
+                        HBONDS *HBonds)
+   ---------------------------------------------------------------
+   Reads the HBond list from HBPlus output which has already been read
+   into memory (e.g. by bulkread.c). It may be compressed. name is the
+   file name for messages. Returns -1 if it fails to decompress.
 
-      fclose(fp);
+   18.10.26 Original   By: agent
+   18.10.26 May be compressed   By: agent
+   18.10.26 Returns -1 on failure   By: agent
+*/
+int ReadHBondsBuffer(char *buffer, size_t size, char *name, 
+                     HBONDS *HBonds)
+{
+   FILE *fp;
+   int  NHBonds = (-1);
+   
+   if((fp=ZOpenBuffer(buffer, size, name))!=NULL)
+   {
+      NHBonds = ParseHBonds(fp, HBonds);
+      if(ZClose(fp))
+         NHBonds = (-1);
    }
    
    return(NHBonds);
@@ -243,18 +1139,75 @@ int ReadHBonds(char *filename, HBONDS *HBonds)
 
 
 /************************************************************************/
-/*>void SetDefaults(EPARAMS *eparams)
-   ----------------------------------
-   Sets default value for parameters.
+/*>int ParseHBonds(FILE *fp, HBONDS *HBonds)
+   -----------------------------------------
+   Parses the HBond list from HBPlus output
 
-   04.01.95 Original    By: ACRM
+   18.10.26 Original   (from ReadHBonds())   By: agent
+   18.10.26 Also stores the residue names   By: agent
 */
-void SetDefaults(EPARAMS *eparams)
+int ParseHBonds(FILE *fp, HBONDS *HBonds)
 {
-   eparams->CutOnHB         = 4.0;
-   eparams->CutOffHB        = 5.0;
-   eparams->CutOnHBAng      = 90.0 * PI / 180.0;
-   eparams->CutOffHBAng     = 90.0 * PI / 180.0;
+   int  NHBonds = 0,
+        NChunk  = 0,
+        i;
+   char buffer[MAXBUFF];
+   REAL DistDA,
+        AngDHA,
+        DistHA,
+        AngHAAA,
+        AngDAAA,
+        ChunkAng[COSCHUNK],
+        ChunkCos[COSCHUNK];
+   
+   /* Skip the first NSKIP lines                                        */
+   for(i=0; i<NSKIP; i++)
+      fgets(buffer,MAXBUFF,fp);
+
+   while(fgets(buffer,MAXBUFF,fp))
+   {
+      fsscanf(buffer,
+              "%6s%3s%1x%3s%1x%6s%3s%1x%3s%5lf%13x%6lf%1x%5lf%6lf%6lf",
+              HBonds[NHBonds].ResID_D,
+              HBonds[NHBonds].ResNam_D,
+              HBonds[NHBonds].AtomD,
+              HBonds[NHBonds].ResID_A,
+              HBonds[NHBonds].ResNam_A,
+              HBonds[NHBonds].AtomA,
+              &DistDA,
+              &AngDHA,
+              &DistHA,
+              &AngHAAA,
+              &AngDAAA);
+
+      HBonds[NHBonds].DistDA  = (HBREAL)DistDA;
+      HBonds[NHBonds].DistHA  = (HBREAL)DistHA;
+      HBonds[NHBonds].AngDHA  = (HBREAL)AngDHA;
+      HBonds[NHBonds].AngHAAA = (HBREAL)AngHAAA;
+      HBonds[NHBonds].AngDAAA = (HBREAL)AngDAAA;
+
+      /* Collect the DHA angles and find their cosines in batches       */
+      ChunkAng[NChunk++] = AngDHA;
+      if(NChunk == COSCHUNK)
+      {
+         VecCosDeg(ChunkAng, ChunkCos, NChunk);
+         for(i=0; i<NChunk; i++)
+            HBonds[NHBonds+1-NChunk+i].CosDHA = (HBREAL)ChunkCos[i];
+         NChunk = 0;
+      }
+      
+      if((++NHBonds) >= MAXHBOND)
+      {
+         fprintf(stderr,"Too many HBonds, Increase MAXHBONDS\n");
+         return(0);
+      }
+   }
+
+   VecCosDeg(ChunkAng, ChunkCos, NChunk);
+   for(i=0; i<NChunk; i++)
+      HBonds[NHBonds-NChunk+i].CosDHA = (HBREAL)ChunkCos[i];
+
+   return(NHBonds);
 }
 
 
@@ -262,178 +1215,3116 @@ void SetDefaults(EPARAMS *eparams)
 /*>REAL EHBond(HBONDS *HBonds, int NHBonds, EPARAMS *eparams)
    ----------------------------------------------------------
    Calculates the HBond energy from the list of hydrogen bonds and
-   supplied parameters
+   supplied parameters. PrecalcParams() must have been called.
 
    04.01.95 Original   Based on code from ECalc    By: ACRM
+   18.10.26 Per-bond calculation moved to EOneHBond()   By: agent
+   18.10.26 Uses the float kernel if compiled with FLOAT_KERNEL   By: agent
+   18.10.26 Uses BondEnergy() and always sums with CompensatedAdd()
+            By: agent
 */
 REAL EHBond(HBONDS *HBonds, int NHBonds, EPARAMS *eparams)
 {
-   REAL CutOnHBSq,
-        CutOffHBSq,
-        CutOnHBAngSq,
-        CutOffHBAngSq,
-        CosAng,
-        CosAngSq,
-        ETot,
-        EAng,
-        DistSq,
-        InvDistSq,
-        InvDist10,
-        energy,
-        ParamR10,
-        ParamR12,
-        Rul3,
-        Rul12,
-        Rua3,
-        Rua12,
-        RMin,
-        EMin;
-   int  i,
-        j;
+   REAL ETot  = (REAL)0.0,
+        EComp = (REAL)0.0;
+   int  i;
+
+   /* For each hydrogen bond                                            */
+   for(i=0; i<NHBonds; i++)
+      CompensatedAdd(&ETot, &EComp, BondEnergy(&(HBonds[i]), eparams));
+
+   return(ETot + EComp);
+}
+
+
+/************************************************************************/
+/*>REAL EHBondStats(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                    HBSTATS *stats)
+   ---------------------------------------------------------------
+   As EHBond() but also adds the energy and geometry of each HBond to
+   stats. The -1 records and blank lines in HBPlus output are left out.
+   If stats is NULL this is just EHBond().
 
-   ETot     = (REAL)0.0;
+   18.10.26 Original   By: agent
+   18.10.26 Blank records are left out   By: agent
+   18.10.26 Uses BondEnergy() and always sums with CompensatedAdd()
+            By: agent
+*/
+REAL EHBondStats(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                 HBSTATS *stats)
+{
+   REAL ETot  = (REAL)0.0,
+        EComp = (REAL)0.0,
+        energy;
+   int  i;
 
-   CutOnHBSq  = eparams->CutOnHB  * eparams->CutOnHB;
-   CutOffHBSq = eparams->CutOffHB * eparams->CutOffHB;
+   if(stats == NULL)
+      return(EHBond(HBonds, NHBonds, eparams));
 
-   if(CutOffHBSq != CutOnHBSq)
+   for(i=0; i<NHBonds; i++)
    {
-      Rul3  = (REAL)1.0/((CutOffHBSq - CutOnHBSq) * 
-                         (CutOffHBSq - CutOnHBSq) * 
-                         (CutOffHBSq - CutOnHBSq));
-      Rul12 = (REAL)12.0 * Rul3;
+      energy = BondEnergy(&(HBonds[i]), eparams);
+      CompensatedAdd(&ETot, &EComp, energy);
+      if(IsHBondRecord(&(HBonds[i])))
+         AddHBStat(stats, HBClass(HBonds[i].AtomD[0], HBonds[i].AtomA[0]),
+                   energy, (REAL)HBonds[i].DistDA, 
+                   (REAL)HBonds[i].AngDHA);
    }
+
+   return(ETot + EComp);
+}
+
+
+/************************************************************************/
+/*>BOOL IsHBondRecord(HBONDS *hbond)
+   ---------------------------------
+   Tests whether a parsed line of HBPlus output is a real HBond: not a
+   -1 record, nor a blank or short line which gives no donor or 
+   acceptor residue and a zero D-A distance.
+
+   18.10.26 Original   By: agent
+*/
+BOOL IsHBondRecord(HBONDS *hbond)
+{
+   return((hbond->DistHA >= 0.0)     &&
+          (hbond->DistDA >  0.0)     &&
+          (hbond->ResID_D[0] != '\0') &&
+          (hbond->ResID_A[0] != '\0'));
+}
+
+
+/************************************************************************/
+/*>REAL EOneHBond(HBONDS *hbond, EPARAMS *eparams)
+   -----------------------------------------------
+   Calculates the energy of a single hydrogen bond with EHBondGeom()
+   (hbenergy.c). PrecalcParams() must have been called.
+
+   18.10.26 Original   Split out of EHBond()   By: agent
+   18.10.26 Uses the shared kernel in hbenergy.c   By: agent
+*/
+REAL EOneHBond(HBONDS *hbond, EPARAMS *eparams)
+{
+   /* Check for -1 records in HBPlus output                             */
+   if(hbond->DistHA < 0.0)
+      return((REAL)0.0);
+
+   return(EHBondGeom(hbond->AtomD[0], hbond->AtomA[0], 
+                     (REAL)hbond->DistDA, (REAL)hbond->CosDHA, eparams));
+}
+
+
+/************************************************************************/
+/*>float EOneHBondF(HBONDS *hbond, EPARAMS *eparams)
+   -------------------------------------------------
+   Single precision version of EOneHBond(). All the arithmetic is done
+   in float. PrecalcParams() must have been called.
+
+   18.10.26 Original   By: agent
+*/
+float EOneHBondF(HBONDS *hbond, EPARAMS *eparams)
+{
+   float CosAng,
+         CosAngSq,
+         EAng,
+         DistSq,
+         InvDistSq,
+         InvDist10,
+         energy,
+         CutOnHBSq     = (float)eparams->CutOnHBSq,
+         CutOffHBSq    = (float)eparams->CutOffHBSq,
+         CutOnHBAngSq  = (float)eparams->CutOnHBAngSq,
+         CutOffHBAngSq = (float)eparams->CutOffHBAngSq;
+   int   class;
+
+   /* Check for -1 records in HBPlus output                             */
+   if(hbond->DistHA < 0.0f)
+      return(0.0f);
    
-   CutOnHBAngSq   = cos(eparams->CutOnHBAng);
-   CutOnHBAngSq  *= CutOnHBAngSq;
-   CutOffHBAngSq  = cos(eparams->CutOffHBAng);
-   CutOffHBAngSq *= CutOffHBAngSq;
+   DistSq = (float)hbond->DistDA * (float)hbond->DistDA;
+   if((DistSq == 0.0f) || (DistSq >= CutOffHBSq))
+      return(0.0f);
+   
+   InvDistSq = 1.0f / DistSq;
+   InvDist10 = InvDistSq * InvDistSq * InvDistSq * InvDistSq * InvDistSq;
+   
+   class  = HBClass(hbond->AtomD[0], hbond->AtomA[0]);
+   energy = ((float)eparams->ParamR12[class] * InvDistSq * InvDist10) - 
+            ((float)eparams->ParamR10[class] * InvDist10);
 
-   if(CutOffHBAngSq != CutOnHBAngSq)
+   if(DistSq > CutOnHBSq)
    {
-      Rua3  = (REAL)1.0/((CutOffHBAngSq - CutOnHBAngSq) * 
-                         (CutOffHBAngSq - CutOnHBAngSq) * 
-                         (CutOffHBAngSq - CutOnHBAngSq));
-      Rua12 = (REAL)12.0 * Rua3;
+      float DistFromOn  = CutOnHBSq  - DistSq,
+            DistFromOff = CutOffHBSq - DistSq;
+      
+      energy *= DistFromOff * DistFromOff * (float)eparams->Rul3 *
+                (DistFromOff - 3.0f * DistFromOn);
    }
+   
+   CosAng = (float)hbond->CosDHA;
+   if(CosAng <= -0.99999f)
+      CosAng = -0.99999f;
+   if(CosAng > 0.0f)
+      return(0.0f);
+   
+   CosAngSq = CosAng * CosAng;
+   if(CosAngSq <= CutOffHBAngSq)
+      return(0.0f);
 
-   /* For each hydrogen bond                                            */
-   for(i=0; i<NHBonds; i++)
+   EAng = CosAngSq * CosAngSq;
+   if(CosAngSq < CutOnHBAngSq)
    {
-      /* Check for -1 records in HBPlus output                          */
-      if(HBonds[i].DistHA >= 0.0)
-      {
-         DistSq = HBonds[i].DistDA * HBonds[i].DistDA;
-         
-         if(DistSq != (REAL)0.0)
-         {
-            /* If we're within the HBond cutoff, calculate energy       */
-            if(DistSq < CutOffHBSq)
-            {
-               InvDistSq = (REAL)1.0 / DistSq;
-               InvDist10 = InvDistSq * InvDistSq * InvDistSq * 
-                  InvDistSq * InvDistSq;
-               
-               /* Work out the parameters for this atom pair            
-                  Parameters are taken from Charmm/CONGEN
-               */
-               if((HBonds[i].AtomD[0] == 'N') &&
-                  (HBonds[i].AtomA[0] == 'N'))
-               {
-                  EMin = (REAL)(-3.0);
-                  RMin = (REAL)(3.0);
-               }
-               else if((HBonds[i].AtomD[0] == 'N') &&
-                       (HBonds[i].AtomA[0] == 'O'))
-               {
-                  EMin = (REAL)(-3.5);
-                  RMin = (REAL)(2.9);
-               }
-               else if((HBonds[i].AtomD[0] == 'O') &&
-                       (HBonds[i].AtomA[0] == 'N'))
-               {
-                  EMin = (REAL)(-4.0);
-                  RMin = (REAL)(2.85);
-               }
-               else if((HBonds[i].AtomD[0] == 'O') &&
-                       (HBonds[i].AtomA[0] == 'O'))
-               {
-                  EMin = (REAL)(-4.25);
-                  RMin = (REAL)(2.75);
-               }
-               else   /* This is a guess!                               */
-               {
-                  EMin = (REAL)(-3.0);
-                  RMin = (REAL)(3.0);
-               }
-
-               /* Convert EMin and RMin to the Param10 and Param12 
-                  values
-               */
-               ParamR10 = (EMin/(-(REAL)pow((double)5.0, (double)5.0)   /
-                                  (REAL)pow((double)6.0, (double)6.0))) *
-                          (REAL)pow((double)(RMin*RMin/(REAL)1.2),
-                                    (double)5.0);
-               ParamR12 = ParamR10 * RMin * RMin / (REAL)1.2;
-
-               energy = (ParamR12 * InvDistSq * InvDist10) - 
-                  (ParamR10 * InvDist10);
-               
-               /* If we're above the start of the smoothing range, 
-                  calculate the smoothing factor.
-               */
-               if(DistSq > CutOnHBSq)
-               {
-                  REAL DistFromOn,
-                       DistFromOff,
-                       Smoothing;
-                  
-                  DistFromOn  = CutOnHBSq  - DistSq;
-                  DistFromOff = CutOffHBSq - DistSq;
-                  
-                  Smoothing = DistFromOff * DistFromOff * Rul3 *
-                     (DistFromOff - (REAL)3.0 * DistFromOn);
-                  
-                  energy *= Smoothing;
-               }
-               
-               /* Calculate the angle contribution                      */
-               CosAng = (REAL)cos((double)HBonds[i].AngDHA);
-               if(CosAng <= (REAL)(-0.99999))
-                  CosAng = (REAL)(-0.99999);
-               
-               if(CosAng <= 0.0)
-               {
-                  CosAngSq = CosAng * CosAng;
-                  if(CosAngSq > CutOffHBAngSq)
-                  {
-                     EAng = CosAngSq * CosAngSq;
-                     
-                     if(CosAngSq < CutOnHBAngSq)
-                     {
-                        REAL AngFromOn,
-                             AngFromOff,
-                             Smoothing;
-                        
-                        AngFromOn  = CutOnHBAngSq  - CosAngSq;
-                        AngFromOff = CutOffHBAngSq - CosAngSq;
-                        Smoothing  = AngFromOff * AngFromOff * 
-                           Rua3 *
-                              (AngFromOff - (REAL)3.0 * AngFromOn);
-                        
-                        EAng *= Smoothing;
-                     }
-                     
-                     /* Add onto the total energy                       */
-                     ETot += (EAng * energy);
-                  }
-               }
-            }
-         }
-      }
+      float AngFromOn  = CutOnHBAngSq  - CosAngSq,
+            AngFromOff = CutOffHBAngSq - CosAngSq;
+      
+      EAng *= AngFromOff * AngFromOff * (float)eparams->Rua3 *
+              (AngFromOff - 3.0f * AngFromOn);
    }
 
-   return(ETot);
+   return(EAng * energy);
 }
 
 
+/************************************************************************/
+/*>REAL BondEnergy(HBONDS *hbond, EPARAMS *eparams)
+   ------------------------------------------------
+   Calculates the energy of a single hydrogen bond with EOneHBondF() if
+   compiled with FLOAT_KERNEL or EOneHBond() otherwise. Everything that
+   scores a bond should go through here.
+
+   18.10.26 Original   By: agent
+*/
+REAL BondEnergy(HBONDS *hbond, EPARAMS *eparams)
+{
+#ifdef FLOAT_KERNEL
+   return((REAL)EOneHBondF(hbond, eparams));
+#else
+   return(EOneHBond(hbond, eparams));
+#endif
+}
+
+
+/************************************************************************/
+/*>void ValidatePrecision(HBONDS *HBonds, int NHBonds, EPARAMS *eparams)
+   ---------------------------------------------------------------------
+   Scores every bond with both the double and float kernels and 
+   reports the largest per-bond deviation and the deviation of the
+   totals (the float total being accumulated with compensation as in
+   EHBond()).
+
+   18.10.26 Original   By: agent
+*/
+void ValidatePrecision(HBONDS *HBonds, int NHBonds, EPARAMS *eparams)
+{
+   REAL EDouble = (REAL)0.0,
+        EFloat  = (REAL)0.0,
+        EComp   = (REAL)0.0,
+        MaxDev  = (REAL)0.0,
+        MaxRel  = (REAL)0.0,
+        ed,
+        ef;
+   int  i,
+        worst   = (-1);
+   
+   for(i=0; i<NHBonds; i++)
+   {
+      ed = EOneHBond(&(HBonds[i]), eparams);
+      ef = (REAL)EOneHBondF(&(HBonds[i]), eparams);
+      EDouble += ed;
+      CompensatedAdd(&EFloat, &EComp, ef);
+      
+      if(ABS(ef - ed) > MaxDev)
+      {
+         MaxDev = ABS(ef - ed);
+         worst  = i;
+      }
+      if((ed != (REAL)0.0) && (ABS((ef - ed) / ed) > MaxRel))
+         MaxRel = ABS((ef - ed) / ed);
+   }
+   EFloat += EComp;
+
+#ifdef FLOAT_KERNEL
+   printf("Geometry is stored in single precision\n");
+#endif
+   printf("Max per-bond deviation = %g", MaxDev);
+   if(worst >= 0)
+      printf(" (HBond %d)", worst+1);
+   printf("\nMax relative deviation = %g\n", MaxRel);
+   printf("Total (double) = %.10f\n", EDouble);
+   printf("Total (float)  = %.10f\n", EFloat);
+   printf("Total deviation = %g\n", EFloat - EDouble);
+}
+
+
+/************************************************************************/
+/*>void VecCosDeg(REAL *deg, REAL *cosval, int n)
+   ----------------------------------------------
+   Calculates the cosines of n angles given in degrees. The angle is
+   folded into [0,180] (valid for |angle| <= 540, which covers all 
+   HBPlus output) and cos(x) is calculated as -sin(x - 90) using a
+   polynomial in (x-90) converted to radians. The loop has no calls or
+   branches so the compiler can vectorise it. Truncation error is 
+   below 1e-11. Any angle outside the valid range is then fixed up 
+   with cos().
+
+   18.10.26 Original   By: agent
+*/
+void VecCosDeg(REAL *deg, REAL *cosval, int n)
+{
+   const REAL DegToRad = PI / (REAL)180.0;
+   int        i;
+
+   for(i=0; i<n; i++)
+   {
+      REAL a, y, y2, s;
+      
+      a  = ABS(deg[i]);
+      a  = (a > (REAL)180.0) ? (REAL)360.0 - a : a;
+      y  = (a - (REAL)90.0) * DegToRad;
+      y2 = y * y;
+
+      /* sin(y) for y in [-PI/2, PI/2] - Taylor series to y^15          */
+      s = (REAL)(-1.0/1307674368000.0);
+      s = s * y2 + (REAL)( 1.0/6227020800.0);
+      s = s * y2 + (REAL)(-1.0/39916800.0);
+      s = s * y2 + (REAL)( 1.0/362880.0);
+      s = s * y2 + (REAL)(-1.0/5040.0);
+      s = s * y2 + (REAL)( 1.0/120.0);
+      s = s * y2 + (REAL)(-1.0/6.0);
+      s = s * y2 + (REAL)1.0;
+
+      cosval[i] = -(s * y);
+   }
+
+   for(i=0; i<n; i++)
+   {
+      if(ABS(deg[i]) > (REAL)540.0)
+         cosval[i] = cos(deg[i] * DegToRad);
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL BuildHBPlusResID(char *resspec, char *resid)
+   -------------------------------------------------
+   Converts a residue specification of the form [c]nnn[i] into the
+   residue ID format used by HBPlus (e.g. A0010-). resid must be at 
+   least 8 characters.
+
+   18.10.26 Original   By: agent
+*/
+BOOL BuildHBPlusResID(char *resspec, char *resid)
+{
+   char chain  = '-',
+        insert = '-',
+        *ptr   = resspec;
+   int  resnum;
+   
+   if(isalpha(*ptr))
+      chain = toupper(*(ptr++));
+   if(!isdigit(*ptr))
+      return(FALSE);
+
+   resnum = (int)strtol(ptr, &ptr, 10);
+   if(isalpha(*ptr))
+      insert = toupper(*(ptr++));
+   if(*ptr || resnum > 9999)
+      return(FALSE);
+
+   sprintf(resid, "%c%04d%c", chain, resnum, insert);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int SplitResList(char *xres, char resids[][8], int maxres)
+   ----------------------------------------------------------
+   Splits a comma-separated list of residue specifications into 
+   HBPlus residue IDs. Returns the number of residues or 0 on error.
+
+   18.10.26 Original   By: agent
+*/
+int SplitResList(char *xres, char resids[][8], int maxres)
+{
+   char *spec;
+   int  NRes = 0;
+   
+   for(spec=strtok(xres, ","); spec!=NULL; spec=strtok(NULL, ","))
+   {
+      if((NRes >= maxres) || !BuildHBPlusResID(spec, resids[NRes]))
+         return(0);
+      NRes++;
+   }
+   return(NRes);
+}
+
+
+/************************************************************************/
+/*>EINCR *CreateIncremental(HBONDS *HBonds, int NHBonds, int MaxHBonds,
+                            EPARAMS *eparams)
+   --------------------------------------------------------------------
+   Creates an incremental evaluator from a list of HBonds. Room is left
+   for MaxHBonds bonds to be held at any one time. The bonds are 
+   copied so the caller's array may be reused. PrecalcParams() must 
+   have been called. Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+EINCR *CreateIncremental(HBONDS *HBonds, int NHBonds, int MaxHBonds,
+                         EPARAMS *eparams)
+{
+   EINCR *einc;
+   int   i;
+
+   if(MaxHBonds < NHBonds)
+      MaxHBonds = NHBonds;
+   if(MaxHBonds < 1)
+      MaxHBonds = 1;
+   
+   if((einc = (EINCR *)malloc(sizeof(EINCR)))==NULL)
+      return(NULL);
+
+   /* Each bond introduces at most two residues; keep the hash table no
+      more than a quarter full
+   */
+   for(einc->HashSize=16; einc->HashSize < 8*MaxHBonds; 
+       einc->HashSize *= 2);
+   
+   einc->MaxHBonds = MaxHBonds;
+   einc->NSlots    = 0;
+   einc->FreeSlot  = (-1);
+   einc->NActive   = 0;
+   einc->ETot      = (REAL)0.0;
+   einc->EComp     = (REAL)0.0;
+   einc->eparams   = eparams;
+   einc->HBonds    = (HBONDS *)malloc(MaxHBonds * sizeof(HBONDS));
+   einc->Energy    = (REAL *)malloc(MaxHBonds * sizeof(REAL));
+   einc->ResD      = (int *)malloc(MaxHBonds * sizeof(int));
+   einc->ResA      = (int *)malloc(MaxHBonds * sizeof(int));
+   einc->NextD     = (int *)malloc(MaxHBonds * sizeof(int));
+   einc->NextA     = (int *)malloc(MaxHBonds * sizeof(int));
+   einc->FirstD    = (int *)malloc(einc->HashSize * sizeof(int));
+   einc->FirstA    = (int *)malloc(einc->HashSize * sizeof(int));
+   einc->ResID     = (char (*)[8])malloc(einc->HashSize * 8);
+
+   if((einc->HBonds==NULL) || (einc->Energy==NULL) || 
+      (einc->ResD==NULL)   || (einc->ResA==NULL)   ||
+      (einc->NextD==NULL)  || (einc->NextA==NULL)  ||
+      (einc->FirstD==NULL) || (einc->FirstA==NULL) ||
+      (einc->ResID==NULL))
+   {
+      FreeIncremental(einc);
+      return(NULL);
+   }
+
+   for(i=0; i<einc->HashSize; i++)
+   {
+      einc->ResID[i][0] = '\0';
+      einc->FirstD[i]   = (-1);
+      einc->FirstA[i]   = (-1);
+   }
+   
+   for(i=0; i<NHBonds; i++)
+      AddIncrementalBond(einc, &(HBonds[i]));
+
+   return(einc);
+}
+
+
+/************************************************************************/
+/*>void FreeIncremental(EINCR *einc)
+   ---------------------------------
+   Frees an incremental evaluator
+
+   18.10.26 Original   By: agent
+*/
+void FreeIncremental(EINCR *einc)
+{
+   if(einc == NULL)
+      return;
+   
+   if(einc->HBonds != NULL) free(einc->HBonds);
+   if(einc->Energy != NULL) free(einc->Energy);
+   if(einc->ResD   != NULL) free(einc->ResD);
+   if(einc->ResA   != NULL) free(einc->ResA);
+   if(einc->NextD  != NULL) free(einc->NextD);
+   if(einc->NextA  != NULL) free(einc->NextA);
+   if(einc->FirstD != NULL) free(einc->FirstD);
+   if(einc->FirstA != NULL) free(einc->FirstA);
+   if(einc->ResID  != NULL) free(einc->ResID);
+   free(einc);
+}
+
+
+/************************************************************************/
+/*>REAL IncrementalTotal(EINCR *einc)
+   ----------------------------------
+   Returns the current total energy held by an incremental evaluator
+
+   18.10.26 Original   By: agent
+*/
+REAL IncrementalTotal(EINCR *einc)
+{
+   return(einc->ETot + einc->EComp);
+}
+
+
+/************************************************************************/
+/*>int FindResIndex(EINCR *einc, char *resid, BOOL create)
+   -------------------------------------------------------
+   Finds the hash table index of a residue ID, adding it if create is
+   set. Returns -1 if the residue is not known (or the table is full).
+
+   18.10.26 Original   By: agent
+*/
+int FindResIndex(EINCR *einc, char *resid, BOOL create)
+{
+   unsigned long hash = 5381;
+   char          *ch;
+   int           i,
+                 probe;
+   
+   for(ch=resid; *ch; ch++)
+      hash = (hash * 33) ^ (unsigned char)(*ch);
+
+   i = (int)(hash & (einc->HashSize - 1));
+   for(probe=0; probe<einc->HashSize; probe++)
+   {
+      if(einc->ResID[i][0] == '\0')
+      {
+         if(!create)
+            return(-1);
+         strncpy(einc->ResID[i], resid, 7);
+         einc->ResID[i][7] = '\0';
+         return(i);
+      }
+      if(!strncmp(einc->ResID[i], resid, 7))
+         return(i);
+      
+      i = (i + 1) & (einc->HashSize - 1);
+   }
+   
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>BOOL AddIncrementalBond(EINCR *einc, HBONDS *hbond)
+   ---------------------------------------------------
+   Adds a bond to an incremental evaluator, updating the running
+   total. Returns FALSE if there is no room.
+
+   18.10.26 Original   By: agent
+   18.10.26 Residues looked up before a slot is taken so a failure
+            does not lose the slot   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+BOOL AddIncrementalBond(EINCR *einc, HBONDS *hbond)
+{
+   int slot,
+       rd,
+       ra;
+   
+   if(((rd = FindResIndex(einc, hbond->ResID_D, TRUE)) < 0) ||
+      ((ra = FindResIndex(einc, hbond->ResID_A, TRUE)) < 0))
+      return(FALSE);
+
+   if(einc->FreeSlot >= 0)
+   {
+      slot           = einc->FreeSlot;
+      einc->FreeSlot = einc->NextD[slot];
+   }
+   else if(einc->NSlots < einc->MaxHBonds)
+   {
+      slot = einc->NSlots++;
+   }
+   else
+   {
+      return(FALSE);
+   }
+
+   einc->HBonds[slot] = *hbond;
+   einc->Energy[slot] = BondEnergy(hbond, einc->eparams);
+   einc->ResD[slot]   = rd;
+   einc->ResA[slot]   = ra;
+   einc->NextD[slot]  = einc->FirstD[rd];
+   einc->FirstD[rd]   = slot;
+   einc->NextA[slot]  = einc->FirstA[ra];
+   einc->FirstA[ra]   = slot;
+   einc->NActive++;
+
+   CompensatedAdd(&(einc->ETot), &(einc->EComp), einc->Energy[slot]);
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>REAL RemoveResidueBonds(EINCR *einc, char resids[][8], int NRes)
+   ----------------------------------------------------------------
+   Removes all bonds in which any of the given residues (HBPlus residue
+   IDs) act as donor or acceptor. The cost is proportional to the 
+   number of bonds involving those residues and their partners.
+   Returns the new total energy.
+
+   18.10.26 Original   By: agent
+*/
+REAL RemoveResidueBonds(EINCR *einc, char resids[][8], int NRes)
+{
+   int i,
+       r,
+       slot,
+       next,
+       *link;
+   
+   for(i=0; i<NRes; i++)
+   {
+      if((r = FindResIndex(einc, resids[i], FALSE)) < 0)
+         continue;
+      
+      /* Bonds where this residue is the donor. Unlink each from its
+         acceptor's chain, then release the slot
+      */
+      for(slot=einc->FirstD[r]; slot>=0; slot=next)
+      {
+         next = einc->NextD[slot];
+         for(link = &(einc->FirstA[einc->ResA[slot]]); 
+             *link != slot; 
+             link = &(einc->NextA[*link]));
+         *link = einc->NextA[slot];
+
+         CompensatedAdd(&(einc->ETot), &(einc->EComp), 
+                        -einc->Energy[slot]);
+         einc->NextD[slot] = einc->FreeSlot;
+         einc->FreeSlot    = slot;
+         einc->NActive--;
+      }
+      einc->FirstD[r] = (-1);
+
+      /* Bonds where this residue is the acceptor                       */
+      for(slot=einc->FirstA[r]; slot>=0; slot=next)
+      {
+         next = einc->NextA[slot];
+         for(link = &(einc->FirstD[einc->ResD[slot]]); 
+             *link != slot; 
+             link = &(einc->NextD[*link]));
+         *link = einc->NextD[slot];
+
+         CompensatedAdd(&(einc->ETot), &(einc->EComp), 
+                        -einc->Energy[slot]);
+         einc->NextD[slot] = einc->FreeSlot;
+         einc->FreeSlot    = slot;
+         einc->NActive--;
+      }
+      einc->FirstA[r] = (-1);
+   }
+
+   return(IncrementalTotal(einc));
+}
+
+
+/************************************************************************/
+/*>REAL ReplaceResidueBonds(EINCR *einc, char resids[][8], int NRes,
+                            HBONDS *NewBonds, int NNew)
+   -----------------------------------------------------------------
+   Removes all bonds involving the given residues and adds the new
+   set of bonds (e.g. those for a new rotamer or mutation). Only the
+   new bonds which involve one of the residues are added, so a complete
+   HBPlus list for the modified structure may be supplied. Returns the
+   new total energy.
+
+   18.10.26 Original   By: agent
+*/
+REAL ReplaceResidueBonds(EINCR *einc, char resids[][8], int NRes,
+                         HBONDS *NewBonds, int NNew)
+{
+   int i,
+       j;
+   
+   RemoveResidueBonds(einc, resids, NRes);
+
+   for(i=0; i<NNew; i++)
+   {
+      for(j=0; j<NRes; j++)
+      {
+         if(!strncmp(NewBonds[i].ResID_D, resids[j], 7) ||
+            !strncmp(NewBonds[i].ResID_A, resids[j], 7))
+         {
+            if(!AddIncrementalBond(einc, &(NewBonds[i])))
+               fprintf(stderr,"Incremental evaluator full; bond \
+ignored\n");
+            break;
+         }
+      }
+   }
+
+   return(IncrementalTotal(einc));
+}
+
+
+/************************************************************************/
+/*>BONDQUERY *CreateBondQuery(int K, BOOL UseBelow, REAL Below)
+   ------------------------------------------------------------
+   Creates a bond query. With K > 0 the K strongest (most negative) 
+   bonds are kept in a heap, so the memory used does not depend on 
+   the number of files. With UseBelow, only bonds with an energy 
+   <= Below are considered. With K == 0 every such bond is printed 
+   as it is found. Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+BONDQUERY *CreateBondQuery(int K, BOOL UseBelow, REAL Below)
+{
+   BONDQUERY *query;
+
+   if((query = (BONDQUERY *)calloc(1, sizeof(BONDQUERY)))==NULL)
+      return(NULL);
+   if((K > 0) && 
+      ((query->Hits = (BONDHIT *)malloc(K * sizeof(BONDHIT)))==NULL))
+   {
+      free(query);
+      return(NULL);
+   }
+   query->K        = K;
+   query->UseBelow = UseBelow;
+   query->Below    = Below;
+
+   return(query);
+}
+
+
+/************************************************************************/
+/*>void FreeBondQuery(BONDQUERY *query)
+   ------------------------------------
+   Frees a bond query
+
+   18.10.26 Original   By: agent
+*/
+void FreeBondQuery(BONDQUERY *query)
+{
+   if(query != NULL)
+   {
+      free(query->Hits);
+      free(query);
+   }
+}
+
+
+/************************************************************************/
+/*>void QueryBonds(BONDQUERY *query, char *filename, HBONDS *HBonds, 
+                   int NHBonds, EPARAMS *eparams)
+   -----------------------------------------------------------------
+   Scores each bond of a file with the same kernel as EHBond() and 
+   offers it to the query. A bond which is stronger than the weakest
+   of the K kept replaces it at the root of the heap. Records which 
+   are not HBonds (see IsHBondRecord()) are skipped.
+
+   18.10.26 Original   By: agent
+   18.10.26 Skips records which are not HBonds   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+void QueryBonds(BONDQUERY *query, char *filename, HBONDS *HBonds, 
+                int NHBonds, EPARAMS *eparams)
+{
+   BONDHIT hit;
+   int     i;
+
+   for(i=0; i<NHBonds; i++)
+   {
+      if(!IsHBondRecord(&(HBonds[i])))
+         continue;
+
+      hit.Energy = BondEnergy(&(HBonds[i]), eparams);
+      query->NBonds++;
+      if(query->UseBelow && (hit.Energy > query->Below))
+         continue;
+      query->NMatch++;
+
+      /* Don't bother filling in a bond which won't be kept             */
+      if((query->K > 0) && (query->NHits == query->K) &&
+         (hit.Energy > query->Hits[0].Energy))
+         continue;
+
+      hit.Serial = i+1;
+      strncpy(hit.File, filename, MAXBUFF-1);
+      hit.File[MAXBUFF-1] = '\0';
+      hit.Bond = HBonds[i];
+
+      if(query->K == 0)
+      {
+         PrintBondHit(&hit);
+      }
+      else if(query->NHits < query->K)
+      {
+         query->Hits[query->NHits++] = hit;
+         SiftUpHit(query->Hits, query->NHits-1);
+      }
+      else if(CompareHits(&hit, &(query->Hits[0])) < 0)
+      {
+         query->Hits[0] = hit;
+         SiftDownHit(query->Hits, query->NHits, 0);
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>void PrintBondQuery(BONDQUERY *query)
+   -------------------------------------
+   Prints the kept bonds, strongest first, or just the count of bonds
+   found if they were printed as they were found
+
+   18.10.26 Original   By: agent
+*/
+void PrintBondQuery(BONDQUERY *query)
+{
+   int i;
+
+   if(query->K > 0)
+   {
+      qsort(query->Hits, query->NHits, sizeof(BONDHIT), CompareHits);
+      printf("Strongest %d of %ld HBonds", query->NHits, query->NMatch);
+      if(query->UseBelow)
+         printf(" with energy <= %f", query->Below);
+      printf(":\n");
+      for(i=0; i<query->NHits; i++)
+         PrintBondHit(&(query->Hits[i]));
+   }
+   else
+   {
+      printf("%ld of %ld HBonds with energy <= %f\n", query->NMatch, 
+             query->NBonds, query->Below);
+   }
+}
+
+
+/************************************************************************/
+/*>void PrintBondHit(BONDHIT *hit)
+   -------------------------------
+   Prints a bond found by a query. The residues and atoms are as given
+   by HBPlus and the number is the bond's number in the HBPlus file.
+
+   18.10.26 Original   By: agent
+*/
+void PrintBondHit(BONDHIT *hit)
+{
+   printf("Bond %5d %s%-3s %-4s %s%-3s %-4s %11.6f %s\n", hit->Serial,
+          hit->Bond.ResID_D, hit->Bond.ResNam_D, hit->Bond.AtomD,
+          hit->Bond.ResID_A, hit->Bond.ResNam_A, hit->Bond.AtomA,
+          hit->Energy, hit->File);
+}
+
+
+/************************************************************************/
+/*>int CompareHits(const void *a, const void *b)
+   ---------------------------------------------
+   Orders bonds by energy and then by file name and number so that the
+   result does not depend on the order in which files were scored
+
+   18.10.26 Original   By: agent
+*/
+int CompareHits(const void *a, const void *b)
+{
+   const BONDHIT *ha = (const BONDHIT *)a,
+                 *hb = (const BONDHIT *)b;
+   int           cmp;
+
+   if(ha->Energy != hb->Energy)
+      return((ha->Energy < hb->Energy) ? (-1) : 1);
+   if((cmp = strcmp(ha->File, hb->File)) != 0)
+      return(cmp);
+   return(ha->Serial - hb->Serial);
+}
+
+
+/************************************************************************/
+/*>void SiftUpHit(BONDHIT *heap, int i)
+   ------------------------------------
+   Moves a new entry up a max-heap (weakest bond at the root)
+
+   18.10.26 Original   By: agent
+*/
+void SiftUpHit(BONDHIT *heap, int i)
+{
+   BONDHIT hit = heap[i];
+   int     parent;
+
+   while(i > 0)
+   {
+      parent = (i-1) / 2;
+      if(CompareHits(&(heap[parent]), &hit) >= 0)
+         break;
+      heap[i] = heap[parent];
+      i       = parent;
+   }
+   heap[i] = hit;
+}
+
+
+/************************************************************************/
+/*>void SiftDownHit(BONDHIT *heap, int n, int i)
+   ---------------------------------------------
+   Moves a replaced entry down a max-heap of n entries
+
+   18.10.26 Original   By: agent
+*/
+void SiftDownHit(BONDHIT *heap, int n, int i)
+{
+   BONDHIT hit = heap[i];
+   int     child;
+
+   while((child = 2*i + 1) < n)
+   {
+      if((child+1 < n) && 
+         (CompareHits(&(heap[child+1]), &(heap[child])) > 0))
+         child++;
+      if(CompareHits(&(heap[child]), &hit) <= 0)
+         break;
+      heap[i] = heap[child];
+      i       = child;
+   }
+   heap[i] = hit;
+}
+
+
+/************************************************************************/
+/*>int DoDiff(char *RefFile, char **files, int NFiles, HBONDS *HBonds,
+              EPARAMS *eparams)
+   -------------------------------------------------------------------
+   --diff mode. The bonds of the reference file are scored and hashed
+   once and the bonds of each file are then joined with them in a 
+   single pass (DiffBonds()). A file name of - reads the list of files
+   from stdin. Returns the exit status.
+
+   18.10.26 Original   By: agent
+   18.10.26 Frees the join on a read error. No separate access() check
+            By: agent
+*/
+int DoDiff(char *RefFile, char **files, int NFiles, HBONDS *HBonds,
+           EPARAMS *eparams)
+{
+   BONDJOIN *join;
+   HBONDS   *RefBonds;
+   char     buffer[MAXBUFF],
+            *filename;
+   int      NRef,
+            NHBonds,
+            seen = 0,
+            i;
+
+   if((RefBonds = (HBONDS *)malloc(MAXHBOND * sizeof(HBONDS)))==NULL)
+   {
+      fprintf(stderr,"No memory for reference HBonds\n");
+      return(1);
+   }
+   if((NRef = ReadHBonds(RefFile, RefBonds)) < 0)
+   {
+      fprintf(stderr,"Unable to read HBPlus file: %s\n", RefFile);
+      free(RefBonds);
+      return(1);
+   }
+   if((join = CreateBondJoin(RefBonds, NRef, eparams))==NULL)
+   {
+      fprintf(stderr,"No memory for reference HBonds\n");
+      free(RefBonds);
+      return(1);
+   }
+
+   for(i=0; i<NFiles; i++)
+   {
+      BOOL FromStdin = !strcmp(files[i], "-");
+
+      for(;;)
+      {
+         if(FromStdin)
+         {
+            if(!fgets(buffer, MAXBUFF, stdin))
+               break;
+            TERMINATE(buffer);
+            if(buffer[0] == '\0')
+               continue;
+            filename = buffer;
+         }
+         else
+         {
+            filename = files[i];
+         }
+
+         if((NHBonds = ReadHBonds(filename, HBonds)) < 0)
+         {
+            fprintf(stderr,"Unable to read HBPlus file: %s\n", filename);
+            FreeBondJoin(join);
+            free(RefBonds);
+            return(1);
+         }
+         
+         DiffBonds(join, RefFile, filename, HBonds, NHBonds, eparams, 
+                   ++seen);
+
+         if(!FromStdin)
+            break;
+      }
+   }
+
+   FreeBondJoin(join);
+   free(RefBonds);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>BONDJOIN *CreateBondJoin(HBONDS *HBonds, int NHBonds, 
+                            EPARAMS *eparams)
+   -----------------------------------------------------------
+   Scores the reference bonds and builds the hash table used to join
+   other bonds with them. Records which are not HBonds (see 
+   IsHBondRecord()) are left out of the table. HBonds is not copied. 
+   Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+   18.10.26 Skips records which are not HBonds   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+BONDJOIN *CreateBondJoin(HBONDS *HBonds, int NHBonds, EPARAMS *eparams)
+{
+   BONDJOIN *join;
+   int      i, h;
+
+   if((join = (BONDJOIN *)calloc(1, sizeof(BONDJOIN)))==NULL)
+      return(NULL);
+
+   /* Keep the hash table no more than half full                        */
+   for(join->HashSize=16; join->HashSize < 2*NHBonds; 
+       join->HashSize *= 2);
+   join->Bonds  = HBonds;
+   join->NBonds = NHBonds;
+   join->Energy = (REAL *)malloc((NHBonds+1) * sizeof(REAL));
+   join->Seen   = (int *)calloc(NHBonds+1, sizeof(int));
+   join->Hash   = (int *)malloc(join->HashSize * sizeof(int));
+   if((join->Energy == NULL) || (join->Seen == NULL) || 
+      (join->Hash == NULL))
+   {
+      FreeBondJoin(join);
+      return(NULL);
+   }
+
+   for(h=0; h<join->HashSize; h++)
+      join->Hash[h] = (-1);
+   
+   for(i=0; i<NHBonds; i++)
+   {
+      if(!IsHBondRecord(&(HBonds[i])))
+         continue;
+
+      join->Energy[i] = BondEnergy(&(HBonds[i]), eparams);
+      h = (int)(HashBondKey(&(HBonds[i])) & (join->HashSize - 1));
+      while(join->Hash[h] >= 0)
+         h = (h + 1) & (join->HashSize - 1);
+      join->Hash[h] = i;
+   }
+
+   return(join);
+}
+
+
+/************************************************************************/
+/*>void FreeBondJoin(BONDJOIN *join)
+   ---------------------------------
+   Frees a bond join (but not the reference bonds)
+
+   18.10.26 Original   By: agent
+*/
+void FreeBondJoin(BONDJOIN *join)
+{
+   if(join == NULL)
+      return;
+   
+   free(join->Energy);
+   free(join->Seen);
+   free(join->Hash);
+   free(join);
+}
+
+
+/************************************************************************/
+/*>int FindJoinBond(BONDJOIN *join, HBONDS *hbond, int seen)
+   ---------------------------------------------------------
+   Returns the index of a reference bond with the same donor and 
+   acceptor residue and atom as hbond, which has not already been 
+   matched in file number seen. Returns -1 if there is none.
+
+   18.10.26 Original   By: agent
+*/
+int FindJoinBond(BONDJOIN *join, HBONDS *hbond, int seen)
+{
+   int h, i;
+
+   h = (int)(HashBondKey(hbond) & (join->HashSize - 1));
+   while((i = join->Hash[h]) >= 0)
+   {
+      if((join->Seen[i] != seen) && SameBondKey(&(join->Bonds[i]), hbond))
+         return(i);
+      h = (h + 1) & (join->HashSize - 1);
+   }
+   
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>unsigned long HashBondKey(HBONDS *hbond)
+   ----------------------------------------
+   Hash of the donor and acceptor residue IDs and atom names of a bond
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses FNVHash32()   By: agent
+*/
+unsigned long HashBondKey(HBONDS *hbond)
+{
+   char          *fields[4];
+   unsigned long hash = FNV32_INIT;
+   int           i;
+
+   fields[0] = hbond->ResID_D;
+   fields[1] = hbond->AtomD;
+   fields[2] = hbond->ResID_A;
+   fields[3] = hbond->AtomA;
+   
+   for(i=0; i<4; i++)
+   {
+      hash = FNVHash32(hash, fields[i], strlen(fields[i]));
+      hash = FNV32_STEP(hash, '|');
+   }
+   
+   return(hash);
+}
+
+
+/************************************************************************/
+/*>BOOL SameBondKey(HBONDS *a, HBONDS *b)
+   --------------------------------------
+   Do two bonds have the same donor and acceptor residues and atoms?
+
+   18.10.26 Original   By: agent
+*/
+BOOL SameBondKey(HBONDS *a, HBONDS *b)
+{
+   return(!strcmp(a->ResID_D, b->ResID_D) && !strcmp(a->AtomD, b->AtomD) &&
+          !strcmp(a->ResID_A, b->ResID_A) && !strcmp(a->AtomA, b->AtomA));
+}
+
+
+/************************************************************************/
+/*>void DiffBonds(BONDJOIN *join, char *RefFile, char *filename, 
+                  HBONDS *HBonds, int NHBonds, EPARAMS *eparams, 
+                  int seen)
+   --------------------------------------------------------------
+   Joins the bonds of one file with the reference bonds. Bonds which
+   are not in the reference are printed as gained and those whose 
+   energy differs by more than DIFFTOL as changed, in the order of the
+   file. Reference bonds which were not matched are then printed as 
+   lost. Each line gives the reference and new energies and the 
+   difference. The totals follow. seen is a number for the file which
+   is different from that of any earlier file. Records which are not 
+   HBonds (see IsHBondRecord()) are skipped on both sides.
+
+   18.10.26 Original   By: agent
+   18.10.26 Skips records which are not HBonds   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+void DiffBonds(BONDJOIN *join, char *RefFile, char *filename, 
+               HBONDS *HBonds, int NHBonds, EPARAMS *eparams, int seen)
+{
+   REAL energy,
+        EGained  = (REAL)0.0,
+        ELost    = (REAL)0.0,
+        EChanged = (REAL)0.0;
+   int  NGained  = 0,
+        NLost    = 0,
+        NChanged = 0,
+        NSame    = 0,
+        i, j;
+
+   printf("Diff %s %s\n", RefFile, filename);
+
+   for(i=0; i<NHBonds; i++)
+   {
+      if(!IsHBondRecord(&(HBonds[i])))
+         continue;
+
+      energy = BondEnergy(&(HBonds[i]), eparams);
+      if((j = FindJoinBond(join, &(HBonds[i]), seen)) < 0)
+      {
+         PrintDiffBond("Gained", &(HBonds[i]), (REAL)0.0, energy);
+         EGained += energy;
+         NGained++;
+      }
+      else
+      {
+         join->Seen[j] = seen;
+         if(fabs(energy - join->Energy[j]) > DIFFTOL)
+         {
+            PrintDiffBond("Changed", &(HBonds[i]), join->Energy[j], 
+                          energy);
+            EChanged += energy - join->Energy[j];
+            NChanged++;
+         }
+         else
+         {
+            NSame++;
+         }
+      }
+   }
+
+   for(j=0; j<join->NBonds; j++)
+   {
+      if((join->Seen[j] != seen) && IsHBondRecord(&(join->Bonds[j])))
+      {
+         PrintDiffBond("Lost", &(join->Bonds[j]), join->Energy[j], 
+                       (REAL)0.0);
+         ELost -= join->Energy[j];
+         NLost++;
+      }
+   }
+
+   printf("Delta %f: %d gained %f, %d lost %f, %d changed %f, \
+%d unchanged\n", EGained + ELost + EChanged, NGained, EGained, 
+          NLost, ELost, NChanged, EChanged, NSame);
+}
+
+
+/************************************************************************/
+/*>void PrintDiffBond(char *label, HBONDS *hbond, REAL EOld, REAL ENew)
+   -------------------------------------------------------------------
+   Prints a bond found by --diff with its reference and new energies
+   and the difference
+
+   18.10.26 Original   By: agent
+*/
+void PrintDiffBond(char *label, HBONDS *hbond, REAL EOld, REAL ENew)
+{
+   printf("%-7s %s%-3s %-4s %s%-3s %-4s %11.6f %11.6f %11.6f\n", label,
+          hbond->ResID_D, hbond->ResNam_D, hbond->AtomD,
+          hbond->ResID_A, hbond->ResNam_A, hbond->AtomA,
+          EOld, ENew, ENew - EOld);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteEnergyMatrix(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                          char *filename)
+   ---------------------------------------------------------------------
+   Writes the residue x residue HBond energy matrix of a structure 
+   (see resmatrix.c). Each bond is scored with the same kernel as 
+   EHBond(). The -1 records and blank lines in HBPlus output are left
+   out. Returns FALSE on failure.
+
+   18.10.26 Original   By: agent
+   18.10.26 Blank records are left out   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+BOOL WriteEnergyMatrix(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                       char *filename)
+{
+   RESMATRIX *rm;
+   REAL      energy;
+   BOOL      ok = TRUE;
+   int       i;
+
+   if((rm = CreateResMatrix())==NULL)
+   {
+      fprintf(stderr,"No memory for residue energy matrix\n");
+      return(FALSE);
+   }
+
+   for(i=0; ok && (i<NHBonds); i++)
+   {
+      if(!IsHBondRecord(&(HBonds[i])))
+         continue;
+      energy = BondEnergy(&(HBonds[i]), eparams);
+      if(!AddResMatrixBond(rm, HBonds[i].ResID_D, HBonds[i].ResNam_D,
+                           HBonds[i].ResID_A, HBonds[i].ResNam_A, 
+                           energy))
+      {
+         fprintf(stderr,"No memory for residue energy matrix\n");
+         ok = FALSE;
+      }
+   }
+
+   if(ok)
+      ok = WriteResMatrix(rm, filename);
+
+   FreeResMatrix(rm);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>int DoBatch(char **files, int NFiles, HBONDS *HBonds, 
+               EPARAMS *eparams)
+   -----------------------------------------------------
+   Interface and batch modes. Scores each of a list of HBPlus files. A
+   file name of - means read the file names from stdin, one per line.
+   The HBonds array is reused for every file. Files which are not in
+   this shard (--shard) are skipped.
+
+   In interface mode, only the inter-chain HBonds are scored and the 
+   total and per-chain-pair energies are printed for each file as it 
+   is done. In batch mode, the total for each file and the total over
+   all files are printed at the end. In either mode the results are 
+   written to a partial result file with --partial.
+
+   With --journal, each result is recorded in the journal as it is 
+   done and files found in the journal are not scored again.
+
+   With -p, the files are processed by DoPipeline() instead. In run
+   mode, they are PDB files which are processed by DoRun(). With a 
+   bond query (--top or --below), every bond is also offered to 
+   gQuery and the bonds found are printed at the end. With --hbstats,
+   the bonds are added to gHBStats as they are scored and the 
+   statistics are printed and written at the end.
+
+   18.10.26 Original   (as DoInterface())   By: agent
+   18.10.26 Renamed. Added batch mode, sharding and partial results
+            By: agent
+   18.10.26 Added the journal   By: agent
+   18.10.26 Added the pipeline   By: agent
+   18.10.26 Added run mode   By: agent
+   18.10.26 Added bond queries   By: agent
+   18.10.26 Added HBond statistics   By: agent
+*/
+int DoBatch(char **files, int NFiles, HBONDS *HBonds, 
+            EPARAMS *eparams)
+{
+   CHAINPAIR pairs[MAXCHAINPAIR];
+   BATCH     *batch;
+   BATCHREC  *rec;
+   JOURNAL   *journal = NULL;
+   char      buffer[MAXBUFF],
+             *filename;
+   int       NHBonds,
+             NPairs  = 0,
+             NFailed = 0,
+             i, j;
+   REAL      energy;
+
+#ifdef FLOAT_KERNEL
+   batch = CreateBatch("ehb", gInterface ? "interface" : "hbond", 
+                       "float", gShard, gNShards);
+#else
+   batch = CreateBatch("ehb", gInterface ? "interface" : "hbond", 
+                       "", gShard, gNShards);
+#endif
+   if(batch == NULL)
+   {
+      fprintf(stderr,"No memory for batch results\n");
+      return(1);
+   }
+
+   if((gJournal != NULL) && 
+      ((journal = OpenJournal(gJournal, batch))==NULL))
+      return(1);
+
+   if((gNThreads > 0) && 
+      !DoPipeline(files, NFiles, eparams, batch, journal))
+      return(1);
+
+   if(gRun && 
+      !DoRun(files, NFiles, HBonds, eparams, batch, journal, &NFailed))
+      return(1);
+
+   for(i=0; (gNThreads == 0) && !gRun && (i<NFiles); i++)
+   {
+      BOOL FromStdin = !strcmp(files[i], "-");
+
+      for(;;)
+      {
+         if(FromStdin)
+         {
+            if(!fgets(buffer, MAXBUFF, stdin))
+               break;
+            TERMINATE(buffer);
+            if(buffer[0] == '\0')
+               continue;
+            filename = buffer;
+         }
+         else
+         {
+            filename = files[i];
+         }
+
+         if(!InShard(filename, gShard, gNShards))
+         {
+            if(!FromStdin)
+               break;
+            continue;
+         }
+         
+         /* Files already in the journal are not scored again         */
+         if((journal != NULL) && 
+            ((rec = JournalDone(journal, filename))!=NULL))
+         {
+            if(gInterface)
+               PrintInterface(rec);
+            if(!FromStdin)
+               break;
+            continue;
+         }
+         
+         if(access(filename, R_OK) ||
+            ((NHBonds = ReadHBonds(filename, HBonds)) < 0))
+         {
+            fprintf(stderr,"Unable to read HBPlus file: %s\n", filename);
+            return(1);
+         }
+         
+         if(gQuery != NULL)
+            QueryBonds(gQuery, filename, HBonds, NHBonds, eparams);
+         if(gInterface)
+         {
+            energy  = InterfaceEnergy(HBonds, NHBonds, eparams, 
+                                      pairs, &NPairs);
+            for(NHBonds=0, j=0; j<NPairs; j++)
+               NHBonds += pairs[j].NHBonds;
+         }
+         else
+         {
+            energy = EHBondStats(HBonds, NHBonds, eparams, gHBStats);
+         }
+
+         if(!RecordResult(batch, journal, filename, energy, NHBonds,
+                          pairs, NPairs))
+            return(1);
+
+         if(!FromStdin)
+            break;
+      }
+   }
+
+   if(!CloseJournal(journal))
+      return(1);
+
+   if(gBatch)
+      PrintBatchReport(stdout, batch);
+   if(gQuery != NULL)
+      PrintBondQuery(gQuery);
+   if(gHBStats != NULL)
+   {
+      PrintHBStats(stdout, gHBStats, FALSE);
+      if(!WriteHBStats(gHBStats, gStatsFile))
+         return(1);
+   }
+
+   if((gPartial != NULL) && !WritePartial(batch, gPartial))
+      return(1);
+
+   FreeBatch(batch);
+   return(NFailed ? 1 : 0);
+}
+
+
+/************************************************************************/
+/*>BOOL RecordResult(BATCH *batch, JOURNAL *journal, char *filename,
+                     REAL energy, int NHBonds, CHAINPAIR *pairs, 
+                     int NPairs)
+   -------------------------------------------------------------------
+   Adds the result for a file to the batch results and the journal 
+   (if any). In interface mode it is also printed.
+
+   18.10.26 Original   (from DoBatch())   By: agent
+*/
+BOOL RecordResult(BATCH *batch, JOURNAL *journal, char *filename,
+                  REAL energy, int NHBonds, CHAINPAIR *pairs, int NPairs)
+{
+   BATCHREC *rec;
+   int      j;
+   
+   if((rec = AddBatchRecord(batch, filename, energy, NHBonds))==NULL)
+   {
+      fprintf(stderr,"No memory for batch results\n");
+      return(FALSE);
+   }
+   for(j=0; j<NPairs; j++)
+   {
+      if(!AddBatchPair(rec, pairs[j].ChainX, pairs[j].ChainY,
+                       pairs[j].Energy, pairs[j].NHBonds))
+      {
+         fprintf(stderr,"No memory for batch results\n");
+         return(FALSE);
+      }
+   }
+
+   if(gInterface)
+      PrintInterface(rec);
+   if((journal != NULL) && !JournalRecord(journal, rec))
+      return(FALSE);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL DoRun(char **files, int NFiles, HBONDS *HBonds, 
+              EPARAMS *eparams, BATCH *batch, JOURNAL *journal,
+              int *NFailed)
+   ---------------------------------------------------------------
+   Run mode. files are PDB files (or - for a list on stdin). HBPlus is
+   run on each file in this shard which is not in the journal, up to
+   gNJobs at a time in scratch directories (hbplusrun.c), and its 
+   output is parsed from memory and scored as in DoBatch(). The 
+   results are recorded in the order of the files under the PDB file
+   names. Files on which HBPlus failed are counted in NFailed and are
+   not recorded, so a restarted run tries them again. Returns FALSE on
+   a fatal error.
+
+   18.10.26 Original   By: agent
+*/
+BOOL DoRun(char **files, int NFiles, HBONDS *HBonds, EPARAMS *eparams,
+           BATCH *batch, JOURNAL *journal, int *NFailed)
+{
+   PIPELINE  pl;
+   HBPLUSRUN *run      = NULL;
+   RUNRESULT *results  = NULL,
+             *res;
+   CHAINPAIR pairs[MAXCHAINPAIR];
+   char      *data;
+   size_t    size;
+   int       next      = 0,
+             done      = 0,
+             NHBonds,
+             NPairs    = 0,
+             id, i, j;
+   REAL      energy;
+   BOOL      ok        = TRUE;
+
+   memset(&pl, 0, sizeof(PIPELINE));
+   if(!GatherNames(files, NFiles, journal, &pl) ||
+      ((results = (RUNRESULT *)calloc(MAX(pl.NNames, 1), 
+                                      sizeof(RUNRESULT)))==NULL) ||
+      ((run = CreateHBPlusRunner(gHBPlus, gNJobs, gTimeout, gTries))
+       ==NULL))
+   {
+      fprintf(stderr,"No memory for HBPlus jobs\n");
+      ok = FALSE;
+   }
+
+   while(ok && (done < pl.NNames))
+   {
+      /* Fill the free job slots                                        */
+      while((next < pl.NNames) && !HBPlusRunnerFull(run))
+      {
+         if(pl.Done[next])
+            results[next].Finished = TRUE;
+         else if(!StartHBPlusJob(run, next, pl.Names[next]))
+            results[next].Finished = results[next].Failed = TRUE;
+         next++;
+      }
+
+      /* Record the results which are ready in the order of the files  */
+      for(; (done < pl.NNames) && results[done].Finished; done++)
+      {
+         res = &(results[done]);
+         if(pl.Done[done])
+         {
+            if(gInterface)
+               PrintInterface(JournalDone(journal, pl.Names[done]));
+         }
+         else if(res->Failed)
+         {
+            (*NFailed)++;
+         }
+         else if(!RecordResult(batch, journal, pl.Names[done], 
+                               res->Energy, res->NHBonds, res->Pairs,
+                               res->NPairs))
+         {
+            ok = FALSE;
+            break;
+         }
+         free(res->Pairs);
+         res->Pairs = NULL;
+      }
+      if(!ok || (done == pl.NNames))
+         break;
+
+      /* Wait for a job and score its output                            */
+      if(!NextHBPlusResult(run, &id, &data, &size))
+      {
+         fprintf(stderr,"Lost track of HBPlus jobs\n");
+         ok = FALSE;
+         break;
+      }
+      res = &(results[id]);
+      res->Finished = TRUE;
+      if(data == NULL)
+      {
+         res->Failed = TRUE;
+         continue;
+      }
+      
+      NHBonds = ReadHBondsBuffer(data, size, pl.Names[id], HBonds);
+      free(data);
+      if(NHBonds < 0)
+      {
+         fprintf(stderr,"Unable to read HBPlus output for: %s\n",
+                 pl.Names[id]);
+         res->Failed = TRUE;
+         continue;
+      }
+      if(gQuery != NULL)
+         QueryBonds(gQuery, pl.Names[id], HBonds, NHBonds, eparams);
+      if(gInterface)
+      {
+         energy = InterfaceEnergy(HBonds, NHBonds, eparams, 
+                                  pairs, &NPairs);
+         for(NHBonds=0, j=0; j<NPairs; j++)
+            NHBonds += pairs[j].NHBonds;
+         if(NPairs > 0)
+         {
+            if((res->Pairs = (CHAINPAIR *)malloc(NPairs * 
+                                                 sizeof(CHAINPAIR)))
+               ==NULL)
+            {
+               fprintf(stderr,"No memory for batch results\n");
+               ok = FALSE;
+               break;
+            }
+            memcpy(res->Pairs, pairs, NPairs * sizeof(CHAINPAIR));
+         }
+      }
+      else
+      {
+         energy = EHBondStats(HBonds, NHBonds, eparams, gHBStats);
+      }
+      res->Energy  = energy;
+      res->NHBonds = NHBonds;
+      res->NPairs  = gInterface ? NPairs : 0;
+   }
+
+   if(*NFailed)
+      fprintf(stderr,"HBPlus failed on %d file%s\n", *NFailed,
+              (*NFailed == 1) ? "" : "s");
+
+   FreeHBPlusRunner(run);
+   for(i=0; i<pl.NNames; i++)
+   {
+      if(results != NULL)
+         free(results[i].Pairs);
+      free(pl.Names[i]);
+   }
+   free(results);
+   free(pl.Names);
+   free(pl.Done);
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL DoPipeline(char **files, int NFiles, EPARAMS *eparams, 
+                   BATCH *batch, JOURNAL *journal)
+   -----------------------------------------------------------
+   Pipelined batch and interface modes (-p with -b or -i). gNReaders 
+   reader threads read and parse the HBPlus files, gNThreads compute 
+   threads score them and this thread writes the results in the order
+   of the files. The readers use io_uring where they can. The stages
+   are connected by bounded lock-free queues (lfqueue.c) of 
+   PIPEITEMs. The items come from a fixed pool held in a third queue
+   so that a reader cannot get more than the pool ahead of the 
+   writer. Results are the same as for the serial loop in DoBatch().
+   With --stats, the queue depths are reported at the end.
+
+   18.10.26 Original   By: agent
+   18.10.26 Reports the use of io_uring   By: agent
+   18.10.26 The writer offers the bonds to any bond query   By: agent
+   18.10.26 Merges the HBond statistics from the compute threads   By: agent
+   18.10.26 Fails if a thread aborts the pipeline   By: agent
+   18.10.26 Uses Now() for the time. Frees the file names if 
+            GatherNames() fails   By: agent
+*/
+BOOL DoPipeline(char **files, int NFiles, EPARAMS *eparams, 
+                BATCH *batch, JOURNAL *journal)
+{
+   PIPELINE  pl;
+   PIPEITEM  *items    = NULL,
+             **slots   = NULL,
+             *item;
+   pthread_t threads[2*MAXTHREAD];
+   int       NItems,
+             NStarted  = 0,
+             next      = 0,
+             i;
+   BOOL      ok        = TRUE;
+   double    start     = Now();
+
+   memset(&pl, 0, sizeof(PIPELINE));
+   pl.eparams  = eparams;
+   pl.NWorkers = gNThreads;
+   atomic_init(&pl.NextName, 0);
+   atomic_init(&pl.NReadersLeft, gNReaders);
+   atomic_init(&pl.NUring, 0);
+   atomic_init(&pl.NextStats, 0);
+   atomic_init(&pl.Abort, 0);
+   
+   if(!GatherNames(files, NFiles, journal, &pl))
+   {
+      FreeNames(&pl);
+      return(FALSE);
+   }
+
+   /* Set up the pool of items and the queues                          */
+   NItems = 2*PIPEDEPTH + gNReaders + gNThreads;
+   if(((items = (PIPEITEM *)calloc(NItems, sizeof(PIPEITEM)))==NULL) ||
+      ((slots = (PIPEITEM **)calloc(NItems, sizeof(PIPEITEM *)))==NULL) ||
+      ((pl.Free      = CreateLFQueue(NItems))==NULL)    ||
+      ((pl.ToCompute = CreateLFQueue(PIPEDEPTH))==NULL) ||
+      ((pl.ToWrite   = CreateLFQueue(PIPEDEPTH))==NULL))
+      ok = FALSE;
+   for(i=0; ok && (i<NItems); i++)
+   {
+      if((items[i].HBonds = (HBONDS *)malloc(MAXHBOND * sizeof(HBONDS)))
+         ==NULL)
+         ok = FALSE;
+      else
+         LFQTryPush(pl.Free, items+i);
+   }
+   if(ok && (gHBStats != NULL))
+   {
+      if((pl.Stats = (HBSTATS **)calloc(gNThreads, sizeof(HBSTATS *)))
+         ==NULL)
+         ok = FALSE;
+      for(i=0; ok && (i<gNThreads); i++)
+      {
+         if((pl.Stats[i] = CreateHBStats(gShard, gNShards))==NULL)
+            ok = FALSE;
+      }
+   }
+   if(!ok)
+      fprintf(stderr,"No memory for the pipeline\n");
+   
+   /* Start the readers and compute threads                            */
+   for(i=0; ok && (i<gNReaders+gNThreads); i++)
+   {
+      if(pthread_create(&(threads[i]), NULL, 
+                        (i<gNReaders) ? PipeReader : PipeWorker, 
+                        (void *)&pl))
+      {
+         fprintf(stderr,"Unable to start pipeline thread\n");
+         ok = FALSE;
+         break;
+      }
+      NStarted++;
+   }
+
+   /* Write the results in order. Items which arrive early wait in the 
+      reorder buffer. All the items in flight have sequence numbers 
+      within NItems of the next to write so the slot is seq % NItems.
+   */
+   while(ok && (next < pl.NNames))
+   {
+      if((item = slots[next % NItems]) == NULL)
+      {
+         /* Only NULL if a thread has aborted the pipeline             */
+         if((item = (PIPEITEM *)LFQPop(pl.ToWrite, &pl.Abort)) == NULL)
+         {
+            ok = FALSE;
+            break;
+         }
+         slots[item->Seq % NItems] = item;
+         continue;
+      }
+      slots[next % NItems] = NULL;
+
+      if(item->Error)
+      {
+         fprintf(stderr,"Unable to read HBPlus file: %s\n", 
+                 pl.Names[next]);
+         ok = FALSE;
+      }
+      else if(item->Done)
+      {
+         if(gInterface)
+            PrintInterface(JournalDone(journal, pl.Names[next]));
+      }
+      else
+      {
+         if(gQuery != NULL)
+            QueryBonds(gQuery, pl.Names[next], item->HBonds, 
+                       item->NHBonds, eparams);
+         ok = RecordResult(batch, journal, pl.Names[next], item->Energy,
+                           item->NHBonds, item->Pairs, item->NPairs);
+      }
+      
+      LFQTryPush(pl.Free, item);
+      next++;
+   }
+   
+   if(!ok)
+      atomic_store(&pl.Abort, 1);
+   for(i=0; i<NStarted; i++)
+      pthread_join(threads[i], NULL);
+
+   /* Merged in thread order, so the bin counts are the same as for a
+      serial run
+   */
+   for(i=0; (pl.Stats != NULL) && (i<gNThreads); i++)
+   {
+      if(pl.Stats[i] != NULL)
+      {
+         MergeHBStats(gHBStats, pl.Stats[i]);
+         FreeHBStats(pl.Stats[i]);
+      }
+   }
+   free(pl.Stats);
+
+   if(gStats && (pl.Free != NULL))
+   {
+      fprintf(stderr,"Pipeline: %d files, %d readers, %d compute \
+threads, %d buffers, %.3fs\n", pl.NNames, gNReaders, gNThreads, NItems,
+              Now() - start);
+      fprintf(stderr,"Reading: %d with io_uring (depth %d), %d with \
+blocking reads\n", atomic_load(&pl.NUring), gIODepth, 
+              gNReaders - atomic_load(&pl.NUring));
+      fprintf(stderr,"%-16s %8s %10s %8s %8s %8s\n", "Queue", 
+              "Capacity", "MeanDepth", "MaxDepth", "Full", "Empty");
+      PrintQueueStats("read->compute",  pl.ToCompute);
+      PrintQueueStats("compute->write", pl.ToWrite);
+      PrintQueueStats("free buffers",   pl.Free);
+   }
+
+   for(i=0; (items != NULL) && (i<NItems); i++)
+      free(items[i].HBonds);
+   free(items);
+   free(slots);
+   FreeLFQueue(pl.Free);
+   FreeLFQueue(pl.ToCompute);
+   FreeLFQueue(pl.ToWrite);
+   FreeNames(&pl);
+
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>BOOL GatherNames(char **files, int NFiles, JOURNAL *journal, 
+                    PIPELINE *pl)
+   ------------------------------------------------------------
+   Makes the list of files in this shard for the pipeline, reading 
+   the names from stdin for a file of -. Files which are already in 
+   the journal are flagged as done.
+
+   18.10.26 Original   By: agent
+*/
+BOOL GatherNames(char **files, int NFiles, JOURNAL *journal, 
+                 PIPELINE *pl)
+{
+   char buffer[MAXBUFF],
+        *filename,
+        **names;
+   BOOL *done;
+   int  max = 0,
+        i;
+
+   for(i=0; i<NFiles; i++)
+   {
+      BOOL FromStdin = !strcmp(files[i], "-");
+
+      for(;;)
+      {
+         if(FromStdin)
+         {
+            if(!fgets(buffer, MAXBUFF, stdin))
+               break;
+            TERMINATE(buffer);
+            if(buffer[0] == '\0')
+               continue;
+            filename = buffer;
+         }
+         else
+         {
+            filename = files[i];
+         }
+
+         if(InShard(filename, gShard, gNShards))
+         {
+            if(pl->NNames == max)
+            {
+               max = max ? 2*max : 256;
+               if((names = (char **)realloc(pl->Names, 
+                                            max*sizeof(char *)))!=NULL)
+                  pl->Names = names;
+               if((done = (BOOL *)realloc(pl->Done, max*sizeof(BOOL)))
+                  !=NULL)
+                  pl->Done = done;
+               if((names == NULL) || (done == NULL))
+               {
+                  fprintf(stderr,"No memory for file names\n");
+                  return(FALSE);
+               }
+            }
+            if((pl->Names[pl->NNames] = strdup(filename))==NULL)
+            {
+               fprintf(stderr,"No memory for file names\n");
+               return(FALSE);
+            }
+            pl->Done[pl->NNames++] = (journal != NULL) && 
+                                     (JournalDone(journal, filename)
+                                      != NULL);
+         }
+
+         if(!FromStdin)
+            break;
+      }
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeNames(PIPELINE *pl)
+   ----------------------------
+   Frees the list of files made by GatherNames(), including a partial
+   list if it failed
+
+   18.10.26 Original   By: agent
+*/
+void FreeNames(PIPELINE *pl)
+{
+   int i;
+
+   for(i=0; i<pl->NNames; i++)
+      free(pl->Names[i]);
+   free(pl->Names);
+   free(pl->Done);
+   pl->Names  = NULL;
+   pl->Done   = NULL;
+   pl->NNames = 0;
+}
+
+
+/************************************************************************/
+/*>void *PipeReader(void *arg)
+   ---------------------------
+   Pipeline reader thread. Reads files with io_uring (bulkread.c) if it
+   is available, otherwise with ordinary blocking reads. The last 
+   reader to finish sends an end marker to each compute thread.
+
+   18.10.26 Original   By: agent
+   18.10.26 Added io_uring   By: agent
+*/
+void *PipeReader(void *arg)
+{
+   PIPELINE *pl = (PIPELINE *)arg;
+   BULKREAD *br = NULL;
+   int      i;
+
+   if((gIODepth > 0) && ((br = CreateBulkReader(gIODepth)) != NULL))
+   {
+      atomic_fetch_add(&pl->NUring, 1);
+      PipeReadUring(pl, br);
+      FreeBulkReader(br);
+   }
+   else
+   {
+      PipeReadBlocking(pl);
+   }
+
+   if(atomic_fetch_sub(&pl->NReadersLeft, 1) == 1)
+   {
+      for(i=0; i<pl->NWorkers; i++)
+      {
+         if(!LFQPush(pl->ToCompute, &(pl->EndMark), &pl->Abort))
+            break;
+      }
+   }
+   
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL ClaimFile(PIPELINE *pl, PIPEITEM *item)
+   --------------------------------------------
+   Claims the next file for a reader, which must already have a free 
+   item to put it in, so that the files in flight are always the next
+   ones to be written. Returns FALSE (and frees the item) when there 
+   are no more files.
+
+   18.10.26 Original   (from PipeReader())   By: agent
+*/
+BOOL ClaimFile(PIPELINE *pl, PIPEITEM *item)
+{
+   int i;
+   
+   if((i = atomic_fetch_add(&pl->NextName, 1)) >= pl->NNames)
+   {
+      LFQTryPush(pl->Free, item);
+      return(FALSE);
+   }
+
+   item->Seq     = i;
+   item->Done    = pl->Done[i];
+   item->Error   = FALSE;
+   item->NHBonds = 0;
+   item->NPairs  = 0;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void PipeReadBlocking(PIPELINE *pl)
+   -----------------------------------
+   Pipeline reader loop using blocking reads. Several readers make a 
+   thread pool to keep the device busy.
+
+   18.10.26 Original   (from PipeReader())   By: agent
+   18.10.26 A file which fails to decompress is an error   By: agent
+*/
+void PipeReadBlocking(PIPELINE *pl)
+{
+   PIPEITEM *item;
+
+   while(((item = (PIPEITEM *)LFQPop(pl->Free, &pl->Abort)) != NULL) &&
+         ClaimFile(pl, item))
+   {
+      if(!item->Done)
+      {
+         if(access(pl->Names[item->Seq], R_OK) ||
+            ((item->NHBonds = ReadHBonds(pl->Names[item->Seq], 
+                                         item->HBonds)) < 0))
+            item->Error = TRUE;
+      }
+
+      if(!LFQPush(pl->ToCompute, item, &pl->Abort))
+         break;
+   }
+}
+
+
+/************************************************************************/
+/*>void PipeReadUring(PIPELINE *pl, BULKREAD *br)
+   ----------------------------------------------
+   Pipeline reader loop using io_uring. Keeps up to gIODepth files in
+   flight, as long as there are free items, and parses each file from
+   memory as it arrives.
+
+   18.10.26 Original   By: agent
+   18.10.26 A file which fails to decompress is an error   By: agent
+   18.10.26 A failure of io_uring itself aborts the pipeline, as the
+            files in flight will never arrive   By: agent
+*/
+void PipeReadUring(PIPELINE *pl, BULKREAD *br)
+{
+   PIPEITEM *item;
+   BOOL     more = TRUE;
+   void     *user;
+   char     *data;
+   size_t   size;
+   int      error;
+
+   while(!atomic_load(&pl->Abort))
+   {
+      /* Start as many files as possible, only waiting for a free item
+         if nothing is in flight
+      */
+      while(more && !BulkReadFull(br))
+      {
+         if(BulkReadBusy(br))
+            item = (PIPEITEM *)LFQTryPop(pl->Free);
+         else
+            item = (PIPEITEM *)LFQPop(pl->Free, &pl->Abort);
+         if(item == NULL)
+            break;
+         if(!(more = ClaimFile(pl, item)))
+            break;
+
+         if(item->Done)
+         {
+            if(!LFQPush(pl->ToCompute, item, &pl->Abort))
+               return;
+         }
+         else
+         {
+            BulkReadAdd(br, pl->Names[item->Seq], item);
+         }
+      }
+
+      if(!BulkReadBusy(br))
+      {
+         if(!more)
+            break;
+         continue;
+      }
+
+      if(!BulkReadNext(br, &user, &data, &size, &error))
+      {
+         fprintf(stderr,"io_uring read failed: %s\n", strerror(errno));
+         atomic_store(&pl->Abort, 1);
+         break;
+      }
+      item = (PIPEITEM *)user;
+      if(error ||
+         ((item->NHBonds = ReadHBondsBuffer(data, size, 
+                                            pl->Names[item->Seq],
+                                            item->HBonds)) < 0))
+         item->Error = TRUE;
+      free(data);
+
+      if(!LFQPush(pl->ToCompute, item, &pl->Abort))
+         break;
+   }
+}
+
+
+/************************************************************************/
+/*>void *PipeWorker(void *arg)
+   ---------------------------
+   Pipeline compute thread. Scores the HBonds of each item and passes
+   it on to the writer, until it gets an end marker. With HBond 
+   statistics, each thread collects its own which DoPipeline() merges
+   at the end.
+
+   18.10.26 Original   By: agent
+   18.10.26 Collects HBond statistics   By: agent
+*/
+void *PipeWorker(void *arg)
+{
+   PIPELINE *pl    = (PIPELINE *)arg;
+   PIPEITEM *item;
+   HBSTATS  *stats = NULL;
+   int      j;
+
+   if(pl->Stats != NULL)
+      stats = pl->Stats[atomic_fetch_add(&pl->NextStats, 1)];
+
+   while(((item = (PIPEITEM *)LFQPop(pl->ToCompute, &pl->Abort)) 
+          != NULL) && (item != &(pl->EndMark)))
+   {
+      if(!item->Done && !item->Error)
+      {
+         if(gInterface)
+         {
+            item->Energy = InterfaceEnergy(item->HBonds, item->NHBonds,
+                                           pl->eparams, item->Pairs, 
+                                           &(item->NPairs));
+            for(item->NHBonds=0, j=0; j<item->NPairs; j++)
+               item->NHBonds += item->Pairs[j].NHBonds;
+         }
+         else
+         {
+            item->Energy = EHBondStats(item->HBonds, item->NHBonds, 
+                                       pl->eparams, stats);
+         }
+      }
+      
+      if(!LFQPush(pl->ToWrite, item, &pl->Abort))
+         break;
+   }
+
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>void PrintQueueStats(char *name, LFQUEUE *q)
+   --------------------------------------------
+   Prints the statistics for one pipeline queue
+
+   18.10.26 Original   By: agent
+*/
+void PrintQueueStats(char *name, LFQUEUE *q)
+{
+   unsigned long NPush = atomic_load(&(q->NPush));
+   
+   fprintf(stderr,"%-16s %8d %10.2f %8lu %8lu %8lu\n", name, 
+           LFQCapacity(q),
+           NPush ? (double)atomic_load(&(q->DepthSum)) / NPush : 0.0,
+           atomic_load(&(q->MaxDepth)), atomic_load(&(q->NFull)),
+           atomic_load(&(q->NEmpty)));
+}
+
+
+/************************************************************************/
+/*>void PrintInterface(BATCHREC *rec)
+   ----------------------------------
+   Prints the interface energy of a file and its chain pairs
+
+   18.10.26 Original   (from DoBatch())   By: agent
+*/
+void PrintInterface(BATCHREC *rec)
+{
+   int j;
+   
+   printf("%s Interface energy = %f\n", rec->Name, rec->Energy);
+   for(j=0; j<rec->NPairs; j++)
+   {
+      printf("%s %c:%c %f %d\n", rec->Name,
+             rec->Pairs[j].ChainX, rec->Pairs[j].ChainY,
+             rec->Pairs[j].Energy, rec->Pairs[j].NHBonds);
+   }
+}
+
+
+/************************************************************************/
+/*>REAL InterfaceEnergy(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                        CHAINPAIR *pairs, int *NPairs)
+   -------------------------------------------------------------------
+   Scores only the HBonds where the donor and acceptor are in different
+   chains (from the first character of the HBPlus residue IDs). The
+   energy for each pair of chains is accumulated in pairs, which are
+   returned sorted by chain. Returns the total interface energy.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+REAL InterfaceEnergy(HBONDS *HBonds, int NHBonds, EPARAMS *eparams,
+                     CHAINPAIR *pairs, int *NPairs)
+{
+   REAL      ETot  = (REAL)0.0,
+             EComp = (REAL)0.0,
+             e;
+   int       i, j,
+             last  = (-1);
+   char      cx, cy;
+   CHAINPAIR tmp;
+
+   *NPairs = 0;
+   
+   for(i=0; i<NHBonds; i++)
+   {
+      cx = HBonds[i].ResID_D[0];
+      cy = HBonds[i].ResID_A[0];
+      if(cx == cy)
+         continue;
+      if(cx > cy)
+      {
+         char c = cx;
+         cx = cy;
+         cy = c;
+      }
+
+      /* Find the chain pair - usually the same as the last bond        */
+      if((last < 0) || 
+         (pairs[last].ChainX != cx) || (pairs[last].ChainY != cy))
+      {
+         for(last=0; last<*NPairs; last++)
+         {
+            if((pairs[last].ChainX == cx) && (pairs[last].ChainY == cy))
+               break;
+         }
+         if(last == *NPairs)
+         {
+            if(*NPairs == MAXCHAINPAIR)
+            {
+               fprintf(stderr,"Too many chain pairs, increase \
+MAXCHAINPAIR\n");
+               last = (-1);
+               continue;
+            }
+            pairs[last].ChainX  = cx;
+            pairs[last].ChainY  = cy;
+            pairs[last].Energy  = (REAL)0.0;
+            pairs[last].EComp   = (REAL)0.0;
+            pairs[last].NHBonds = 0;
+            (*NPairs)++;
+         }
+      }
+
+      e = BondEnergy(&(HBonds[i]), eparams);
+      CompensatedAdd(&(pairs[last].Energy), &(pairs[last].EComp), e);
+      CompensatedAdd(&ETot, &EComp, e);
+      pairs[last].NHBonds++;
+   }
+
+   for(i=0; i<*NPairs; i++)
+   {
+      pairs[i].Energy += pairs[i].EComp;
+      pairs[i].EComp   = (REAL)0.0;
+   }
+
+   /* Sort the pairs by chain                                           */
+   for(i=1; i<*NPairs; i++)
+   {
+      tmp = pairs[i];
+      for(j=i; j>0 && ((pairs[j-1].ChainX > tmp.ChainX) ||
+                       ((pairs[j-1].ChainX == tmp.ChainX) &&
+                        (pairs[j-1].ChainY > tmp.ChainY))); j--)
+         pairs[j] = pairs[j-1];
+      pairs[j] = tmp;
+   }
+
+   return(ETot + EComp);
+}
+
+
+/************************************************************************/
+/*>int DoTrajectory(char *topfile, char *trajfile, EPARAMS *eparams)
+   -----------------------------------------------------------------
+   Trajectory mode. Reads the atoms from the first model of topfile
+   and scores each model of that file, or each frame of the DCD file
+   trajfile if one is given. Frames are read in blocks and each block
+   is shared between threads. The energy time series is written to 
+   stdout. With --stats, the number of times the threads built their
+   pair lists is reported at the end. Returns the program exit status.
+
+   18.10.26 Original   By: agent
+   18.10.26 Reports the pair list builds with --stats   By: agent
+*/
+int DoTrajectory(char *topfile, char *trajfile, EPARAMS *eparams)
+{
+   TOPOLOGY  topo;
+   TRAJWORK  work[MAXTHREAD];
+   pthread_t threads[MAXTHREAD];
+   BOOL      started[MAXTHREAD],
+             swap     = FALSE,
+             UnitCell = FALSE,
+             FourD    = FALSE,
+             eof      = FALSE;
+   FILE      *fp,
+             *tfp;
+   float     *xyz     = NULL,
+             *buffer  = NULL;
+   REAL      *energy  = NULL;
+   int       NThreads,
+             BlockSize,
+             PerThread,
+             NRead,
+             NBuilds  = 0,
+             NFrame   = 0,
+             first,
+             i,
+             t;
+   size_t    FrameSize;
+
+   if((fp=fopen(topfile,"r"))==NULL)
+   {
+      fprintf(stderr,"Unable to open PDB file: %s\n", topfile);
+      return(1);
+   }
+   if(!ReadTopology(fp, &topo))
+   {
+      fprintf(stderr,"Unable to read atoms from PDB file: %s\n", 
+              topfile);
+      return(1);
+   }
+
+   /* Frames come either from a DCD file or from the models of the PDB
+      file itself
+   */
+   if(trajfile[0])
+   {
+      if((tfp=fopen(trajfile,"rb"))==NULL)
+      {
+         fprintf(stderr,"Unable to open trajectory file: %s\n", 
+                 trajfile);
+         return(1);
+      }
+      if(!OpenDCD(tfp, topo.NAtoms, &swap, &UnitCell, &FourD))
+         return(1);
+   }
+   else
+   {
+      rewind(fp);
+      tfp = fp;
+   }
+
+   if((NThreads = gNThreads) == 0)
+      NThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   NThreads  = MAX(1, MIN(NThreads, MAXTHREAD));
+   BlockSize = NThreads * FRAMESPERTHREAD;
+   FrameSize = 3 * (size_t)topo.NAtoms;
+
+   xyz    = (float *)malloc(BlockSize * FrameSize * sizeof(float));
+   buffer = (float *)malloc(topo.NAtoms * sizeof(float));
+   energy = (REAL *)malloc(BlockSize * sizeof(REAL));
+   if((xyz==NULL) || (buffer==NULL) || (energy==NULL))
+   {
+      fprintf(stderr,"No memory for trajectory frames\n");
+      return(1);
+   }
+
+   for(t=0; t<NThreads; t++)
+   {
+      work[t].topo     = &topo;
+      work[t].eparams  = eparams;
+      work[t].MaxCells = 0;
+      work[t].CellHead = NULL;
+      work[t].NPairs   = 0;
+      work[t].MaxPairs = 0;
+      work[t].PairD    = NULL;
+      work[t].PairA    = NULL;
+      work[t].NBuilds  = 0;
+      work[t].HaveList = FALSE;
+      work[t].CellNext = 
+         (int *)malloc(MAX(1, topo.NAcceptors) * sizeof(int));
+      work[t].RefXYZ   = (float *)malloc(FrameSize * sizeof(float));
+      if((work[t].CellNext == NULL) || (work[t].RefXYZ == NULL))
+      {
+         fprintf(stderr,"No memory for thread work space\n");
+         return(1);
+      }
+   }
+
+   while(!eof)
+   {
+      /* Read the next block of frames                                  */
+      for(NRead=0; NRead<BlockSize; NRead++)
+      {
+         float *frame = xyz + NRead * FrameSize;
+         
+         if(trajfile[0] ?
+            !ReadDCDFrame(tfp, topo.NAtoms, swap, UnitCell, FourD, 
+                          frame, buffer) :
+            !ReadPDBFrame(tfp, topo.NAtoms, frame))
+         {
+            eof = TRUE;
+            break;
+         }
+      }
+      if(NRead == 0)
+         break;
+
+      /* Give each thread a contiguous run of frames. If a thread can't
+         be started, its frames are scored here instead
+      */
+      PerThread = (NRead + NThreads - 1) / NThreads;
+      for(t=0, first=0; first<NRead; t++, first+=PerThread)
+      {
+         work[t].xyz     = xyz + first * FrameSize;
+         work[t].energy  = energy + first;
+         work[t].NFrames = MIN(PerThread, NRead - first);
+         started[t]      = (pthread_create(&(threads[t]), NULL, 
+                                           TrajThread, 
+                                           (void *)&(work[t])) == 0);
+         if(!started[t])
+            TrajThread((void *)&(work[t]));
+      }
+      while(t--)
+      {
+         if(started[t])
+            pthread_join(threads[t], NULL);
+      }
+
+      for(i=0; i<NRead; i++)
+         printf("%d %f\n", ++NFrame, energy[i]);
+   }
+
+   if(gStats)
+   {
+      for(t=0; t<NThreads; t++)
+         NBuilds += work[t].NBuilds;
+      fprintf(stderr,"Pair lists: %d frames, %d threads, skin %.2f, \
+%d builds (%.1f frames per build)\n", NFrame, NThreads, gSkin, NBuilds,
+              NBuilds ? (double)NFrame / NBuilds : 0.0);
+   }
+
+   for(t=0; t<NThreads; t++)
+   {
+      free(work[t].CellNext);
+      free(work[t].RefXYZ);
+      if(work[t].CellHead != NULL)
+         free(work[t].CellHead);
+      if(work[t].PairD != NULL)
+         free(work[t].PairD);
+      if(work[t].PairA != NULL)
+         free(work[t].PairA);
+   }
+   free(xyz);
+   free(buffer);
+   free(energy);
+   FreeTopology(&topo);
+   if(tfp != fp)
+      fclose(tfp);
+   fclose(fp);
+   
+   return(0);
+}
+
+
+/************************************************************************/
+/*>void *TrajThread(void *arg)
+   ---------------------------
+   Thread function to score a run of frames
+
+   18.10.26 Original   By: agent
+*/
+void *TrajThread(void *arg)
+{
+   TRAJWORK *work = (TRAJWORK *)arg;
+   size_t   FrameSize;
+   int      i;
+
+   FrameSize = 3 * (size_t)work->topo->NAtoms;
+   for(i=0; i<work->NFrames; i++)
+   {
+      work->energy[i] = FrameEnergy(work->topo, work->xyz + i*FrameSize,
+                                    work->eparams, work);
+   }
+   
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadTopology(FILE *fp, TOPOLOGY *topo)
+   -------------------------------------------
+   Reads the ATOM/HETATM records of the first model of a PDB file and
+   assigns donors and acceptors with FindPolarAtoms() (hbenergy.c) as
+   ehb2 and ehb3 do. Each hydrogen is assigned to the nearest N or O
+   in the same residue within XHBOND. Acceptors are all oxygens plus
+   the unprotonated ring nitrogens of histidine.
+
+   18.10.26 Original   By: agent
+   18.10.26 Donors and acceptors found by FindPolarAtoms()   By: agent
+   18.10.26 Fixed width fields copied with memcpy()   By: agent
+*/
+BOOL ReadTopology(FILE *fp, TOPOLOGY *topo)
+{
+   char     buffer[MAXBUFF],
+            field[16],
+            PrevRes[16];
+   PDB      *atoms    = NULL,
+            *p;
+   RESPOLAR polar;
+   int      MaxAtoms  = 0,
+            NRes      = 0,
+            i, j, k, d, h;
+
+   topo->NAtoms     = 0;
+   topo->NDonors    = 0;
+   topo->NAcceptors = 0;
+   topo->AtomName   = NULL;
+   topo->ResID      = NULL;
+   topo->ResIndex   = NULL;
+   PrevRes[0]       = '\0';
+   
+   while(fgets(buffer, MAXBUFF, fp))
+   {
+      if(!strncmp(buffer, "ENDMDL", 6))
+         break;
+      if(strncmp(buffer, "ATOM  ", 6) && strncmp(buffer, "HETATM", 6))
+         continue;
+      if(strlen(buffer) < 54)
+         continue;
+
+      if(topo->NAtoms == MaxAtoms)
+      {
+         MaxAtoms = MaxAtoms ? 2*MaxAtoms : 1024;
+         topo->AtomName = (char (*)[8])realloc(topo->AtomName, 
+                                               MaxAtoms * 8);
+         topo->ResID    = (char (*)[8])realloc(topo->ResID, 
+                                               MaxAtoms * 8);
+         topo->ResIndex = (int *)realloc(topo->ResIndex, 
+                                         MaxAtoms * sizeof(int));
+         atoms   = (PDB *)realloc(atoms, MaxAtoms * sizeof(PDB));
+         if((topo->AtomName==NULL) || (topo->ResID==NULL) || 
+            (topo->ResIndex==NULL) || (atoms==NULL))
+            return(FALSE);
+      }
+      i = topo->NAtoms++;
+      p = atoms + i;
+      memset(p, 0, sizeof(PDB));
+      
+      /* Atom name, trimmed                                             */
+      for(j=12, k=0; j<16; j++)
+      {
+         if(buffer[j] != ' ')
+            topo->AtomName[i][k++] = buffer[j];
+      }
+      topo->AtomName[i][k] = '\0';
+      strcpy(p->atnam, topo->AtomName[i]);
+      memcpy(p->resnam, buffer+17, 3);
+      p->resnam[3] = '\0';
+
+      /* HBPlus style residue ID and sequential residue number          */
+      memcpy(field, buffer+22, 4);
+      field[4] = '\0';
+      p->resnum    = atoi(field);
+      p->chain[0]  = buffer[21];
+      p->insert[0] = buffer[26];
+      sprintf(topo->ResID[i], "%c%04d%c", 
+              (buffer[21]==' ') ? '-' : buffer[21], p->resnum,
+              (buffer[26]==' ') ? '-' : buffer[26]);
+      if(strcmp(topo->ResID[i], PrevRes))
+      {
+         NRes++;
+         strcpy(PrevRes, topo->ResID[i]);
+      }
+      topo->ResIndex[i] = NRes;
+
+      memcpy(field, buffer+30, 8);
+      field[8] = '\0';
+      p->x = (REAL)atof(field);
+      memcpy(field, buffer+38, 8);
+      field[8] = '\0';
+      p->y = (REAL)atof(field);
+      memcpy(field, buffer+46, 8);
+      field[8] = '\0';
+      p->z = (REAL)atof(field);
+   }
+
+   if(topo->NAtoms == 0)
+      return(FALSE);
+
+   topo->Donor    = (int *)malloc(topo->NAtoms * sizeof(int));
+   topo->NH       = (int *)malloc(topo->NAtoms * sizeof(int));
+   topo->DonorH   = (int (*)[MAXHPERD])malloc(topo->NAtoms * 
+                                              MAXHPERD * sizeof(int));
+   topo->Acceptor = (int *)malloc(topo->NAtoms * sizeof(int));
+   if((topo->Donor==NULL) || (topo->NH==NULL) || (topo->DonorH==NULL) ||
+      (topo->Acceptor==NULL))
+   {
+      free(atoms);
+      return(FALSE);
+   }
+
+   /* Link the atoms now that the array will not move                   */
+   for(i=0; i<topo->NAtoms; i++)
+      atoms[i].next = (i+1 < topo->NAtoms) ? atoms+i+1 : NULL;
+
+   /* Find the donors and acceptors of each residue in turn. Atoms of a 
+      residue are contiguous
+   */
+   for(i=0; i<topo->NAtoms; i=j)
+   {
+      FindPolarAtoms(atoms+i, &polar);
+      for(d=0; d<polar.NDonors; d++)
+      {
+         topo->Donor[topo->NDonors] = (int)(polar.Donor[d] - atoms);
+         topo->NH[topo->NDonors]    = polar.NH[d];
+         for(h=0; h<polar.NH[d]; h++)
+            topo->DonorH[topo->NDonors][h] = 
+               (int)(polar.DonorH[d][h] - atoms);
+         topo->NDonors++;
+      }
+      for(k=0; k<polar.NAcceptors; k++)
+         topo->Acceptor[topo->NAcceptors++] = 
+            (int)(polar.Acceptor[k] - atoms);
+
+      for(j=i+1; (j<topo->NAtoms) && SAMERES(atoms+j, atoms+i); j++);
+   }
+
+   free(atoms);
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void FreeTopology(TOPOLOGY *topo)
+   ---------------------------------
+   Frees the arrays in a topology
+
+   18.10.26 Original   By: agent
+*/
+void FreeTopology(TOPOLOGY *topo)
+{
+   free(topo->AtomName);
+   free(topo->ResID);
+   free(topo->ResIndex);
+   free(topo->Donor);
+   free(topo->NH);
+   free(topo->DonorH);
+   free(topo->Acceptor);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadPDBFrame(FILE *fp, int NAtoms, float *xyz)
+   ---------------------------------------------------
+   Reads the coordinates of the next model from a PDB file. Returns
+   FALSE at the end of the file or if the model does not have the
+   expected number of atoms.
+
+   18.10.26 Original   By: agent
+   18.10.26 Fixed width fields copied with memcpy()   By: agent
+*/
+BOOL ReadPDBFrame(FILE *fp, int NAtoms, float *xyz)
+{
+   char buffer[MAXBUFF],
+        field[16];
+   int  n = 0,
+        k;
+   
+   while(fgets(buffer, MAXBUFF, fp))
+   {
+      if(!strncmp(buffer, "ENDMDL", 6))
+         break;
+      if(strncmp(buffer, "ATOM  ", 6) && strncmp(buffer, "HETATM", 6))
+         continue;
+      if(strlen(buffer) < 54)
+         continue;
+      
+      if(n == NAtoms)
+      {
+         fprintf(stderr,"Model has more atoms than the first model\n");
+         return(FALSE);
+      }
+      for(k=0; k<3; k++)
+      {
+         memcpy(field, buffer+30+8*k, 8);
+         field[8] = '\0';
+         xyz[3*n+k] = (float)atof(field);
+      }
+      n++;
+   }
+
+   if((n != 0) && (n != NAtoms))
+      fprintf(stderr,"Model has fewer atoms than the first model\n");
+
+   return(n == NAtoms);
+}
+
+
+/************************************************************************/
+/*>void SwapBytes4(void *data, int n)
+   ----------------------------------
+   Reverses the byte order of n 4-byte words
+
+   18.10.26 Original   By: agent
+*/
+void SwapBytes4(void *data, int n)
+{
+   unsigned char *b = (unsigned char *)data,
+                 tmp;
+   int           i;
+   
+   for(i=0; i<n; i++, b+=4)
+   {
+      tmp = b[0]; b[0] = b[3]; b[3] = tmp;
+      tmp = b[1]; b[1] = b[2]; b[2] = tmp;
+   }
+}
+
+
+/************************************************************************/
+/*>int ReadFortranRecord(FILE *fp, void *data, int maxlen, BOOL swap)
+   ------------------------------------------------------------------
+   Reads one Fortran unformatted record. If data is NULL the record is
+   skipped. The data are not byte swapped; swap applies only to the
+   record length markers. Returns the record length or -1 on error.
+
+   18.10.26 Original   By: agent
+*/
+int ReadFortranRecord(FILE *fp, void *data, int maxlen, BOOL swap)
+{
+   int len, 
+       trail;
+   
+   if(fread(&len, 4, 1, fp) != 1)
+      return(-1);
+   if(swap)
+      SwapBytes4(&len, 1);
+   if(len < 0)
+      return(-1);
+
+   if(data == NULL)
+   {
+      if(fseek(fp, (long)len, SEEK_CUR))
+         return(-1);
+   }
+   else if((len > maxlen) || (fread(data, 1, len, fp) != (size_t)len))
+   {
+      return(-1);
+   }
+   
+   if(fread(&trail, 4, 1, fp) != 1)
+      return(-1);
+   if(swap)
+      SwapBytes4(&trail, 1);
+   
+   return((trail == len) ? len : -1);
+}
+
+
+/************************************************************************/
+/*>BOOL OpenDCD(FILE *fp, int NAtoms, BOOL *swap, BOOL *UnitCell, 
+                BOOL *FourD)
+   -------------------------------------------------------------
+   Reads the header of a CHARMM/NAMD/X-PLOR DCD file, detecting the
+   byte order from the first record length. Checks the number of atoms
+   matches the topology.
+
+   18.10.26 Original   By: agent
+*/
+BOOL OpenDCD(FILE *fp, int NAtoms, BOOL *swap, BOOL *UnitCell, 
+             BOOL *FourD)
+{
+   int header[21],
+       natoms;
+
+   if(fread(header, 4, 1, fp) != 1)
+      return(FALSE);
+   *swap = FALSE;
+   if(header[0] != 84)
+   {
+      SwapBytes4(header, 1);
+      if(header[0] != 84)
+      {
+         fprintf(stderr,"Not a DCD file\n");
+         return(FALSE);
+      }
+      *swap = TRUE;
+   }
+   rewind(fp);
+
+   if((ReadFortranRecord(fp, header, sizeof(header), *swap) != 84) ||
+      strncmp((char *)header, "CORD", 4))
+   {
+      fprintf(stderr,"Not a DCD coordinate file\n");
+      return(FALSE);
+   }
+   if(*swap)
+      SwapBytes4(header+1, 20);
+
+   /* header[1..20] are the ICNTRL values. 9 is the number of fixed 
+      atoms, 20 is non-zero for CHARMM-style files which may then flag
+      unit cell (11) and 4D (12) data
+   */
+   if(header[9] != 0)
+   {
+      fprintf(stderr,"DCD files with fixed atoms are not supported\n");
+      return(FALSE);
+   }
+   *UnitCell = (header[20] != 0) && (header[11] != 0);
+   *FourD    = (header[20] != 0) && (header[12] != 0);
+
+   /* Skip the title record and read the number of atoms               */
+   if((ReadFortranRecord(fp, NULL, 0, *swap) < 0) ||
+      (ReadFortranRecord(fp, &natoms, 4, *swap) != 4))
+   {
+      fprintf(stderr,"Corrupt DCD header\n");
+      return(FALSE);
+   }
+   if(*swap)
+      SwapBytes4(&natoms, 1);
+   if(natoms != NAtoms)
+   {
+      fprintf(stderr,"DCD file has %d atoms but the PDB file has %d\n",
+              natoms, NAtoms);
+      return(FALSE);
+   }
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ReadDCDFrame(FILE *fp, int NAtoms, BOOL swap, BOOL UnitCell, 
+                     BOOL FourD, float *xyz, float *buffer)
+   ------------------------------------------------------------------
+   Reads the next frame from a DCD file into xyz (interleaved x,y,z).
+   buffer must hold NAtoms floats. Returns FALSE at end of file.
+
+   18.10.26 Original   By: agent
+*/
+BOOL ReadDCDFrame(FILE *fp, int NAtoms, BOOL swap, BOOL UnitCell, 
+                  BOOL FourD, float *xyz, float *buffer)
+{
+   int i, k;
+   
+   if(UnitCell && (ReadFortranRecord(fp, NULL, 0, swap) < 0))
+      return(FALSE);
+   
+   for(k=0; k<3; k++)
+   {
+      if(ReadFortranRecord(fp, buffer, NAtoms*4, swap) != NAtoms*4)
+         return(FALSE);
+      if(swap)
+         SwapBytes4(buffer, NAtoms);
+      for(i=0; i<NAtoms; i++)
+         xyz[3*i+k] = buffer[i];
+   }
+
+   if(FourD && (ReadFortranRecord(fp, NULL, 0, swap) < 0))
+      return(FALSE);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>REAL FrameEnergy(TOPOLOGY *topo, float *xyz, EPARAMS *eparams, 
+                    TRAJWORK *work)
+   ---------------------------------------------------------------
+   Calculates the HBond energy of one frame. The thread's Verlet list
+   of donor/acceptor pairs within CutOffHB + gSkin is rebuilt only if
+   it does not exist yet or some donor or acceptor has moved more than
+   half the skin since it was built; otherwise just the listed pairs
+   are scored.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses the Verlet list   By: agent
+*/
+REAL FrameEnergy(TOPOLOGY *topo, float *xyz, EPARAMS *eparams, 
+                 TRAJWORK *work)
+{
+   if((topo->NAcceptors == 0) || (topo->NDonors == 0))
+      return((REAL)0.0);
+
+   if(!work->HaveList || ListNeedsRebuild(topo, xyz, work))
+   {
+      if(!BuildPairList(topo, xyz, eparams->CutOffHB + gSkin, work))
+         return((REAL)0.0);
+   }
+   
+   return(ScorePairs(topo, xyz, eparams, work));
+}
+
+
+/************************************************************************/
+/*>BOOL ListNeedsRebuild(TOPOLOGY *topo, float *xyz, TRAJWORK *work)
+   -----------------------------------------------------------------
+   Tests whether any donor or acceptor has moved more than half the
+   skin distance since the pair list was built. If none has, no pair
+   can have come within CutOffHB without already being in the list.
+
+   18.10.26 Original   By: agent
+*/
+BOOL ListNeedsRebuild(TOPOLOGY *topo, float *xyz, TRAJWORK *work)
+{
+   float MaxSq,
+         dx, dy, dz;
+   int   i,
+         j;
+   
+   MaxSq = (float)(gSkin * gSkin / 4.0);
+
+   for(i=0; i<topo->NDonors; i++)
+   {
+      j  = 3 * topo->Donor[i];
+      dx = xyz[j]   - work->RefXYZ[j];
+      dy = xyz[j+1] - work->RefXYZ[j+1];
+      dz = xyz[j+2] - work->RefXYZ[j+2];
+      if(dx*dx + dy*dy + dz*dz > MaxSq)
+         return(TRUE);
+   }
+   for(i=0; i<topo->NAcceptors; i++)
+   {
+      j  = 3 * topo->Acceptor[i];
+      dx = xyz[j]   - work->RefXYZ[j];
+      dy = xyz[j+1] - work->RefXYZ[j+1];
+      dz = xyz[j+2] - work->RefXYZ[j+2];
+      if(dx*dx + dy*dy + dz*dz > MaxSq)
+         return(TRUE);
+   }
+
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>BOOL BuildPairList(TOPOLOGY *topo, float *xyz, REAL cutoff, 
+                      TRAJWORK *work)
+   -----------------------------------------------------------
+   Builds the list of donor/acceptor pairs (in different residues)
+   within cutoff. The acceptors are binned into a grid of cells at 
+   least cutoff across so only the 27 cells around each donor need be
+   searched. The coordinates are saved for ListNeedsRebuild().
+
+   18.10.26 Original   Split out of FrameEnergy()   By: agent
+*/
+BOOL BuildPairList(TOPOLOGY *topo, float *xyz, REAL cutoff, 
+                   TRAJWORK *work)
+{
+   float min[3],
+         max[3],
+         CutSq    = (float)(cutoff * cutoff),
+         CellSize = (float)cutoff;
+   int   ncell[3],
+         NCells,
+         cell[3],
+         a, d, i, k, 
+         dx, dy, dz;
+
+   work->HaveList = FALSE;
+   work->NPairs   = 0;
+   
+   /* Bounding box of the acceptors                                     */
+   for(k=0; k<3; k++)
+      min[k] = max[k] = xyz[3*topo->Acceptor[0]+k];
+   for(i=1; i<topo->NAcceptors; i++)
+   {
+      for(k=0; k<3; k++)
+      {
+         float c = xyz[3*topo->Acceptor[i]+k];
+         if(c < min[k]) min[k] = c;
+         if(c > max[k]) max[k] = c;
+      }
+   }
+
+   /* Size the grid, using bigger cells if a sparse system would need
+      an excessive number of them
+   */
+   for(;;)
+   {
+      for(k=0; k<3; k++)
+         ncell[k] = (int)((max[k] - min[k]) / CellSize) + 1;
+      NCells = ncell[0] * ncell[1] * ncell[2];
+      if(NCells <= MAX(64, 4*topo->NAcceptors))
+         break;
+      CellSize *= 1.5;
+   }
+   if(NCells > work->MaxCells)
+   {
+      if(work->CellHead != NULL)
+         free(work->CellHead);
+      if((work->CellHead = (int *)malloc(NCells * sizeof(int)))==NULL)
+      {
+         work->MaxCells = 0;
+         return(FALSE);
+      }
+      work->MaxCells = NCells;
+   }
+
+   for(i=0; i<NCells; i++)
+      work->CellHead[i] = (-1);
+   for(i=0; i<topo->NAcceptors; i++)
+   {
+      int c;
+      a = topo->Acceptor[i];
+      for(k=0; k<3; k++)
+         cell[k] = (int)((xyz[3*a+k] - min[k]) / CellSize);
+      c = (cell[2] * ncell[1] + cell[1]) * ncell[0] + cell[0];
+      work->CellNext[i]  = work->CellHead[c];
+      work->CellHead[c]  = i;
+   }
+
+   /* Search around each donor                                          */
+   for(d=0; d<topo->NDonors; d++)
+   {
+      int   D = topo->Donor[d];
+      float *pD = xyz + 3*D;
+
+      for(k=0; k<3; k++)
+         cell[k] = (int)floor((pD[k] - min[k]) / CellSize);
+
+      for(dz=-1; dz<=1; dz++)
+      {
+         if((cell[2]+dz < 0) || (cell[2]+dz >= ncell[2])) continue;
+         for(dy=-1; dy<=1; dy++)
+         {
+            if((cell[1]+dy < 0) || (cell[1]+dy >= ncell[1])) continue;
+            for(dx=-1; dx<=1; dx++)
+            {
+               if((cell[0]+dx < 0) || (cell[0]+dx >= ncell[0])) continue;
+               
+               for(i=work->CellHead[((cell[2]+dz) * ncell[1] + 
+                                     (cell[1]+dy)) * ncell[0] + 
+                                    (cell[0]+dx)];
+                   i >= 0;
+                   i=work->CellNext[i])
+               {
+                  float *pA;
+                  
+                  a = topo->Acceptor[i];
+                  if(topo->ResIndex[a] == topo->ResIndex[D])
+                     continue;
+                  pA = xyz + 3*a;
+                  if((pA[0]-pD[0])*(pA[0]-pD[0]) + 
+                     (pA[1]-pD[1])*(pA[1]-pD[1]) + 
+                     (pA[2]-pD[2])*(pA[2]-pD[2]) >= CutSq)
+                     continue;
+
+                  if(work->NPairs == work->MaxPairs)
+                  {
+                     int *newD, *newA;
+                     
+                     k    = work->MaxPairs ? 2*work->MaxPairs : 1024;
+                     newD = (int *)realloc(work->PairD, k*sizeof(int));
+                     if(newD != NULL)
+                        work->PairD = newD;
+                     newA = (int *)realloc(work->PairA, k*sizeof(int));
+                     if(newA != NULL)
+                        work->PairA = newA;
+                     if((newD == NULL) || (newA == NULL))
+                        return(FALSE);
+                     work->MaxPairs = k;
+                  }
+                  work->PairD[work->NPairs] = d;
+                  work->PairA[work->NPairs] = a;
+                  work->NPairs++;
+               }
+            }
+         }
+      }
+   }
+
+   memcpy(work->RefXYZ, xyz, 3 * (size_t)topo->NAtoms * sizeof(float));
+   work->HaveList = TRUE;
+   work->NBuilds++;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>REAL ScorePairs(TOPOLOGY *topo, float *xyz, EPARAMS *eparams, 
+                   TRAJWORK *work)
+   --------------------------------------------------------------
+   Scores the pairs in the Verlet list which are within CutOffHB in
+   this frame. Where a donor has several hydrogens, the one giving the
+   lowest energy is used.
+
+   18.10.26 Original   Split out of FrameEnergy()   By: agent
+   18.10.26 Uses BondEnergy()   By: agent
+*/
+REAL ScorePairs(TOPOLOGY *topo, float *xyz, EPARAMS *eparams, 
+                TRAJWORK *work)
+{
+   HBONDS hb;
+   REAL   ETot = (REAL)0.0;
+   float  CutSq;
+   int    p, 
+          h,
+          k;
+
+   CutSq = (float)eparams->CutOffHBSq;
+   
+   for(p=0; p<work->NPairs; p++)
+   {
+      int   d     = work->PairD[p],
+            a     = work->PairA[p],
+            D     = topo->Donor[d];
+      float *pD   = xyz + 3*D,
+            *pA   = xyz + 3*a,
+            DASq;
+      REAL  EBest = (REAL)0.0;
+      
+      DASq = (pA[0]-pD[0])*(pA[0]-pD[0]) + 
+             (pA[1]-pD[1])*(pA[1]-pD[1]) + 
+             (pA[2]-pD[2])*(pA[2]-pD[2]);
+      if(DASq >= CutSq)
+         continue;
+
+      strcpy(hb.AtomD, topo->AtomName[D]);
+      strcpy(hb.AtomA, topo->AtomName[a]);
+      hb.DistDA = sqrt((double)DASq);
+      
+      for(h=0; h<topo->NH[d]; h++)
+      {
+         float *pH = xyz + 3*topo->DonorH[d][h];
+         REAL  HD[3], HA[3], LenHD, LenHA, CosDHA, e;
+         
+         for(k=0; k<3; k++)
+         {
+            HD[k] = pD[k] - pH[k];
+            HA[k] = pA[k] - pH[k];
+         }
+         LenHD = sqrt(HD[0]*HD[0] + HD[1]*HD[1] + HD[2]*HD[2]);
+         LenHA = sqrt(HA[0]*HA[0] + HA[1]*HA[1] + HA[2]*HA[2]);
+         if((LenHD == (REAL)0.0) || (LenHA == (REAL)0.0))
+            continue;
+         CosDHA = (HD[0]*HA[0] + HD[1]*HA[1] + HD[2]*HA[2]) /
+                  (LenHD * LenHA);
+         CosDHA = MAX((REAL)(-1.0), MIN((REAL)1.0, CosDHA));
+         
+         hb.DistHA = LenHA;
+         hb.CosDHA = CosDHA;
+         if((e = BondEnergy(&hb, eparams)) < EBest)
+            EBest = e;
+      }
+      ETot += EBest;
+   }
+
+   return(ETot);
+}
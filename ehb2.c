@@ -3,8 +3,8 @@
    Program:    ehb2a
    File:       ehb2a.c
    
-   Version:    V1.2
-   Date:       23.09.05
+   Version:    V2.9
+   Date:       18.10.26
    Function:   Calculate total energy between two H-bonded residues
                identified by HBPlus
    
@@ -52,62 +52,196 @@
    V1.1  07.03.03   Added control file    By: ALC
    V1.2  23.09.05   Fixed various bugs and takes command line parameters
                     for potential type    By: ACRM
+   V1.3  18.10.26   Added -t threshold mode. The HBond term is first
+                    estimated in-process from the HBPlus geometry using
+                    the ehb potential and only bonds which pass the
+                    threshold are sent to ecalc   By: agent
+   V1.4  18.10.26   HBonds are held in a compact HBTABLE (hbtable.c) 
+                    with interned names rather than a fixed size array
+                    of HBONDS on the stack   By: agent
+   V1.5  18.10.26   Added --type, --chains and --res filters which are
+                    checked on the raw HBPlus columns before a line is
+                    parsed. The SS and OXT tests are now done the same 
+                    way rather than after reading every bond   By: agent
+   V1.6  18.10.26   Added interface mode (-i). Intra-chain HBonds are
+                    skipped when reading and totals are given for each
+                    pair of chains   By: agent
+   V1.7  18.10.26   Only the residues used by the HBonds (and their
+                    neighbours) are read from the PDB file (pdbindex.c)
+                    By: agent
+   V1.8  18.10.26   The parsed PDB file is kept in a binary cache 
+                    (pdbcache.c) which is mapped on later runs. -C 
+                    switches this off   By: agent
+   V1.9  18.10.26   The coordinate file may be mmCIF (cifread.c)   By: agent
+   V2.0  18.10.26   -o calculates the HBond energy in-process from the
+                    coordinates (hbenergy.c) rather than running ecalc.
+                    -V runs both and prints the difference. The 
+                    potential code is now shared in hbenergy.c   By: agent
+   V2.1  18.10.26   -r with -o relaxes the sidechains of the pair 
+                    in-process (relax.c) before calculating the HBond
+                    energy   By: agent
+   V2.2  18.10.26   ecalc jobs are run by ecalcrun.c rather than 
+                    system(). -j runs several at once and --timeout and
+                    --tries kill and retry runs which hang or fail. 
+                    Each job has its own files. Results are still 
+                    printed in order   By: agent
+   V2.3  18.10.26   Added list mode (-l) to process many structures in
+                    one run. Lists may be split with --shard i/N and 
+                    the results written to a partial result file with
+                    --partial; 'ehb2 merge' combines them (batch.c)
+                    By: agent
+   V2.4  18.10.26   List mode may keep a journal of the structures 
+                    done (--journal) and skip them when restarted 
+                    (journal.c)   By: agent
+   V2.5  18.10.26   HBPlus and PDB files may be gzip or zstd 
+                    compressed (zread.c)   By: agent
+   V2.6  18.10.26   Added --matrix which writes the residue x residue
+                    energy matrix of a structure in binary CSR form 
+                    (resmatrix.c)   By: agent
+   V2.7  18.10.26   -t estimates are no longer added to the totals, the
+                    batch results or the matrix; their total is given
+                    separately. -t may not be used with -o   By: agent
+   V2.8  18.10.26   -o overrides -r again, as it did before V2.1. The
+                    in-process relaxation (relax.c) is now -R, which
+                    implies -o. A failed relaxation fails the structure
+                    By: agent
+   V2.9  18.10.26   ReadNeededResidues() moved to pdbread.c, which is
+                    shared with ehb3   By: agent
 
 *************************************************************************/
 /* Includes
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
 #include <unistd.h>
 #include "bioplib/macros.h"
 #include "bioplib/pdb.h"
 #include "bioplib/fsscanf.h"
 #include "bioplib/MathUtil.h"
+#include "hbtable.h"
+#include "pdbindex.h"
+#include "pdbread.h"
+#include "pdbcache.h"
+#include "cifread.h"
+#include "hbenergy.h"
+#include "relax.h"
+#include "ecalcrun.h"
+#include "batch.h"
+#include "journal.h"
+#include "zread.h"
+#include "resmatrix.h"
 
 /************************************************************************/
 /* Defines and macros
 */
-#define MAXHBOND 10000
 #define MAXBUFF  256
 #define NSKIP    8  /* Number of header lines at start of HBPlus output */
 #define CUTSQ    3.5
+#define MAXTYPES 4  /* MM, MS, SM, SS                                   */
+#define MINLINE  35 /* Shortest HBPlus line (up to the bond type)       */
+#define MAXCHAINPAIR 256 /* Max chain pairs in interface mode           */
+#define SRC_EHB      1   /* Energy calculated in-process                */
+#define SRC_ECALC    2   /* ...or by ecalc                              */
 
+/* Column offsets in an HBPlus .hb2 line                                */
+#define COL_CHAIND   0
+#define COL_RESNUMD  1
+#define COL_ATOMD    10
+#define COL_CHAINA   14
+#define COL_RESNUMA  15
+#define COL_ATOMA    24
+#define COL_TYPE     33
+
+/* Filters applied to the raw .hb2 lines. Chains are as written by 
+   HBPlus, i.e. '-' for a blank chain
+*/
 typedef struct
 {
-   char AtomD[8],
-        AtomA[8],
-        AtomH[8],
-        ResID_D[8],
-        ResID_A[8],
-        Resnam_D[8],
-        Resnam_A[8],
-        type[8];
-   REAL DistDA,
-        AngDHA,
-        DistHA,
-        AngHAAA,
-        AngDAAA;
-}  HBONDS;
+   char Types[MAXTYPES][3];   /* Bond types to keep (none = all)        */
+   int  NTypes;
+   char ChainX,               /* Chain pair to keep (either way round)  */
+        ChainY,
+        ResChain;             /* Chain for residue window (0 = any)     */
+   int  ResFirst,             /* Residue window - both residues must    */
+        ResLast;              /* lie inside it                          */
+   BOOL DoChains,
+        DoRes,
+        Interface;            /* Only keep inter-chain bonds            */
+}  HBFILTER;
+
+/* Interface mode total for one pair of chains (ChainX < ChainY)       */
+typedef struct
+{
+   REAL Energy;
+   int  NHBonds;
+   char ChainX,
+        ChainY;
+}  CHAINPAIR;
+
+/* The energy of one bond, held until it can be printed in order       */
+typedef struct
+{
+   REAL Energy,
+        Native;               /* In-process value for -V                */
+   int  Source;               /* SRC_EHB or SRC_ECALC                   */
+   BOOL Done,
+        Estimated;            /* -t estimate; not in the totals         */
+}  BONDRESULT;
 
 /************************************************************************/
 /* Globals
 */
 BOOL gRelax = FALSE;
+BOOL gRelaxInProcess = FALSE;
 BOOL gHBOnly = FALSE;
+BOOL gTiered = FALSE;
+REAL gThreshold = (REAL)0.0;
+BOOL gUseCache = TRUE;
+BOOL gValidate = FALSE;
+int  gNJobs = 1;
+REAL gTimeout = (REAL)0.0;
+int  gTries = ERUN_TRIES;
+char *gListFile = NULL;
+int  gShard = 0;
+int  gNShards = 1;
+char *gPartial = NULL;
+char *gJournal = NULL;
+char *gMatrixFile = NULL;
+HBFILTER gFilter = {{"SS"}, 1, '\0', '\0', '\0', 0, 0, FALSE, FALSE, 
+                    FALSE};
 
 /************************************************************************/
 /* Prototypes
 */
 BOOL ParseCmdLine(int argc, char **argv, char *PDBFile, char *HBPlusFile);
-BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i);
+BOOL ProcessStructure(char *PDBFile, char *HBPlusFile, EPARAMS *eparams,
+                      ECALCRUN *run, RELAXWORK *work, BATCH *batch);
+BOOL CalcEnergy(char *PDBFile, PDB **ppdb, HBTABLE *hbt, int i, 
+                EPARAMS *eparams, ECALCRUN *run, RELAXWORK *work,
+                BONDRESULT *results);
+BOOL CollectECalcResult(ECALCRUN *run, HBTABLE *hbt, 
+                        BONDRESULT *results);
+int PrintResults(HBTABLE *hbt, BONDRESULT *results, int NPrinted,
+                 CHAINPAIR *pairs, int *NPairs);
 void Usage(void);
 int main(int argc, char **argv);
-int ReadHBonds(char *filename, HBONDS *HBonds);
+int ReadHBonds(char *filename, HBTABLE *hbt);
 void FixHydrogenAtomNames(PDB *pdb);
 PDB *CopyAndFixResidue(PDB *pdb, char chain);
-REAL ParseECalcOutput(char *EnergyFile);
 PDB *FixResidue(PDB *res);
 PDB *CopyResidue(PDB *pdb, char chain);
+REAL EOneHBond(HBTABLE *hbt, int i, EPARAMS *eparams);
+BOOL ParseTypes(char *list, HBFILTER *filter);
+BOOL ParseChains(char *pair, HBFILTER *filter);
+BOOL ParseResRange(char *range, HBFILTER *filter);
+BOOL KeepHBondLine(char *buffer, HBFILTER *filter);
+int RawResnum(char *field);
+int AddChainPair(CHAINPAIR *pairs, int NPairs, char cx, char cy, 
+                 REAL energy);
+void BuildOptions(char *options);
 
 /************************************************************************/
 /*>int main(int argc, char **argv)
@@ -115,40 +249,285 @@ PDB *CopyResidue(PDB *pdb, char chain);
    Main program
 
    06.02.03 Original   By: ACRM
+   18.10.26 Added threshold mode   By: agent
+   18.10.26 Uses HBTABLE   By: agent
+   18.10.26 Bond type and OXT checks moved into ReadHBonds(). Reports
+            the HBPlus bond number   By: agent
+   18.10.26 Prints chain pair totals in interface mode   By: agent
+   18.10.26 Runs ecalc jobs through an ECALCRUN and prints the results
+            in order as they become available   By: agent
+   18.10.26 Work on one structure moved to ProcessStructure(). Added
+            list mode, sharding, partial results and merge   By: agent
+   18.10.26 Added the journal   By: agent
+   18.10.26 Creates the relaxation work space for -R   By: agent
 */
 int main(int argc, char **argv)
 {
-   char    PDBFile[MAXBUFF],
-           HBPlusFile[MAXBUFF];
-   HBONDS  HBonds[MAXHBOND];
-   int     NHBonds, i;
+   char     PDBFile[MAXBUFF],
+            HBPlusFile[MAXBUFF],
+            options[BAT_MAXOPT],
+            buffer[MAXBUFF];
+   FILE     *fp;
+   EPARAMS  eparams;
+   ECALCRUN  *run;
+   RELAXWORK *work    = NULL;
+   BATCH     *batch;
+   JOURNAL   *journal = NULL;
+   BOOL      ok       = TRUE;
    
-   if(ParseCmdLine(argc, argv, PDBFile, HBPlusFile))
+   if((argc > 1) && !strcmp(argv[1], "merge"))
+      return(MergeMain(argc-1, argv+1, "ehb2"));
+
+   if(!ParseCmdLine(argc, argv, PDBFile, HBPlusFile))
    {
-      if((NHBonds = ReadHBonds(HBPlusFile, HBonds))==0)
+      Usage();
+      return(0);
+   }
+
+   SetDefaults(&eparams);
+   PrecalcParams(&eparams);
+
+   BuildOptions(options);
+   if(((run = CreateECalcRunner(gNJobs, gTimeout, gTries))==NULL) ||
+      (gRelaxInProcess && ((work = CreateRelaxWork())==NULL))      ||
+      ((batch = CreateBatch("ehb2", 
+                            gFilter.Interface ? "interface" : 
+                            (gHBOnly ? "hbond" : "energy"),
+                            options, gShard, gNShards))==NULL))
+   {
+      fprintf(stderr,"No memory for results\n");
+      return(1);
+   }
+
+   if(gListFile == NULL)
+   {
+      ok = ProcessStructure(PDBFile, HBPlusFile, &eparams, run, work,
+                            batch);
+   }
+   else
+   {
+      if((gJournal != NULL) && 
+         ((journal = OpenJournal(gJournal, batch))==NULL))
          return(1);
-      
+
+      /* Each line of the list gives a PDB file and HBPlus file         */
+      if(!strcmp(gListFile, "-"))
+      {
+         fp = stdin;
+      }
+      else if((fp = fopen(gListFile, "r"))==NULL)
+      {
+         fprintf(stderr,"Unable to read list file: %s\n", gListFile);
+         return(1);
+      }
+
+      while(ok && fgets(buffer, MAXBUFF, fp))
+      {
+         TERMINATE(buffer);
+         if((buffer[0] == '\0') || (buffer[0] == '#'))
+            continue;
+         if(sscanf(buffer, "%s %s", PDBFile, HBPlusFile) != 2)
+         {
+            fprintf(stderr,"Bad line in list file: %s\n", buffer);
+            ok = FALSE;
+            break;
+         }
+         if(!InShard(PDBFile, gShard, gNShards))
+            continue;
+
+         /* Structures already in the journal are not done again      */
+         if((journal != NULL) && (JournalDone(journal, PDBFile)!=NULL))
+         {
+            fprintf(stdout, "Structure: %s [journal]\n", PDBFile);
+            continue;
+         }
+
+         fprintf(stdout, "Structure: %s\n", PDBFile);
+         ok = ProcessStructure(PDBFile, HBPlusFile, &eparams, run, 
+                               work, batch);
+         if(ok && (journal != NULL))
+            ok = JournalRecord(journal, batch->Recs + batch->NRecs - 1);
+      }
+      if(fp != stdin)
+         fclose(fp);
+      if(!CloseJournal(journal))
+         ok = FALSE;
+
+      if(ok)
+         PrintBatchReport(stdout, batch);
+   }
+
+   if(ok && (gPartial != NULL))
+      ok = WritePartial(batch, gPartial);
+
+   FreeECalcRunner(run);
+   FreeRelaxWork(work);
+   FreeBatch(batch);
+
+   return(ok ? 0 : 1);
+}
+
+/************************************************************************/
+/*>BOOL ProcessStructure(char *PDBFile, char *HBPlusFile, 
+                         EPARAMS *eparams, ECALCRUN *run, 
+                         RELAXWORK *work, BATCH *batch)
+   ----------------------------------------------------------------------
+   Calculates and prints the energies of the HBonds in one structure.
+   The total energy (and chain pair totals in interface mode) are 
+   added to batch. With --matrix, the energies are also written as a
+   residue x residue matrix. Returns FALSE on failure.
+
+   With -t, the bonds whose energy was only estimated are left out of
+   the total, the batch results and the matrix (which hold ecalc 
+   energies) and their total is printed separately.
+
+   18.10.26 Original   (from main())   By: agent
+   18.10.26 Writes the residue energy matrix   By: agent
+   18.10.26 -t estimates kept out of the totals   By: agent
+   18.10.26 Takes the relaxation work space for -R   By: agent
+*/
+BOOL ProcessStructure(char *PDBFile, char *HBPlusFile, EPARAMS *eparams,
+                      ECALCRUN *run, RELAXWORK *work, BATCH *batch)
+{
+   HBTABLE    *hbt;
+   BONDRESULT *results;
+   BATCHREC   *rec;
+   CHAINPAIR  pairs[MAXCHAINPAIR];
+   PDB        *pdb     = NULL;
+   REAL       energy   = (REAL)0.0,
+              EEst     = (REAL)0.0;
+   BOOL       ok       = TRUE;
+   int        NHBonds, i,
+              NPrinted = 0,
+              NPairs   = 0,
+              NEst     = 0;
+
+   if((hbt = CreateHBTable())==NULL)
+   {
+      fprintf(stderr,"No memory for HBond table\n");
+      return(FALSE);
+   }
+   if((NHBonds = ReadHBonds(HBPlusFile, hbt))<0)
+   {
+      FreeHBTable(hbt);
+      return(FALSE);
+   }
+
+   if((results = (BONDRESULT *)calloc(MAX(NHBonds, 1), 
+                                      sizeof(BONDRESULT)))==NULL)
+   {
+      fprintf(stderr,"No memory for results\n");
+      FreeHBTable(hbt);
+      return(FALSE);
+   }
+   
+   /* Only the bonds which pass the filters (by default, sidechain-
+      sidechain HBonds not involving OXT) have been read
+   */
+   for(i=0; ok && (i<NHBonds); i++)
+   {
+      /* In threshold mode, only bonds whose HBond term passes the
+         threshold are sent to ecalc
+      */
+      if(gTiered && 
+         ((results[i].Energy = EOneHBond(hbt, i, eparams)) > 
+          gThreshold))
+      {
+         results[i].Source    = SRC_EHB;
+         results[i].Estimated = TRUE;
+         results[i].Done      = TRUE;
+      }
+      else if(!CalcEnergy(PDBFile, &pdb, hbt, i, eparams, run, work,
+                          results))
+      {
+         ok = FALSE;
+         break;
+      }
+
+      NPrinted = PrintResults(hbt, results, NPrinted, pairs, &NPairs);
+   }
+
+   /* Wait for the ecalc jobs which are still running. They are 
+      collected even after a failure so that the runner is empty for 
+      the next structure
+   */
+   while(ECalcRunnerBusy(run))
+   {
+      if(!CollectECalcResult(run, hbt, results))
+         ok = FALSE;
+      else if(ok)
+         NPrinted = PrintResults(hbt, results, NPrinted, pairs, &NPairs);
+   }
+
+   if(ok && gFilter.Interface)
+   {
+      for(i=0; i<NPairs; i++)
+      {
+         fprintf(stdout, "Chains %c:%c Energy: %.6f (%d HBonds)\n",
+                 pairs[i].ChainX, pairs[i].ChainY, 
+                 pairs[i].Energy, pairs[i].NHBonds);
+      }
+   }
+
+   if(ok)
+   {
       for(i=0; i<NHBonds; i++)
       {
-         /* If this is a sidechain-sidechain HBonds and doesn't involve
-            the OXT atoms (a bug in HBPlus...), then calculate the 
-            energy
-         */
-         if(!strncmp(HBonds[i].type, "SS", 2) &&
-            strncmp(HBonds[i].AtomD, "OXT", 3) &&
-            strncmp(HBonds[i].AtomA, "OXT", 3))
+         if(results[i].Estimated)
+         {
+            EEst += results[i].Energy;
+            NEst++;
+         }
+         else
          {
-            if(!CalcEnergy(PDBFile, HBonds, i))
-               return(1);
+            energy += results[i].Energy;
          }
       }
+      if(gTiered)
+         fprintf(stdout, "Estimated [ehb] Energy: %.6f (%d HBonds, not \
+in the totals)\n", EEst, NEst);
+
+      if((rec = AddBatchRecord(batch, PDBFile, energy, NHBonds - NEst))
+         ==NULL)
+         ok = FALSE;
+      for(i=0; ok && (i<NPairs); i++)
+      {
+         ok = AddBatchPair(rec, pairs[i].ChainX, pairs[i].ChainY,
+                           pairs[i].Energy, pairs[i].NHBonds);
+      }
+      if(!ok)
+         fprintf(stderr,"No memory for batch results\n");
    }
-   else
+
+   if(ok && (gMatrixFile != NULL))
    {
-      Usage();
+      RESMATRIX *rm;
+      
+      if((rm = CreateResMatrix())==NULL)
+         ok = FALSE;
+      for(i=0; ok && (i<NHBonds); i++)
+      {
+         if(results[i].Estimated)
+            continue;
+         ok = AddResMatrixBond(rm, 
+                               HBTRESID(hbt, hbt->ResD[i]), 
+                               HBTRESNAM(hbt, hbt->ResD[i]),
+                               HBTRESID(hbt, hbt->ResA[i]), 
+                               HBTRESNAM(hbt, hbt->ResA[i]),
+                               results[i].Energy);
+      }
+      if(!ok)
+         fprintf(stderr,"No memory for residue energy matrix\n");
+      else
+         ok = WriteResMatrix(rm, gMatrixFile);
+      FreeResMatrix(rm);
    }
 
-   return(0);
+   FREELIST(pdb, PDB);
+   free(results);
+   FreeHBTable(hbt);
+
+   return(ok);
 }
 
 /************************************************************************/
@@ -158,19 +537,112 @@ int main(int argc, char **argv)
 
    06.02.03 Original   By: ACRM
    23.09.05 Updated for V1.2
+   18.10.26 Added -t   By: agent
+   18.10.26 Added --type, --chains, --res   By: agent
+   18.10.26 Added -i   By: agent
+   18.10.26 Added -C   By: agent
+   18.10.26 Added -V   By: agent
+   18.10.26 -r may be used with -o   By: agent
+   18.10.26 Added -j, --timeout, --tries   By: agent
+   18.10.26 Added -l, --shard, --partial and merge   By: agent
+   18.10.26 Added --journal   By: agent
+   18.10.26 Added --matrix   By: agent
+   18.10.26 V2.7   By: agent
+   18.10.26 V2.8. Added -R   By: agent
+   18.10.26 V2.9   By: agent
 */
 void Usage(void)
 {
-   fprintf(stderr,"\nehb2 V1.2 (c) 2003-5, Dr. Andrew C.R. Martin, The \
+   fprintf(stderr,"\nehb2 V2.9 (c) 2003-5, Dr. Andrew C.R. Martin, The \
 University of Reading\n");
    fprintf(stderr, "and Dr. Alison L. Cuff\n");
+   fprintf(stderr, "V1.3 to V2.9 (c) 2026, agent\n");
    
-   fprintf(stderr,"\nUsage: ehb2a [-r][-o] pdhfile hbplusfile\n");
+   fprintf(stderr,"\nUsage: ehb2a [-r][-o][-R][-V][-i][-C][-t threshold][-j njobs]\n");
+   fprintf(stderr,"             [--timeout secs][--tries n][--type \
+t[,t...]][--chains X:Y]\n");
+   fprintf(stderr,"             [--res [X]first-[X]last] [--matrix file] \
+pdhfile hbplusfile\n");
+   fprintf(stderr,"       ehb2a [options] -l listfile [--shard i/N] \
+[--partial file]\n");
+   fprintf(stderr,"             [--journal file]\n");
+   fprintf(stderr,"       ehb2a merge [-p merged] partial \
+[partial ...]\n");
    fprintf(stderr,"\n       -r  Use the RELAX option in ecalc\n");
-   fprintf(stderr,"       -o  Calculate the hbond energy only (overrides -r)\n");
+   fprintf(stderr,"       -o  Calculate the hbond energy only (overrides \
+-r). This is done\n");
+   fprintf(stderr,"           in-process from the coordinates without \
+running ecalc\n");
+   fprintf(stderr,"       -R  As -o, but the two sidechains are first \
+relaxed in-process\n");
+   fprintf(stderr,"           with a simple model (HBond term, soft \
+repulsion and restraints\n");
+   fprintf(stderr,"           to the start positions). This is not \
+ecalc's RELAX and gives\n");
+   fprintf(stderr,"           different energies\n");
+   fprintf(stderr,"       -V  With -o, also run ecalc and print the \
+difference. Not with -R\n");
+   fprintf(stderr,"       -C  Do not use or write the binary cache of \
+the PDB file\n");
+   fprintf(stderr,"           (pdhfile%s)\n", PDBCACHE_EXT);
+   fprintf(stderr,"       -i  Interface mode. Only inter-chain HBonds \
+are used and the total\n");
+   fprintf(stderr,"           for each pair of chains is printed\n");
+   fprintf(stderr,"       -t  Threshold mode. The HBond energy is first \
+estimated from the\n");
+   fprintf(stderr,"           HBPlus geometry and only bonds with an \
+estimate <= threshold\n");
+   fprintf(stderr,"           are sent to ecalc. Each energy is tagged \
+[ehb] or [ecalc]. The\n");
+   fprintf(stderr,"           [ehb] estimates are totalled separately \
+and are not in the\n");
+   fprintf(stderr,"           totals, batch results or matrix. Not \
+with -o\n");
+   fprintf(stderr,"       -j  Number of ecalc jobs to run at once \
+(Default: 1)\n");
+   fprintf(stderr,"       --timeout Kill an ecalc run after this many \
+seconds (Default: none)\n");
+   fprintf(stderr,"       --tries  Number of times to run ecalc on a \
+bond before giving up\n");
+   fprintf(stderr,"                if it fails or times out \
+(Default: %d)\n", ERUN_TRIES);
+   fprintf(stderr,"       --type   Bond types to use (MM, MS, SM, SS or \
+ALL). Default: SS\n");
+   fprintf(stderr,"       --chains Only use bonds between chains X and \
+Y (- for a blank\n");
+   fprintf(stderr,"                chain; X:X for bonds within a chain)\n");
+   fprintf(stderr,"       --res    Only use bonds where both residues \
+are in this range\n");
+   fprintf(stderr,"                (e.g. A10-A80 or 10-80 for any chain)\n");
+   fprintf(stderr,"       --matrix Write the donor x acceptor residue \
+energy matrix to this\n");
+   fprintf(stderr,"                file in binary CSR form (see \
+resmatread.h). Not with -l\n");
+   fprintf(stderr,"       -l  List mode. Each line of listfile (- for \
+stdin) gives a pdhfile\n");
+   fprintf(stderr,"           and hbplusfile. The total for each \
+structure and over all\n");
+   fprintf(stderr,"           structures are printed at the end\n");
+   fprintf(stderr,"       --shard   With -l, only process the \
+structures in shard i of N\n");
+   fprintf(stderr,"                 (0 <= i < N) as chosen by a hash \
+of the pdhfile name\n");
+   fprintf(stderr,"       --partial With -l, also write the results \
+to this partial result\n");
+   fprintf(stderr,"                 file. ehb2a merge combines the \
+partials of all shards\n");
+   fprintf(stderr,"                 and prints the results. -p also \
+writes the merged results\n");
+   fprintf(stderr,"       --journal With -l, record each structure as \
+it is done in this\n");
+   fprintf(stderr,"                 journal. If the run is restarted \
+with the same journal,\n");
+   fprintf(stderr,"                 the structures already done are \
+skipped\n");
 
    fprintf(stderr,"\n       pdhfile    - PDB file with hydrogens output \
 from HBPlus (xxxx.h)\n");
+   fprintf(stderr,"                    or the equivalent mmCIF file\n");
    fprintf(stderr,"       hbplusfile - the main results file from HBPlus \
 (xxxx.hb2)\n");
 
@@ -192,6 +664,17 @@ together with the\n");
    Parse the command line
 
    06.02.03 Original   By: ACRM
+   18.10.26 Added -t   By: agent
+   18.10.26 Added --type, --chains, --res   By: agent
+   18.10.26 Added -i   By: agent
+   18.10.26 Added -C   By: agent
+   18.10.26 Added -V   By: agent
+   18.10.26 Added -j, --timeout, --tries   By: agent
+   18.10.26 Added -l, --shard, --partial   By: agent
+   18.10.26 Added --journal   By: agent
+   18.10.26 Added --matrix   By: agent
+   18.10.26 -t may not be used with -o   By: agent
+   18.10.26 Added -R. -o overrides -r   By: agent
 */
 BOOL ParseCmdLine(int argc, char **argv, char *PDBFile, char *HBPlusFile)
 {
@@ -205,9 +688,94 @@ BOOL ParseCmdLine(int argc, char **argv, char *PDBFile, char *HBPlusFile)
       case 'r':
          gRelax = TRUE;
          break;
+      case 'R':
+         gRelaxInProcess = TRUE;
+         gHBOnly         = TRUE;
+         break;
       case 'o':
          gHBOnly = TRUE;
          break;
+      case 'i':
+         gFilter.Interface = TRUE;
+         break;
+      case 'C':
+         gUseCache = FALSE;
+         break;
+      case 'V':
+         gValidate = TRUE;
+         break;
+      case 't':
+         argc--;
+         argv++;
+         if(!argc || !sscanf(argv[0], "%lf", &gThreshold))
+            return(FALSE);
+         gTiered = TRUE;
+         break;
+      case 'l':
+         argc--;
+         argv++;
+         if(!argc)
+            return(FALSE);
+         gListFile = argv[0];
+         break;
+      case 'j':
+         argc--;
+         argv++;
+         if(!argc || !sscanf(argv[0], "%d", &gNJobs) || (gNJobs < 1))
+            return(FALSE);
+         break;
+      case '-':
+         if(argc < 2)
+            return(FALSE);
+         if(!strcmp(argv[0], "--type"))
+         {
+            if(!ParseTypes(argv[1], &gFilter))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--chains"))
+         {
+            if(!ParseChains(argv[1], &gFilter))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--res"))
+         {
+            if(!ParseResRange(argv[1], &gFilter))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--timeout"))
+         {
+            if(!sscanf(argv[1], "%lf", &gTimeout) || (gTimeout < 0.0))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--tries"))
+         {
+            if(!sscanf(argv[1], "%d", &gTries) || (gTries < 1))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--shard"))
+         {
+            if(!ParseShard(argv[1], &gShard, &gNShards))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--partial"))
+         {
+            gPartial = argv[1];
+         }
+         else if(!strcmp(argv[0], "--journal"))
+         {
+            gJournal = argv[1];
+         }
+         else if(!strcmp(argv[0], "--matrix"))
+         {
+            gMatrixFile = argv[1];
+         }
+         else
+         {
+            return(FALSE);
+         }
+         argc--;
+         argv++;
+         break;
       case 'h':
          return(FALSE);
       default:
@@ -217,8 +785,30 @@ BOOL ParseCmdLine(int argc, char **argv, char *PDBFile, char *HBPlusFile)
       argc--;
       argv++;
    }
+
+   /* -o calculates every bond in-process so there is nothing to
+      estimate
+   */
+   if(gTiered && gHBOnly)
+      return(FALSE);
+
+   /* -o overrides -r. ecalc would not use the -R relaxation so it can't
+      validate it
+   */
+   if(gHBOnly)
+      gRelax = FALSE;
+   if(gRelaxInProcess && gValidate)
+      return(FALSE);
    
-   if(argc != 2)
+   /* In list mode the files come from the list. The residue energy 
+      matrix is for a single structure
+   */
+   if(gListFile != NULL)
+      return((argc == 0) && (gMatrixFile == NULL));
+
+   /* Sharding and partial results are only for lists of structures   */
+   if((argc != 2) || (gNShards > 1) || (gPartial != NULL) || 
+      (gJournal != NULL))
       return(FALSE);
    
    strcpy(PDBFile,argv[0]);
@@ -229,24 +819,42 @@ BOOL ParseCmdLine(int argc, char **argv, char *PDBFile, char *HBPlusFile)
 }
 
 /************************************************************************/
-/*>int ReadHBonds(char *filename, HBONDS *HBonds)
-   ----------------------------------------------
-   Reads the HBond list from HBPlus output
+/*>int ReadHBonds(char *filename, HBTABLE *hbt)
+   ---------------------------------------------
+   Reads the HBond list from HBPlus output into an HBond table.
+   Only lines passing gFilter are parsed and stored. Returns the 
+   number of HBonds read or -1 on failure.
 
    Lifted from ehb.c
 
    04.01.95 Original    By: ACRM  (from ehb.c)
    05.02.03 Modified to store residue ID and name as well
+   18.10.26 Stores into an HBTABLE. The two angles which are never 
+            used are no longer stored or converted   By: agent
+   18.10.26 Lines are filtered with KeepHBondLine() before parsing and
+            each bond is given its HBPlus number   By: agent
+   18.10.26 May be compressed   By: agent
+   18.10.26 HBPlus number set with SetHBondSerial()   By: agent
 */
-int ReadHBonds(char *filename, HBONDS *HBonds)
+int ReadHBonds(char *filename, HBTABLE *hbt)
 {
    FILE *fp     = NULL;
-   int  NHBonds = 0,
-        i;
-   char buffer[MAXBUFF];
+   int  i,
+        serial  = 0;
+   char buffer[MAXBUFF],
+        ResID_D[8],
+        ResID_A[8],
+        Resnam_D[8],
+        Resnam_A[8],
+        AtomD[8],
+        AtomA[8],
+        type[8];
+   REAL DistDA,
+        AngDHA,
+        DistHA;
    
    /* Open the file for reading                                         */
-   if((fp=fopen(filename,"r"))!=NULL)
+   if((fp=ZOpen(filename))!=NULL)
    {
       /* Skip the first NSKIP lines                                     */
       for(i=0; i<NSKIP; i++)
@@ -254,60 +862,100 @@ int ReadHBonds(char *filename, HBONDS *HBonds)
 
       while(fgets(buffer,MAXBUFF,fp))
       {
-         fsscanf(buffer,"%6s%3s%1x%3s%1x%6s%3s%1x%3s%5lf%1x%2s%10x%6lf%1x%5lf%6lf%6lf",
-                 HBonds[NHBonds].ResID_D,
-                 HBonds[NHBonds].Resnam_D,
-                 HBonds[NHBonds].AtomD,
-                 HBonds[NHBonds].ResID_A,
-                 HBonds[NHBonds].Resnam_A,
-                 HBonds[NHBonds].AtomA,
-                 &(HBonds[NHBonds].DistDA),
-                 HBonds[NHBonds].type,
-                 &(HBonds[NHBonds].AngDHA),
-                 &(HBonds[NHBonds].DistHA),
-                 &(HBonds[NHBonds].AngHAAA),
-                 &(HBonds[NHBonds].AngDAAA));
-
-         HBonds[NHBonds].AngDHA  *= PI / (REAL)180.0;
-         HBonds[NHBonds].AngHAAA *= PI / (REAL)180.0;
-         HBonds[NHBonds].AngDAAA *= PI / (REAL)180.0;
+         serial++;
+         if(!KeepHBondLine(buffer, &gFilter))
+            continue;
          
-         if((++NHBonds) >= MAXHBOND)
+         fsscanf(buffer,"%6s%3s%1x%3s%1x%6s%3s%1x%3s%5lf%1x%2s%10x%6lf%1x%5lf",
+                 ResID_D,
+                 Resnam_D,
+                 AtomD,
+                 ResID_A,
+                 Resnam_A,
+                 AtomA,
+                 &DistDA,
+                 type,
+                 &AngDHA,
+                 &DistHA);
+
+         if((i = AddHBond(hbt, ResID_D, Resnam_D, AtomD, 
+                          ResID_A, Resnam_A, AtomA, type,
+                          DistDA, AngDHA * PI / (REAL)180.0, DistHA)) < 0)
          {
-            fprintf(stderr,"Too many HBonds, Increase MAXHBONDS\n");
-            return(0);
+            fprintf(stderr,"No memory for HBonds\n");
+            ZClose(fp);
+            return(-1);
+         }
+         if(!SetHBondSerial(hbt, i, serial))
+         {
+            fprintf(stderr,"Too many lines in HBPlus file: %s\n", 
+                    filename);
+            ZClose(fp);
+            return(-1);
          }
       }
 
-      fclose(fp);
+      if(ZClose(fp))
+         return(-1);
+   }
+   else
+   {
+      fprintf(stderr,"Unable to open HBPlus file: %s\n", filename);
+      return(-1);
    }
    
-   return(NHBonds);
+   return(hbt->NHBonds);
 }
 
 
 /************************************************************************/
-/*>BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds,  int i)
-   -----------------------------------------------------
+/*>BOOL CalcEnergy(char *PDBFile, PDB **ppdb, HBTABLE *hbt, int i, 
+                   EPARAMS *eparams, ECALCRUN *run, RELAXWORK *work,
+                   BONDRESULT *results)
+   ---------------------------------------------------
    Given a PDB file with hydrogens (in Charmm format) and a list of
-   HBonds, calculate the energy for one HBond
+   HBonds, calculate the energy for one HBond. The residues are read
+   into *ppdb the first time they are needed. The files for ecalc are
+   written and the job is started on run, waiting for a free slot if
+   needed. The energy is stored in results[i] when the job finishes.
+   With -o, the HBond energy between the two residues is calculated 
+   here using eparams rather than by ecalc (unless -V is given when 
+   both are calculated). With -R the sidechains are first relaxed in
+   work.
 
    06.02.03 Original   By: ACRM
+   18.10.26 Tags the energy with [ecalc] in threshold mode   By: agent
+   18.10.26 Takes an HBTABLE   By: agent
+   18.10.26 Returns the energy   By: agent
+   18.10.26 Reads only the needed residues   By: agent
+   18.10.26 In-process HBond energy for -o   By: agent
+   18.10.26 In-process relaxation for -r -o   By: agent
+   18.10.26 Starts the ecalc job on an ECALCRUN with its own files
+            By: agent
+   18.10.26 The PDB linked list is owned by the caller (*ppdb) rather
+            than held in a static so that several structures may be
+            processed   By: agent
+   18.10.26 In-process relaxation is -R rather than -r -o. The work
+            space is owned by the caller. A failed relaxation is an 
+            error   By: agent
+   18.10.26 Residues are read by pdbread.c and their IDs parsed with
+            ParseHBTResID()   By: agent
 */
-BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
+BOOL CalcEnergy(char *PDBFile, PDB **ppdb, HBTABLE *hbt, int i, 
+                EPARAMS *eparams, ECALCRUN *run, RELAXWORK *work,
+                BONDRESULT *results)
 {
    FILE       *fp;
-   char       chainA,  chainD,
-              insertA, insertD,
-              cmdline[MAXBUFF],
-              PDBFilename[MAXBUFF],
-              EnergyFile[MAXBUFF],
-              *CONTROLfile;
+   char       chainA[8],  chainD[8],
+              insertA[8], insertD[8],
+              PDBFilename[ERUN_MAXFILE],
+              EnergyFile[ERUN_MAXFILE],
+              CONTROLfile[ERUN_MAXFILE];
    
-   int        resnumA, resnumD,
-              natoms;
-   REAL       energy;
-   static PDB *pdb = NULL;
+   int        resnumA, resnumD;
+   REAL       native = (REAL)0.0;
+   BONDRESULT *res = results + i;
+   PDB        *pdb;
    PDB        *donor,
               *acceptor,
               *p,
@@ -316,54 +964,69 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
               *acceptor_n,
               *donor_n;
    
-   CONTROLfile = "control.dat";
-   
-   /* If the PDB file hasn't been read in yet, then do so               */
-   if(pdb == NULL)
+   /* If the PDB file hasn't been read in yet, then read the residues
+      used by the HBonds
+   */
+   if(*ppdb == NULL)
    {
-      if((fp=fopen(PDBFile, "r"))!=NULL)
-      {
-         if((pdb = ReadPDB(fp, &natoms))==NULL)
-         {
-            fprintf(stderr,"Can't read atoms from PDB file %s\n",
-                    PDBFile);
-            fclose(fp);
-            return(FALSE);
-         }
-/*         FixHydrogenAtomNames(pdb); */
-         fclose(fp);
-      }
-      else
-      {
-         fprintf(stderr,"Unable to open PDB file with hydrogens: %s\n",
-                 PDBFile);
+      if((*ppdb = ReadNeededResidues(PDBFile, hbt, gUseCache))==NULL)
          return(FALSE);
-      }
+/*    FixHydrogenAtomNames(*ppdb); */
    }
+   pdb = *ppdb;
    
    /* Find the details of the donor and acceptor residues               */
-   fsscanf(hbonds[i].ResID_A, "%c%4d%c", &chainA, &resnumA, &insertA);
-   fsscanf(hbonds[i].ResID_D, "%c%4d%c", &chainD, &resnumD, &insertD);
-   if(chainA == '-')      chainA  = ' ';
-   if(chainD == '-')      chainD  = ' ';
-   if(insertA == '-')     insertA = ' ';
-   if(insertD == '-')     insertD = ' ';
+   ParseHBTResID(HBTRESID(hbt, hbt->ResA[i]), chainA, &resnumA, insertA);
+   ParseHBTResID(HBTRESID(hbt, hbt->ResD[i]), chainD, &resnumD, insertD);
 
    /* Find these residues                                               */
-   if((donor = FindResidue(pdb, chainD, resnumD, insertD))==NULL)
+   if((donor = FindResidueChain(pdb, chainD, resnumD, insertD[0]))==NULL)
    {
       fprintf(stderr,"Donor residue %s not found\n", 
-              hbonds[i].ResID_D);
+              HBTRESID(hbt, hbt->ResD[i]));
       return(FALSE);
    }
    
-   if((acceptor = FindResidue(pdb, chainA, resnumA, insertA))==NULL)
+   if((acceptor = FindResidueChain(pdb, chainA, resnumA, 
+                                   insertA[0]))==NULL)
    {
       fprintf(stderr,"Acceptor residue %s not found\n", 
-              hbonds[i].ResID_A);
+              HBTRESID(hbt, hbt->ResA[i]));
       return(FALSE);
    }
 
+   /* 18.10.26 The HBond term alone is calculated here from the 
+      coordinates using the same potential as ecalc, relaxing the
+      sidechains first with -R
+   */
+   if(gHBOnly)
+   {
+      if(gRelaxInProcess)
+      {
+         if((native = RelaxResPair(work, donor, acceptor, eparams, 
+                                   NULL)) == RLX_FAILED)
+         {
+            fprintf(stderr,"No memory to relax %s and %s\n",
+                    HBTRESID(hbt, hbt->ResD[i]), 
+                    HBTRESID(hbt, hbt->ResA[i]));
+            return(FALSE);
+         }
+      }
+      else
+      {
+         native = ResPairHBEnergy(donor, acceptor, eparams);
+      }
+
+      res->Native = native;
+      if(!gValidate)
+      {
+         res->Energy = native;
+         res->Source = SRC_EHB;
+         res->Done   = TRUE;
+         return(TRUE);
+      }
+   }
+
    /* 22.09.05 If the two residues are bonded, join them into one       */
    acceptor_c = FindAtomInRes(acceptor, "C   ");
    donor_c    = FindAtomInRes(donor,    "C   ");
@@ -405,11 +1068,12 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
    }
    
    /* Now write temporary PDB file containing just donor and acceptor 
-      residues 
+      residues. Each bond has its own files so that several ecalc 
+      jobs may run at once.
    */
-          
-   sprintf(PDBFilename, "%d.pdh", (int)getpid());
-   sprintf(EnergyFile,  "%d.ec",  (int)getpid());
+   sprintf(PDBFilename, "%d.%d.pdh",         (int)getpid(), i);
+   sprintf(EnergyFile,  "%d.%d.ec",          (int)getpid(), i);
+   sprintf(CONTROLfile, "control.dat.%d.%d", (int)getpid(), i);
 
    /* Write PDBFilename and other options  to control file */
    if((fp=fopen(CONTROLfile, "w"))!=NULL)
@@ -422,15 +1086,19 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
          fprintf(fp, "HBONDS\n");
          fprintf(fp, "END\n");
       }
-      else if(gRelax)
+      if(gRelax)
       {
          fprintf(fp, "RELAX\n");
       }
+      fclose(fp);
+   }
+   else
+   {
+      fprintf(stderr,"Can't write control file: %s\n", CONTROLfile);
+      return(FALSE);
    }
-   fclose(fp);
 
    /* Write donor/acceptor residues to temporary PDB file */
-
    if((fp=fopen(PDBFilename, "w"))!=NULL)
    {
       for(p=donor; p!=NULL; NEXT(p))
@@ -438,26 +1106,11 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
       for(p=acceptor; p!=NULL; NEXT(p))
          WritePDBRecordAtnam(fp, p);
       fclose(fp);
-
-      /* Call the ecalc program to calculate the energy  */
- 
-      sprintf(cmdline, "ecalc %s > %s\n", CONTROLfile, EnergyFile);
-       
-      system(cmdline); 
-
-      /* Extract the energy from the output of ecalc                    */
-      if((energy = ParseECalcOutput(EnergyFile))==(REAL)-99999.999)
-         return(FALSE);
-
-      /* Print the energy                                               */
-      fprintf(stdout, "HBond %d Energy: %.6f\n", i+1, energy);
-      
-      unlink(PDBFilename);
-      unlink(EnergyFile);
    }
    else
    {
       fprintf(stderr,"Can't write temporary PDB file\n");
+      unlink(CONTROLfile);
       return(FALSE);
    }
 
@@ -465,9 +1118,96 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
    FREELIST(donor, PDB);
    FREELIST(acceptor, PDB);
 
+   /* Call the ecalc program to calculate the energy once there is a 
+      free slot
+   */
+   if(ECalcRunnerFull(run) && !CollectECalcResult(run, hbt, results))
+      return(FALSE);
+   if(!StartECalcJob(run, i, CONTROLfile, PDBFilename, EnergyFile))
+   {
+      fprintf(stderr,"Can't run %s\n", ERUN_PROG);
+      return(FALSE);
+   }
+
    return(TRUE);
 }
 
+/************************************************************************/
+/*>BOOL CollectECalcResult(ECALCRUN *run, HBTABLE *hbt, 
+                           BONDRESULT *results)
+   ----------------------------------------------------
+   Waits for the next ecalc job to finish and stores its energy. 
+   Returns FALSE if every try failed.
+
+   18.10.26 Original   By: agent
+*/
+BOOL CollectECalcResult(ECALCRUN *run, HBTABLE *hbt, 
+                        BONDRESULT *results)
+{
+   int  id;
+   REAL energy;
+   
+   if(!NextECalcResult(run, &id, &energy))
+      return(FALSE);
+
+   if(energy == ERUN_FAILED)
+   {
+      fprintf(stderr,"Unable to calculate energy for HBond %d\n",
+              HBTSERIAL(hbt, id));
+      return(FALSE);
+   }
+
+   results[id].Energy = energy;
+   results[id].Source = SRC_ECALC;
+   results[id].Done   = TRUE;
+
+   return(TRUE);
+}
+
+/************************************************************************/
+/*>int PrintResults(HBTABLE *hbt, BONDRESULT *results, int NPrinted,
+                    CHAINPAIR *pairs, int *NPairs)
+   -----------------------------------------------------------------
+   Prints the energies of the bonds after the NPrinted already printed
+   up to the first which is not yet done, so that the output is in 
+   order. In interface mode they are added to the chain pair totals
+   (unless only estimated with -t). Returns the new number printed.
+
+   18.10.26 Original   (printing moved from main() and CalcEnergy())
+            By: agent
+   18.10.26 -t estimates not added to the chain pair totals   By: agent
+*/
+int PrintResults(HBTABLE *hbt, BONDRESULT *results, int NPrinted,
+                 CHAINPAIR *pairs, int *NPairs)
+{
+   for(; (NPrinted < hbt->NHBonds) && results[NPrinted].Done; NPrinted++)
+   {
+      BONDRESULT *res = results + NPrinted;
+      int        i    = NPrinted;
+
+      if(gHBOnly && gValidate && (res->Source == SRC_ECALC))
+         fprintf(stdout, "HBond %d Energy: %.6f ehb: %.6f diff: %.6f\n",
+                 HBTSERIAL(hbt, i), res->Energy, res->Native, 
+                 res->Native - res->Energy);
+      else if(gTiered)
+         fprintf(stdout, "HBond %d Energy: %.6f [%s]\n", 
+                 HBTSERIAL(hbt, i), res->Energy,
+                 (res->Source == SRC_EHB) ? "ehb" : "ecalc");
+      else
+         fprintf(stdout, "HBond %d Energy: %.6f\n", 
+                 HBTSERIAL(hbt, i), res->Energy);
+
+      if(gFilter.Interface && !res->Estimated)
+         *NPairs = AddChainPair(pairs, *NPairs, 
+                                HBTRESID(hbt, hbt->ResD[i])[0],
+                                HBTRESID(hbt, hbt->ResA[i])[0],
+                                res->Energy);
+   }
+
+   fflush(stdout);
+   return(NPrinted);
+}
+
 /************************************************************************/
 /*>PDB *CopyResidue(PDB *pdb, char chain)
    --------------------------------------
@@ -576,27 +1316,315 @@ void FixHydrogenAtomNames(PDB *pdb)
 
 
 /************************************************************************/
-/*>REAL ParseECalcOutput(char *EnergyFile)
-   ---------------------------------------
-   Grab the energy from the output file generated by ECalc. Returns
-   the magic number -99999.999 on failure.
+/*>REAL EOneHBond(HBTABLE *hbt, int i, EPARAMS *eparams)
+   -----------------------------------------------------
+   Calculates the energy of HBond i from the HBPlus geometry using 
+   the Charmm 10-12 potential. PrecalcParams() must have been called.
 
-   06.02.03 Original   By: ACRM
+   Lifted from ehb.c
+
+   18.10.26 Original    (from ehb.c)   By: agent
+   18.10.26 Takes an HBTABLE   By: agent
+   18.10.26 Uses EHBondGeom()   By: agent
 */
-REAL ParseECalcOutput(char *EnergyFile)
+REAL EOneHBond(HBTABLE *hbt, int i, EPARAMS *eparams)
 {
-   FILE *fp;
-   char buffer[MAXBUFF];
-   REAL energy;
+   /* Check for -1 records in HBPlus output                             */
+   if(HBTNOH(hbt, i))
+      return((REAL)0.0);
    
-   if((fp=fopen(EnergyFile, "r"))!=NULL)
+   return(EHBondGeom(HBTATOMD(hbt, i)[0], HBTATOMA(hbt, i)[0],
+                     (REAL)hbt->DistDA[i],
+                     (REAL)cos((double)hbt->AngDHA[i]), eparams));
+}
+
+
+/************************************************************************/
+/*>BOOL KeepHBondLine(char *buffer, HBFILTER *filter)
+   -------------------------------------------------
+   Tests a line of HBPlus output against the filters using only the raw
+   fixed-width columns, so a rejected line is never parsed. Bonds 
+   involving OXT (a bug in HBPlus...) are always rejected, as are lines
+   too short to hold a bond.
+
+   18.10.26 Original   By: agent
+   18.10.26 Added interface filter   By: agent
+*/
+BOOL KeepHBondLine(char *buffer, HBFILTER *filter)
+{
+   int  i;
+   char cd, ca;
+
+   for(i=0; i<MINLINE; i++)
    {
-      fgets(buffer, MAXBUFF, fp);
-      fgets(buffer, MAXBUFF, fp);
-      sscanf(buffer,"%*s %*s %*s %*s %lf", &energy);
-      return(energy);
+      if(buffer[i] == '\0')
+         return(FALSE);
    }
-   
-   return((REAL)-99999.999);
+
+   if(!strncmp(buffer+COL_ATOMD, "OXT", 3) ||
+      !strncmp(buffer+COL_ATOMA, "OXT", 3))
+      return(FALSE);
+
+   if(filter->NTypes)
+   {
+      for(i=0; i<filter->NTypes; i++)
+      {
+         if((buffer[COL_TYPE]   == filter->Types[i][0]) &&
+            (buffer[COL_TYPE+1] == filter->Types[i][1]))
+            break;
+      }
+      if(i == filter->NTypes)
+         return(FALSE);
+   }
+
+   cd = buffer[COL_CHAIND];
+   ca = buffer[COL_CHAINA];
+
+   if(filter->Interface && (cd == ca))
+      return(FALSE);
+
+   if(filter->DoChains &&
+      !((cd == filter->ChainX && ca == filter->ChainY) ||
+        (cd == filter->ChainY && ca == filter->ChainX)))
+      return(FALSE);
+
+   if(filter->DoRes)
+   {
+      int resD, resA;
+
+      if(filter->ResChain && 
+         ((cd != filter->ResChain) || (ca != filter->ResChain)))
+         return(FALSE);
+
+      resD = RawResnum(buffer+COL_RESNUMD);
+      resA = RawResnum(buffer+COL_RESNUMA);
+      if((resD < filter->ResFirst) || (resD > filter->ResLast) ||
+         (resA < filter->ResFirst) || (resA > filter->ResLast))
+         return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int RawResnum(char *field)
+   --------------------------
+   Reads the 4 character residue number from an HBPlus residue ID 
+   without going through sscanf()
+
+   18.10.26 Original   By: agent
+*/
+int RawResnum(char *field)
+{
+   int  i,
+        resnum = 0;
+   BOOL neg    = FALSE;
+
+   for(i=0; i<4; i++)
+   {
+      if(field[i] == '-')
+         neg = TRUE;
+      else if(isdigit(field[i]))
+         resnum = 10*resnum + (field[i] - '0');
+   }
+
+   return(neg ? -resnum : resnum);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseTypes(char *list, HBFILTER *filter)
+   --------------------------------------------
+   Parses a comma separated list of bond types (MM, MS, SM, SS) or ALL
+
+   18.10.26 Original   By: agent
+*/
+BOOL ParseTypes(char *list, HBFILTER *filter)
+{
+   char *p;
+
+   filter->NTypes = 0;
+   if(!strcmp(list, "ALL") || !strcmp(list, "all"))
+      return(TRUE);
+
+   for(p=list; *p; )
+   {
+      if((filter->NTypes == MAXTYPES) ||
+         !(p[0] == 'M' || p[0] == 'S' || p[0] == 'm' || p[0] == 's') ||
+         !(p[1] == 'M' || p[1] == 'S' || p[1] == 'm' || p[1] == 's') ||
+         !(p[2] == ',' || p[2] == '\0'))
+         return(FALSE);
+
+      filter->Types[filter->NTypes][0] = toupper(p[0]);
+      filter->Types[filter->NTypes][1] = toupper(p[1]);
+      filter->Types[filter->NTypes][2] = '\0';
+      filter->NTypes++;
+
+      p += (p[2] == ',') ? 3 : 2;
+   }
+
+   return(filter->NTypes > 0);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseChains(char *pair, HBFILTER *filter)
+   ----------------------------------------------
+   Parses a chain pair of the form X:Y
+
+   18.10.26 Original   By: agent
+*/
+BOOL ParseChains(char *pair, HBFILTER *filter)
+{
+   if((strlen(pair) != 3) || (pair[1] != ':'))
+      return(FALSE);
+
+   filter->ChainX   = pair[0];
+   filter->ChainY   = pair[2];
+   filter->DoChains = TRUE;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL ParseResRange(char *range, HBFILTER *filter)
+   -------------------------------------------------
+   Parses a residue range of the form [X]first-[X]last. If a chain is
+   given at both ends, it must be the same.
+
+   18.10.26 Original   By: agent
+*/
+BOOL ParseResRange(char *range, HBFILTER *filter)
+{
+   char chain1 = '\0',
+        chain2 = '\0',
+        *p     = range;
+
+   if(isalpha(*p))
+      chain1 = *(p++);
+   filter->ResFirst = (int)strtol(p, &p, 10);
+   if(*(p++) != '-')
+      return(FALSE);
+   if(isalpha(*p))
+      chain2 = *(p++);
+   filter->ResLast = (int)strtol(p, &p, 10);
+   if(*p != '\0')
+      return(FALSE);
+
+   if(chain1 && chain2 && (chain1 != chain2))
+      return(FALSE);
+
+   filter->ResChain = chain1 ? chain1 : chain2;
+   filter->DoRes    = TRUE;
+
+   return(filter->ResFirst <= filter->ResLast);
 }
 
+
+/************************************************************************/
+/*>int AddChainPair(CHAINPAIR *pairs, int NPairs, char cx, char cy, 
+                    REAL energy)
+   ----------------------------------------------------------------
+   Adds the energy of an HBond between chains cx and cy to the total
+   for that pair of chains, creating it if needed. Pairs are kept 
+   sorted by chain. Returns the updated number of pairs.
+
+   18.10.26 Original   By: agent
+*/
+int AddChainPair(CHAINPAIR *pairs, int NPairs, char cx, char cy, 
+                 REAL energy)
+{
+   int i, j;
+
+   if(cx > cy)
+   {
+      char c = cx;
+      cx = cy;
+      cy = c;
+   }
+
+   for(i=0; i<NPairs; i++)
+   {
+      if((pairs[i].ChainX > cx) ||
+         ((pairs[i].ChainX == cx) && (pairs[i].ChainY >= cy)))
+         break;
+   }
+
+   if((i == NPairs) || (pairs[i].ChainX != cx) || (pairs[i].ChainY != cy))
+   {
+      if(NPairs == MAXCHAINPAIR)
+      {
+         fprintf(stderr,"Too many chain pairs, increase MAXCHAINPAIR\n");
+         return(NPairs);
+      }
+      for(j=NPairs; j>i; j--)
+         pairs[j] = pairs[j-1];
+      pairs[i].ChainX  = cx;
+      pairs[i].ChainY  = cy;
+      pairs[i].Energy  = (REAL)0.0;
+      pairs[i].NHBonds = 0;
+      NPairs++;
+   }
+
+   pairs[i].Energy += energy;
+   pairs[i].NHBonds++;
+
+   return(NPairs);
+}
+
+
+/************************************************************************/
+/*>void BuildOptions(char *options)
+   --------------------------------
+   Builds the string recording the options which affect the results 
+   for a partial result file. Options which only affect how the work is
+   done (-C, -j, --timeout, --tries) are not included.
+
+   18.10.26 Original   By: agent
+*/
+void BuildOptions(char *options)
+{
+   char word[MAXBUFF];
+   int  i;
+
+   options[0] = '\0';
+   if(gHBOnly)           strcat(options, "-o ");
+   if(gRelax)            strcat(options, "-r ");
+   if(gRelaxInProcess)   strcat(options, "-R ");
+   if(gValidate)         strcat(options, "-V ");
+   if(gFilter.Interface) strcat(options, "-i ");
+   if(gTiered)
+   {
+      sprintf(word, "-t %.17g ", gThreshold);
+      strcat(options, word);
+   }
+
+   strcat(options, "--type ");
+   if(gFilter.NTypes == 0)
+      strcat(options, "ALL");
+   for(i=0; i<gFilter.NTypes; i++)
+   {
+      if(i)
+         strcat(options, ",");
+      strcat(options, gFilter.Types[i]);
+   }
+
+   if(gFilter.DoChains)
+   {
+      sprintf(word, " --chains %c:%c", gFilter.ChainX, gFilter.ChainY);
+      strcat(options, word);
+   }
+   if(gFilter.DoRes)
+   {
+      if(gFilter.ResChain)
+         sprintf(word, " --res %c%d-%c%d", 
+                 gFilter.ResChain, gFilter.ResFirst, 
+                 gFilter.ResChain, gFilter.ResLast);
+      else
+         sprintf(word, " --res %d-%d", 
+                 gFilter.ResFirst, gFilter.ResLast);
+      strcat(options, word);
+   }
+}
@@ -3,8 +3,8 @@
    Program:    ehb3
    File:       ehb3.c
    
-   Version:    V1.0
-   Date:       07.02.06
+   Version:    V2.0
+   Date:       18.10.26
    Function:   Calculate total energy between two H-bonded residues
                specified on the command line
    
@@ -44,6 +44,34 @@
    V1.1  07.03.03   Added control file    By: ALC
    V1.2  23.09.05   Fixed various bugs and takes command line parameters
                     for potential type    By: ACRM
+   ---- ehb3 ----
+   V1.0  07.02.06   Original (from ehb2)  By: ACRM
+   V1.1  18.10.26   The HBond is held in an HBTABLE (hbtable.c) as in
+                    ehb2   By: agent
+   V1.2  18.10.26   Only the two residues (and their neighbours) are
+                    read from the PDB file (pdbindex.c)   By: agent
+   V1.3  18.10.26   The parsed PDB file is kept in a binary cache 
+                    (pdbcache.c) which is mapped on later runs. -C 
+                    switches this off   By: agent
+   V1.4  18.10.26   The coordinate file may be mmCIF (cifread.c). 
+                    Residues are found by the whole chain ID so that
+                    multi-character chains may be used   By: agent
+   V1.5  18.10.26   -o calculates the HBond energy in-process 
+                    (hbenergy.c) and -r -o relaxes the sidechains 
+                    in-process first (relax.c) as in ehb2   By: agent
+   V1.6  18.10.26   ecalc is run through ecalcrun.c rather than 
+                    system(), so a failed run is detected and retried.
+                    --timeout kills a run which hangs   By: agent
+   V1.7  18.10.26   The PDB file may be gzip or zstd compressed 
+                    (zread.c)   By: agent
+   V1.8  18.10.26   -o overrides -r again. The in-process relaxation 
+                    is now -R, which implies -o, as in ehb2. A failed
+                    relaxation is an error   By: agent
+   V1.9  18.10.26   ReadNeededResidues() moved to pdbread.c, which is
+                    shared with ehb2. The residue specs are stored in
+                    the same form as HBPlus IDs in ehb2   By: agent
+   V2.0  18.10.26   Added --tries, with the same default as ehb2
+                    By: agent
 
 *************************************************************************/
 /* Includes
@@ -55,52 +83,46 @@
 #include "bioplib/pdb.h"
 #include "bioplib/fsscanf.h"
 #include "bioplib/MathUtil.h"
+#include "hbtable.h"
+#include "pdbindex.h"
+#include "pdbread.h"
+#include "pdbcache.h"
+#include "cifread.h"
+#include "hbenergy.h"
+#include "relax.h"
+#include "ecalcrun.h"
+#include "zread.h"
 
 /************************************************************************/
 /* Defines and macros
 */
-#define MAXHBOND 10000
 #define MAXBUFF  256
 #define NSKIP    8  /* Number of header lines at start of HBPlus output */
 #define CUTSQ    3.5
 
-typedef struct
-{
-   char AtomD[8],
-        AtomA[8],
-        AtomH[8],
-        ResID_D[8],
-        ResID_A[8],
-        Resnam_D[8],
-        Resnam_A[8],
-        type[8];
-   REAL DistDA,
-        AngDHA,
-        DistHA,
-        AngHAAA,
-        AngDAAA;
-}  HBONDS;
-
 /************************************************************************/
 /* Globals
 */
 BOOL gRelax = FALSE;
+BOOL gRelaxInProcess = FALSE;
 BOOL gHBOnly = FALSE;
+BOOL gUseCache = TRUE;
+REAL gTimeout = (REAL)0.0;
+int  gTries = ERUN_TRIES;
 
 /************************************************************************/
 /* Prototypes
 */
 BOOL ParseCmdLine(int argc, char **argv, char *PDBFile,
                   char *resspec1, char *resspec2);
-BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i);
+BOOL CalcEnergy(char *PDBFile, HBTABLE *hbt, int i, EPARAMS *eparams);
 void Usage(void);
 int main(int argc, char **argv);
 void FixHydrogenAtomNames(PDB *pdb);
 PDB *CopyAndFixResidue(PDB *pdb, char chain);
-REAL ParseECalcOutput(char *EnergyFile);
 PDB *FixResidue(PDB *res);
 PDB *CopyResidue(PDB *pdb, char chain);
-BOOL CreateHB(HBONDS *HBonds, char *resspec1, char *resspec2);
+BOOL CreateHB(HBTABLE *hbt, char *resspec1, char *resspec2);
 
 
 /************************************************************************/
@@ -109,23 +131,35 @@ BOOL CreateHB(HBONDS *HBonds, char *resspec1, char *resspec2);
    Main program
 
    06.02.03 Original   By: ACRM
+   18.10.26 Uses HBTABLE   By: agent
+   18.10.26 Sets up the HBond parameters   By: agent
 */
 int main(int argc, char **argv)
 {
    char    PDBFile[MAXBUFF],
            resspec1[MAXBUFF],
            resspec2[MAXBUFF];
-   HBONDS  HBonds[1];
+   HBTABLE *hbt;
+   EPARAMS eparams;
    
    if(ParseCmdLine(argc, argv, PDBFile, resspec1, resspec2))
    {
-      if(CreateHB(HBonds, resspec1, resspec2))
+      if((hbt = CreateHBTable())==NULL)
+      {
+         fprintf(stderr,"No memory for HBond table\n");
+         return(1);
+      }
+      
+      SetDefaults(&eparams);
+      PrecalcParams(&eparams);
+      
+      if(CreateHB(hbt, resspec1, resspec2))
       {
-         if(!strncmp(HBonds[0].type, "SS", 2) &&
-            strncmp(HBonds[0].AtomD, "OXT", 3) &&
-            strncmp(HBonds[0].AtomA, "OXT", 3))
+         if(!strncmp(HBTTYPE(hbt, 0), "SS", 2) &&
+            strncmp(HBTATOMD(hbt, 0), "OXT", 3) &&
+            strncmp(HBTATOMA(hbt, 0), "OXT", 3))
          {
-            if(!CalcEnergy(PDBFile, HBonds, 0))
+            if(!CalcEnergy(PDBFile, hbt, 0, &eparams))
                return(1);
          }
          else
@@ -150,20 +184,51 @@ int main(int argc, char **argv)
 
    06.02.03 Original   By: ACRM
    23.09.05 Updated for V1.2
+   18.10.26 Added -C   By: agent
+   18.10.26 Added mmCIF and multi-letter chains   By: agent
+   18.10.26 -r may be used with -o   By: agent
+   18.10.26 Added --timeout   By: agent
+   18.10.26 Added -R. -o overrides -r   By: agent
+   18.10.26 Added --tries   By: agent
 */
 void Usage(void)
 {
    fprintf(stderr,"\nehb3 V3 (c) 2003-6, Dr. Andrew C.R. Martin, UCL, The \
 University of Reading\n");
    fprintf(stderr, "and Dr. Alison L. Cuff\n");
+   fprintf(stderr, "V1.1 to V2.0 (c) 2026, agent\n");
    
-   fprintf(stderr,"\nUsage: ehb3 [-r][-o] pdhfile resspec1 resspec2\n");
+   fprintf(stderr,"\nUsage: ehb3 [-r][-o][-R][-C][--timeout secs][--tries n] \
+pdhfile\n");
+   fprintf(stderr,"            resspec1 resspec2\n");
    fprintf(stderr,"\n       -r  Use the RELAX option in ecalc\n");
-   fprintf(stderr,"       -o  Calculate the hbond energy only (overrides -r)\n");
-
-   fprintf(stderr,"\n       pdhfile    - PDB file with hydrogens\n");
+   fprintf(stderr,"       -o  Calculate the hbond energy only (overrides \
+-r). This is done\n");
+   fprintf(stderr,"           in-process from the coordinates without \
+running ecalc\n");
+   fprintf(stderr,"       -R  As -o, but the two sidechains are first \
+relaxed in-process\n");
+   fprintf(stderr,"           with a simple model (HBond term, soft \
+repulsion and restraints\n");
+   fprintf(stderr,"           to the start positions). This is not \
+ecalc's RELAX and gives\n");
+   fprintf(stderr,"           different energies\n");
+   fprintf(stderr,"       -C  Do not use or write the binary cache of \
+the PDB file\n");
+   fprintf(stderr,"           (pdhfile%s)\n", PDBCACHE_EXT);
+   fprintf(stderr,"       --timeout Kill ecalc after this many seconds \
+and try again\n");
+   fprintf(stderr,"                 (Default: none)\n");
+   fprintf(stderr,"       --tries   Number of times to run ecalc \
+before giving up if it\n");
+   fprintf(stderr,"                 fails or times out (Default: %d)\n",
+           ERUN_TRIES);
+
+   fprintf(stderr,"\n       pdhfile    - PDB or mmCIF file with hydrogens\n");
    fprintf(stderr,"       resspec - residue and atom specifier in the form \
 [c]nnn[i].atom\n");
+   fprintf(stderr,"                 (or chain.nnn[i].atom for multi-letter \
+chains)\n");
 
    fprintf(stderr,"\nehb3 calculates the total energy for a pair of amino \
 acids identified\n");
@@ -177,6 +242,10 @@ acids identified\n");
    Parse the command line
 
    06.02.03 Original   By: ACRM
+   18.10.26 Added -C   By: agent
+   18.10.26 Added --timeout   By: agent
+   18.10.26 Added -R   By: agent
+   18.10.26 Added --tries   By: agent
 */
 BOOL ParseCmdLine(int argc, char **argv, char *PDBFile,
                   char *resspec1, char *resspec2)
@@ -191,9 +260,36 @@ BOOL ParseCmdLine(int argc, char **argv, char *PDBFile,
       case 'r':
          gRelax = TRUE;
          break;
+      case 'R':
+         gRelaxInProcess = TRUE;
+         gHBOnly         = TRUE;
+         break;
       case 'o':
          gHBOnly = TRUE;
          break;
+      case 'C':
+         gUseCache = FALSE;
+         break;
+      case '-':
+         if(argc < 2)
+            return(FALSE);
+         if(!strcmp(argv[0], "--timeout"))
+         {
+            if(!sscanf(argv[1], "%lf", &gTimeout) || (gTimeout < 0.0))
+               return(FALSE);
+         }
+         else if(!strcmp(argv[0], "--tries"))
+         {
+            if(!sscanf(argv[1], "%d", &gTries) || (gTries < 1))
+               return(FALSE);
+         }
+         else
+         {
+            return(FALSE);
+         }
+         argc--;
+         argv++;
+         break;
       case 'h':
          return(FALSE);
       default:
@@ -216,27 +312,40 @@ BOOL ParseCmdLine(int argc, char **argv, char *PDBFile,
 
 
 /************************************************************************/
-/*>BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds,  int i)
-   -----------------------------------------------------
+/*>BOOL CalcEnergy(char *PDBFile, HBTABLE *hbt,  int i, 
+                   EPARAMS *eparams)
+   ----------------------------------------------------
    Given a PDB file with hydrogens (in Charmm format) and a list of
-   HBonds, calculate the energy for one HBond
+   HBonds, calculate the energy for one HBond. With -o this is done
+   in-process using eparams.
 
    06.02.03 Original   By: ACRM
+   18.10.26 Takes an HBTABLE   By: agent
+   18.10.26 Reads only the needed residues   By: agent
+   18.10.26 Residues are found by the whole chain ID   By: agent
+   18.10.26 In-process HBond energy and relaxation for -o   By: agent
+   18.10.26 Runs ecalc through an ECALCRUN   By: agent
+   18.10.26 In-process relaxation is -R rather than -r -o. The work
+            space is freed. A failed relaxation is an error   By: agent
+   18.10.26 Residues are read by pdbread.c and their IDs parsed with
+            ParseHBTResID()   By: agent
+   18.10.26 Runs ecalc up to gTries times   By: agent
 */
-BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
+BOOL CalcEnergy(char *PDBFile, HBTABLE *hbt, int i, EPARAMS *eparams)
 {
    FILE       *fp;
    char       chainA[8],  chainD[8],
               insertA[8], insertD[8],
-              cmdline[MAXBUFF],
-              PDBFilename[MAXBUFF],
-              EnergyFile[MAXBUFF],
+              PDBFilename[ERUN_MAXFILE],
+              EnergyFile[ERUN_MAXFILE],
               CONTROLfile[MAXBUFF];
    
-   int        resnumA, resnumD,
-              natoms;
+   int        resnumA, resnumD;
    REAL       energy;
    static PDB *pdb = NULL;
+   RELAXWORK  *work;
+   ECALCRUN   *run;
+   int        id;
    PDB        *donor,
               *acceptor,
               *p,
@@ -247,48 +356,64 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
    
    sprintf(CONTROLfile, "control.dat.%d", (int)getpid());
    
-   /* If the PDB file hasn't been read in yet, then do so               */
+   /* If the PDB file hasn't been read in yet, then read the residues
+      used by the HBonds
+   */
    if(pdb == NULL)
    {
-      if((fp=fopen(PDBFile, "r"))!=NULL)
-      {
-         if((pdb = ReadPDB(fp, &natoms))==NULL)
-         {
-            fprintf(stderr,"Can't read atoms from PDB file %s\n",
-                    PDBFile);
-            fclose(fp);
-            return(FALSE);
-         }
-/*         FixHydrogenAtomNames(pdb); */
-         fclose(fp);
-      }
-      else
-      {
-         fprintf(stderr,"Unable to open PDB file with hydrogens: %s\n",
-                 PDBFile);
+      if((pdb = ReadNeededResidues(PDBFile, hbt, gUseCache))==NULL)
          return(FALSE);
-      }
+/*    FixHydrogenAtomNames(pdb); */
    }
    
    /* Find the details of the donor and acceptor residues               */
-   ParseResSpec(hbonds[i].ResID_A, chainA, &resnumA, insertA);
-   ParseResSpec(hbonds[i].ResID_D, chainD, &resnumD, insertD);
+   ParseHBTResID(HBTRESID(hbt, hbt->ResA[i]), chainA, &resnumA, insertA);
+   ParseHBTResID(HBTRESID(hbt, hbt->ResD[i]), chainD, &resnumD, insertD);
 
    /* Find these residues                                               */
-   if((donor = FindResidue(pdb, chainD[0], resnumD, insertD[0]))==NULL)
+   if((donor = FindResidueChain(pdb, chainD, resnumD, insertD[0]))==NULL)
    {
       fprintf(stderr,"Donor residue %s not found\n", 
-              hbonds[i].ResID_D);
+              HBTRESID(hbt, hbt->ResD[i]));
       return(FALSE);
    }
    
-   if((acceptor = FindResidue(pdb, chainA[0], resnumA, insertA[0]))==NULL)
+   if((acceptor = FindResidueChain(pdb, chainA, resnumA, 
+                                   insertA[0]))==NULL)
    {
       fprintf(stderr,"Acceptor residue %s not found\n", 
-              hbonds[i].ResID_A);
+              HBTRESID(hbt, hbt->ResA[i]));
       return(FALSE);
    }
 
+   /* 18.10.26 The HBond term alone is calculated here from the 
+      coordinates, relaxing the sidechains first with -R
+   */
+   if(gHBOnly)
+   {
+      if(gRelaxInProcess)
+      {
+         if((work = CreateRelaxWork())==NULL)
+         {
+            fprintf(stderr,"No memory for relaxation\n");
+            return(FALSE);
+         }
+         energy = RelaxResPair(work, donor, acceptor, eparams, NULL);
+         FreeRelaxWork(work);
+         if(energy == RLX_FAILED)
+         {
+            fprintf(stderr,"No memory for relaxation\n");
+            return(FALSE);
+         }
+      }
+      else
+      {
+         energy = ResPairHBEnergy(donor, acceptor, eparams);
+      }
+      fprintf(stdout, "%.6f\n", energy);
+      return(TRUE);
+   }
+
    /* 22.09.05 If the two residues are bonded, join them into one       */
    acceptor_c = FindAtomInRes(acceptor, "C   ");
    donor_c    = FindAtomInRes(donor,    "C   ");
@@ -369,26 +494,11 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
       for(p=acceptor; p!=NULL; NEXT(p))
          WritePDBRecordAtnam(fp, p);
       fclose(fp);
-
-      /* Call the ecalc program to calculate the energy  */
- 
-      sprintf(cmdline, "ecalc %s > %s\n", CONTROLfile, EnergyFile);
-       
-      system(cmdline); 
-
-      /* Extract the energy from the output of ecalc                    */
-      if((energy = ParseECalcOutput(EnergyFile))==(REAL)-99999.999)
-         return(FALSE);
-
-      /* Print the energy                                               */
-      fprintf(stdout, "%.6f\n", energy);
-      
-      unlink(PDBFilename);
-      unlink(EnergyFile);
    }
    else
    {
       fprintf(stderr,"Can't write temporary PDB file\n");
+      unlink(CONTROLfile);
       return(FALSE);
    }
 
@@ -396,8 +506,25 @@ BOOL CalcEnergy(char *PDBFile, HBONDS *hbonds, int i)
    FREELIST(donor, PDB);
    FREELIST(acceptor, PDB);
 
-   /* Delete the control file                                           */
-   unlink(CONTROLfile);
+   /* Call the ecalc program to calculate the energy. The runner deletes
+      the files when it has finished.
+   */
+   if((run = CreateECalcRunner(1, gTimeout, gTries))==NULL)
+   {
+      fprintf(stderr,"No memory for ecalc runner\n");
+      return(FALSE);
+   }
+   if(!StartECalcJob(run, i, CONTROLfile, PDBFilename, EnergyFile) ||
+      !NextECalcResult(run, &id, &energy) || (energy == ERUN_FAILED))
+   {
+      fprintf(stderr,"Unable to run %s\n", ERUN_PROG);
+      FreeECalcRunner(run);
+      return(FALSE);
+   }
+   FreeECalcRunner(run);
+
+   /* Print the energy                                                  */
+   fprintf(stdout, "%.6f\n", energy);
    
    return(TRUE);
 }
@@ -510,61 +637,46 @@ void FixHydrogenAtomNames(PDB *pdb)
 
 
 /************************************************************************/
-/*>REAL ParseECalcOutput(char *EnergyFile)
-   ---------------------------------------
-   Grab the energy from the output file generated by ECalc. Returns
-   the magic number -99999.999 on failure.
-
-   06.02.03 Original   By: ACRM
-*/
-REAL ParseECalcOutput(char *EnergyFile)
-{
-   FILE *fp;
-   char buffer[MAXBUFF];
-   REAL energy;
-   
-   if((fp=fopen(EnergyFile, "r"))!=NULL)
-   {
-      fgets(buffer, MAXBUFF, fp);
-      fgets(buffer, MAXBUFF, fp);
-      sscanf(buffer,"%*s %*s %*s %*s %lf", &energy);
-      return(energy);
-   }
-   
-   return((REAL)-99999.999);
-}
-
-/************************************************************************/
-/*>int ReadHBonds(char *filename, HBONDS *HBonds)
-   ----------------------------------------------
-   Reads the HBond list from HBPlus output
-
-   Lifted from ehb.c
-
-   04.01.95 Original    By: ACRM  (from ehb.c)
-   05.02.03 Modified to store residue ID and name as well
+/*>BOOL CreateHB(HBTABLE *hbt, char *resspec1, char *resspec2)
+   ------------------------------------------------------------
+   Creates an SS HBond from two residue/atom specifications of the
+   form [c]nnn[i].atom (donor first) and adds it to the table.
+   The atom name follows the last '.' so that the residue may be given
+   as chain.nnn[i]. The residues are stored in the form written by 
+   FormatHBTResID(), as for HBPlus output in ehb2.
+
+   07.02.06 Original    By: ACRM  (from ReadHBonds() in ehb2.c)
+   18.10.26 Adds to an HBTABLE   By: agent
+   18.10.26 Splits at the last '.'   By: agent
+   18.10.26 Stores the residues with FormatHBTResID()   By: agent
 */
-BOOL CreateHB(HBONDS *HBonds, char *resspec1, char *resspec2)
+BOOL CreateHB(HBTABLE *hbt, char *resspec1, char *resspec2)
 {
-   char *stop;
+   char *stopD,
+        *stopA,
+        chain[MAXBUFF],
+        insert[MAXBUFF],
+        resD[HBT_MAXSTR],
+        resA[HBT_MAXSTR];
+   int  resnum;
    
    UPPER(resspec1);
    UPPER(resspec2);
    
-   if((stop = strchr(resspec1, '.'))==NULL)
+   if((stopD = strrchr(resspec1, '.'))==NULL)
       return(FALSE);
-   *stop = '\0';
-   strncpy(HBonds[0].ResID_D, resspec1, 8);
-   strncpy(HBonds[0].AtomD, stop+1, 8);
+   *stopD = '\0';
    
-   if((stop = strchr(resspec2, '.'))==NULL)
+   if((stopA = strrchr(resspec2, '.'))==NULL)
       return(FALSE);
-   *stop = '\0';
-   strncpy(HBonds[0].ResID_A, resspec2, 8);
-   strncpy(HBonds[0].AtomA, stop+1, 8);
+   *stopA = '\0';
 
-   strcpy(HBonds[0].type, "SS");
+   if(!ParseResSpec(resspec1, chain, &resnum, insert) ||
+      !FormatHBTResID(resD, chain, resnum, insert[0])  ||
+      !ParseResSpec(resspec2, chain, &resnum, insert) ||
+      !FormatHBTResID(resA, chain, resnum, insert[0]))
+      return(FALSE);
 
-   return(TRUE);
+   return(AddHBond(hbt, resD, "", stopD+1, resA, "", stopA+1,
+                   "SS", (REAL)0.0, (REAL)0.0, (REAL)0.0) >= 0);
 }
-
@@ -0,0 +1,134 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       ehbutil.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Small helpers shared by the ehb programs
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See ehbutil.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - from batch.c, hbstats.c, ehb.c,
+                    journal.c, jobrun.c, hbtable.c, pdbcache.c and
+                    pdbindex.c   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <math.h>
+#include <time.h>
+#include "ehbutil.h"
+
+
+/************************************************************************/
+/*>void CompensatedAdd(REAL *sum, REAL *comp, REAL value)
+   ------------------------------------------------------
+   Neumaier compensated summation step. The best estimate of the total
+   is *sum + *comp. Unlike plain Kahan summation this remains accurate
+   when large terms are later subtracted again.
+
+   18.10.26 Original   (from ehb.c)   By: agent
+*/
+void CompensatedAdd(REAL *sum, REAL *comp, REAL value)
+{
+   REAL t = *sum + value;
+
+   if(fabs(*sum) >= fabs(value))
+      *comp += (*sum - t) + value;
+   else
+      *comp += (value - t) + *sum;
+   *sum = t;
+}
+
+
+/************************************************************************/
+/*>double Now(void)
+   ----------------
+   Monotonic clock time in seconds
+
+   18.10.26 Original   By: agent
+*/
+double Now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return((double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9);
+}
+
+
+/************************************************************************/
+/*>unsigned long long FNVHash64(unsigned long long hash, const void *data,
+                                size_t size)
+   ----------------------------------------------------------------------
+   Adds size bytes of data to a 64-bit FNV-1a hash. Start with
+   FNV64_INIT; a long input may be hashed in pieces.
+
+   18.10.26 Original   (from ShardHash() in batch.c)   By: agent
+*/
+unsigned long long FNVHash64(unsigned long long hash, const void *data,
+                             size_t size)
+{
+   const unsigned char *c = (const unsigned char *)data;
+   size_t              i;
+
+   for(i=0; i<size; i++)
+   {
+      hash ^= c[i];
+      hash *= 1099511628211ULL;
+   }
+   return(hash);
+}
+
+
+/************************************************************************/
+/*>unsigned long FNVHash32(unsigned long hash, const void *data,
+                           size_t size)
+   ------------------------------------------------------------
+   Adds size bytes of data to a 32-bit FNV-1a hash. Start with
+   FNV32_INIT.
+
+   18.10.26 Original   (from HashString() in hbtable.c)   By: agent
+*/
+unsigned long FNVHash32(unsigned long hash, const void *data,
+                        size_t size)
+{
+   const unsigned char *c = (const unsigned char *)data;
+   size_t              i;
+
+   for(i=0; i<size; i++)
+      hash = FNV32_STEP(hash, c[i]);
+   return(hash);
+}
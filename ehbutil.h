@@ -0,0 +1,88 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       ehbutil.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Small helpers shared by the ehb programs
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Neumaier compensated summation, a monotonic clock and FNV-1a
+   hashing, which were repeated in several modules.
+
+   The hashes must not change: shards are chosen with the 64-bit hash
+   and the residue hash tables in .ehbcache files are built with the
+   32-bit one. FNV32_STEP() mixes in a whole value (such as a residue
+   number) in one step as those tables always have. Note that the
+   32-bit hash is kept in an unsigned long, so is not reduced modulo
+   2^32 on 64-bit machines; only its low bits are ever used.
+
+**************************************************************************
+
+   Usage:
+   ======
+   REAL sum = 0.0, comp = 0.0;
+   CompensatedAdd(&sum, &comp, value); ... total = sum + comp;
+
+   hash = FNVHash64(FNV64_INIT, data, size);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - from batch.c, hbstats.c, ehb.c,
+                    journal.c, jobrun.c, hbtable.c, pdbcache.c and
+                    pdbindex.c   By: agent
+
+*************************************************************************/
+#ifndef _EHBUTIL_H
+#define _EHBUTIL_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stddef.h>
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define FNV64_INIT 14695981039346656037ULL
+#define FNV32_INIT 2166136261UL
+#define FNV32_STEP(hash, value) \
+   (((hash) ^ (unsigned long)(value)) * 16777619UL)
+
+/************************************************************************/
+/* Prototypes
+*/
+void CompensatedAdd(REAL *sum, REAL *comp, REAL value);
+double Now(void);
+unsigned long long FNVHash64(unsigned long long hash, const void *data,
+                             size_t size);
+unsigned long FNVHash32(unsigned long hash, const void *data,
+                        size_t size);
+
+#endif
@@ -0,0 +1,464 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       hbenergy.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   CHARMM 10-12 hydrogen bond energy
+
+   Copyright:  (c) agent 2026
+               Code moved from ehb.c and ehb2.c is (c) Dr. Andrew C. R.
+               Martin
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See hbenergy.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - parameter code moved from ehb2.c   By: agent
+   V1.1  18.10.26   Also used by ehb, whose copies of the kernel and
+                    parameter code have been removed   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "bioplib/macros.h"
+#include "hbenergy.h"
+
+/************************************************************************/
+/* Prototypes
+*/
+static REAL PolarPairEnergy(RESPOLAR *don, RESPOLAR *acc, 
+                            EPARAMS *eparams);
+
+/************************************************************************/
+/*>void SetDefaults(EPARAMS *eparams)
+   ----------------------------------
+   Sets default value for parameters.
+
+   Lifted from ehb.c via ehb2.c
+
+   04.01.95 Original    By: ACRM  (from ehb.c)
+*/
+void SetDefaults(EPARAMS *eparams)
+{
+   eparams->CutOnHB         = 4.0;
+   eparams->CutOffHB        = 5.0;
+   eparams->CutOnHBAng      = 90.0 * PI / 180.0;
+   eparams->CutOffHBAng     = 90.0 * PI / 180.0;
+}
+
+
+/************************************************************************/
+/*>void PrecalcParams(EPARAMS *eparams)
+   ------------------------------------
+   Calculates the values which depend only on the parameters so that
+   they need not be recalculated for every bond. Must be called after
+   the cutoffs have been set.
+
+   Lifted from ehb.c via ehb2.c
+
+   18.10.26 Original    (from ehb.c)   By: agent
+*/
+void PrecalcParams(EPARAMS *eparams)
+{
+   REAL EMin,
+        RMin;
+   int  class;
+   
+   eparams->CutOnHBSq  = eparams->CutOnHB  * eparams->CutOnHB;
+   eparams->CutOffHBSq = eparams->CutOffHB * eparams->CutOffHB;
+   eparams->Rul3       = (REAL)0.0;
+   eparams->Rua3       = (REAL)0.0;
+
+   if(eparams->CutOffHBSq != eparams->CutOnHBSq)
+   {
+      eparams->Rul3 = (REAL)1.0/
+         ((eparams->CutOffHBSq - eparams->CutOnHBSq) * 
+          (eparams->CutOffHBSq - eparams->CutOnHBSq) * 
+          (eparams->CutOffHBSq - eparams->CutOnHBSq));
+   }
+   
+   eparams->CutOnHBAngSq   = cos(eparams->CutOnHBAng);
+   eparams->CutOnHBAngSq  *= eparams->CutOnHBAngSq;
+   eparams->CutOffHBAngSq  = cos(eparams->CutOffHBAng);
+   eparams->CutOffHBAngSq *= eparams->CutOffHBAngSq;
+
+   if(eparams->CutOffHBAngSq != eparams->CutOnHBAngSq)
+   {
+      eparams->Rua3 = (REAL)1.0/
+         ((eparams->CutOffHBAngSq - eparams->CutOnHBAngSq) * 
+          (eparams->CutOffHBAngSq - eparams->CutOnHBAngSq) * 
+          (eparams->CutOffHBAngSq - eparams->CutOnHBAngSq));
+   }
+
+   /* Work out the parameters for each class of atom pair
+      Parameters are taken from Charmm/CONGEN
+   */
+   for(class=0; class<NHBCLASS; class++)
+   {
+      switch(class)
+      {
+      case 1:                   /* N-O                                  */
+         EMin = (REAL)(-3.5);
+         RMin = (REAL)(2.9);
+         break;
+      case 2:                   /* O-N                                  */
+         EMin = (REAL)(-4.0);
+         RMin = (REAL)(2.85);
+         break;
+      case 3:                   /* O-O                                  */
+         EMin = (REAL)(-4.25);
+         RMin = (REAL)(2.75);
+         break;
+      default:                  /* N-N and other (this is a guess!)     */
+         EMin = (REAL)(-3.0);
+         RMin = (REAL)(3.0);
+         break;
+      }
+
+      /* Convert EMin and RMin to the Param10 and Param12 values        */
+      eparams->ParamR10[class] = 
+         (EMin/(-(REAL)pow((double)5.0, (double)5.0)   /
+                 (REAL)pow((double)6.0, (double)6.0))) *
+         (REAL)pow((double)(RMin*RMin/(REAL)1.2), (double)5.0);
+      eparams->ParamR12[class] = 
+         eparams->ParamR10[class] * RMin * RMin / (REAL)1.2;
+   }
+}
+
+
+/************************************************************************/
+/*>int HBClass(char donor, char acceptor)
+   --------------------------------------
+   Returns the parameter class for a donor/acceptor element pair:
+   0 = N-N, 1 = N-O, 2 = O-N, 3 = O-O, 4 = anything else
+
+   Lifted from ehb.c via ehb2.c
+
+   18.10.26 Original    (from ehb.c)   By: agent
+*/
+int HBClass(char donor, char acceptor)
+{
+   if(donor == 'N')
+   {
+      if(acceptor == 'N') return(0);
+      if(acceptor == 'O') return(1);
+   }
+   else if(donor == 'O')
+   {
+      if(acceptor == 'N') return(2);
+      if(acceptor == 'O') return(3);
+   }
+   return(4);
+}
+
+
+/************************************************************************/
+/*>REAL EHBondGeom(char donor, char acceptor, REAL DistDA, REAL CosDHA,
+                   EPARAMS *eparams)
+   --------------------------------------------------------------------
+   Calculates the energy of one hydrogen bond from the donor and 
+   acceptor elements, the D-A distance and the cosine of the D-H-A 
+   angle. PrecalcParams() must have been called.
+
+   18.10.26 Original    (from EOneHBond() in ehb.c)   By: agent
+*/
+REAL EHBondGeom(char donor, char acceptor, REAL DistDA, REAL CosDHA,
+                EPARAMS *eparams)
+{
+   REAL CosAng,
+        CosAngSq,
+        EAng,
+        DistSq,
+        InvDistSq,
+        InvDist10,
+        energy;
+   int  class;
+
+   DistSq = DistDA * DistDA;
+
+   /* If we're outside the HBond cutoff, there is no energy             */
+   if((DistSq == (REAL)0.0) || (DistSq >= eparams->CutOffHBSq))
+      return((REAL)0.0);
+   
+   InvDistSq = (REAL)1.0 / DistSq;
+   InvDist10 = InvDistSq * InvDistSq * InvDistSq * InvDistSq * InvDistSq;
+               
+   class  = HBClass(donor, acceptor);
+   energy = (eparams->ParamR12[class] * InvDistSq * InvDist10) - 
+            (eparams->ParamR10[class] * InvDist10);
+               
+   /* If we're above the start of the smoothing range, calculate the 
+      smoothing factor.
+   */
+   if(DistSq > eparams->CutOnHBSq)
+   {
+      REAL DistFromOn,
+           DistFromOff,
+           Smoothing;
+      
+      DistFromOn  = eparams->CutOnHBSq  - DistSq;
+      DistFromOff = eparams->CutOffHBSq - DistSq;
+      
+      Smoothing = DistFromOff * DistFromOff * eparams->Rul3 *
+         (DistFromOff - (REAL)3.0 * DistFromOn);
+      
+      energy *= Smoothing;
+   }
+   
+   /* Calculate the angle contribution                                  */
+   CosAng = CosDHA;
+   if(CosAng <= (REAL)(-0.99999))
+      CosAng = (REAL)(-0.99999);
+   
+   if(CosAng > 0.0)
+      return((REAL)0.0);
+   
+   CosAngSq = CosAng * CosAng;
+   if(CosAngSq <= eparams->CutOffHBAngSq)
+      return((REAL)0.0);
+
+   EAng = CosAngSq * CosAngSq;
+   
+   if(CosAngSq < eparams->CutOnHBAngSq)
+   {
+      REAL AngFromOn,
+           AngFromOff,
+           Smoothing;
+      
+      AngFromOn  = eparams->CutOnHBAngSq  - CosAngSq;
+      AngFromOff = eparams->CutOffHBAngSq - CosAngSq;
+      Smoothing  = AngFromOff * AngFromOff * eparams->Rua3 *
+         (AngFromOff - (REAL)3.0 * AngFromOn);
+      
+      EAng *= Smoothing;
+   }
+
+   return(EAng * energy);
+}
+
+
+/************************************************************************/
+/*>void FindPolarAtoms(PDB *res, RESPOLAR *polar)
+   ----------------------------------------------
+   Finds the donors (with their hydrogens) and acceptors of the residue
+   starting at res. Each hydrogen is assigned to the nearest N or O 
+   within XHBOND. Acceptors are all oxygens plus the unprotonated ring
+   nitrogens of histidine. As in ehb's trajectory mode.
+
+   18.10.26 Original   By: agent
+*/
+void FindPolarAtoms(PDB *res, RESPOLAR *polar)
+{
+   PDB  *p,
+        *q,
+        *heavy[MAXRESATM];
+   char el[MAXRESATM];
+   int  NHeavy = 0,
+        i, best;
+   REAL BestDSq, DSq;
+
+   polar->NDonors    = 0;
+   polar->NAcceptors = 0;
+
+   /* Collect the N and O atoms                                         */
+   for(p=res; p!=NULL && SAMERES(p, res); NEXT(p))
+   {
+      char e = AtomElement(p);
+      if(((e == 'N') || (e == 'O')) && (NHeavy < MAXRESATM))
+      {
+         el[NHeavy]      = e;
+         heavy[NHeavy++] = p;
+      }
+   }
+
+   /* Assign each hydrogen to its heavy atom                            */
+   for(q=res; q!=NULL && SAMERES(q, res); NEXT(q))
+   {
+      if(AtomElement(q) != 'H')
+         continue;
+      
+      BestDSq = (REAL)(XHBOND * XHBOND);
+      best    = (-1);
+      for(i=0; i<NHeavy; i++)
+      {
+         if((DSq = DISTSQ(q, heavy[i])) < BestDSq)
+         {
+            BestDSq = DSq;
+            best    = i;
+         }
+      }
+      if(best < 0)
+         continue;
+
+      /* Find or add the donor                                          */
+      for(i=0; i<polar->NDonors; i++)
+      {
+         if(polar->Donor[i] == heavy[best])
+            break;
+      }
+      if(i == polar->NDonors)
+      {
+         polar->Donor[i]   = heavy[best];
+         polar->DonorEl[i] = el[best];
+         polar->NH[i]      = 0;
+         polar->NDonors++;
+      }
+      if(polar->NH[i] < MAXHPERD)
+         polar->DonorH[i][polar->NH[i]++] = q;
+   }
+
+   /* Acceptors                                                         */
+   for(i=0; i<NHeavy; i++)
+   {
+      BOOL acc = (el[i] == 'O');
+      
+      if(!acc && 
+         (!strncmp(heavy[i]->resnam, "HIS", 3) || 
+          !strncmp(heavy[i]->resnam, "HS",  2)) &&
+         (!strncmp(heavy[i]->atnam, "ND1", 3) || 
+          !strncmp(heavy[i]->atnam, "NE2", 3)))
+      {
+         int d;
+         for(d=0; d<polar->NDonors; d++)
+         {
+            if(polar->Donor[d] == heavy[i])
+               break;
+         }
+         acc = (d == polar->NDonors);
+      }
+
+      if(acc)
+      {
+         polar->AcceptorEl[polar->NAcceptors] = el[i];
+         polar->Acceptor[polar->NAcceptors++] = heavy[i];
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>REAL ResPairHBEnergy(PDB *res1, PDB *res2, EPARAMS *eparams)
+   ------------------------------------------------------------
+   Calculates the hydrogen bond energy between two residues from their
+   coordinates: every donor in one residue with every acceptor in the
+   other, in both directions, taking the best hydrogen for each pair.
+
+   18.10.26 Original   By: agent
+*/
+REAL ResPairHBEnergy(PDB *res1, PDB *res2, EPARAMS *eparams)
+{
+   RESPOLAR polar1,
+            polar2;
+
+   FindPolarAtoms(res1, &polar1);
+   FindPolarAtoms(res2, &polar2);
+
+   return(PolarPairEnergy(&polar1, &polar2, eparams) +
+          PolarPairEnergy(&polar2, &polar1, eparams));
+}
+
+
+/************************************************************************/
+/*>static REAL PolarPairEnergy(RESPOLAR *don, RESPOLAR *acc, 
+                               EPARAMS *eparams)
+   ----------------------------------------------------------
+   Sums the energy of the donors of one residue with the acceptors of
+   another
+
+   18.10.26 Original   By: agent
+*/
+static REAL PolarPairEnergy(RESPOLAR *don, RESPOLAR *acc, 
+                            EPARAMS *eparams)
+{
+   REAL ETot = (REAL)0.0;
+   int  d, a, h;
+
+   for(d=0; d<don->NDonors; d++)
+   {
+      PDB *D = don->Donor[d];
+
+      for(a=0; a<acc->NAcceptors; a++)
+      {
+         PDB  *A     = acc->Acceptor[a];
+         REAL DASq,
+              EBest  = (REAL)0.0;
+
+         if((DASq = DISTSQ(D, A)) >= eparams->CutOffHBSq)
+            continue;
+
+         for(h=0; h<don->NH[d]; h++)
+         {
+            PDB  *H = don->DonorH[d][h];
+            REAL HD[3], HA[3], LenSq, CosDHA, e;
+
+            HD[0] = D->x - H->x;   HA[0] = A->x - H->x;
+            HD[1] = D->y - H->y;   HA[1] = A->y - H->y;
+            HD[2] = D->z - H->z;   HA[2] = A->z - H->z;
+            LenSq = (HD[0]*HD[0] + HD[1]*HD[1] + HD[2]*HD[2]) *
+                    (HA[0]*HA[0] + HA[1]*HA[1] + HA[2]*HA[2]);
+            if(LenSq == (REAL)0.0)
+               continue;
+            CosDHA = (HD[0]*HA[0] + HD[1]*HA[1] + HD[2]*HA[2]) / 
+                     sqrt(LenSq);
+            CosDHA = MAX((REAL)(-1.0), MIN((REAL)1.0, CosDHA));
+
+            if((e = EHBondGeom(don->DonorEl[d], acc->AcceptorEl[a],
+                               sqrt(DASq), CosDHA, eparams)) < EBest)
+               EBest = e;
+         }
+         ETot += EBest;
+      }
+   }
+
+   return(ETot);
+}
+
+
+/************************************************************************/
+/*>char AtomElement(PDB *p)
+   ------------------------
+   Element of an atom from its name, skipping any leading digit
+
+   18.10.26 Original   By: agent
+*/
+char AtomElement(PDB *p)
+{
+   char *c;
+   
+   for(c=p->atnam; isdigit(*c); c++);
+   return(toupper(*c));
+}
@@ -0,0 +1,120 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       hbenergy.h
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   CHARMM 10-12 hydrogen bond energy
+
+   Copyright:  (c) agent 2026
+               Code moved from ehb.c and ehb2.c is (c) Dr. Andrew C. R.
+               Martin
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   The CHARMM 10-12 hydrogen bond potential with distance and angle
+   smoothing, shared by ehb, ehb2 and ehb3. EHBondGeom() 
+   scores one bond from its D-A distance and D-H-A angle (as given by
+   HBPlus). ResPairHBEnergy() finds the donors, hydrogens and acceptors
+   of two residues from their coordinates and sums the energy of every
+   donor/acceptor pair between them, using the best hydrogen for each
+   pair as ehb does in trajectory mode.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - parameter code moved from ehb2.c   By: agent
+   V1.1  18.10.26   Also used by ehb, whose copies of the kernel and
+                    parameter code have been removed   By: agent
+
+*************************************************************************/
+#ifndef _HBENERGY_H
+#define _HBENERGY_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "bioplib/pdb.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define NHBCLASS  5     /* Donor/acceptor classes: NN, NO, ON, OO, other */
+#define MAXHPERD  4     /* Max hydrogens on one donor                    */
+#define XHBOND    1.3   /* Max X-H bond length when assigning hydrogens  */
+#define MAXRESATM 64    /* Max atoms in one residue                      */
+
+#define SAMERES(p, q)  (((p)->resnum    == (q)->resnum)    && \
+                        ((p)->insert[0] == (q)->insert[0]) && \
+                        !strcmp((p)->chain, (q)->chain))
+
+typedef struct
+{
+   REAL CutOnHB,
+        CutOffHB,
+        CutOnHBAng,
+        CutOffHBAng;
+   /* Derived values - filled in by PrecalcParams()                     */
+   REAL CutOnHBSq,
+        CutOffHBSq,
+        CutOnHBAngSq,
+        CutOffHBAngSq,
+        Rul3,
+        Rua3,
+        ParamR10[NHBCLASS],
+        ParamR12[NHBCLASS];
+}  EPARAMS;
+
+/* Polar atoms of one residue found by ResPairHBEnergy()               */
+typedef struct
+{
+   PDB  *Donor[MAXRESATM],
+        *DonorH[MAXRESATM][MAXHPERD],
+        *Acceptor[MAXRESATM];
+   char DonorEl[MAXRESATM],
+        AcceptorEl[MAXRESATM];
+   int  NH[MAXRESATM],
+        NDonors,
+        NAcceptors;
+}  RESPOLAR;
+
+/************************************************************************/
+/* Prototypes
+*/
+void SetDefaults(EPARAMS *eparams);
+void PrecalcParams(EPARAMS *eparams);
+int HBClass(char donor, char acceptor);
+REAL EHBondGeom(char donor, char acceptor, REAL DistDA, REAL CosDHA,
+                EPARAMS *eparams);
+void FindPolarAtoms(PDB *res, RESPOLAR *polar);
+REAL ResPairHBEnergy(PDB *res1, PDB *res2, EPARAMS *eparams);
+char AtomElement(PDB *p);
+
+#endif
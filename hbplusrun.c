@@ -0,0 +1,416 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       hbplusrun.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Run HBPlus jobs concurrently in scratch directories
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See hbplusrun.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   The process handling is shared with ecalcrun.c in
+                    jobrun.c   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "bioplib/macros.h"
+#include "hbplusrun.h"
+#include "zread.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define COPYBUFF 65536
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL MakeJobDir(HBPLUSJOB *job, char *PDBFile);
+static void ExecHBPlus(void *data);
+static BOOL CollectHBPlus(void *data, int status);
+static BOOL ReadJobOutput(HBPLUSJOB *job, char **data, size_t *size);
+static void RemoveJobDir(void *data);
+
+/************************************************************************/
+/* Globals
+*/
+static JOBTYPE sHBPlusType = {ExecHBPlus, CollectHBPlus, RemoveJobDir};
+
+
+/************************************************************************/
+/*>HBPLUSRUN *CreateHBPlusRunner(char *prog, int MaxJobs, REAL Timeout,
+                                 int MaxTries)
+   --------------------------------------------------------------------
+   Creates a runner for up to MaxJobs concurrent runs of the HBPlus 
+   program prog (found on the PATH). Timeout is the wall clock limit 
+   for one run in seconds (0 for none) and MaxTries the number of 
+   times a job is run before giving up. Returns NULL if out of memory.
+
+   18.10.26 Original   18.10.26 Uses a JOBRUN   By: agent
+*/
+HBPLUSRUN *CreateHBPlusRunner(char *prog, int MaxJobs, REAL Timeout, 
+                              int MaxTries)
+{
+   HBPLUSRUN *run;
+
+   if((run = (HBPLUSRUN *)malloc(sizeof(HBPLUSRUN)))==NULL)
+      return(NULL);
+
+   run->Prog = prog;
+   if((run->Runner = CreateJobRunner("HBPlus", &sHBPlusType, MaxJobs, 
+                                     Timeout, MaxTries))==NULL)
+   {
+      free(run);
+      return(NULL);
+   }
+
+   return(run);
+}
+
+
+/************************************************************************/
+/*>void FreeHBPlusRunner(HBPLUSRUN *run)
+   -------------------------------------
+   Kills any jobs which are still running, removes their scratch 
+   directories and frees the runner
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+void FreeHBPlusRunner(HBPLUSRUN *run)
+{
+   if(run == NULL)
+      return;
+
+   FreeJobRunner(run->Runner);
+   free(run);
+}
+
+
+/************************************************************************/
+/*>BOOL StartHBPlusJob(HBPLUSRUN *run, int id, char *PDBFile)
+   ----------------------------------------------------------
+   Makes a scratch directory for a PDB file and starts HBPlus on it.
+   There must be a free slot (see HBPlusRunnerFull()). Returns FALSE 
+   if the directory could not be made or HBPlus could not be started.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+BOOL StartHBPlusJob(HBPLUSRUN *run, int id, char *PDBFile)
+{
+   HBPLUSJOB *job;
+
+   if((job = (HBPLUSJOB *)malloc(sizeof(HBPLUSJOB)))==NULL)
+      return(FALSE);
+
+   snprintf(job->PDBFile, HRUN_MAXFILE, "%s", PDBFile);
+   job->Prog = run->Prog;
+   job->Data = NULL;
+   job->Size = 0;
+
+   if(!MakeJobDir(job, PDBFile))
+   {
+      free(job);
+      return(FALSE);
+   }
+   
+   if(!StartJob(run->Runner, id, job->PDBFile, job))
+   {
+      fprintf(stderr,"Unable to run %s\n", run->Prog);
+      free(job);
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL NextHBPlusResult(HBPLUSRUN *run, int *id, char **data, 
+                         size_t *size)
+   -------------------------------------------------------------
+   Waits for the next job to finish. Failed runs are retried. Returns
+   FALSE if there are no jobs running; otherwise the job's identifier
+   is returned in id and the contents of its .hb2 file in data (which
+   the caller must free) and size. data is NULL if every try failed.
+   The job's scratch directory is removed.
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses a JOBRUN   By: agent
+*/
+BOOL NextHBPlusResult(HBPLUSRUN *run, int *id, char **data, 
+                      size_t *size)
+{
+   HBPLUSJOB *job;
+   void      *jobdata;
+   BOOL      ok;
+
+   *data = NULL;
+   *size = 0;
+
+   if(!NextJobResult(run->Runner, id, &jobdata, &ok))
+      return(FALSE);
+
+   job = (HBPLUSJOB *)jobdata;
+   if(ok)
+   {
+      *data = job->Data;
+      *size = job->Size;
+   }
+   else
+   {
+      free(job->Data);
+   }
+   free(job);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL MakeJobDir(HBPLUSJOB *job, char *PDBFile)
+   -----------------------------------------------------
+   Makes the scratch directory for a job and puts the PDB file into it
+   as HRUN_INPUT. A plain file is linked; a compressed file is 
+   decompressed since HBPlus can't read it.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL MakeJobDir(HBPLUSJOB *job, char *PDBFile)
+{
+   char   input[HRUN_MAXFILE+16],
+          *tmpdir,
+          *path,
+          *buffer;
+   FILE   *in,
+          *out;
+   size_t n;
+   BOOL   ok = TRUE;
+
+   if(((tmpdir = getenv("TMPDIR"))==NULL) || (tmpdir[0] == '\0'))
+      tmpdir = "/tmp";
+   if((snprintf(job->Dir, HRUN_MAXFILE, "%s/ehbrunXXXXXX", tmpdir) 
+       >= HRUN_MAXFILE) || (mkdtemp(job->Dir) == NULL))
+   {
+      fprintf(stderr,"Unable to make a scratch directory in %s\n", 
+              tmpdir);
+      job->Dir[0] = '\0';
+      return(FALSE);
+   }
+   sprintf(input, "%s/%s", job->Dir, HRUN_INPUT);
+
+   if(ZFileType(PDBFile) == ZT_PLAIN)
+   {
+      if(((path = realpath(PDBFile, NULL))==NULL) || 
+         symlink(path, input))
+         ok = FALSE;
+      free(path);
+   }
+   else if((in = ZOpen(PDBFile))==NULL)
+   {
+      ok = FALSE;
+   }
+   else
+   {
+      if(((buffer = (char *)malloc(COPYBUFF))==NULL) ||
+         ((out = fopen(input, "w"))==NULL))
+      {
+         ok = FALSE;
+      }
+      else
+      {
+         while((n = fread(buffer, 1, COPYBUFF, in)) > 0)
+         {
+            if(fwrite(buffer, 1, n, out) != n)
+               ok = FALSE;
+         }
+         if(fclose(out))
+            ok = FALSE;
+      }
+      free(buffer);
+      if(ZClose(in))
+         ok = FALSE;
+   }
+
+   if(!ok)
+   {
+      fprintf(stderr,"Unable to read PDB file: %s\n", PDBFile);
+      RemoveJobDir(job);
+   }
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>static void ExecHBPlus(void *data)
+   ----------------------------------
+   Runs in the child: execs HBPlus in a job's scratch directory with 
+   its messages going to HRUN_LOG
+
+   18.10.26 Original   (from LaunchJob())   By: agent
+*/
+static void ExecHBPlus(void *data)
+{
+   HBPLUSJOB *job = (HBPLUSJOB *)data;
+   int       fd;
+
+   if(chdir(job->Dir))
+      _exit(127);
+
+   /* Don't let the output of a failed try be taken for this one       */
+   unlink(HRUN_OUTPUT);
+
+   if((fd = open("/dev/null", O_RDONLY)) >= 0)
+   {
+      dup2(fd, 0);
+      close(fd);
+   }
+   if((fd = open(HRUN_LOG, O_WRONLY|O_CREAT|O_TRUNC, 0644)) < 0)
+      _exit(127);
+   dup2(fd, 1);
+   dup2(fd, 2);
+   close(fd);
+   execlp(job->Prog, job->Prog, "-o", HRUN_INPUT, (char *)NULL);
+}
+
+
+/************************************************************************/
+/*>static BOOL CollectHBPlus(void *data, int status)
+   -------------------------------------------------
+   A try succeeded if HBPlus exited cleanly and left a .hb2 file, which
+   is read into memory
+
+   18.10.26 Original   (from NextHBPlusResult())   By: agent
+*/
+static BOOL CollectHBPlus(void *data, int status)
+{
+   HBPLUSJOB *job = (HBPLUSJOB *)data;
+
+   return(WIFEXITED(status) && (WEXITSTATUS(status) == 0) &&
+          ReadJobOutput(job, &(job->Data), &(job->Size)));
+}
+
+
+/************************************************************************/
+/*>static BOOL ReadJobOutput(HBPLUSJOB *job, char **data, size_t *size)
+   --------------------------------------------------------------------
+   Reads the whole of a job's .hb2 file into memory. Returns FALSE if
+   it is missing or empty.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL ReadJobOutput(HBPLUSJOB *job, char **data, size_t *size)
+{
+   char        output[HRUN_MAXFILE+16];
+   struct stat st;
+   ssize_t     n;
+   size_t      got = 0;
+   int         fd;
+
+   sprintf(output, "%s/%s", job->Dir, HRUN_OUTPUT);
+   if((fd = open(output, O_RDONLY|O_CLOEXEC)) < 0)
+      return(FALSE);
+   if((fstat(fd, &st) < 0) || (st.st_size == 0) ||
+      ((*data = (char *)malloc((size_t)st.st_size))==NULL))
+   {
+      close(fd);
+      return(FALSE);
+   }
+
+   while(got < (size_t)st.st_size)
+   {
+      if((n = read(fd, *data + got, (size_t)st.st_size - got)) < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         break;
+      }
+      if(n == 0)
+         break;
+      got += (size_t)n;
+   }
+   close(fd);
+
+   if(got != (size_t)st.st_size)
+   {
+      free(*data);
+      *data = NULL;
+      return(FALSE);
+   }
+   *size = got;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static void RemoveJobDir(void *data)
+   ------------------------------------
+   Deletes a job's scratch directory and the files HBPlus left in it
+
+   18.10.26 Original   By: agent
+   18.10.26 Called by the JOBRUN   By: agent
+*/
+static void RemoveJobDir(void *data)
+{
+   HBPLUSJOB     *job = (HBPLUSJOB *)data;
+   DIR           *dir;
+   struct dirent *ent;
+
+   if(job->Dir[0] == '\0')
+      return;
+   
+   if((dir = opendir(job->Dir))!=NULL)
+   {
+      while((ent = readdir(dir))!=NULL)
+      {
+         if(strcmp(ent->d_name, ".") && strcmp(ent->d_name, ".."))
+            unlinkat(dirfd(dir), ent->d_name, 0);
+      }
+      closedir(dir);
+   }
+   rmdir(job->Dir);
+   job->Dir[0] = '\0';
+}
@@ -0,0 +1,114 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       hbplusrun.h
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Run HBPlus jobs concurrently in scratch directories
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Runs up to a given number of HBPlus processes at once, one for each
+   PDB file. Each job has its own scratch directory made with mkdtemp()
+   in $TMPDIR (or /tmp) since HBPlus writes its output files into the
+   current directory under names derived from the input file. The PDB
+   file is linked into the directory (or decompressed into it if it is
+   gzip or zstd compressed, see zread.c) and HBPlus is run there as
+   'hbplus -o input.pdb'.
+
+   When a job finishes, its .hb2 output is read into memory and the 
+   directory and everything in it are removed, so the caller never 
+   sees the scratch files. The processes are run by the job runner 
+   shared with ecalcrun.c (jobrun.c): a job which runs past the 
+   timeout is killed and a job which fails is re-run up to MaxTries 
+   times in all.
+
+**************************************************************************
+
+   Usage:
+   ======
+   run = CreateHBPlusRunner("hbplus", MaxJobs, Timeout, MaxTries);
+   if(HBPlusRunnerFull(run)) NextHBPlusResult(run, &id, &data, &size);
+   StartHBPlusJob(run, i, PDBFile);
+   ...
+   while(NextHBPlusResult(run, &id, &data, &size)) ...parse data...
+   FreeHBPlusRunner(run);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   The process handling is shared with ecalcrun.c in
+                    jobrun.c   By: agent
+
+*************************************************************************/
+#ifndef _HBPLUSRUN_H
+#define _HBPLUSRUN_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stddef.h>
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "jobrun.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define HRUN_MAXFILE 160            /* Max length of a scratch path     */
+#define HRUN_PROG    "hbplus"
+#define HRUN_INPUT   "input.pdb"    /* PDB file in the scratch directory*/
+#define HRUN_OUTPUT  "input.hb2"    /* ...and HBPlus's output           */
+#define HRUN_LOG     "hbplus.log"   /* HBPlus stdout and stderr         */
+
+#define HBPlusRunnerFull(run) JobRunnerFull((run)->Runner)
+
+typedef struct
+{
+   char   PDBFile[HRUN_MAXFILE],    /* For messages                     */
+          Dir[HRUN_MAXFILE],        /* Scratch directory                */
+          *Prog,
+          *Data;                    /* The .hb2 output                  */
+   size_t Size;
+}  HBPLUSJOB;
+
+typedef struct
+{
+   JOBRUN    *Runner;
+   char      *Prog;
+}  HBPLUSRUN;
+
+/************************************************************************/
+/* Prototypes
+*/
+HBPLUSRUN *CreateHBPlusRunner(char *prog, int MaxJobs, REAL Timeout, 
+                              int MaxTries);
+void FreeHBPlusRunner(HBPLUSRUN *run);
+BOOL StartHBPlusJob(HBPLUSRUN *run, int id, char *PDBFile);
+BOOL NextHBPlusResult(HBPLUSRUN *run, int *id, char **data, 
+                      size_t *size);
+
+#endif
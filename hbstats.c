@@ -0,0 +1,761 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       hbstats.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Mergeable statistics of HBond energies and geometry
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See hbstats.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "bioplib/macros.h"
+#include "batch.h"
+#include "hbstats.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXBUFF 160
+
+typedef struct
+{
+   char *Name;
+   REAL Lo,
+        Width;
+   int  NBins;
+}  HISTDEF;
+
+/************************************************************************/
+/* Globals
+*/
+static char *sClassNames[HBS_NCLASS] = {"NN", "NO", "ON", "OO", "other"};
+
+/* Histogram bins for each quantity. The energy histogram covers the
+   range of the CHARMM parameters; bonds beyond the ends go in the
+   underflow and overflow bins.
+*/
+static HISTDEF sHist[HBS_NQUANT] =
+{
+   {"energy", -10.0, 0.1,  150},
+   {"DistDA",   0.0, 0.05, 100},
+   {"AngDHA",   0.0, 1.0,  180}
+};
+
+/************************************************************************/
+/* Prototypes
+*/
+static void AddStat(HBSTAT *stat, int quant, REAL value);
+static int  SketchBucket(REAL value);
+static REAL BucketValue(int bucket);
+static BOOL ReadStatLine(HBSTATS *stats, char *buffer, BOOL *isQ);
+
+
+/************************************************************************/
+/*>HBSTATS *CreateHBStats(int shard, int NShards)
+   ----------------------------------------------
+   Creates empty statistics for a shard of a run. Returns NULL if out
+   of memory.
+
+   18.10.26 Original   By: agent
+*/
+HBSTATS *CreateHBStats(int shard, int NShards)
+{
+   HBSTATS *stats;
+   int     class, quant;
+
+   if((stats = (HBSTATS *)calloc(1, sizeof(HBSTATS)))==NULL)
+      return(NULL);
+
+   stats->Shard   = shard;
+   stats->NShards = NShards;
+   for(class=0; class<HBS_NCLASS; class++)
+   {
+      for(quant=0; quant<HBS_NQUANT; quant++)
+      {
+         stats->Stat[class][quant].Min = HUGE_VAL;
+         stats->Stat[class][quant].Max = -HUGE_VAL;
+      }
+   }
+   
+   return(stats);
+}
+
+
+/************************************************************************/
+/*>void FreeHBStats(HBSTATS *stats)
+   --------------------------------
+   Frees statistics
+
+   18.10.26 Original   By: agent
+*/
+void FreeHBStats(HBSTATS *stats)
+{
+   free(stats);
+}
+
+
+/************************************************************************/
+/*>void AddHBStat(HBSTATS *stats, int class, REAL energy, REAL DistDA,
+                  REAL AngDHA)
+   -------------------------------------------------------------------
+   Adds one HBond of a donor/acceptor class (as HBClass()) to the 
+   statistics. AngDHA is in degrees.
+
+   18.10.26 Original   By: agent
+*/
+void AddHBStat(HBSTATS *stats, int class, REAL energy, REAL DistDA,
+               REAL AngDHA)
+{
+   if((class < 0) || (class >= HBS_NCLASS))
+      class = HBS_NCLASS - 1;
+   
+   AddStat(&(stats->Stat[class][HBS_ENERGY]), HBS_ENERGY, energy);
+   AddStat(&(stats->Stat[class][HBS_DISTDA]), HBS_DISTDA, DistDA);
+   AddStat(&(stats->Stat[class][HBS_ANGDHA]), HBS_ANGDHA, AngDHA);
+}
+
+
+/************************************************************************/
+/*>void MergeHBStats(HBSTATS *into, HBSTATS *from)
+   -----------------------------------------------
+   Adds the statistics in from to those in into. The counts in the
+   bins and buckets are simply added so the result is the same as if
+   every bond had been added to into.
+
+   18.10.26 Original   By: agent
+*/
+void MergeHBStats(HBSTATS *into, HBSTATS *from)
+{
+   int class, quant, i;
+
+   for(class=0; class<HBS_NCLASS; class++)
+   {
+      for(quant=0; quant<HBS_NQUANT; quant++)
+      {
+         HBSTAT *a = &(into->Stat[class][quant]),
+                *b = &(from->Stat[class][quant]);
+
+         if(b->N == 0)
+            continue;
+         
+         a->N += b->N;
+         CompensatedAdd(&(a->Sum), &(a->Comp), b->Sum);
+         a->Comp += b->Comp;
+         if(b->Min < a->Min) a->Min = b->Min;
+         if(b->Max > a->Max) a->Max = b->Max;
+
+         for(i=0; i<HBS_MAXBIN+2; i++)
+            a->Hist[i] += b->Hist[i];
+         for(i=0; i<HBS_NBUCKET; i++)
+         {
+            a->Sketch.Pos[i] += b->Sketch.Pos[i];
+            a->Sketch.Neg[i] += b->Sketch.Neg[i];
+         }
+         a->Sketch.Zero += b->Sketch.Zero;
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>REAL HBStatQuantile(HBSTAT *stat, REAL q)
+   -----------------------------------------
+   Estimates quantile q (0..1) from the sketch. The result is within a
+   relative error of HBS_ALPHA of a value of the given rank (values 
+   closer to zero than HBS_MINVAL are given as zero). Returns 0 if
+   there are no values.
+
+   18.10.26 Original   By: agent
+*/
+REAL HBStatQuantile(HBSTAT *stat, REAL q)
+{
+   DDSKETCH      *sketch = &(stat->Sketch);
+   unsigned long rank,
+                 count = 0;
+   REAL          value = (REAL)0.0;
+   int           i;
+
+   if(stat->N == 0)
+      return((REAL)0.0);
+   if(q < (REAL)0.0) q = (REAL)0.0;
+   if(q > (REAL)1.0) q = (REAL)1.0;
+   rank = (unsigned long)(q * (REAL)(stat->N - 1));
+
+   /* Walk up from the most negative bucket                             */
+   for(i=HBS_NBUCKET-1; i>=0; i--)
+   {
+      if((count += sketch->Neg[i]) > rank)
+      {
+         value = -BucketValue(i);
+         goto found;
+      }
+   }
+   if((count += sketch->Zero) > rank)
+   {
+      value = (REAL)0.0;
+      goto found;
+   }
+   for(i=0; i<HBS_NBUCKET; i++)
+   {
+      if((count += sketch->Pos[i]) > rank)
+      {
+         value = BucketValue(i);
+         goto found;
+      }
+   }
+   
+found:
+   if(value < stat->Min) value = stat->Min;
+   if(value > stat->Max) value = stat->Max;
+   return(value);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteHBStats(HBSTATS *stats, char *filename)
+   -------------------------------------------------
+   Writes statistics as a text file with hex floats (so they are read
+   back exactly). Only the bins and buckets which are in use are 
+   written. As with WritePartial() it is written to a temporary file 
+   and renamed.
+
+   18.10.26 Original   By: agent
+*/
+BOOL WriteHBStats(HBSTATS *stats, char *filename)
+{
+   FILE *fp;
+   char tmpfile[MAXBUFF];
+   int  class, quant, i,
+        NQ = 0;
+
+   snprintf(tmpfile, MAXBUFF, "%s.tmp", filename);
+   if((fp = fopen(tmpfile, "w"))==NULL)
+   {
+      fprintf(stderr,"Unable to write HBond statistics: %s\n", tmpfile);
+      return(FALSE);
+   }
+
+   fprintf(fp, "#EHBSTATS %d\n", HBS_VERSION);
+   fprintf(fp, "#sketch %a %a %d\n", (REAL)HBS_ALPHA, (REAL)HBS_MINVAL,
+           HBS_NBUCKET);
+   for(quant=0; quant<HBS_NQUANT; quant++)
+      fprintf(fp, "#hist %s %a %a %d\n", sHist[quant].Name, 
+              sHist[quant].Lo, sHist[quant].Width, sHist[quant].NBins);
+   fprintf(fp, "#shard %d/%d\n", stats->Shard, stats->NShards);
+
+   for(class=0; class<HBS_NCLASS; class++)
+   {
+      for(quant=0; quant<HBS_NQUANT; quant++)
+      {
+         HBSTAT *stat = &(stats->Stat[class][quant]);
+
+         if(stat->N == 0)
+            continue;
+         
+         fprintf(fp, "Q %d %d %lu %a %a %a %a %lu\n", class, quant,
+                 stat->N, stat->Sum, stat->Comp, stat->Min, stat->Max,
+                 stat->Sketch.Zero);
+         for(i=0; i<sHist[quant].NBins+2; i++)
+         {
+            if(stat->Hist[i])
+               fprintf(fp, "H %d %d %d %lu\n", class, quant, i,
+                       stat->Hist[i]);
+         }
+         for(i=0; i<HBS_NBUCKET; i++)
+         {
+            if(stat->Sketch.Pos[i])
+               fprintf(fp, "P %d %d %d %lu\n", class, quant, i,
+                       stat->Sketch.Pos[i]);
+         }
+         for(i=0; i<HBS_NBUCKET; i++)
+         {
+            if(stat->Sketch.Neg[i])
+               fprintf(fp, "N %d %d %d %lu\n", class, quant, i,
+                       stat->Sketch.Neg[i]);
+         }
+         NQ++;
+      }
+   }
+   fprintf(fp, "#end %d\n", NQ);
+
+   if((fclose(fp) != 0) || (rename(tmpfile, filename) != 0))
+   {
+      fprintf(stderr,"Unable to write HBond statistics: %s\n", filename);
+      unlink(tmpfile);
+      return(FALSE);
+   }
+   
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>HBSTATS *ReadHBStats(char *filename)
+   ------------------------------------
+   Reads a statistics file written by WriteHBStats(). Returns NULL 
+   (with a message) if it cannot be read, is incomplete or was written
+   with different bins or buckets.
+
+   18.10.26 Original   By: agent
+*/
+HBSTATS *ReadHBStats(char *filename)
+{
+   FILE    *fp;
+   HBSTATS *stats = NULL;
+   char    buffer[MAXBUFF],
+           expect[MAXBUFF],
+           name[MAXBUFF];
+   int     version, quant,
+           ishard, NShards,
+           NQ   = 0,
+           NEnd = (-1),
+           line = 0;
+   BOOL    ok   = TRUE;
+   
+   if((fp = fopen(filename, "r"))==NULL)
+   {
+      fprintf(stderr,"Unable to read HBond statistics: %s\n", filename);
+      return(NULL);
+   }
+
+   line++;
+   if(!fgets(buffer, MAXBUFF, fp) ||
+      (sscanf(buffer, "#EHBSTATS %d", &version) != 1) ||
+      (version != HBS_VERSION))
+   {
+      fprintf(stderr,"Not a version %d HBond statistics file: %s\n",
+              HBS_VERSION, filename);
+      fclose(fp);
+      return(NULL);
+   }
+
+   /* The bins and buckets must match ours for the counts to mean the
+      same thing
+   */
+   line++;
+   snprintf(expect, MAXBUFF, "#sketch %a %a %d\n", (REAL)HBS_ALPHA,
+            (REAL)HBS_MINVAL, HBS_NBUCKET);
+   if(!fgets(buffer, MAXBUFF, fp) || strcmp(buffer, expect))
+      ok = FALSE;
+   for(quant=0; ok && (quant<HBS_NQUANT); quant++)
+   {
+      line++;
+      snprintf(expect, MAXBUFF, "#hist %s %a %a %d\n", sHist[quant].Name,
+               sHist[quant].Lo, sHist[quant].Width, sHist[quant].NBins);
+      if(!fgets(buffer, MAXBUFF, fp) || strcmp(buffer, expect))
+         ok = FALSE;
+   }
+   if(!ok)
+   {
+      fprintf(stderr,"HBond statistics file %s uses different bins \
+(line %d)\n", filename, line);
+      fclose(fp);
+      return(NULL);
+   }
+   
+   line++;
+   if(!fgets(buffer, MAXBUFF, fp) ||
+      (sscanf(buffer, "#shard %s", name) != 1) ||
+      !ParseShard(name, &ishard, &NShards))
+   {
+      fprintf(stderr,"Missing #shard line in HBond statistics file: \
+%s\n", filename);
+      fclose(fp);
+      return(NULL);
+   }
+   
+   if((stats = CreateHBStats(ishard, NShards))==NULL)
+   {
+      fprintf(stderr,"No memory for HBond statistics\n");
+      fclose(fp);
+      return(NULL);
+   }
+
+   while(fgets(buffer, MAXBUFF, fp))
+   {
+      line++;
+      TERMINATE(buffer);
+      
+      if(!strncmp(buffer, "#end ", 5))
+      {
+         NEnd = atoi(buffer+5);
+         break;
+      }
+      if(!ReadStatLine(stats, buffer, &ok))
+      {
+         fprintf(stderr,"Bad line %d in HBond statistics file: %s\n", 
+                 line, filename);
+         break;
+      }
+      if(ok)
+         NQ++;
+   }
+   fclose(fp);
+
+   if(NEnd != NQ)
+   {
+      fprintf(stderr,"Incomplete HBond statistics file: %s\n", filename);
+      FreeHBStats(stats);
+      return(NULL);
+   }
+   
+   return(stats);
+}
+
+
+/************************************************************************/
+/*>void PrintHBStats(FILE *out, HBSTATS *stats, BOOL histograms)
+   -------------------------------------------------------------
+   Prints the count, mean, range and quantiles of each quantity for
+   each donor/acceptor class that has any HBonds. If histograms is set
+   the bins in use are printed as well.
+
+   18.10.26 Original   By: agent
+*/
+void PrintHBStats(FILE *out, HBSTATS *stats, BOOL histograms)
+{
+   static REAL quantiles[] = {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99};
+   int         class, quant, i,
+               NQuantiles = sizeof(quantiles) / sizeof(REAL);
+
+   fprintf(out, "\nHBond statistics by donor/acceptor class:\n");
+   fprintf(out, "%-5s %-6s %8s %10s %10s %10s", "Class", "", "N", "Mean",
+           "Min", "Max");
+   for(i=0; i<NQuantiles; i++)
+   {
+      char label[16];
+      sprintf(label, "P%g", 100.0 * quantiles[i]);
+      fprintf(out, " %9s", label);
+   }
+   fprintf(out, "\n");
+   
+   for(class=0; class<HBS_NCLASS; class++)
+   {
+      for(quant=0; quant<HBS_NQUANT; quant++)
+      {
+         HBSTAT *stat = &(stats->Stat[class][quant]);
+
+         if(stat->N == 0)
+            continue;
+
+         fprintf(out, "%-5s %-6s %8lu %10.4f %10.4f %10.4f", 
+                 sClassNames[class], sHist[quant].Name, stat->N,
+                 (stat->Sum + stat->Comp) / (REAL)stat->N,
+                 stat->Min, stat->Max);
+         for(i=0; i<NQuantiles; i++)
+            fprintf(out, " %9.4f", HBStatQuantile(stat, quantiles[i]));
+         fprintf(out, "\n");
+      }
+   }
+
+   if(!histograms)
+      return;
+   
+   for(class=0; class<HBS_NCLASS; class++)
+   {
+      for(quant=0; quant<HBS_NQUANT; quant++)
+      {
+         HBSTAT  *stat = &(stats->Stat[class][quant]);
+         HISTDEF *hist = &(sHist[quant]);
+
+         if(stat->N == 0)
+            continue;
+
+         fprintf(out, "\nHistogram of %s for %s HBonds:\n", hist->Name, 
+                 sClassNames[class]);
+         if(stat->Hist[0])
+            fprintf(out, "%10s < %-10.4f %10lu\n", "", hist->Lo, 
+                    stat->Hist[0]);
+         for(i=1; i<=hist->NBins; i++)
+         {
+            if(stat->Hist[i])
+               fprintf(out, "%10.4f - %-10.4f %10lu\n", 
+                       hist->Lo + (i-1) * hist->Width,
+                       hist->Lo + i * hist->Width, stat->Hist[i]);
+         }
+         if(stat->Hist[hist->NBins+1])
+            fprintf(out, "%10s >= %-9.4f %10lu\n", "",
+                    hist->Lo + hist->NBins * hist->Width, 
+                    stat->Hist[hist->NBins+1]);
+      }
+   }
+}
+
+
+/************************************************************************/
+/*>int HBStatsMain(int argc, char **argv, char *program)
+   -----------------------------------------------------
+   Reads the HBond statistics files from every shard of a run, checks
+   that every shard is present exactly once and prints the combined
+   statistics. -o also writes them as a statistics file for shard 0/1;
+   -H prints the histograms. argv[0] is "hbstats". Returns the exit 
+   status.
+
+   18.10.26 Original   By: agent
+*/
+int HBStatsMain(int argc, char **argv, char *program)
+{
+   HBSTATS *all  = NULL,
+           *part;
+   char    *outfile = NULL;
+   BOOL    *seen = NULL,
+           histograms = FALSE;
+   int     i;
+
+   argc--;
+   argv++;
+   while(argc && (argv[0][0] == '-'))
+   {
+      if(!strcmp(argv[0], "-H"))
+      {
+         histograms = TRUE;
+         argc--;
+         argv++;
+      }
+      else if(!strcmp(argv[0], "-o") && (argc > 1))
+      {
+         outfile = argv[1];
+         argc -= 2;
+         argv += 2;
+      }
+      else
+      {
+         argc = 0;
+      }
+   }
+   if(argc < 1)
+   {
+      fprintf(stderr,"\nUsage: %s hbstats [-H] [-o merged] stats \
+[stats ...]\n", program);
+      fprintf(stderr,"       Combines the HBond statistics files from \
+every shard of a run\n");
+      fprintf(stderr,"       -H  Also print the histograms\n");
+      fprintf(stderr,"       -o  Also write the combined statistics \
+file\n\n");
+      return(1);
+   }
+
+   for(i=0; i<argc; i++)
+   {
+      if((part = ReadHBStats(argv[i]))==NULL)
+         return(1);
+
+      if(all == NULL)
+      {
+         if((all = CreateHBStats(0, part->NShards))==NULL ||
+            (seen = (BOOL *)calloc(part->NShards, sizeof(BOOL)))==NULL)
+         {
+            fprintf(stderr,"No memory for HBond statistics\n");
+            return(1);
+         }
+      }
+      else if(part->NShards != all->NShards)
+      {
+         fprintf(stderr,"%s is not from the same run as %s\n", argv[i],
+                 argv[0]);
+         return(1);
+      }
+
+      if(seen[part->Shard])
+      {
+         fprintf(stderr,"Shard %d/%d given twice (%s)\n", part->Shard,
+                 part->NShards, argv[i]);
+         return(1);
+      }
+      seen[part->Shard] = TRUE;
+
+      MergeHBStats(all, part);
+      FreeHBStats(part);
+   }
+
+   for(i=0; i<all->NShards; i++)
+   {
+      if(!seen[i])
+      {
+         fprintf(stderr,"Shard %d/%d is missing\n", i, all->NShards);
+         return(1);
+      }
+   }
+   
+   all->NShards = 1;
+   PrintHBStats(stdout, all, histograms);
+   if((outfile != NULL) && !WriteHBStats(all, outfile))
+      return(1);
+
+   FreeHBStats(all);
+   free(seen);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>static void AddStat(HBSTAT *stat, int quant, REAL value)
+   --------------------------------------------------------
+   Adds a value to the statistics for one quantity
+
+   18.10.26 Original   By: agent
+*/
+static void AddStat(HBSTAT *stat, int quant, REAL value)
+{
+   HISTDEF *hist = &(sHist[quant]);
+   REAL    x;
+   int     bin;
+
+   stat->N++;
+   CompensatedAdd(&(stat->Sum), &(stat->Comp), value);
+   if(value < stat->Min) stat->Min = value;
+   if(value > stat->Max) stat->Max = value;
+
+   /* Histogram                                                         */
+   x = (value - hist->Lo) / hist->Width;
+   if(!(x >= (REAL)0.0))
+      bin = 0;
+   else if(x >= (REAL)hist->NBins)
+      bin = hist->NBins + 1;
+   else
+      bin = 1 + (int)x;
+   stat->Hist[bin]++;
+
+   /* Sketch                                                            */
+   if(value >= (REAL)HBS_MINVAL)
+      stat->Sketch.Pos[SketchBucket(value)]++;
+   else if(value <= (REAL)(-HBS_MINVAL))
+      stat->Sketch.Neg[SketchBucket(-value)]++;
+   else
+      stat->Sketch.Zero++;
+}
+
+
+/************************************************************************/
+/*>static int SketchBucket(REAL value)
+   -----------------------------------
+   The sketch bucket for a value >= HBS_MINVAL. Bucket k holds values 
+   in (gamma^(k+k0-1), gamma^(k+k0)] where gamma = (1+alpha)/(1-alpha)
+   and gamma^k0 is the first bucket boundary >= HBS_MINVAL.
+
+   18.10.26 Original   By: agent
+*/
+static int SketchBucket(REAL value)
+{
+   REAL lngamma = log((1.0 + HBS_ALPHA) / (1.0 - HBS_ALPHA));
+   int  k0      = (int)ceil(log(HBS_MINVAL) / lngamma),
+        k       = (int)ceil(log(value) / lngamma) - k0;
+
+   if(k < 0)
+      k = 0;
+   if(k >= HBS_NBUCKET)
+      k = HBS_NBUCKET - 1;
+   return(k);
+}
+
+
+/************************************************************************/
+/*>static REAL BucketValue(int bucket)
+   -----------------------------------
+   The value which represents a sketch bucket; it is within a relative
+   error of alpha of anything in the bucket.
+
+   18.10.26 Original   By: agent
+*/
+static REAL BucketValue(int bucket)
+{
+   REAL gamma   = (1.0 + HBS_ALPHA) / (1.0 - HBS_ALPHA);
+   int  k0      = (int)ceil(log(HBS_MINVAL) / log(gamma));
+
+   return(2.0 * pow(gamma, (REAL)(bucket + k0)) / (gamma + 1.0));
+}
+
+
+/************************************************************************/
+/*>static BOOL ReadStatLine(HBSTATS *stats, char *buffer, BOOL *isQ)
+   -----------------------------------------------------------------
+   Reads a Q, H, P or N line of a statistics file into stats. isQ is 
+   set if it was a Q line. Returns FALSE if the line is not valid.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL ReadStatLine(HBSTATS *stats, char *buffer, BOOL *isQ)
+{
+   HBSTAT        *stat;
+   unsigned long count;
+   int           class, quant, i;
+   char          type;
+
+   *isQ = FALSE;
+   if((sscanf(buffer, "%c %d %d", &type, &class, &quant) != 3) ||
+      (class < 0) || (class >= HBS_NCLASS) ||
+      (quant < 0) || (quant >= HBS_NQUANT))
+      return(FALSE);
+   stat = &(stats->Stat[class][quant]);
+
+   switch(type)
+   {
+   case 'Q':
+      if(sscanf(buffer, "Q %*d %*d %lu %la %la %la %la %lu", &(stat->N),
+                &(stat->Sum), &(stat->Comp), &(stat->Min), &(stat->Max),
+                &(stat->Sketch.Zero)) != 6)
+         return(FALSE);
+      *isQ = TRUE;
+      return(TRUE);
+   case 'H':
+      if((sscanf(buffer, "H %*d %*d %d %lu", &i, &count) != 2) ||
+         (i < 0) || (i >= sHist[quant].NBins+2))
+         return(FALSE);
+      stat->Hist[i] = count;
+      return(TRUE);
+   case 'P':
+   case 'N':
+      if((sscanf(buffer+1, " %*d %*d %d %lu", &i, &count) != 2) ||
+         (i < 0) || (i >= HBS_NBUCKET))
+         return(FALSE);
+      if(type == 'P')
+         stat->Sketch.Pos[i] = count;
+      else
+         stat->Sketch.Neg[i] = count;
+      return(TRUE);
+   }
+   return(FALSE);
+}
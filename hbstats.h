@@ -0,0 +1,146 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       hbstats.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Mergeable statistics of HBond energies and geometry
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Collects the distributions of the HBond energy, the donor-acceptor
+   distance and the D-H-A angle for each donor/acceptor class (NN, NO,
+   ON, OO and other, as HBClass() in ehb.c) in a fixed amount of 
+   memory however many bonds are added.
+
+   Each distribution has a count, a compensated sum, the minimum and
+   maximum, a histogram with fixed bins (plus underflow and overflow
+   bins) and a DDSketch quantile sketch. The sketch counts values in 
+   logarithmically spaced buckets (separately for positive and 
+   negative values, with a count of zeros) so that any quantile is 
+   found to within a relative error of HBS_ALPHA. The bucket range is
+   fixed so the sketch never collapses buckets. Since the bins and 
+   buckets are fixed, two HBSTATS are merged by adding the counts, 
+   which gives exactly the same counts as collecting all the bonds in
+   one. Only the sum (and so the mean) depends on the order, and then 
+   only by rounding.
+
+   Statistics are written as text with hex floats so that they are 
+   read back exactly. The hbstats subcommand merges the files from 
+   the shards of a run.
+
+   File format:
+      #EHBSTATS 1
+      #sketch <alpha> <minimum |value|> <buckets>
+      #hist <quantity> <lower limit> <bin width> <bins>   (x3)
+      #shard <i>/<N>
+      Q <class> <quantity> <n> <sum> <comp> <min> <max> <zeros>
+      H <class> <quantity> <bin> <count>      (non-zero bins; 0 is the
+                                               underflow bin)
+      P <class> <quantity> <bucket> <count>   (non-zero buckets for
+      N <class> <quantity> <bucket> <count>    values > 0 and < 0)
+      #end <number of Q records>
+
+**************************************************************************
+
+   Usage:
+   ======
+   stats = CreateHBStats(shard, NShards);
+   AddHBStat(stats, class, energy, DistDA, AngDHA);
+   MergeHBStats(all, stats);
+   WriteHBStats(stats, filename);
+   PrintHBStats(stdout, stats, FALSE);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _HBSTATS_H
+#define _HBSTATS_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define HBS_VERSION  1        /* File format version                    */
+#define HBS_NCLASS   5        /* Donor/acceptor classes                 */
+#define HBS_NQUANT   3        /* Quantities...                          */
+#define HBS_ENERGY   0
+#define HBS_DISTDA   1
+#define HBS_ANGDHA   2
+#define HBS_MAXBIN   180      /* Max histogram bins for a quantity      */
+#define HBS_ALPHA    0.01     /* Relative accuracy of the quantiles     */
+#define HBS_MINVAL   1.0e-6   /* Smaller |values| count as zero and...  */
+#define HBS_MAXVAL   1.0e6    /* ...larger ones go in the last bucket   */
+#define HBS_NBUCKET  1400     /* Covers HBS_MINVAL to HBS_MAXVAL        */
+
+typedef struct
+{
+   unsigned long Pos[HBS_NBUCKET],
+                 Neg[HBS_NBUCKET],
+                 Zero;
+}  DDSKETCH;
+
+typedef struct
+{
+   DDSKETCH      Sketch;
+   unsigned long Hist[HBS_MAXBIN+2],  /* [0] under, [nbins+1] overflow */
+                 N;
+   REAL          Sum,
+                 Comp,
+                 Min,
+                 Max;
+}  HBSTAT;
+
+typedef struct
+{
+   HBSTAT Stat[HBS_NCLASS][HBS_NQUANT];
+   int    Shard,
+          NShards;
+}  HBSTATS;
+
+/************************************************************************/
+/* Prototypes
+*/
+HBSTATS *CreateHBStats(int shard, int NShards);
+void FreeHBStats(HBSTATS *stats);
+void AddHBStat(HBSTATS *stats, int class, REAL energy, REAL DistDA,
+               REAL AngDHA);
+void MergeHBStats(HBSTATS *into, HBSTATS *from);
+REAL HBStatQuantile(HBSTAT *stat, REAL q);
+BOOL WriteHBStats(HBSTATS *stats, char *filename);
+HBSTATS *ReadHBStats(char *filename);
+void PrintHBStats(FILE *out, HBSTATS *stats, BOOL histograms);
+int HBStatsMain(int argc, char **argv, char *program);
+
+#endif
@@ -0,0 +1,407 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       hbtable.c
+
+   Version:    V1.2
+   Date:       18.10.26
+   Function:   Compact table of hydrogen bonds with interned names
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See hbtable.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Added Serial   By: agent
+   V1.2  18.10.26   Serial and Type packed into TypeSerial   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bioplib/macros.h"
+#include "hbtable.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define INITBONDS 1024
+#define INITSTR   64
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL GrowBonds(HBTABLE *hbt);
+static BOOL InitPool(STRPOOL *pool);
+static void FreePool(STRPOOL *pool);
+static BOOL GrowPool(STRPOOL *pool);
+static unsigned long HashString(char *str);
+
+/************************************************************************/
+/*>HBTABLE *CreateHBTable(void)
+   ----------------------------
+   Creates an empty HBond table. Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+HBTABLE *CreateHBTable(void)
+{
+   HBTABLE *hbt;
+
+   if((hbt = (HBTABLE *)calloc(1, sizeof(HBTABLE)))==NULL)
+      return(NULL);
+
+   if(!GrowBonds(hbt)            ||
+      !InitPool(&(hbt->Atoms))    ||
+      !InitPool(&(hbt->Residues)) ||
+      !InitPool(&(hbt->ResNames)) ||
+      !InitPool(&(hbt->Types)))
+   {
+      FreeHBTable(hbt);
+      return(NULL);
+   }
+
+   return(hbt);
+}
+
+
+/************************************************************************/
+/*>void FreeHBTable(HBTABLE *hbt)
+   ------------------------------
+   Frees an HBond table
+
+   18.10.26 Original   By: agent
+*/
+void FreeHBTable(HBTABLE *hbt)
+{
+   if(hbt == NULL)
+      return;
+
+   free(hbt->AtomD);
+   free(hbt->AtomA);
+   free(hbt->ResD);
+   free(hbt->ResA);
+   free(hbt->DistDA);
+   free(hbt->AngDHA);
+   free(hbt->TypeSerial);
+   FreePool(&(hbt->Atoms));
+   FreePool(&(hbt->Residues));
+   FreePool(&(hbt->ResNames));
+   FreePool(&(hbt->Types));
+   free(hbt);
+}
+
+
+/************************************************************************/
+/*>int AddHBond(HBTABLE *hbt, char *ResID_D, char *Resnam_D,
+                char *AtomD, char *ResID_A, char *Resnam_A,
+                char *AtomA, char *type, REAL DistDA, REAL AngDHA,
+                REAL DistHA)
+   ----------------------------------------------------------------
+   Adds an HBond to the table. AngDHA is in radians. DistHA is only
+   used to flag the -1 records in HBPlus output. Returns the index of
+   the new bond or -1 if out of memory or the table is full. The 
+   bond's serial number is set to its index + 1; the caller may change
+   it with SetHBondSerial().
+
+   18.10.26 Original   By: agent
+   18.10.26 The limits on the number of atom names and types are 
+            checked before anything is interned. Sets TypeSerial   By: agent
+*/
+int AddHBond(HBTABLE *hbt, char *ResID_D, char *Resnam_D, char *AtomD,
+             char *ResID_A, char *Resnam_A, char *AtomA, char *type,
+             REAL DistDA, REAL AngDHA, REAL DistHA)
+{
+   int i,
+       atomD, atomA,
+       resD,  resA,
+       resnamD, resnamA,
+       typeid;
+
+   /* A bond may add up to two atom names and one type. Check these
+      would still fit the USHORT and type bits before the pools are 
+      changed
+   */
+   if((hbt->NHBonds >= HBT_MAXSERIAL)       ||
+      (hbt->Atoms.NStr + 2 > 0xFFFF + 1)    ||
+      (hbt->Types.NStr + 1 > HBT_TYPEMASK + 1))
+      return(-1);
+
+   if((hbt->NHBonds == hbt->MaxHBonds) && !GrowBonds(hbt))
+      return(-1);
+
+   if(((atomD   = InternString(&(hbt->Atoms),    AtomD))    < 0) ||
+      ((atomA   = InternString(&(hbt->Atoms),    AtomA))    < 0) ||
+      ((resD    = InternString(&(hbt->Residues), ResID_D))  < 0) ||
+      ((resA    = InternString(&(hbt->Residues), ResID_A))  < 0) ||
+      ((resnamD = InternString(&(hbt->ResNames), Resnam_D)) < 0) ||
+      ((resnamA = InternString(&(hbt->ResNames), Resnam_A)) < 0) ||
+      ((typeid  = InternString(&(hbt->Types),    type))     < 0))
+      return(-1);
+
+   hbt->Residues.Aux[resD] = resnamD;
+   hbt->Residues.Aux[resA] = resnamA;
+
+   i = hbt->NHBonds++;
+   hbt->AtomD[i]  = (USHORT)atomD;
+   hbt->AtomA[i]  = (USHORT)atomA;
+   hbt->ResD[i]   = resD;
+   hbt->ResA[i]   = resA;
+   hbt->DistDA[i] = (float)DistDA;
+   hbt->AngDHA[i] = (float)AngDHA;
+   hbt->TypeSerial[i] = ((unsigned int)(i+1) << HBT_SERIALSHIFT) |
+                        (unsigned int)typeid;
+   if(DistHA < (REAL)0.0)
+      hbt->TypeSerial[i] |= HBT_NOH;
+
+   return(i);
+}
+
+
+/************************************************************************/
+/*>BOOL SetHBondSerial(HBTABLE *hbt, int i, int serial)
+   ----------------------------------------------------
+   Sets the serial (HBPlus) number of bond i. Returns FALSE if it is 
+   outside 0..HBT_MAXSERIAL.
+
+   18.10.26 Original   By: agent
+*/
+BOOL SetHBondSerial(HBTABLE *hbt, int i, int serial)
+{
+   if((serial < 0) || (serial > HBT_MAXSERIAL))
+      return(FALSE);
+
+   hbt->TypeSerial[i] = 
+      ((unsigned int)serial << HBT_SERIALSHIFT) |
+      (hbt->TypeSerial[i] & ((1U << HBT_SERIALSHIFT) - 1));
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>int InternString(STRPOOL *pool, char *str)
+   ------------------------------------------
+   Returns the index of a string in a pool, adding it if it is not
+   already there. Strings are truncated to HBT_MAXSTR-1 characters.
+   Returns -1 if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+int InternString(STRPOOL *pool, char *str)
+{
+   int h;
+
+   if((h = FindString(pool, str)) >= 0)
+      return(h);
+
+   /* Keep the hash table no more than half full                        */
+   if((2 * (pool->NStr + 1) > pool->HashSize) && !GrowPool(pool))
+      return(-1);
+
+   h = (int)(HashString(str) & (pool->HashSize - 1));
+   while(pool->Hash[h] >= 0)
+      h = (h + 1) & (pool->HashSize - 1);
+
+   strncpy(pool->Str[pool->NStr], str, HBT_MAXSTR-1);
+   pool->Str[pool->NStr][HBT_MAXSTR-1] = '\0';
+   pool->Aux[pool->NStr] = 0;
+   pool->Hash[h] = pool->NStr;
+
+   return(pool->NStr++);
+}
+
+
+/************************************************************************/
+/*>int FindString(STRPOOL *pool, char *str)
+   ----------------------------------------
+   Returns the index of a string in a pool or -1 if not there
+
+   18.10.26 Original   By: agent
+*/
+int FindString(STRPOOL *pool, char *str)
+{
+   int h;
+
+   h = (int)(HashString(str) & (pool->HashSize - 1));
+   while(pool->Hash[h] >= 0)
+   {
+      if(!strncmp(pool->Str[pool->Hash[h]], str, HBT_MAXSTR-1))
+         return(pool->Hash[h]);
+      h = (h + 1) & (pool->HashSize - 1);
+   }
+
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>static BOOL GrowBonds(HBTABLE *hbt)
+   -----------------------------------
+   Doubles the space for bonds
+
+   18.10.26 Original   By: agent
+*/
+static BOOL GrowBonds(HBTABLE *hbt)
+{
+   int    max;
+   void   *p;
+
+   max = hbt->MaxHBonds ? 2 * hbt->MaxHBonds : INITBONDS;
+
+#define GROW(field, type)                                         \
+   if((p = realloc(hbt->field, max * sizeof(type)))==NULL)        \
+      return(FALSE);                                              \
+   hbt->field = (type *)p
+
+   GROW(AtomD,  USHORT);
+   GROW(AtomA,  USHORT);
+   GROW(ResD,   int);
+   GROW(ResA,   int);
+   GROW(DistDA, float);
+   GROW(AngDHA, float);
+   GROW(TypeSerial, unsigned int);
+#undef GROW
+
+   hbt->MaxHBonds = max;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL InitPool(STRPOOL *pool)
+   -----------------------------------
+   Initialises an empty string pool
+
+   18.10.26 Original   By: agent
+*/
+static BOOL InitPool(STRPOOL *pool)
+{
+   int i;
+
+   pool->NStr     = 0;
+   pool->MaxStr   = INITSTR;
+   pool->HashSize = 2 * INITSTR;
+   pool->Str      = (char (*)[HBT_MAXSTR])malloc(INITSTR * HBT_MAXSTR);
+   pool->Aux      = (int *)malloc(INITSTR * sizeof(int));
+   pool->Hash     = (int *)malloc(pool->HashSize * sizeof(int));
+   if((pool->Str == NULL) || (pool->Aux == NULL) || (pool->Hash == NULL))
+      return(FALSE);
+
+   for(i=0; i<pool->HashSize; i++)
+      pool->Hash[i] = (-1);
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static void FreePool(STRPOOL *pool)
+   -----------------------------------
+   Frees the memory used by a string pool
+
+   18.10.26 Original   By: agent
+*/
+static void FreePool(STRPOOL *pool)
+{
+   free(pool->Str);
+   free(pool->Aux);
+   free(pool->Hash);
+}
+
+
+/************************************************************************/
+/*>static BOOL GrowPool(STRPOOL *pool)
+   -----------------------------------
+   Doubles the size of a string pool and rebuilds its hash table
+
+   18.10.26 Original   By: agent
+*/
+static BOOL GrowPool(STRPOOL *pool)
+{
+   char (*str)[HBT_MAXSTR];
+   int  *aux,
+        *hash,
+        size,
+        i,
+        h;
+
+   size = 2 * pool->HashSize;
+   if((hash = (int *)malloc(size * sizeof(int)))==NULL)
+      return(FALSE);
+   if((str = (char (*)[HBT_MAXSTR])realloc(pool->Str,
+                                           size/2 * HBT_MAXSTR))==NULL)
+   {
+      free(hash);
+      return(FALSE);
+   }
+   pool->Str = str;
+   if((aux = (int *)realloc(pool->Aux, size/2 * sizeof(int)))==NULL)
+   {
+      free(hash);
+      return(FALSE);
+   }
+   pool->Aux = aux;
+
+   for(i=0; i<size; i++)
+      hash[i] = (-1);
+   for(i=0; i<pool->NStr; i++)
+   {
+      h = (int)(HashString(pool->Str[i]) & (size - 1));
+      while(hash[h] >= 0)
+         h = (h + 1) & (size - 1);
+      hash[h] = i;
+   }
+
+   free(pool->Hash);
+   pool->Hash     = hash;
+   pool->HashSize = size;
+   pool->MaxStr   = size / 2;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static unsigned long HashString(char *str)
+   ------------------------------------------
+   FNV-1a hash of (at most HBT_MAXSTR-1 characters of) a string
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses FNVHash32()   By: agent
+*/
+static unsigned long HashString(char *str)
+{
+   return(FNVHash32(FNV32_INIT, str, strnlen(str, HBT_MAXSTR-1)));
+}
@@ -0,0 +1,126 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       hbtable.h
+
+   Version:    V1.2
+   Date:       18.10.26
+   Function:   Compact table of hydrogen bonds with interned names
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Each HBond is held as a set of parallel arrays. Atom names, residue
+   IDs, residue names and bond types are interned into string pools
+   so that a bond needs only small integer IDs plus the geometry that
+   is actually used (as floats). The bond type and HBPlus number share
+   one 32-bit word. That is 24 bytes per bond against over 100 for
+   the old HBONDS structure. The residue name is a
+   property of the residue so it is held once per residue rather than
+   once per bond.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Added Serial so that bonds keep their HBPlus
+                    numbering when lines are filtered out on reading
+                    By: agent
+   V1.2  18.10.26   Serial and Type packed into TypeSerial so a bond
+                    takes 24 bytes. Added SetHBondSerial()   By: agent
+
+*************************************************************************/
+#ifndef _HBTABLE_H
+#define _HBTABLE_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define HBT_MAXSTR   16    /* Max length of an interned string + 1      */
+#define HBT_NOH      0x80  /* Type flag: HBPlus gave no H-A distance    */
+#define HBT_TYPEMASK 0x7F  /* Type bits giving index into Types pool    */
+#define HBT_SERIALSHIFT 8  /* TypeSerial bits above the type           */
+#define HBT_MAXSERIAL 0xFFFFFF /* Largest HBond number                  */
+
+typedef struct
+{
+   char (*Str)[HBT_MAXSTR];   /* The strings                            */
+   int  *Aux,                 /* Caller data for each string            */
+        *Hash,                /* Open-addressed hash of string indices  */
+        NStr,
+        MaxStr,
+        HashSize;
+}  STRPOOL;
+
+typedef struct
+{
+   USHORT  *AtomD,            /* Index into Atoms                       */
+           *AtomA;
+   int     *ResD,             /* Index into Residues                    */
+           *ResA;
+   float   *DistDA,
+           *AngDHA;           /* Radians                                */
+   unsigned int *TypeSerial;  /* HBond number (defaults to index+1) 
+                                 << HBT_SERIALSHIFT | index into Types
+                                 | HBT_NOH                              */
+   int     NHBonds,
+           MaxHBonds;
+   STRPOOL Atoms,
+           Residues,          /* Aux is the index into ResNames         */
+           ResNames,
+           Types;
+}  HBTABLE;
+
+#define HBTATOMD(hbt, i)  ((hbt)->Atoms.Str[(hbt)->AtomD[i]])
+#define HBTATOMA(hbt, i)  ((hbt)->Atoms.Str[(hbt)->AtomA[i]])
+#define HBTRESID(hbt, r)  ((hbt)->Residues.Str[r])
+#define HBTRESNAM(hbt, r) ((hbt)->ResNames.Str[(hbt)->Residues.Aux[r]])
+#define HBTTYPE(hbt, i)   \
+   ((hbt)->Types.Str[(hbt)->TypeSerial[i] & HBT_TYPEMASK])
+#define HBTNOH(hbt, i)    ((hbt)->TypeSerial[i] & HBT_NOH)
+#define HBTSERIAL(hbt, i) ((int)((hbt)->TypeSerial[i] >> HBT_SERIALSHIFT))
+
+/************************************************************************/
+/* Prototypes
+*/
+HBTABLE *CreateHBTable(void);
+void FreeHBTable(HBTABLE *hbt);
+int AddHBond(HBTABLE *hbt, char *ResID_D, char *Resnam_D, char *AtomD,
+             char *ResID_A, char *Resnam_A, char *AtomA, char *type,
+             REAL DistDA, REAL AngDHA, REAL DistHA);
+BOOL SetHBondSerial(HBTABLE *hbt, int i, int serial);
+int InternString(STRPOOL *pool, char *str);
+int FindString(STRPOOL *pool, char *str);
+
+#endif
@@ -0,0 +1,391 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       jobrun.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Run external programs concurrently with timeouts
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See jobrun.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - from ecalcrun.c and hbplusrun.c   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include "bioplib/macros.h"
+#include "jobrun.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define POLLMS   10      /* Poll interval (ms) when there are no pidfds */
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL LaunchJob(JOBRUN *run, RUNJOB *job);
+static BOOL ReapJob(JOBRUN *run, RUNJOB *job, BOOL kill_it,
+                    int *status);
+static int PidfdOpen(pid_t pid);
+
+
+/************************************************************************/
+/*>JOBRUN *CreateJobRunner(char *label, JOBTYPE *type, int MaxJobs,
+                           REAL Timeout, int MaxTries)
+   ------------------------------------------------------------------
+   Creates a runner for up to MaxJobs concurrent jobs of the given
+   type. label names the program in messages. Timeout is the wall
+   clock limit for one run in seconds (0 for none) and MaxTries the
+   number of times a job is run before giving up. Returns NULL if out
+   of memory.
+
+   18.10.26 Original   (from CreateECalcRunner())   By: agent
+*/
+JOBRUN *CreateJobRunner(char *label, JOBTYPE *type, int MaxJobs,
+                        REAL Timeout, int MaxTries)
+{
+   JOBRUN *run;
+   int    i;
+
+   if((run = (JOBRUN *)calloc(1, sizeof(JOBRUN)))==NULL)
+      return(NULL);
+
+   run->Label    = label;
+   run->Type     = type;
+   run->MaxJobs  = MAX(MaxJobs, 1);
+   run->MaxTries = MAX(MaxTries, 1);
+   run->Timeout  = Timeout;
+   if((run->Jobs = (RUNJOB *)calloc(run->MaxJobs, sizeof(RUNJOB)))==NULL)
+   {
+      free(run);
+      return(NULL);
+   }
+   for(i=0; i<run->MaxJobs; i++)
+      run->Jobs[i].pidfd = (-1);
+
+   run->epfd = epoll_create1(EPOLL_CLOEXEC);
+
+   return(run);
+}
+
+
+/************************************************************************/
+/*>void FreeJobRunner(JOBRUN *run)
+   -------------------------------
+   Kills any jobs which are still running, removes their files, frees
+   their data and frees the runner
+
+   18.10.26 Original   (from FreeECalcRunner())   By: agent
+*/
+void FreeJobRunner(JOBRUN *run)
+{
+   int i, status;
+
+   if(run == NULL)
+      return;
+
+   for(i=0; i<run->MaxJobs; i++)
+   {
+      if(run->Jobs[i].pid)
+      {
+         ReapJob(run, &(run->Jobs[i]), TRUE, &status);
+         (*run->Type->Remove)(run->Jobs[i].Data);
+         free(run->Jobs[i].Data);
+      }
+   }
+   if(run->epfd >= 0)
+      close(run->epfd);
+   free(run->Jobs);
+   free(run);
+}
+
+
+/************************************************************************/
+/*>BOOL StartJob(JOBRUN *run, int id, char *name, void *data)
+   ----------------------------------------------------------
+   Starts a job. data is the caller's description of the job, from
+   malloc(), which is passed to the JOBTYPE functions. name (which
+   should point into data) identifies the job in messages. There must
+   be a free slot (see JobRunnerFull()). Returns FALSE if the job
+   could not be started, in which case its files have been removed
+   but data still belongs to the caller.
+
+   18.10.26 Original   (from StartECalcJob())   By: agent
+*/
+BOOL StartJob(JOBRUN *run, int id, char *name, void *data)
+{
+   RUNJOB *job = NULL;
+   int    i;
+
+   for(i=0; i<run->MaxJobs; i++)
+   {
+      if(run->Jobs[i].pid == 0)
+      {
+         job = &(run->Jobs[i]);
+         break;
+      }
+   }
+   if(job == NULL)
+      return(FALSE);
+
+   job->Data  = data;
+   job->Name  = name;
+   job->Id    = id;
+   job->Tries = 0;
+
+   if(!LaunchJob(run, job))
+   {
+      (*run->Type->Remove)(data);
+      job->Data = NULL;
+      return(FALSE);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL NextJobResult(JOBRUN *run, int *id, void **data, BOOL *ok)
+   ---------------------------------------------------------------
+   Waits for the next job to finish. Failed runs are retried. Returns
+   FALSE if there are no jobs running; otherwise the job's identifier
+   is returned in id and its data (which the caller must free) in
+   data. ok is FALSE if every try failed. The job's files have been
+   removed.
+
+   18.10.26 Original   (from NextECalcResult())   By: agent
+*/
+BOOL NextJobResult(JOBRUN *run, int *id, void **data, BOOL *ok)
+{
+   struct epoll_event events[16];
+   int                i, status, wait_ms;
+   double             now, first;
+
+   while(run->NRunning)
+   {
+      /* Sleep until a child exits or the first deadline               */
+      now     = Now();
+      first   = (-1.0);
+      for(i=0; i<run->MaxJobs; i++)
+      {
+         if(run->Jobs[i].pid && (run->Timeout > (REAL)0.0) &&
+            ((first < 0.0) || (run->Jobs[i].Deadline < first)))
+            first = run->Jobs[i].Deadline;
+      }
+      wait_ms = (first < 0.0) ? (-1)
+                              : (int)(MAX(first - now, 0.0) * 1000.0) + 1;
+      if(run->epfd < 0)
+         wait_ms = (wait_ms < 0) ? POLLMS : MIN(wait_ms, POLLMS);
+
+      if(run->epfd >= 0)
+      {
+         if((epoll_wait(run->epfd, events, 16, wait_ms) < 0) &&
+            (errno != EINTR))
+            return(FALSE);
+      }
+      else
+      {
+         usleep(wait_ms * 1000);
+      }
+
+      /* See which jobs have finished or run out of time                */
+      now = Now();
+      for(i=0; i<run->MaxJobs; i++)
+      {
+         RUNJOB *job = &(run->Jobs[i]);
+
+         if(job->pid == 0)
+            continue;
+
+         if(ReapJob(run, job, FALSE, &status))
+         {
+            if(!(*ok = (*run->Type->Collect)(job->Data, status)))
+               fprintf(stderr,"%s failed on %s (try %d of %d)\n",
+                       run->Label, job->Name, job->Tries,
+                       run->MaxTries);
+         }
+         else if((run->Timeout > (REAL)0.0) && (now >= job->Deadline))
+         {
+            ReapJob(run, job, TRUE, &status);
+            *ok = FALSE;
+            fprintf(stderr,"%s timed out on %s (try %d of %d)\n",
+                    run->Label, job->Name, job->Tries, run->MaxTries);
+         }
+         else
+         {
+            continue;
+         }
+
+         /* Retry a failed job if we have tries left                    */
+         if(!(*ok) && (job->Tries < run->MaxTries) && LaunchJob(run, job))
+            continue;
+
+         *id   = job->Id;
+         *data = job->Data;
+         (*run->Type->Remove)(job->Data);
+         job->Data = NULL;
+         return(TRUE);
+      }
+   }
+
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>static BOOL LaunchJob(JOBRUN *run, RUNJOB *job)
+   -----------------------------------------------
+   Forks and runs a job in its own process group, adding its pidfd to
+   the epoll set
+
+   18.10.26 Original   (from ecalcrun.c)   By: agent
+*/
+static BOOL LaunchJob(JOBRUN *run, RUNJOB *job)
+{
+   pid_t pid;
+
+   fflush(stdout);
+   fflush(stderr);
+
+   if((pid = fork()) < 0)
+      return(FALSE);
+
+   if(pid == 0)
+   {
+      /* Own process group so that a timeout kills anything it runs    */
+      setpgid(0, 0);
+      (*run->Type->Exec)(job->Data);
+      _exit(127);
+   }
+
+   setpgid(pid, pid);
+   job->pid      = pid;
+   job->Deadline = Now() + run->Timeout;
+   job->Tries++;
+   run->NRunning++;
+
+   job->pidfd = (-1);
+   if((run->epfd >= 0) && ((job->pidfd = PidfdOpen(pid)) >= 0))
+   {
+      struct epoll_event ev;
+
+      ev.events  = EPOLLIN;
+      ev.data.fd = job->pidfd;
+      if(epoll_ctl(run->epfd, EPOLL_CTL_ADD, job->pidfd, &ev) < 0)
+      {
+         close(job->pidfd);
+         job->pidfd = (-1);
+      }
+   }
+
+   /* Without a pidfd for every child we have to poll                   */
+   if((job->pidfd < 0) && (run->epfd >= 0))
+   {
+      close(run->epfd);
+      run->epfd = (-1);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL ReapJob(JOBRUN *run, RUNJOB *job, BOOL kill_it,
+                       int *status)
+   ------------------------------------------------------------
+   Collects a child which has exited (or kills it first if kill_it is
+   set) and frees its slot. Returns FALSE if the child is still
+   running.
+
+   18.10.26 Original   (from ecalcrun.c)   By: agent
+*/
+static BOOL ReapJob(JOBRUN *run, RUNJOB *job, BOOL kill_it,
+                    int *status)
+{
+   pid_t ret;
+
+   if(kill_it)
+   {
+      kill(-job->pid, SIGKILL);
+      kill(job->pid, SIGKILL);
+   }
+
+   do
+   {
+      ret = waitpid(job->pid, status, kill_it ? 0 : WNOHANG);
+   }  while((ret < 0) && (errno == EINTR));
+
+   if(ret == 0)
+      return(FALSE);
+
+   if(job->pidfd >= 0)
+   {
+      if(run->epfd >= 0)
+         epoll_ctl(run->epfd, EPOLL_CTL_DEL, job->pidfd, NULL);
+      close(job->pidfd);
+      job->pidfd = (-1);
+   }
+   job->pid = 0;
+   run->NRunning--;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static int PidfdOpen(pid_t pid)
+   -------------------------------
+   Returns a pidfd for a child or -1 if the kernel (or C library) does
+   not provide pidfd_open()
+
+   18.10.26 Original   By: agent
+*/
+static int PidfdOpen(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+   return((int)syscall(SYS_pidfd_open, pid, 0));
+#else
+   return(-1);
+#endif
+}
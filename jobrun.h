@@ -0,0 +1,124 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       jobrun.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Run external programs concurrently with timeouts
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   The process handling shared by ecalcrun.c and hbplusrun.c. Runs up
+   to a given number of jobs at once. Each job is started with fork()
+   in its own process group and its JOBTYPE's Exec() function is
+   called in the child to set up the files and exec() the program.
+   Children are watched through pidfds in an epoll set so that
+   NextJobResult() sleeps until a job finishes or the nearest timeout
+   expires. Where pidfd_open() is not available the children are
+   polled with waitpid() instead. A job that times out is killed.
+
+   When a child exits, Collect() is given its wait status and reads
+   the job's output. A job that times out, or for which Collect()
+   fails, is re-run up to MaxTries times in all. Remove() deletes the
+   job's files once it is finished.
+
+   The data for each job is allocated by the caller with malloc() and
+   belongs to the runner while the job runs. NextJobResult() hands it
+   back.
+
+**************************************************************************
+
+   Usage:
+   ======
+   run = CreateJobRunner("prog", &type, MaxJobs, Timeout, MaxTries);
+   if(JobRunnerFull(run)) NextJobResult(run, &id, &data, &ok);
+   StartJob(run, i, name, data);
+   ...
+   while(NextJobResult(run, &id, &data, &ok)) ...use and free data...
+   FreeJobRunner(run);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original - from ecalcrun.c and hbplusrun.c   By: agent
+
+*************************************************************************/
+#ifndef _JOBRUN_H
+#define _JOBRUN_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <sys/types.h>
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define JobRunnerFull(run) ((run)->NRunning == (run)->MaxJobs)
+#define JobRunnerBusy(run) ((run)->NRunning > 0)
+
+/* What the runner calls for one kind of job                           */
+typedef struct
+{
+   void (*Exec)(void *data);        /* In the child; must not return    */
+   BOOL (*Collect)(void *data, int status); /* Reads the output         */
+   void (*Remove)(void *data);      /* Deletes the job's files          */
+}  JOBTYPE;
+
+typedef struct
+{
+   void   *Data;                    /* Caller's job data                */
+   char   *Name;                    /* For messages                     */
+   double Deadline;                 /* Time at which to kill the job    */
+   pid_t  pid;                      /* 0 if the slot is free            */
+   int    pidfd,                    /* -1 if not available              */
+          Id,                       /* Caller's identifier              */
+          Tries;
+}  RUNJOB;
+
+typedef struct
+{
+   RUNJOB  *Jobs;
+   JOBTYPE *Type;
+   char    *Label;                  /* Program name for messages        */
+   REAL    Timeout;                 /* Seconds; 0 for none              */
+   int     MaxJobs,
+           MaxTries,
+           NRunning,
+           epfd;                    /* -1 if pidfds are not available   */
+}  JOBRUN;
+
+/************************************************************************/
+/* Prototypes
+*/
+JOBRUN *CreateJobRunner(char *label, JOBTYPE *type, int MaxJobs,
+                        REAL Timeout, int MaxTries);
+void FreeJobRunner(JOBRUN *run);
+BOOL StartJob(JOBRUN *run, int id, char *name, void *data);
+BOOL NextJobResult(JOBRUN *run, int *id, void **data, BOOL *ok);
+
+#endif
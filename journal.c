@@ -0,0 +1,541 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       journal.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Checkpoint journal for batch runs
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See journal.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "bioplib/macros.h"
+#include "journal.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXHEADER  (BAT_MAXOPT + 3*BAT_MAXWORD + 64)
+#define INITHASH   1024
+#define PAIRSPACE  80      /* Max length of one chain pair in a record  */
+#define MAXPAIRS   256     /* Max chain pairs in a record read back     */
+
+/************************************************************************/
+/* Prototypes
+*/
+static unsigned long Crc32(char *buffer, int len);
+static BOOL   WriteLine(JOURNAL *jnl, char *payload);
+static BOOL   ParseRecord(JOURNAL *jnl, char *payload);
+static BOOL   HashRecord(JOURNAL *jnl, int index);
+static BOOL   SyncJournal(JOURNAL *jnl);
+static void   SyncDirectory(char *filename);
+
+
+/************************************************************************/
+/*>JOURNAL *OpenJournal(char *filename, BATCH *batch)
+   --------------------------------------------------
+   Opens a journal for the results in batch, creating it if it does 
+   not exist. If it does, the records in it are added to batch (which
+   should be empty) and any incomplete or corrupt tail is discarded.
+   Returns NULL (with a message) if the journal cannot be opened or 
+   was written by a run with different settings.
+
+   18.10.26 Original   By: agent
+*/
+JOURNAL *OpenJournal(char *filename, BATCH *batch)
+{
+   JOURNAL *jnl;
+   FILE    *fp;
+   char    header[MAXHEADER],
+           *line = NULL;
+   size_t  size  = 0;
+   ssize_t len;
+   off_t   good  = 0,
+           total = 0;
+   int     i;
+
+   if((jnl = (JOURNAL *)calloc(1, sizeof(JOURNAL)))==NULL)
+   {
+      fprintf(stderr,"No memory for journal\n");
+      return(NULL);
+   }
+   jnl->Batch    = batch;
+   jnl->HashSize = INITHASH;
+   jnl->fd       = (-1);
+   if((jnl->Hash = (int *)malloc(INITHASH * sizeof(int)))==NULL)
+   {
+      fprintf(stderr,"No memory for journal\n");
+      CloseJournal(jnl);
+      return(NULL);
+   }
+   for(i=0; i<INITHASH; i++)
+      jnl->Hash[i] = (-1);
+
+   snprintf(header, MAXHEADER, "#EHBJOURNAL %d\t%s\t%s\t%d/%d\t%s", 
+            JNL_VERSION, batch->Program, batch->Mode, 
+            batch->Shard, batch->NShards, batch->Options);
+
+   /* Read the lines which are complete and have a good checksum       */
+   if((fp = fopen(filename, "r"))!=NULL)
+   {
+      while((len = getline(&line, &size, fp)) > 0)
+      {
+         char          *payload;
+         unsigned long crc;
+
+         total += len;
+         if((len < 11) || (line[len-1] != '\n') || (line[8] != ' '))
+            break;
+         line[len-1] = '\0';
+         crc         = strtoul(line, NULL, 16);
+         payload     = line + 9;
+         if(crc != Crc32(payload, (int)(len - 10)))
+            break;
+
+         if(good == 0)
+         {
+            if(strcmp(payload, header))
+            {
+               fprintf(stderr,"Journal %s is from a different run \
+(program, options or shard)\n", filename);
+               free(line);
+               fclose(fp);
+               CloseJournal(jnl);
+               return(NULL);
+            }
+         }
+         else if(!ParseRecord(jnl, payload))
+         {
+            break;
+         }
+         good = total;
+      }
+      while(len > 0)
+         total += (len = getline(&line, &size, fp)) > 0 ? len : 0;
+      free(line);
+      fclose(fp);
+   }
+
+   if((jnl->fd = open(filename, O_WRONLY|O_CREAT|O_APPEND, 0644)) < 0)
+   {
+      fprintf(stderr,"Unable to open journal: %s\n", filename);
+      CloseJournal(jnl);
+      return(NULL);
+   }
+
+   /* Drop a tail left by a crash so new records follow good ones      */
+   if(total > good)
+   {
+      fprintf(stderr,"Discarding %ld bytes of incomplete journal: %s\n",
+              (long)(total - good), filename);
+      if(ftruncate(jnl->fd, good) != 0)
+      {
+         fprintf(stderr,"Unable to truncate journal: %s\n", filename);
+         CloseJournal(jnl);
+         return(NULL);
+      }
+   }
+
+   if(good == 0)
+   {
+      if(!WriteLine(jnl, header) || !SyncJournal(jnl))
+      {
+         fprintf(stderr,"Unable to write journal: %s\n", filename);
+         CloseJournal(jnl);
+         return(NULL);
+      }
+      SyncDirectory(filename);
+   }
+   else
+   {
+      fprintf(stderr,"Resuming from journal %s (%d structures done)\n",
+              filename, batch->NRecs);
+   }
+   
+   jnl->LastSync = Now();
+   return(jnl);
+}
+
+
+/************************************************************************/
+/*>BATCHREC *JournalDone(JOURNAL *jnl, char *name)
+   -----------------------------------------------
+   Returns the result for the named structure if it is already done
+   or NULL if not
+
+   18.10.26 Original   By: agent
+*/
+BATCHREC *JournalDone(JOURNAL *jnl, char *name)
+{
+   BATCHREC *recs = jnl->Batch->Recs;
+   int      h;
+
+   h = (int)(ShardHash(name) & (jnl->HashSize - 1));
+   while(jnl->Hash[h] >= 0)
+   {
+      if(!strcmp(recs[jnl->Hash[h]].Name, name))
+         return(recs + jnl->Hash[h]);
+      h = (h + 1) & (jnl->HashSize - 1);
+   }
+   return(NULL);
+}
+
+
+/************************************************************************/
+/*>BOOL JournalRecord(JOURNAL *jnl, BATCHREC *rec)
+   -----------------------------------------------
+   Appends the result for a structure (which must be in the journal's
+   BATCH) to the journal, syncing it if enough records or time have
+   passed since the last sync
+
+   18.10.26 Original   By: agent
+*/
+BOOL JournalRecord(JOURNAL *jnl, BATCHREC *rec)
+{
+   char *payload,
+        *p;
+   int  j;
+
+   if((payload = (char *)malloc(64 + strlen(rec->Name) + 
+                                rec->NPairs * PAIRSPACE))==NULL)
+   {
+      fprintf(stderr,"No memory for journal\n");
+      return(FALSE);
+   }
+
+   p = payload + sprintf(payload, "S\t%d\t%a\t%d\t", 
+                         rec->NHBonds, rec->Energy, rec->NPairs);
+   for(j=0; j<rec->NPairs; j++)
+   {
+      p += sprintf(p, "%d %d %d %a\t", 
+                   (int)rec->Pairs[j].ChainX, (int)rec->Pairs[j].ChainY,
+                   rec->Pairs[j].NHBonds, rec->Pairs[j].Energy);
+   }
+   strcpy(p, rec->Name);
+
+   if(!WriteLine(jnl, payload))
+   {
+      fprintf(stderr,"Unable to write journal\n");
+      free(payload);
+      return(FALSE);
+   }
+   free(payload);
+
+   if(!HashRecord(jnl, (int)(rec - jnl->Batch->Recs)))
+   {
+      fprintf(stderr,"No memory for journal\n");
+      return(FALSE);
+   }
+
+   if((++(jnl->NPending) >= JNL_SYNCRECS) ||
+      (Now() - jnl->LastSync >= JNL_SYNCSECS))
+      return(SyncJournal(jnl));
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL CloseJournal(JOURNAL *jnl)
+   -------------------------------
+   Syncs and closes a journal. The BATCH is not freed. Returns FALSE
+   if the final sync failed.
+
+   18.10.26 Original   By: agent
+*/
+BOOL CloseJournal(JOURNAL *jnl)
+{
+   BOOL ok = TRUE;
+
+   if(jnl == NULL)
+      return(TRUE);
+
+   if(jnl->fd >= 0)
+   {
+      if(jnl->NPending)
+         ok = SyncJournal(jnl);
+      if(close(jnl->fd) != 0)
+         ok = FALSE;
+   }
+   if(!ok)
+      fprintf(stderr,"Unable to sync journal\n");
+
+   free(jnl->Hash);
+   free(jnl);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>static BOOL ParseRecord(JOURNAL *jnl, char *payload)
+   ----------------------------------------------------
+   Adds a structure record read from the journal to the BATCH. A 
+   repeated name is ignored. Returns FALSE if the record is badly 
+   formed (or out of memory).
+
+   18.10.26 Original   By: agent
+*/
+static BOOL ParseRecord(JOURNAL *jnl, char *payload)
+{
+   BATCHREC *rec;
+   BATCHPAIR pairs[MAXPAIRS],
+             *pair;
+   char     *p = payload,
+            *q;
+   REAL     energy;
+   int      NHBonds,
+            NPairs,
+            j;
+
+   if(strncmp(p, "S\t", 2))
+      return(FALSE);
+   p += 2;
+   
+   NHBonds = (int)strtol(p, &q, 10);
+   if((q == p) || (*q != '\t'))  return(FALSE);
+   energy  = strtod(p = q+1, &q);
+   if((q == p) || (*q != '\t'))  return(FALSE);
+   NPairs  = (int)strtol(p = q+1, &q, 10);
+   if((q == p) || (*q != '\t') || (NPairs < 0) || (NPairs > MAXPAIRS))
+      return(FALSE);
+   p = q+1;
+
+   for(j=0; j<NPairs; j++)
+   {
+      pair          = pairs + j;
+      pair->ChainX  = (char)strtol(p, &q, 10);
+      pair->ChainY  = (char)strtol(q, &q, 10);
+      pair->NHBonds = (int)strtol(q, &q, 10);
+      pair->Energy  = strtod(q, &q);
+      if(*q != '\t')
+         return(FALSE);
+      p = q+1;
+   }
+   if(*p == '\0')
+      return(FALSE);
+
+   if(JournalDone(jnl, p) != NULL)
+      return(TRUE);
+
+   if((rec = AddBatchRecord(jnl->Batch, p, energy, NHBonds))==NULL)
+      return(FALSE);
+   for(j=0; j<NPairs; j++)
+   {
+      if(!AddBatchPair(rec, pairs[j].ChainX, pairs[j].ChainY,
+                       pairs[j].Energy, pairs[j].NHBonds))
+         return(FALSE);
+   }
+
+   return(HashRecord(jnl, jnl->Batch->NRecs - 1));
+}
+
+
+/************************************************************************/
+/*>static BOOL HashRecord(JOURNAL *jnl, int index)
+   -----------------------------------------------
+   Adds record index of the BATCH to the hash of names done, growing
+   the hash if it would be more than half full
+
+   18.10.26 Original   By: agent
+*/
+static BOOL HashRecord(JOURNAL *jnl, int index)
+{
+   BATCHREC *recs = jnl->Batch->Recs;
+   int      *hash,
+            size, i, h;
+
+   if(2 * (jnl->NHashed + 1) > jnl->HashSize)
+   {
+      size = 2 * jnl->HashSize;
+      if((hash = (int *)malloc(size * sizeof(int)))==NULL)
+         return(FALSE);
+      for(i=0; i<size; i++)
+         hash[i] = (-1);
+      for(i=0; i<jnl->HashSize; i++)
+      {
+         if(jnl->Hash[i] >= 0)
+         {
+            h = (int)(ShardHash(recs[jnl->Hash[i]].Name) & (size - 1));
+            while(hash[h] >= 0)
+               h = (h + 1) & (size - 1);
+            hash[h] = jnl->Hash[i];
+         }
+      }
+      free(jnl->Hash);
+      jnl->Hash     = hash;
+      jnl->HashSize = size;
+   }
+
+   h = (int)(ShardHash(recs[index].Name) & (jnl->HashSize - 1));
+   while(jnl->Hash[h] >= 0)
+      h = (h + 1) & (jnl->HashSize - 1);
+   jnl->Hash[h] = index;
+   jnl->NHashed++;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL WriteLine(JOURNAL *jnl, char *payload)
+   --------------------------------------------------
+   Appends a line with its checksum to the journal in a single write
+   (retried if it is interrupted or short)
+
+   18.10.26 Original   By: agent
+*/
+static BOOL WriteLine(JOURNAL *jnl, char *payload)
+{
+   char    *line;
+   int     len;
+   ssize_t done = 0,
+           n;
+
+   len = (int)strlen(payload);
+   if((line = (char *)malloc(len + 11))==NULL)
+      return(FALSE);
+   sprintf(line, "%08lx %s\n", Crc32(payload, len), payload);
+   len += 10;
+
+   while(done < len)
+   {
+      if((n = write(jnl->fd, line + done, len - done)) < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         free(line);
+         return(FALSE);
+      }
+      done += n;
+   }
+
+   free(line);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL SyncJournal(JOURNAL *jnl)
+   -------------------------------------
+   Flushes the journal to disk
+
+   18.10.26 Original   By: agent
+*/
+static BOOL SyncJournal(JOURNAL *jnl)
+{
+   jnl->NPending = 0;
+   jnl->LastSync = Now();
+   return(fdatasync(jnl->fd) == 0);
+}
+
+
+/************************************************************************/
+/*>static void SyncDirectory(char *filename)
+   -----------------------------------------
+   Flushes the directory containing a new file so that the file 
+   itself survives a crash
+
+   18.10.26 Original   By: agent
+*/
+static void SyncDirectory(char *filename)
+{
+   char *dir,
+        *slash;
+   int  fd;
+
+   if((dir = strdup(filename))==NULL)
+      return;
+   if((slash = strrchr(dir, '/')) == NULL)
+      strcpy(dir, ".");
+   else if(slash == dir)
+      slash[1] = '\0';
+   else
+      *slash = '\0';
+
+   if((fd = open(dir, O_RDONLY)) >= 0)
+   {
+      fsync(fd);
+      close(fd);
+   }
+   free(dir);
+}
+
+
+/************************************************************************/
+/*>static unsigned long Crc32(char *buffer, int len)
+   -------------------------------------------------
+   CRC-32 (as used by zlib) of a buffer
+
+   18.10.26 Original   By: agent
+*/
+static unsigned long Crc32(char *buffer, int len)
+{
+   static unsigned long table[256];
+   static BOOL          init = FALSE;
+   unsigned long        crc;
+   int                  i, j;
+
+   if(!init)
+   {
+      for(i=0; i<256; i++)
+      {
+         crc = (unsigned long)i;
+         for(j=0; j<8; j++)
+            crc = (crc & 1) ? (0xEDB88320UL ^ (crc >> 1)) : (crc >> 1);
+         table[i] = crc;
+      }
+      init = TRUE;
+   }
+
+   crc = 0xFFFFFFFFUL;
+   for(i=0; i<len; i++)
+      crc = table[(crc ^ (unsigned char)buffer[i]) & 0xFF] ^ (crc >> 8);
+
+   return(crc ^ 0xFFFFFFFFUL);
+}
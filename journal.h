@@ -0,0 +1,98 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       journal.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Checkpoint journal for batch runs
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   A journal records the result of each structure in a batch run as
+   soon as it is done so that a run which is killed can be restarted
+   and will skip the structures already done.
+
+   Each line of the journal is one complete record preceded by the 
+   CRC-32 of the rest of the line:
+      <crc> #EHBJOURNAL <version>\t<program>\t<mode>\t<i>/<N>\t<options>
+      <crc> S\t<nhbonds>\t<energy>\t<npairs>\t[<cx> <cy> <nh> <e>\t]...<name>
+   Energies are C99 hex floats and chains are char codes, as in the
+   partial result files (batch.h). Each record is appended with a 
+   single write() and the file is fsync()ed after every JNL_SYNCRECS 
+   records or JNL_SYNCSECS seconds, whichever comes first, and when 
+   it is closed. After a crash, the journal is read up to the first 
+   line which is incomplete or fails its checksum and is truncated 
+   there; at most the records since the last sync are lost and they
+   are simply recalculated. A journal may only be resumed by a run 
+   with the same program, mode, options and shard.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "batch.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define JNL_VERSION  1     /* Journal format version                    */
+#define JNL_SYNCRECS 64    /* Sync after this many records...           */
+#define JNL_SYNCSECS 2.0   /* ...or this many seconds                   */
+
+typedef struct
+{
+   BATCH  *Batch;          /* Results, including those from the journal */
+   int    *Hash,           /* Open-addressed hash of indices into Recs  */
+          HashSize,
+          NHashed,
+          fd,
+          NPending;        /* Records written since the last sync       */
+   double LastSync;
+}  JOURNAL;
+
+/************************************************************************/
+/* Prototypes
+*/
+JOURNAL *OpenJournal(char *filename, BATCH *batch);
+BATCHREC *JournalDone(JOURNAL *jnl, char *name);
+BOOL JournalRecord(JOURNAL *jnl, BATCHREC *rec);
+BOOL CloseJournal(JOURNAL *jnl);
+
+#endif
@@ -0,0 +1,331 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       lfqueue.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Bounded lock-free multi-producer multi-consumer queue
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See lfqueue.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Fixed the queue depth statistics   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+#include "lfqueue.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define NSPIN   64      /* Tries before yielding when full or empty     */
+#define NYIELD  16      /* ...and yields before sleeping                */
+#define NAPNSEC 50000   /* Sleep time (ns)                              */
+
+/************************************************************************/
+/* Prototypes
+*/
+static void Backoff(int tries);
+
+
+/************************************************************************/
+/*>LFQUEUE *CreateLFQueue(int capacity)
+   ------------------------------------
+   Creates an empty queue. The capacity is rounded up to a power of 2.
+   Returns NULL if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+LFQUEUE *CreateLFQueue(int capacity)
+{
+   LFQUEUE *q;
+   size_t  size = 2,
+           i;
+
+   while(size < (size_t)capacity)
+      size *= 2;
+
+   if((q = (LFQUEUE *)calloc(1, sizeof(LFQUEUE)))==NULL)
+      return(NULL);
+   if((q->Cells = (LFQCELL *)calloc(size, sizeof(LFQCELL)))==NULL)
+   {
+      free(q);
+      return(NULL);
+   }
+
+   q->Mask = size - 1;
+   for(i=0; i<size; i++)
+      atomic_init(&(q->Cells[i].Seq), i);
+   atomic_init(&(q->Head), 0);
+   atomic_init(&(q->Tail), 0);
+   atomic_init(&(q->NPush), 0);
+   atomic_init(&(q->DepthSum), 0);
+   atomic_init(&(q->MaxDepth), 0);
+   atomic_init(&(q->NFull), 0);
+   atomic_init(&(q->NEmpty), 0);
+
+   return(q);
+}
+
+
+/************************************************************************/
+/*>void FreeLFQueue(LFQUEUE *q)
+   ----------------------------
+   Frees a queue (but not anything still in it)
+
+   18.10.26 Original   By: agent
+*/
+void FreeLFQueue(LFQUEUE *q)
+{
+   if(q != NULL)
+   {
+      free(q->Cells);
+      free(q);
+   }
+}
+
+
+/************************************************************************/
+/*>BOOL LFQTryPush(LFQUEUE *q, void *data)
+   ---------------------------------------
+   Adds an item to the queue. Returns FALSE if it is full.
+
+   18.10.26 Original   By: agent
+   18.10.26 The depth is measured before the item is published, as a 
+            consumer may take it at once and leave Tail past pos+1
+            By: agent
+*/
+BOOL LFQTryPush(LFQUEUE *q, void *data)
+{
+   LFQCELL       *cell;
+   size_t        pos,
+                 seq;
+   unsigned long depth,
+                 max;
+
+   pos = atomic_load_explicit(&(q->Head), memory_order_relaxed);
+   for(;;)
+   {
+      cell = &(q->Cells[pos & q->Mask]);
+      seq  = atomic_load_explicit(&(cell->Seq), memory_order_acquire);
+      
+      if(seq == pos)
+      {
+         /* The cell is free; try to claim it                           */
+         if(atomic_compare_exchange_weak_explicit(&(q->Head), &pos, 
+                                                  pos+1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+            break;
+      }
+      else if((long)(seq - pos) < 0)
+      {
+         /* The cell still holds an item from the last lap: full        */
+         return(FALSE);
+      }
+      else
+      {
+         /* Another producer took this position                         */
+         pos = atomic_load_explicit(&(q->Head), memory_order_relaxed);
+      }
+   }
+
+   /* Statistics. No consumer can pass pos until the item is published
+      so Tail <= pos here
+   */
+   depth = (unsigned long)(pos + 1 - 
+           atomic_load_explicit(&(q->Tail), memory_order_relaxed));
+
+   cell->Data = data;
+   atomic_store_explicit(&(cell->Seq), pos+1, memory_order_release);
+
+   atomic_fetch_add_explicit(&(q->NPush),    1,     memory_order_relaxed);
+   atomic_fetch_add_explicit(&(q->DepthSum), depth, memory_order_relaxed);
+   max = atomic_load_explicit(&(q->MaxDepth), memory_order_relaxed);
+   while((depth > max) &&
+         !atomic_compare_exchange_weak_explicit(&(q->MaxDepth), &max, 
+                                                depth,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed));
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void *LFQTryPop(LFQUEUE *q)
+   ---------------------------
+   Removes the oldest item from the queue. Returns NULL if it is empty.
+
+   18.10.26 Original   By: agent
+*/
+void *LFQTryPop(LFQUEUE *q)
+{
+   LFQCELL *cell;
+   size_t  pos,
+           seq;
+   void    *data;
+
+   pos = atomic_load_explicit(&(q->Tail), memory_order_relaxed);
+   for(;;)
+   {
+      cell = &(q->Cells[pos & q->Mask]);
+      seq  = atomic_load_explicit(&(cell->Seq), memory_order_acquire);
+
+      if(seq == pos+1)
+      {
+         /* The cell is filled; try to claim it                         */
+         if(atomic_compare_exchange_weak_explicit(&(q->Tail), &pos, 
+                                                  pos+1,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+            break;
+      }
+      else if((long)(seq - (pos+1)) < 0)
+      {
+         /* Not filled yet: empty                                       */
+         return(NULL);
+      }
+      else
+      {
+         /* Another consumer took this position                         */
+         pos = atomic_load_explicit(&(q->Tail), memory_order_relaxed);
+      }
+   }
+
+   data = cell->Data;
+   /* Free the cell for the producer on the next lap                   */
+   atomic_store_explicit(&(cell->Seq), pos + q->Mask + 1, 
+                         memory_order_release);
+   return(data);
+}
+
+
+/************************************************************************/
+/*>BOOL LFQPush(LFQUEUE *q, void *data, atomic_int *abort)
+   -------------------------------------------------------
+   Adds an item to the queue, waiting while it is full. Returns FALSE
+   if *abort is set while waiting.
+
+   18.10.26 Original   By: agent
+*/
+BOOL LFQPush(LFQUEUE *q, void *data, atomic_int *abort)
+{
+   int tries;
+
+   if(LFQTryPush(q, data))
+      return(TRUE);
+
+   atomic_fetch_add_explicit(&(q->NFull), 1, memory_order_relaxed);
+   for(tries=0; !LFQTryPush(q, data); tries++)
+   {
+      if(atomic_load_explicit(abort, memory_order_relaxed))
+         return(FALSE);
+      Backoff(tries);
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void *LFQPop(LFQUEUE *q, atomic_int *abort)
+   -------------------------------------------
+   Removes the oldest item from the queue, waiting while it is empty.
+   Returns NULL if *abort is set while waiting.
+
+   18.10.26 Original   By: agent
+*/
+void *LFQPop(LFQUEUE *q, atomic_int *abort)
+{
+   void *data;
+   int  tries;
+
+   if((data = LFQTryPop(q)) != NULL)
+      return(data);
+
+   atomic_fetch_add_explicit(&(q->NEmpty), 1, memory_order_relaxed);
+   for(tries=0; (data = LFQTryPop(q)) == NULL; tries++)
+   {
+      if(atomic_load_explicit(abort, memory_order_relaxed))
+         return(NULL);
+      Backoff(tries);
+   }
+   return(data);
+}
+
+
+/************************************************************************/
+/*>int LFQDepth(LFQUEUE *q)
+   ------------------------
+   The approximate number of items in the queue
+
+   18.10.26 Original   By: agent
+*/
+int LFQDepth(LFQUEUE *q)
+{
+   size_t head = atomic_load_explicit(&(q->Head), memory_order_relaxed),
+          tail = atomic_load_explicit(&(q->Tail), memory_order_relaxed);
+
+   return((head > tail) ? (int)(head - tail) : 0);
+}
+
+
+/************************************************************************/
+/*>static void Backoff(int tries)
+   ------------------------------
+   Waits a little before trying a full or empty queue again: spinning
+   at first, then yielding the CPU, then sleeping
+
+   18.10.26 Original   By: agent
+*/
+static void Backoff(int tries)
+{
+   struct timespec nap;
+
+   if(tries < NSPIN)
+      return;
+   if(tries < NSPIN + NYIELD)
+   {
+      sched_yield();
+      return;
+   }
+   nap.tv_sec  = 0;
+   nap.tv_nsec = NAPNSEC;
+   nanosleep(&nap, NULL);
+}
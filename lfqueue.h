@@ -0,0 +1,110 @@
+/*************************************************************************
+
+   Program:    ehb
+   File:       lfqueue.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Bounded lock-free multi-producer multi-consumer queue
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   A fixed size ring of pointers which may be pushed and popped by any
+   number of threads without locks (D. Vyukov's bounded MPMC queue).
+   Each cell carries a sequence number which tells a producer whether
+   the cell is free for this lap of the ring and a consumer whether it
+   has been filled. The head and tail positions are claimed with a 
+   compare-and-swap and are kept on separate cache lines.
+
+   LFQTryPush() and LFQTryPop() never wait. LFQPush() and LFQPop() 
+   wait (spinning, then yielding, then sleeping) while the queue is 
+   full or empty, which gives back-pressure between the stages of a 
+   pipeline. They give up if *abort becomes non-zero.
+
+   Each queue counts the pushes, the depth seen at each push (for the
+   mean and maximum) and the number of times a push found the queue 
+   full or a pop found it empty, for reporting with --stats.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _LFQUEUE_H
+#define _LFQUEUE_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdatomic.h>
+#include <stddef.h>
+#include "bioplib/SysDefs.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define LFQ_CACHELINE 64
+
+typedef struct
+{
+   atomic_size_t Seq;
+   void          *Data;
+}  LFQCELL;
+
+typedef struct
+{
+   LFQCELL       *Cells;
+   size_t        Mask;
+   char          pad0[LFQ_CACHELINE];
+   atomic_size_t Head;           /* Next position to push               */
+   char          pad1[LFQ_CACHELINE];
+   atomic_size_t Tail;           /* Next position to pop                */
+   char          pad2[LFQ_CACHELINE];
+   atomic_ulong  NPush,          /* Statistics                          */
+                 DepthSum,
+                 MaxDepth,
+                 NFull,
+                 NEmpty;
+}  LFQUEUE;
+
+#define LFQCapacity(q) ((int)((q)->Mask + 1))
+
+/************************************************************************/
+/* Prototypes
+*/
+LFQUEUE *CreateLFQueue(int capacity);
+void FreeLFQueue(LFQUEUE *q);
+BOOL LFQTryPush(LFQUEUE *q, void *data);
+void *LFQTryPop(LFQUEUE *q);
+BOOL LFQPush(LFQUEUE *q, void *data, atomic_int *abort);
+void *LFQPop(LFQUEUE *q, atomic_int *abort);
+int LFQDepth(LFQUEUE *q);
+
+#endif
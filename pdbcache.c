@@ -0,0 +1,755 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       pdbcache.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Binary cache of a parsed PDB file
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See pdbcache.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Every residue, atom, hash entry and name used is 
+                    checked when the cache is opened   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bioplib/macros.h"
+#include "pdbcache.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXPATH 512
+#define HASHMIN 256
+
+/* Size of a field of a PDB record                                      */
+#define PDBFIELD(f) sizeof(((PDB *)NULL)->f)
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL CacheName(char *PDBFile, char *CacheFile);
+static BOOL HashFile(char *PDBFile, unsigned long *hash);
+static BOOL UpdateCacheMTime(char *CacheFile, struct stat *src);
+static BOOL SectionOK(long offset, int n, size_t size, size_t FileSize);
+static BOOL RecordsOK(PDBCACHEHDR *hdr, char *map);
+static BOOL NameOK(char (*names)[HBT_MAXSTR], int NNames, int i, 
+                   size_t size);
+static unsigned long HashResidue(char *chain, int resnum, char insert);
+static BOOL WriteBlock(FILE *fp, void *data, size_t size, long *offset);
+static BOOL FillCache(PDB *pdb, STRPOOL *names, CACHEATOM *atoms,
+                      CACHERES *res, int *NRes);
+static int *HashResidues(CACHERES *res, int NRes, STRPOOL *names,
+                         int *HashSize);
+static BOOL WriteCacheFile(char *CacheFile, PDBCACHEHDR *hdr,
+                           CACHERES *res, int *hash, CACHEATOM *atoms,
+                           char (*names)[HBT_MAXSTR]);
+
+/************************************************************************/
+/*>PDBCACHE *OpenPDBCache(char *PDBFile)
+   -------------------------------------
+   Maps the cache for a PDB file. Returns NULL if there is no cache or
+   it is out of date.
+
+   18.10.26 Original   By: agent
+   18.10.26 Maps the cache read-only. The mtime is updated separately
+            By: agent
+   18.10.26 Checks that every section lies inside the file   By: agent
+   18.10.26 Checks the records with RecordsOK()   By: agent
+*/
+PDBCACHE *OpenPDBCache(char *PDBFile)
+{
+   PDBCACHE    *cache;
+   PDBCACHEHDR *hdr;
+   struct stat src, st;
+   char        CacheFile[MAXPATH];
+   int         fd;
+   void        *map;
+
+   if(!CacheName(PDBFile, CacheFile) || (stat(PDBFile, &src) < 0))
+      return(NULL);
+   if((fd = open(CacheFile, O_RDONLY)) < 0)
+      return(NULL);
+   if((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(PDBCACHEHDR)))
+   {
+      close(fd);
+      return(NULL);
+   }
+
+   map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if(map == MAP_FAILED)
+      return(NULL);
+   hdr = (PDBCACHEHDR *)map;
+
+   /* Check the cache belongs to this version and source file and that
+      each section lies inside the file. The hash table size must be a
+      power of two since it is used as a mask. Then check the records,
+      so that a corrupt cache is treated as a miss
+   */
+   if(strncmp(hdr->Magic, PDBCACHE_MAGIC, 8)        ||
+      (hdr->Version  != PDBCACHE_VERSION)           ||
+      (hdr->SrcSize  != (long)src.st_size)          ||
+      (hdr->HashSize <= 0)                          ||
+      (hdr->HashSize & (hdr->HashSize - 1))         ||
+      !SectionOK(hdr->OffRes,   hdr->NRes,     sizeof(CACHERES), 
+                 (size_t)st.st_size)                ||
+      !SectionOK(hdr->OffHash,  hdr->HashSize, sizeof(int),
+                 (size_t)st.st_size)                ||
+      !SectionOK(hdr->OffAtom,  hdr->NAtoms,   sizeof(CACHEATOM), 
+                 (size_t)st.st_size)                ||
+      !SectionOK(hdr->OffNames, hdr->NNames,   HBT_MAXSTR, 
+                 (size_t)st.st_size)                ||
+      !RecordsOK(hdr, (char *)map))
+   {
+      munmap(map, (size_t)st.st_size);
+      return(NULL);
+   }
+
+   /* If the file has been touched, check whether it has changed       */
+   if((hdr->SrcMTime     != (long)src.st_mtim.tv_sec) ||
+      (hdr->SrcMTimeNsec != (long)src.st_mtim.tv_nsec))
+   {
+      unsigned long hash;
+      
+      if(!HashFile(PDBFile, &hash) || (hash != hdr->SrcHash))
+      {
+         munmap(map, (size_t)st.st_size);
+         return(NULL);
+      }
+      UpdateCacheMTime(CacheFile, &src);
+   }
+
+   if((cache = (PDBCACHE *)malloc(sizeof(PDBCACHE)))==NULL)
+   {
+      munmap(map, (size_t)st.st_size);
+      return(NULL);
+   }
+   if((cache->Marked = (BOOL *)calloc(hdr->NRes+1, sizeof(BOOL)))==NULL)
+   {
+      free(cache);
+      munmap(map, (size_t)st.st_size);
+      return(NULL);
+   }
+   
+   cache->map   = (char *)map;
+   cache->size  = (size_t)st.st_size;
+   cache->hdr   = hdr;
+   cache->res   = (CACHERES  *)(cache->map + hdr->OffRes);
+   cache->hash  = (int       *)(cache->map + hdr->OffHash);
+   cache->atoms = (CACHEATOM *)(cache->map + hdr->OffAtom);
+   cache->names = (char (*)[HBT_MAXSTR])(cache->map + hdr->OffNames);
+
+   return(cache);
+}
+
+
+/************************************************************************/
+/*>void ClosePDBCache(PDBCACHE *cache)
+   -----------------------------------
+   Unmaps a PDB cache
+
+   18.10.26 Original   By: agent
+*/
+void ClosePDBCache(PDBCACHE *cache)
+{
+   if(cache == NULL)
+      return;
+   
+   munmap(cache->map, cache->size);
+   free(cache->Marked);
+   free(cache);
+}
+
+
+/************************************************************************/
+/*>BOOL MarkCachedResidue(PDBCACHE *cache, char *chain, int resnum, 
+                          char insert)
+   ----------------------------------------------------------------
+   Marks a residue (and the residues before and after it in the same
+   chain) to be read by ReadCachedResidues(). Returns FALSE if the
+   residue is not in the cache.
+
+   18.10.26 Original   By: agent
+*/
+BOOL MarkCachedResidue(PDBCACHE *cache, char *chain, int resnum, 
+                       char insert)
+{
+   int      h, i,
+            mask = cache->hdr->HashSize - 1;
+   CACHERES *res = cache->res;
+
+   h = (int)(HashResidue(chain, resnum, insert) & mask);
+   while((i = cache->hash[h]) >= 0)
+   {
+      if((res[i].ResNum == resnum) && (res[i].Insert == insert) &&
+         !strcmp(cache->names[res[i].Chain], chain))
+      {
+         for(; i>=0; i=res[i].Next)
+         {
+            cache->Marked[i] = TRUE;
+            if((i > 0) && (res[i-1].Chain == res[i].Chain))
+               cache->Marked[i-1] = TRUE;
+            if((i < cache->hdr->NRes-1) && 
+               (res[i+1].Chain == res[i].Chain))
+               cache->Marked[i+1] = TRUE;
+         }
+         return(TRUE);
+      }
+      h = (h + 1) & mask;
+   }
+
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>PDB *ReadCachedResidues(PDBCACHE *cache, int *natoms)
+   -----------------------------------------------------
+   Builds a PDB linked list of the marked residues, in file order
+
+   18.10.26 Original   By: agent
+*/
+PDB *ReadCachedResidues(PDBCACHE *cache, int *natoms)
+{
+   PDB       *pdb = NULL,
+             *p   = NULL;
+   CACHEATOM *a;
+   int       i, j;
+
+   *natoms = 0;
+   
+   for(i=0; i<cache->hdr->NRes; i++)
+   {
+      if(!cache->Marked[i])
+         continue;
+      
+      for(j=0; j<cache->res[i].NAtoms; j++)
+      {
+         if(pdb == NULL)
+         {
+            INIT(pdb, PDB);
+            p = pdb;
+         }
+         else
+         {
+            ALLOCNEXT(p, PDB);
+         }
+         if(p == NULL)
+         {
+            FREELIST(pdb, PDB);
+            *natoms = 0;
+            return(NULL);
+         }
+         CLEAR_PDB(p);
+
+         a = &(cache->atoms[cache->res[i].FirstAtom + j]);
+         strcpy(p->record_type, a->hetatm ? "HETATM" : "ATOM  ");
+         strcpy(p->atnam,       cache->names[a->atnam]);
+         strcpy(p->atnam_raw,   cache->names[a->atnam_raw]);
+         strcpy(p->resnam,      cache->names[a->resnam]);
+         strcpy(p->chain,       cache->names[cache->res[i].Chain]);
+         p->insert[0] = cache->res[i].Insert;
+         p->insert[1] = '\0';
+         p->resnum    = cache->res[i].ResNum;
+         p->atnum     = a->atnum;
+         p->altpos    = a->altpos;
+         p->x         = (REAL)a->x;
+         p->y         = (REAL)a->y;
+         p->z         = (REAL)a->z;
+         p->occ       = (REAL)a->occ;
+         p->bval      = (REAL)a->bval;
+         (*natoms)++;
+      }
+   }
+
+   return(pdb);
+}
+
+
+/************************************************************************/
+/*>BOOL WritePDBCache(char *PDBFile, PDB *pdb)
+   -------------------------------------------
+   Writes the cache for a PDB file which has been read into pdb. The
+   cache is written to a temporary file and renamed so a reader never
+   sees a partial cache. Returns FALSE (leaving no cache) on failure,
+   e.g. if the directory is not writable.
+
+   18.10.26 Original   By: agent
+*/
+BOOL WritePDBCache(char *PDBFile, PDB *pdb)
+{
+   PDBCACHEHDR hdr;
+   CACHERES    *res   = NULL;
+   CACHEATOM   *atoms = NULL;
+   HBTABLE     *pools;
+   PDB         *p;
+   int         *hash  = NULL,
+               NAtoms = 0;
+   struct stat src;
+   char        CacheFile[MAXPATH];
+   BOOL        ok     = FALSE;
+
+   if(!CacheName(PDBFile, CacheFile) || (stat(PDBFile, &src) < 0))
+      return(FALSE);
+
+   /* An HBTABLE is used just for its string pool                       */
+   if((pools = CreateHBTable())==NULL)
+      return(FALSE);
+
+   for(p=pdb; p!=NULL; NEXT(p))
+      NAtoms++;
+
+   memset(&hdr, 0, sizeof(PDBCACHEHDR));
+   memcpy(hdr.Magic, PDBCACHE_MAGIC, 8);
+   hdr.Version      = PDBCACHE_VERSION;
+   hdr.NAtoms       = NAtoms;
+   hdr.SrcSize      = (long)src.st_size;
+   hdr.SrcMTime     = (long)src.st_mtim.tv_sec;
+   hdr.SrcMTimeNsec = (long)src.st_mtim.tv_nsec;
+
+   if(((atoms = (CACHEATOM *)calloc(NAtoms+1, sizeof(CACHEATOM)))!=NULL) &&
+      ((res   = (CACHERES  *)calloc(NAtoms+1, sizeof(CACHERES)))!=NULL)  &&
+      FillCache(pdb, &(pools->Atoms), atoms, res, &(hdr.NRes))          &&
+      ((hash  = HashResidues(res, hdr.NRes, &(pools->Atoms), 
+                             &(hdr.HashSize)))!=NULL)                   &&
+      HashFile(PDBFile, &(hdr.SrcHash)))
+   {
+      hdr.NNames = pools->Atoms.NStr;
+      ok = WriteCacheFile(CacheFile, &hdr, res, hash, atoms, 
+                          pools->Atoms.Str);
+   }
+
+   free(atoms);
+   free(res);
+   free(hash);
+   FreeHBTable(pools);
+   
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>static BOOL FillCache(PDB *pdb, STRPOOL *names, CACHEATOM *atoms,
+                         CACHERES *res, int *NRes)
+   -----------------------------------------------------------------
+   Fills in the atom and residue tables from a PDB linked list. A new 
+   residue is started when the chain, residue number or insert changes.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL FillCache(PDB *pdb, STRPOOL *names, CACHEATOM *atoms,
+                      CACHERES *res, int *NRes)
+{
+   PDB *p;
+   int i,
+       n1, n2, n3, nc;
+
+   *NRes = 0;
+   
+   for(i=0, p=pdb; p!=NULL; NEXT(p), i++)
+   {
+      if(((n1 = InternString(names, p->atnam))     < 0) ||
+         ((n2 = InternString(names, p->atnam_raw)) < 0) ||
+         ((n3 = InternString(names, p->resnam))    < 0) ||
+         ((nc = InternString(names, p->chain))     < 0) ||
+         (names->NStr > 0xFFFF))
+         return(FALSE);
+
+      if((*NRes == 0) ||
+         (res[*NRes-1].Chain  != nc)        ||
+         (res[*NRes-1].ResNum != p->resnum) ||
+         (res[*NRes-1].Insert != p->insert[0]))
+      {
+         res[*NRes].FirstAtom = i;
+         res[*NRes].ResNum    = p->resnum;
+         res[*NRes].Chain     = nc;
+         res[*NRes].Insert    = p->insert[0];
+         res[*NRes].Next      = (-1);
+         (*NRes)++;
+      }
+      res[*NRes-1].NAtoms++;
+
+      atoms[i].x         = (double)p->x;
+      atoms[i].y         = (double)p->y;
+      atoms[i].z         = (double)p->z;
+      atoms[i].occ       = (double)p->occ;
+      atoms[i].bval      = (double)p->bval;
+      atoms[i].atnum     = p->atnum;
+      atoms[i].atnam     = (USHORT)n1;
+      atoms[i].atnam_raw = (USHORT)n2;
+      atoms[i].resnam    = (USHORT)n3;
+      atoms[i].hetatm    = (char)!strncmp(p->record_type, "HETATM", 6);
+      atoms[i].altpos    = p->altpos;
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static int *HashResidues(CACHERES *res, int NRes, STRPOOL *names,
+                            int *HashSize)
+   -----------------------------------------------------------------
+   Builds the residue hash table. Further runs of atoms for a residue
+   are chained from the first through Next. Returns NULL if out of 
+   memory.
+
+   18.10.26 Original   By: agent
+*/
+static int *HashResidues(CACHERES *res, int NRes, STRPOOL *names,
+                         int *HashSize)
+{
+   int *hash,
+       *last,
+       i, j, h;
+
+   for(*HashSize=HASHMIN; *HashSize < 2*NRes; *HashSize *= 2);
+   
+   if((hash = (int *)malloc(*HashSize * sizeof(int)))==NULL)
+      return(NULL);
+   if((last = (int *)malloc(*HashSize * sizeof(int)))==NULL)
+   {
+      free(hash);
+      return(NULL);
+   }
+   
+   for(h=0; h<*HashSize; h++)
+      hash[h] = (-1);
+   for(i=0; i<NRes; i++)
+   {
+      h = (int)(HashResidue(names->Str[res[i].Chain], res[i].ResNum, 
+                            res[i].Insert) & (*HashSize - 1));
+      while((j = hash[h]) >= 0)
+      {
+         if((res[j].Chain  == res[i].Chain)  &&
+            (res[j].ResNum == res[i].ResNum) &&
+            (res[j].Insert == res[i].Insert))
+            break;
+         h = (h + 1) & (*HashSize - 1);
+      }
+      if(j < 0)
+         hash[h] = i;
+      else
+         res[last[h]].Next = i;
+      last[h] = i;
+   }
+
+   free(last);
+   return(hash);
+}
+
+
+/************************************************************************/
+/*>static BOOL WriteCacheFile(char *CacheFile, PDBCACHEHDR *hdr,
+                              CACHERES *res, int *hash, 
+                              CACHEATOM *atoms, 
+                              char (*names)[HBT_MAXSTR])
+   -------------------------------------------------------------
+   Writes the sections of the cache to a temporary file, fills in the
+   offsets in the header and renames the file into place
+
+   18.10.26 Original   By: agent
+*/
+static BOOL WriteCacheFile(char *CacheFile, PDBCACHEHDR *hdr,
+                           CACHERES *res, int *hash, CACHEATOM *atoms,
+                           char (*names)[HBT_MAXSTR])
+{
+   FILE *fp;
+   char TmpFile[MAXPATH+32];
+   long offset = 0;
+   BOOL ok     = FALSE;
+
+   sprintf(TmpFile, "%s.%d", CacheFile, (int)getpid());
+   if((fp = fopen(TmpFile, "wb"))==NULL)
+      return(FALSE);
+
+   /* Write a placeholder header, then the sections and finally the
+      real header with the offsets filled in
+   */
+   if(WriteBlock(fp, hdr, sizeof(PDBCACHEHDR), &offset))
+   {
+      hdr->OffRes = offset;
+      if(WriteBlock(fp, res, hdr->NRes * sizeof(CACHERES), &offset))
+      {
+         hdr->OffHash = offset;
+         if(WriteBlock(fp, hash, hdr->HashSize * sizeof(int), &offset))
+         {
+            hdr->OffAtom = offset;
+            if(WriteBlock(fp, atoms, hdr->NAtoms * sizeof(CACHEATOM), 
+                          &offset))
+            {
+               hdr->OffNames = offset;
+               if(WriteBlock(fp, names, 
+                             (size_t)hdr->NNames * HBT_MAXSTR, &offset))
+               {
+                  rewind(fp);
+                  ok = (fwrite(hdr, sizeof(PDBCACHEHDR), 1, fp) == 1);
+               }
+            }
+         }
+      }
+   }
+   
+   if(fclose(fp) || !ok || rename(TmpFile, CacheFile))
+   {
+      unlink(TmpFile);
+      return(FALSE);
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL WriteBlock(FILE *fp, void *data, size_t size, 
+                          long *offset)
+   -------------------------------------------------------------
+   Writes a block of data padded to a multiple of 8 bytes and updates
+   the offset
+
+   18.10.26 Original   By: agent
+*/
+static BOOL WriteBlock(FILE *fp, void *data, size_t size, long *offset)
+{
+   static char zero[8] = {0,0,0,0,0,0,0,0};
+   size_t      pad     = (8 - (size % 8)) % 8;
+
+   if(size && (fwrite(data, 1, size, fp) != size))
+      return(FALSE);
+   if(pad && (fwrite(zero, 1, pad, fp) != pad))
+      return(FALSE);
+
+   *offset += (long)(size + pad);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL CacheName(char *PDBFile, char *CacheFile)
+   -----------------------------------------------------
+   Makes the name of the cache file for a PDB file
+
+   18.10.26 Original   By: agent
+*/
+static BOOL CacheName(char *PDBFile, char *CacheFile)
+{
+   if(strlen(PDBFile) + strlen(PDBCACHE_EXT) >= MAXPATH)
+      return(FALSE);
+   
+   sprintf(CacheFile, "%s%s", PDBFile, PDBCACHE_EXT);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL HashFile(char *PDBFile, unsigned long *hash)
+   --------------------------------------------------------
+   64-bit FNV-1a hash of the contents of a file
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses FNVHash64()   By: agent
+*/
+static BOOL HashFile(char *PDBFile, unsigned long *hash)
+{
+   FILE               *fp;
+   unsigned char      buffer[65536];
+   size_t             n;
+   unsigned long long h = FNV64_INIT;
+
+   if((fp = fopen(PDBFile, "rb"))==NULL)
+      return(FALSE);
+
+   while((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+      h = FNVHash64(h, buffer, n);
+   fclose(fp);
+
+   *hash = (unsigned long)h;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL UpdateCacheMTime(char *CacheFile, struct stat *src)
+   ---------------------------------------------------------------
+   Records the new modification time of an unchanged source file in
+   the cache header so that the file need not be hashed next time. 
+   This only saves time, so the caller ignores a failure (e.g. a cache
+   which we may not write).
+
+   18.10.26 Original   By: agent
+*/
+static BOOL UpdateCacheMTime(char *CacheFile, struct stat *src)
+{
+   long mtime[2];
+   int  fd;
+   BOOL ok;
+
+   if((fd = open(CacheFile, O_WRONLY)) < 0)
+      return(FALSE);
+
+   /* SrcMTime and SrcMTimeNsec are adjacent in the header              */
+   mtime[0] = (long)src->st_mtim.tv_sec;
+   mtime[1] = (long)src->st_mtim.tv_nsec;
+   ok = (pwrite(fd, mtime, sizeof(mtime), 
+                offsetof(PDBCACHEHDR, SrcMTime)) == (ssize_t)sizeof(mtime));
+   close(fd);
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>static BOOL SectionOK(long offset, int n, size_t size, size_t FileSize)
+   ----------------------------------------------------------------------
+   Does a section of n items of size bytes at offset lie inside the
+   file (and is it aligned)? As in resmatread.c
+
+   18.10.26 Original   By: agent
+*/
+static BOOL SectionOK(long offset, int n, size_t size, size_t FileSize)
+{
+   if((n < 0) || (offset < (long)sizeof(PDBCACHEHDR)) || (offset % 8) ||
+      ((size_t)offset > FileSize))
+      return(FALSE);
+   if((size_t)n > (FileSize - (size_t)offset) / size)
+      return(FALSE);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL RecordsOK(PDBCACHEHDR *hdr, char *map)
+   --------------------------------------------------
+   Checks that every index in the records of a mapped cache is in 
+   range, so that nothing read from it can run off a section. Each 
+   residue's atoms must lie inside the atom table and its Next must be
+   a later residue (so the chain ends). Every name used must be NUL 
+   terminated and fit the PDB field it is copied to. The hash table 
+   must hold only residue indices and at least one empty slot (so a
+   probe ends). The sections must already have been checked with 
+   SectionOK().
+
+   18.10.26 Original   By: agent
+*/
+static BOOL RecordsOK(PDBCACHEHDR *hdr, char *map)
+{
+   CACHERES  *res   = (CACHERES  *)(map + hdr->OffRes);
+   int       *hash  = (int       *)(map + hdr->OffHash);
+   CACHEATOM *atoms = (CACHEATOM *)(map + hdr->OffAtom);
+   char      (*names)[HBT_MAXSTR] = 
+                      (char (*)[HBT_MAXSTR])(map + hdr->OffNames);
+   BOOL      empty  = FALSE;
+   int       i;
+
+   for(i=0; i<hdr->NRes; i++)
+   {
+      if(!NameOK(names, hdr->NNames, res[i].Chain, PDBFIELD(chain)) ||
+         (res[i].FirstAtom < 0) || (res[i].NAtoms < 0)              ||
+         (res[i].NAtoms > hdr->NAtoms - res[i].FirstAtom)           ||
+         ((res[i].Next != (-1)) && 
+          ((res[i].Next <= i) || (res[i].Next >= hdr->NRes))))
+         return(FALSE);
+   }
+
+   for(i=0; i<hdr->NAtoms; i++)
+   {
+      if(!NameOK(names, hdr->NNames, atoms[i].atnam, 
+                 PDBFIELD(atnam))                                   ||
+         !NameOK(names, hdr->NNames, atoms[i].atnam_raw, 
+                 PDBFIELD(atnam_raw))                               ||
+         !NameOK(names, hdr->NNames, atoms[i].resnam, 
+                 PDBFIELD(resnam)))
+         return(FALSE);
+   }
+
+   for(i=0; i<hdr->HashSize; i++)
+   {
+      if(hash[i] == (-1))
+         empty = TRUE;
+      else if((hash[i] < 0) || (hash[i] >= hdr->NRes))
+         return(FALSE);
+   }
+
+   return(empty);
+}
+
+
+/************************************************************************/
+/*>static BOOL NameOK(char (*names)[HBT_MAXSTR], int NNames, int i, 
+                      size_t size)
+   ----------------------------------------------------------------
+   Is i the index of a name which is NUL terminated and fits in a 
+   field of size bytes?
+
+   18.10.26 Original   By: agent
+*/
+static BOOL NameOK(char (*names)[HBT_MAXSTR], int NNames, int i, 
+                   size_t size)
+{
+   if((i < 0) || (i >= NNames))
+      return(FALSE);
+   return(memchr(names[i], '\0', MIN(size, HBT_MAXSTR)) != NULL);
+}
+
+
+/************************************************************************/
+/*>static unsigned long HashResidue(char *chain, int resnum, char insert)
+   ---------------------------------------------------------------------
+   Hashes a residue identifier
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses FNVHash32()   By: agent
+*/
+static unsigned long HashResidue(char *chain, int resnum, char insert)
+{
+   unsigned long hash;
+
+   hash = FNVHash32(FNV32_INIT, chain, strlen(chain));
+   hash = FNV32_STEP(hash, resnum);
+   hash = FNV32_STEP(hash, (unsigned char)insert);
+
+   return(hash);
+}
@@ -0,0 +1,146 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       pdbcache.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Binary cache of a parsed PDB file
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   A parsed PDB file is written to <file>.ehbcache as a flat array of
+   atoms, a table of residues (each pointing to a run of atoms) with a
+   hash table for lookup, and a pool of interned names (chains, atom
+   and residue names). Later runs mmap the cache, look up the residues
+   needed and build PDB records for just those, without parsing any
+   text.
+
+   The cache is valid if the size and mtime of the PDB file match those
+   recorded. If only the mtime differs, the file contents are hashed
+   and, if the hash matches, the recorded mtime is updated. The format
+   is native-endian and is not intended to be moved between machines.
+
+   File layout (all offsets from the start of the file):
+      PDBCACHEHDR
+      CACHERES[NRes]
+      int[HashSize]           (residue index, -1 = empty)
+      CACHEATOM[NAtoms]
+      char[NNames][HBT_MAXSTR]
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _PDBCACHE_H
+#define _PDBCACHE_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "bioplib/pdb.h"
+#include "hbtable.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define PDBCACHE_MAGIC   "EHBPDBC1"
+#define PDBCACHE_VERSION 1
+#define PDBCACHE_EXT     ".ehbcache"
+
+typedef struct
+{
+   char          Magic[8];
+   int           Version,
+                 NAtoms,
+                 NRes,
+                 NNames,
+                 HashSize,
+                 Pad;
+   long          SrcSize,
+                 SrcMTime,
+                 SrcMTimeNsec;
+   unsigned long SrcHash;
+   long          OffRes,
+                 OffHash,
+                 OffAtom,
+                 OffNames;
+}  PDBCACHEHDR;
+
+typedef struct
+{
+   int  FirstAtom,
+        NAtoms,
+        ResNum,
+        Chain,                /* Index into the names                   */
+        Next;                 /* Next run of atoms for the same residue */
+   char Insert,
+        Pad[3];
+}  CACHERES;
+
+typedef struct
+{
+   double x, y, z,
+          occ,
+          bval;
+   int    atnum;
+   USHORT atnam,              /* Indices into the names                 */
+          atnam_raw,
+          resnam;
+   char   hetatm,
+          altpos;
+}  CACHEATOM;
+
+typedef struct
+{
+   char        *map;
+   size_t      size;
+   PDBCACHEHDR *hdr;
+   CACHERES    *res;
+   int         *hash;
+   CACHEATOM   *atoms;
+   char        (*names)[HBT_MAXSTR];
+   BOOL        *Marked;
+}  PDBCACHE;
+
+/************************************************************************/
+/* Prototypes
+*/
+PDBCACHE *OpenPDBCache(char *PDBFile);
+void ClosePDBCache(PDBCACHE *cache);
+BOOL WritePDBCache(char *PDBFile, PDB *pdb);
+BOOL MarkCachedResidue(PDBCACHE *cache, char *chain, int resnum, 
+                       char insert);
+PDB *ReadCachedResidues(PDBCACHE *cache, int *natoms);
+
+#endif
@@ -0,0 +1,424 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       pdbindex.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   Load only selected residues from a PDB file
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See pdbindex.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Compressed files are not indexed   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bioplib/macros.h"
+#include "pdbindex.h"
+#include "zread.h"
+#include "ehbutil.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define INITRES 256
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL AddResidue(PDBINDEX *idx, char chain, int resnum, 
+                       char insert, long start);
+static BOOL BuildHash(PDBINDEX *idx);
+static unsigned long HashResidue(char chain, int resnum, char insert);
+static int ReadResnum(char *field);
+
+/************************************************************************/
+/*>PDBINDEX *IndexPDBFile(char *filename)
+   --------------------------------------
+   Maps a PDB file and finds the start and end of each residue's 
+   ATOM/HETATM records. Only the record type and the chain, residue 
+   number and insert columns are examined. Returns NULL if the file 
+   can't be mapped, is compressed or is out of memory - the caller may 
+   then fall back to reading the whole file.
+
+   18.10.26 Original   By: agent
+   18.10.26 Returns NULL for a gzip or zstd file   By: agent
+*/
+PDBINDEX *IndexPDBFile(char *filename)
+{
+   PDBINDEX    *idx;
+   struct stat st;
+   int         fd;
+   char        *line, 
+               *eol,
+               *end,
+               chain  = '\0',
+               insert = '\0';
+   int         resnum = 0;
+
+   if(ZFileType(filename) != ZT_PLAIN)
+      return(NULL);
+   if((fd = open(filename, O_RDONLY)) < 0)
+      return(NULL);
+   if((fstat(fd, &st) < 0) || (st.st_size == 0))
+   {
+      close(fd);
+      return(NULL);
+   }
+
+   if((idx = (PDBINDEX *)calloc(1, sizeof(PDBINDEX)))==NULL)
+   {
+      close(fd);
+      return(NULL);
+   }
+   
+   idx->size = (size_t)st.st_size;
+   idx->text = (char *)mmap(NULL, idx->size, PROT_READ, MAP_PRIVATE, 
+                            fd, 0);
+   close(fd);
+   if(idx->text == (char *)MAP_FAILED)
+   {
+      free(idx);
+      return(NULL);
+   }
+   madvise(idx->text, idx->size, MADV_SEQUENTIAL);
+
+   end = idx->text + idx->size;
+   for(line=idx->text; line<end; line=eol+1)
+   {
+      if((eol = (char *)memchr(line, '\n', end-line)) == NULL)
+         eol = end;
+
+      if((eol - line) >= 6 && !strncmp(line, "ENDMDL", 6))
+         break;
+
+      /* Records need to reach the insert code column                   */
+      if(((eol - line) >= 27) &&
+         (!strncmp(line, "ATOM  ", 6) || !strncmp(line, "HETATM", 6)))
+      {
+         int r = ReadResnum(line+22);
+
+         if((idx->NRes == 0) ||
+            (line[21] != chain) || (r != resnum) || (line[26] != insert))
+         {
+            chain  = line[21];
+            resnum = r;
+            insert = line[26];
+            if(!AddResidue(idx, chain, resnum, insert, line - idx->text))
+            {
+               FreePDBIndex(idx);
+               return(NULL);
+            }
+         }
+         idx->End[idx->NRes-1] = (eol < end) ? (eol+1 - idx->text) 
+                                             : (eol - idx->text);
+      }
+   }
+
+   if(!BuildHash(idx))
+   {
+      FreePDBIndex(idx);
+      return(NULL);
+   }
+
+   return(idx);
+}
+
+
+/************************************************************************/
+/*>void FreePDBIndex(PDBINDEX *idx)
+   --------------------------------
+   Unmaps the file and frees a PDB index
+
+   18.10.26 Original   By: agent
+*/
+void FreePDBIndex(PDBINDEX *idx)
+{
+   if(idx == NULL)
+      return;
+
+   if(idx->text != NULL)
+      munmap(idx->text, idx->size);
+   free(idx->Start);
+   free(idx->End);
+   free(idx->ResNum);
+   free(idx->Next);
+   free(idx->Hash);
+   free(idx->Chain);
+   free(idx->Insert);
+   free(idx->Marked);
+   free(idx);
+}
+
+
+/************************************************************************/
+/*>BOOL MarkResidue(PDBINDEX *idx, char chain, int resnum, char insert)
+   -------------------------------------------------------------------
+   Marks a residue (and the residues before and after it in the same
+   chain) to be read by ReadMarkedResidues(). Returns FALSE if the 
+   residue is not in the file.
+
+   18.10.26 Original   By: agent
+*/
+BOOL MarkResidue(PDBINDEX *idx, char chain, int resnum, char insert)
+{
+   int  h, 
+        i;
+   BOOL found = FALSE;
+
+   h = (int)(HashResidue(chain, resnum, insert) & (idx->HashSize - 1));
+   while(idx->Hash[h] >= 0)
+   {
+      i = idx->Hash[h];
+      if((idx->Chain[i] == chain) && (idx->ResNum[i] == resnum) &&
+         (idx->Insert[i] == insert))
+      {
+         /* Mark every block for this residue                           */
+         for(; i>=0; i=idx->Next[i])
+         {
+            idx->Marked[i] = TRUE;
+            if((i > 0) && (idx->Chain[i-1] == chain))
+               idx->Marked[i-1] = TRUE;
+            if((i < idx->NRes-1) && (idx->Chain[i+1] == chain))
+               idx->Marked[i+1] = TRUE;
+         }
+         found = TRUE;
+         break;
+      }
+      h = (h + 1) & (idx->HashSize - 1);
+   }
+
+   return(found);
+}
+
+
+/************************************************************************/
+/*>PDB *ReadMarkedResidues(PDBINDEX *idx, int *natoms)
+   ---------------------------------------------------
+   Reads the records of the marked residues, in file order, into a PDB
+   linked list
+
+   18.10.26 Original   By: agent
+*/
+PDB *ReadMarkedResidues(PDBINDEX *idx, int *natoms)
+{
+   FILE   *fp;
+   PDB    *pdb;
+   char   *buffer;
+   size_t len = 0;
+   int    i;
+
+   *natoms = 0;
+   
+   for(i=0; i<idx->NRes; i++)
+   {
+      if(idx->Marked[i])
+         len += idx->End[i] - idx->Start[i];
+   }
+   if(len == 0)
+      return(NULL);
+
+   if((buffer = (char *)malloc(len))==NULL)
+      return(NULL);
+
+   for(len=0, i=0; i<idx->NRes; i++)
+   {
+      if(idx->Marked[i])
+      {
+         memcpy(buffer+len, idx->text+idx->Start[i], 
+                idx->End[i] - idx->Start[i]);
+         len += idx->End[i] - idx->Start[i];
+      }
+   }
+
+   if((fp = fmemopen(buffer, len, "r"))==NULL)
+   {
+      free(buffer);
+      return(NULL);
+   }
+   pdb = ReadPDB(fp, natoms);
+   fclose(fp);
+   free(buffer);
+
+   return(pdb);
+}
+
+
+/************************************************************************/
+/*>static BOOL AddResidue(PDBINDEX *idx, char chain, int resnum, 
+                          char insert, long start)
+   -------------------------------------------------------------
+   Adds a residue block to the index, growing the arrays as needed
+
+   18.10.26 Original   By: agent
+*/
+static BOOL AddResidue(PDBINDEX *idx, char chain, int resnum, 
+                       char insert, long start)
+{
+   if(idx->NRes == idx->MaxRes)
+   {
+      int  max = idx->MaxRes ? 2 * idx->MaxRes : INITRES;
+      void *p;
+
+#define GROW(field, type)                                         \
+      if((p = realloc(idx->field, max * sizeof(type)))==NULL)     \
+         return(FALSE);                                           \
+      idx->field = (type *)p
+
+      GROW(Start,  long);
+      GROW(End,    long);
+      GROW(ResNum, int);
+      GROW(Next,   int);
+      GROW(Chain,  char);
+      GROW(Insert, char);
+      GROW(Marked, BOOL);
+#undef GROW
+
+      idx->MaxRes = max;
+   }
+
+   idx->Start[idx->NRes]  = start;
+   idx->End[idx->NRes]    = start;
+   idx->ResNum[idx->NRes] = resnum;
+   idx->Chain[idx->NRes]  = chain;
+   idx->Insert[idx->NRes] = insert;
+   idx->Next[idx->NRes]   = (-1);
+   idx->Marked[idx->NRes] = FALSE;
+   idx->NRes++;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL BuildHash(PDBINDEX *idx)
+   ------------------------------------
+   Builds the residue hash table. Each entry is the first block for a
+   residue; further blocks for the same residue (e.g. split by other
+   records) are chained through Next.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL BuildHash(PDBINDEX *idx)
+{
+   int i, h, j,
+       *last;
+
+   for(idx->HashSize=2*INITRES; idx->HashSize < 2*idx->NRes; 
+       idx->HashSize *= 2);
+
+   if((idx->Hash = (int *)malloc(idx->HashSize * sizeof(int)))==NULL)
+      return(FALSE);
+   if((last = (int *)malloc(idx->HashSize * sizeof(int)))==NULL)
+      return(FALSE);
+   for(i=0; i<idx->HashSize; i++)
+      idx->Hash[i] = (-1);
+
+   for(i=0; i<idx->NRes; i++)
+   {
+      h = (int)(HashResidue(idx->Chain[i], idx->ResNum[i], 
+                            idx->Insert[i]) & (idx->HashSize - 1));
+      while((j = idx->Hash[h]) >= 0)
+      {
+         if((idx->Chain[j]  == idx->Chain[i])  &&
+            (idx->ResNum[j] == idx->ResNum[i]) &&
+            (idx->Insert[j] == idx->Insert[i]))
+            break;
+         h = (h + 1) & (idx->HashSize - 1);
+      }
+      
+      if(j < 0)
+         idx->Hash[h] = i;
+      else
+         idx->Next[last[h]] = i;
+      last[h] = i;
+   }
+
+   free(last);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static unsigned long HashResidue(char chain, int resnum, char insert)
+   --------------------------------------------------------------------
+   Hashes a residue identifier
+
+   18.10.26 Original   By: agent
+   18.10.26 Uses FNV32_STEP()   By: agent
+*/
+static unsigned long HashResidue(char chain, int resnum, char insert)
+{
+   unsigned long hash = FNV32_INIT;
+
+   hash = FNV32_STEP(hash, (unsigned char)chain);
+   hash = FNV32_STEP(hash, resnum);
+   hash = FNV32_STEP(hash, (unsigned char)insert);
+
+   return(hash);
+}
+
+
+/************************************************************************/
+/*>static int ReadResnum(char *field)
+   ----------------------------------
+   Reads the 4 character residue number field of a PDB record
+
+   18.10.26 Original   By: agent
+*/
+static int ReadResnum(char *field)
+{
+   int  i,
+        resnum = 0;
+   BOOL neg    = FALSE;
+
+   for(i=0; i<4; i++)
+   {
+      if(field[i] == '-')
+         neg = TRUE;
+      else if((field[i] >= '0') && (field[i] <= '9'))
+         resnum = 10*resnum + (field[i] - '0');
+   }
+
+   return(neg ? -resnum : resnum);
+}
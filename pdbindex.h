@@ -0,0 +1,91 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       pdbindex.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Load only selected residues from a PDB file
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   IndexPDBFile() maps a PDB file into memory and makes a single pass
+   over it, looking only at the record type and residue columns, to
+   find the block of ATOM/HETATM records for each residue. Residues 
+   needed are then marked with MarkResidue(), which also marks the
+   residues either side in the same chain so that peptide bonds may
+   be checked. ReadMarkedResidues() passes just the marked records to 
+   ReadPDB() and so builds a linked list holding only those residues.
+   As with ReadPDB(), only the first model is used.
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _PDBINDEX_H
+#define _PDBINDEX_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "bioplib/pdb.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+typedef struct
+{
+   char   *text;              /* The mapped file                        */
+   size_t size;
+   long   *Start,             /* Offset of first record of each residue */
+          *End;               /* Offset just past its last record       */
+   int    *ResNum,
+          *Next,              /* Next block with the same hash key      */
+          *Hash,              /* Open-addressed hash of first blocks    */
+          NRes,
+          MaxRes,
+          HashSize;
+   char   *Chain,
+          *Insert;
+   BOOL   *Marked;
+}  PDBINDEX;
+
+/************************************************************************/
+/* Prototypes
+*/
+PDBINDEX *IndexPDBFile(char *filename);
+void FreePDBIndex(PDBINDEX *idx);
+BOOL MarkResidue(PDBINDEX *idx, char chain, int resnum, char insert);
+PDB *ReadMarkedResidues(PDBINDEX *idx, int *natoms);
+
+#endif
@@ -0,0 +1,212 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       pdbread.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Reads the residues needed by an HBond table
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See pdbread.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original (from ehb2 and ehb3)   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bioplib/macros.h"
+#include "bioplib/fsscanf.h"
+#include "pdbread.h"
+#include "pdbindex.h"
+#include "pdbcache.h"
+#include "cifread.h"
+#include "zread.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXCHAIN 8            /* Size of the chain buffers              */
+
+
+/************************************************************************/
+/*>BOOL FormatHBTResID(char *resid, char *chain, int resnum,
+                       char insert)
+   ----------------------------------------------------------
+   Writes a residue ID for an HBond table into resid, which must have
+   room for HBT_MAXSTR characters. This is cnnnni as written by HBPlus
+   if the chain is a single character and the residue number fits in 4
+   characters, otherwise chain.nnnni. A blank chain or insert is
+   written as '-'. Returns FALSE if the ID is too long.
+
+   18.10.26 Original   By: agent
+*/
+BOOL FormatHBTResID(char *resid, char *chain, int resnum, char insert)
+{
+   char buffer[2*HBT_MAXSTR];
+   BOOL blank = (chain[0] == '\0') || !strcmp(chain, " ");
+
+   if(strlen(chain) >= HBT_MAXSTR)
+      return(FALSE);
+   if((insert == ' ') || (insert == '\0'))
+      insert = '-';
+
+   if((strlen(chain) <= 1) && (resnum >= -999) && (resnum <= 9999))
+      sprintf(buffer, "%c%04d%c", blank ? '-' : chain[0], resnum,
+              insert);
+   else
+      sprintf(buffer, "%s.%d%c", blank ? "-" : chain, resnum, insert);
+
+   if(strlen(buffer) >= HBT_MAXSTR)
+      return(FALSE);
+   strcpy(resid, buffer);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>void ParseHBTResID(char *resid, char *chain, int *resnum,
+                      char *insert)
+   ---------------------------------------------------------
+   Reads a residue ID written by HBPlus or FormatHBTResID(). chain and
+   insert must have room for 8 characters. A '-' chain or insert is
+   returned as a blank.
+
+   18.10.26 Original   By: agent   (from ReadNeededResidues())
+*/
+void ParseHBTResID(char *resid, char *chain, int *resnum, char *insert)
+{
+   char *dot;
+   int  len,
+        n = 0;
+
+   *resnum   = 0;
+   insert[0] = '-';
+
+   if((dot = strchr(resid, '.'))!=NULL)
+   {
+      len = MIN((int)(dot - resid), MAXCHAIN-1);
+      strncpy(chain, resid, len);
+      chain[len] = '\0';
+      if(sscanf(dot+1, "%d%n", resnum, &n) == 1)
+         insert[0] = dot[1+n];
+   }
+   else
+   {
+      fsscanf(resid, "%c%4d%c", chain, resnum, insert);
+      chain[1] = '\0';
+   }
+
+   if(!strcmp(chain, "-"))
+      strcpy(chain, " ");
+   if((insert[0] == '-') || (insert[0] == '\0'))
+      insert[0] = ' ';
+   insert[1] = '\0';
+}
+
+
+/************************************************************************/
+/*>PDB *ReadNeededResidues(char *PDBFile, HBTABLE *hbt, BOOL UseCache)
+   -------------------------------------------------------------------
+   Reads just the residues referenced by the HBond table (and their
+   neighbours). If UseCache is set and there is an up to date binary
+   cache of the PDB file, they are taken from that. Otherwise the
+   whole file is read and a cache is written for next time. With the
+   cache switched off, the PDB file is indexed with a PDBINDEX. Falls
+   back to reading the whole file if it can't be indexed. mmCIF files
+   are always read whole (if not cached). Compressed files are read
+   whole through zread.c.
+
+   18.10.26 Original   By: agent   (from ehb2 and ehb3)
+*/
+PDB *ReadNeededResidues(char *PDBFile, HBTABLE *hbt, BOOL UseCache)
+{
+   FILE     *fp;
+   PDBINDEX *idx   = NULL;
+   PDBCACHE *cache = NULL;
+   PDB      *pdb;
+   char     chain[MAXCHAIN],
+            insert[MAXCHAIN];
+   int      resnum,
+            natoms,
+            r;
+   BOOL     cif;
+
+   cif = IsMMCIF(PDBFile);
+
+   if(UseCache && ((cache = OpenPDBCache(PDBFile))!=NULL))
+   {
+      for(r=0; r<hbt->Residues.NStr; r++)
+      {
+         ParseHBTResID(HBTRESID(hbt, r), chain, &resnum, insert);
+         MarkCachedResidue(cache, chain, resnum, insert[0]);
+      }
+      pdb = ReadCachedResidues(cache, &natoms);
+      ClosePDBCache(cache);
+   }
+   else if(!UseCache && !cif && ((idx = IndexPDBFile(PDBFile))!=NULL))
+   {
+      for(r=0; r<hbt->Residues.NStr; r++)
+      {
+         ParseHBTResID(HBTRESID(hbt, r), chain, &resnum, insert);
+         MarkResidue(idx, chain[0], resnum, insert[0]);
+      }
+      pdb = ReadMarkedResidues(idx, &natoms);
+      FreePDBIndex(idx);
+   }
+   else if((fp=ZOpen(PDBFile))!=NULL)
+   {
+      pdb = cif ? ReadMMCIF(fp, &natoms) : ReadPDB(fp, &natoms);
+      if(ZClose(fp) && (pdb != NULL))
+      {
+         FREELIST(pdb, PDB);
+         pdb = NULL;
+      }
+      if(UseCache && (pdb != NULL))
+         WritePDBCache(PDBFile, pdb);
+   }
+   else
+   {
+      fprintf(stderr,"Unable to open PDB file with hydrogens: %s\n",
+              PDBFile);
+      return(NULL);
+   }
+
+   if(pdb == NULL)
+      fprintf(stderr,"Can't read atoms from PDB file %s\n", PDBFile);
+
+   return(pdb);
+}
@@ -0,0 +1,76 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       pdbread.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Reads the residues needed by an HBond table
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   ReadNeededResidues() reads just the residues used by the HBonds in
+   an HBTABLE (and their neighbours) from a PDB or mmCIF file, using
+   the binary cache (pdbcache.c) or the PDB index (pdbindex.c) where
+   it can.
+
+   The residue IDs in the table are in the HBPlus form, cnnnni, where
+   c is the chain, nnnn the residue number and i the insert code, with
+   '-' for a blank chain or insert. A chain of more than one character,
+   or a residue number which does not fit in 4 characters, is given as
+   chain.nnnni instead. FormatHBTResID() writes an ID and
+   ParseHBTResID() reads one back.
+
+**************************************************************************
+
+   Usage:
+   ======
+   FormatHBTResID(resid, "A", 23, ' ');     gives "A0023-"
+   ParseHBTResID("A0023-", chain, &resnum, insert);
+   pdb = ReadNeededResidues(PDBFile, hbt, UseCache);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original (from ehb2 and ehb3)   By: agent
+
+*************************************************************************/
+#ifndef _PDBREAD_H
+#define _PDBREAD_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/pdb.h"
+#include "hbtable.h"
+
+/************************************************************************/
+/* Prototypes
+*/
+BOOL FormatHBTResID(char *resid, char *chain, int resnum, char insert);
+void ParseHBTResID(char *resid, char *chain, int *resnum, char *insert);
+PDB *ReadNeededResidues(char *PDBFile, HBTABLE *hbt, BOOL UseCache);
+
+#endif
@@ -0,0 +1,704 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       relax.c
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   In-process relaxation of a residue pair
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See relax.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Failure is returned as RLX_FAILED   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bioplib/macros.h"
+#include "relax.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define INITATOMS  64
+#define ARMIJO     1.0e-4   /* Sufficient decrease for the line search  */
+#define MAXHALVE   30       /* Max step halvings in the line search     */
+#define ETOL       1.0e-9   /* Stop when the energy change is below this*/
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL GrowRelaxWork(RELAXWORK *work, int NAtoms);
+static BOOL LoadPair(RELAXWORK *work, PDB *res1, PDB *res2);
+static int  LoadResidue(RELAXWORK *work, PDB *res, int first);
+static void MapPolar(RELAXWORK *work, PDB *res, int first, int NAtoms,
+                     RLXPOLAR *polar);
+static BOOL IsBackbone(PDB *p);
+static REAL HBondGrad(REAL *x, REAL *g, RLXPOLAR *don, RLXPOLAR *acc,
+                      EPARAMS *eparams);
+static int  LBFGS(RELAXWORK *work, EPARAMS *eparams);
+static REAL Dot(REAL *a, REAL *b, int n);
+
+/************************************************************************/
+/* Globals
+*/
+static char *sBackbone[] = 
+{
+   "N   ", "CA  ", "C   ", "O   ", "H   ", "HN  ", "HA  ", "HA1 ", 
+   "HA2 ", "OXT ", "HT1 ", "HT2 ", "HT3 ", NULL
+};
+
+
+/************************************************************************/
+/*>RELAXWORK *CreateRelaxWork(void)
+   --------------------------------
+   Creates the work space for RelaxResPair(). Returns NULL if out of
+   memory.
+
+   18.10.26 Original   By: agent
+*/
+RELAXWORK *CreateRelaxWork(void)
+{
+   RELAXWORK *work;
+
+   if((work = (RELAXWORK *)calloc(1, sizeof(RELAXWORK)))==NULL)
+      return(NULL);
+
+   if(!GrowRelaxWork(work, INITATOMS))
+   {
+      FreeRelaxWork(work);
+      return(NULL);
+   }
+
+   return(work);
+}
+
+
+/************************************************************************/
+/*>void FreeRelaxWork(RELAXWORK *work)
+   -----------------------------------
+   Frees the relaxation work space
+
+   18.10.26 Original   By: agent
+*/
+void FreeRelaxWork(RELAXWORK *work)
+{
+   if(work == NULL)
+      return;
+
+   free(work->x);
+   free(work->x0);
+   free(work->g);
+   free(work->xnew);
+   free(work->gnew);
+   free(work->d);
+   free(work->s);
+   free(work->y);
+   free(work->RSq0);
+   free(work->Fixed);
+   free(work->Polar);
+   free(work->Atom);
+   free(work);
+}
+
+
+/************************************************************************/
+/*>REAL RelaxResPair(RELAXWORK *work, PDB *res1, PDB *res2, 
+                     EPARAMS *eparams, int *NIter)
+   ------------------------------------------------------
+   Relaxes the sidechains of two residues and returns the hydrogen 
+   bond energy between them at the relaxed positions. The number of 
+   L-BFGS iterations is returned in NIter (may be NULL). The PDB 
+   linked lists are not changed. PrecalcParams() must have been 
+   called. Returns RLX_FAILED if out of memory.
+
+   18.10.26 Original   By: agent
+   18.10.26 Returns RLX_FAILED   By: agent
+*/
+REAL RelaxResPair(RELAXWORK *work, PDB *res1, PDB *res2, 
+                  EPARAMS *eparams, int *NIter)
+{
+   REAL EHBond;
+   int  iter;
+
+   if(!LoadPair(work, res1, res2))
+      return(RLX_FAILED);
+
+   iter = LBFGS(work, eparams);
+   if(NIter != NULL)
+      *NIter = iter;
+
+   RelaxEnergy(work, work->x, work->g, eparams, &EHBond);
+   return(EHBond);
+}
+
+
+/************************************************************************/
+/*>REAL RelaxEnergy(RELAXWORK *work, REAL *x, REAL *g, EPARAMS *eparams,
+                    REAL *EHBond)
+   ---------------------------------------------------------------------
+   Calculates the relaxation energy of the loaded pair at coordinates
+   x and its gradient in g (zero for fixed atoms). The hydrogen bond 
+   part is returned in EHBond. At the start coordinates this equals
+   ResPairHBEnergy().
+
+   18.10.26 Original   By: agent
+*/
+REAL RelaxEnergy(RELAXWORK *work, REAL *x, REAL *g, EPARAMS *eparams,
+                 REAL *EHBond)
+{
+   REAL energy,
+        EHB;
+   int  i, j, k, 
+        n = 3 * work->NAtoms,
+        NRes2 = work->NAtoms - work->NRes1;
+
+   for(k=0; k<n; k++)
+      g[k] = (REAL)0.0;
+
+   /* Hydrogen bonds in both directions                                 */
+   EHB  = HBondGrad(x, g, &(work->polar[0]), &(work->polar[1]), eparams);
+   EHB += HBondGrad(x, g, &(work->polar[1]), &(work->polar[0]), eparams);
+   energy = EHB;
+
+   /* Repulsion between atoms of the two residues which are not part of
+      the hydrogen bonding. Atoms never need be further apart than they
+      started, so bonded neighbours are not pushed apart.
+   */
+   for(i=0; i<work->NRes1; i++)
+   {
+      for(j=work->NRes1; j<work->NAtoms; j++)
+      {
+         REAL r0Sq, dx, dy, dz, rSq, dE;
+
+         if((work->Fixed[i] && work->Fixed[j]) ||
+            (work->Polar[i] && work->Polar[j]))
+            continue;
+
+         r0Sq = work->RSq0[i*NRes2 + j-work->NRes1];
+         dx   = x[3*i]   - x[3*j];
+         dy   = x[3*i+1] - x[3*j+1];
+         dz   = x[3*i+2] - x[3*j+2];
+         rSq  = dx*dx + dy*dy + dz*dz;
+         if(rSq >= r0Sq)
+            continue;
+
+         energy  += RLX_REPULSE * (r0Sq - rSq) * (r0Sq - rSq);
+         dE       = (REAL)(-4.0) * RLX_REPULSE * (r0Sq - rSq);
+         g[3*i]   += dE * dx;   g[3*j]   -= dE * dx;
+         g[3*i+1] += dE * dy;   g[3*j+1] -= dE * dy;
+         g[3*i+2] += dE * dz;   g[3*j+2] -= dE * dz;
+      }
+   }
+
+   /* Positional restraints on the moving atoms                         */
+   for(i=0; i<work->NAtoms; i++)
+   {
+      if(work->Fixed[i])
+      {
+         g[3*i] = g[3*i+1] = g[3*i+2] = (REAL)0.0;
+         continue;
+      }
+      for(k=3*i; k<3*i+3; k++)
+      {
+         REAL dx = x[k] - work->x0[k];
+         energy += RLX_RESTRAINT * dx * dx;
+         g[k]   += (REAL)2.0 * RLX_RESTRAINT * dx;
+      }
+   }
+
+   if(EHBond != NULL)
+      *EHBond = EHB;
+
+   return(energy);
+}
+
+
+/************************************************************************/
+/*>static REAL HBondGrad(REAL *x, REAL *g, RLXPOLAR *don, RLXPOLAR *acc,
+                         EPARAMS *eparams)
+   ---------------------------------------------------------------------
+   Hydrogen bond energy of the donors in one residue with the acceptors
+   in the other, adding the gradient into g. As in ResPairHBEnergy() 
+   each donor/acceptor pair uses its best hydrogen and the gradient is
+   that of the best hydrogen's term. The terms are those of 
+   EHBondGeom() differentiated with respect to the D, H and A 
+   coordinates.
+
+   18.10.26 Original   By: agent
+*/
+static REAL HBondGrad(REAL *x, REAL *g, RLXPOLAR *don, RLXPOLAR *acc,
+                      EPARAMS *eparams)
+{
+   REAL ETot = (REAL)0.0;
+   int  d, a, h, k;
+
+   for(d=0; d<don->NDonors; d++)
+   {
+      REAL *D = x + 3*don->Donor[d];
+      
+      for(a=0; a<acc->NAcceptors; a++)
+      {
+         REAL *A = x + 3*acc->Acceptor[a],
+              DA[3],
+              u, InvU, Inv10, R, dRdu,
+              EBest = (REAL)0.0,
+              gD[3], gH[3], gA[3];
+         int  class,
+              best  = (-1);
+
+         for(k=0; k<3; k++)
+            DA[k] = D[k] - A[k];
+         u = DA[0]*DA[0] + DA[1]*DA[1] + DA[2]*DA[2];
+         if((u == (REAL)0.0) || (u >= eparams->CutOffHBSq))
+            continue;
+
+         /* Distance part and its derivative with respect to u=r^2     */
+         class = HBClass(don->DonorEl[d], acc->AcceptorEl[a]);
+         InvU  = (REAL)1.0 / u;
+         Inv10 = InvU * InvU * InvU * InvU * InvU;
+         R     = (eparams->ParamR12[class] * InvU * Inv10) -
+                 (eparams->ParamR10[class] * Inv10);
+         dRdu  = ((REAL)(-6.0) * eparams->ParamR12[class] * InvU * Inv10 +
+                  (REAL)5.0 * eparams->ParamR10[class] * Inv10) * InvU;
+         if(u > eparams->CutOnHBSq)
+         {
+            REAL DistFromOn  = eparams->CutOnHBSq  - u,
+                 DistFromOff = eparams->CutOffHBSq - u,
+                 S, dS;
+
+            S    = DistFromOff * DistFromOff * eparams->Rul3 *
+                   (DistFromOff - (REAL)3.0 * DistFromOn);
+            dS   = (REAL)6.0 * eparams->Rul3 * DistFromOff * DistFromOn;
+            dRdu = dRdu * S + R * dS;
+            R   *= S;
+         }
+
+         for(h=0; h<don->NH[d]; h++)
+         {
+            REAL *H = x + 3*don->DonorH[d][h],
+                 va[3], vb[3],
+                 LaSq, LbSq, Lab, c, q, EA, dEAdq, e, K;
+            BOOL clamped = FALSE;
+
+            for(k=0; k<3; k++)
+            {
+               va[k] = D[k] - H[k];
+               vb[k] = A[k] - H[k];
+            }
+            LaSq = va[0]*va[0] + va[1]*va[1] + va[2]*va[2];
+            LbSq = vb[0]*vb[0] + vb[1]*vb[1] + vb[2]*vb[2];
+            if((Lab = sqrt(LaSq * LbSq)) == (REAL)0.0)
+               continue;
+            c = (va[0]*vb[0] + va[1]*vb[1] + va[2]*vb[2]) / Lab;
+            if(c <= (REAL)(-0.99999))
+            {
+               c       = (REAL)(-0.99999);
+               clamped = TRUE;
+            }
+            if(c > (REAL)0.0)
+               continue;
+            q = c * c;
+            if(q <= eparams->CutOffHBAngSq)
+               continue;
+
+            /* Angle part and its derivative with respect to q=cos^2   */
+            EA    = q * q;
+            dEAdq = (REAL)2.0 * q;
+            if(q < eparams->CutOnHBAngSq)
+            {
+               REAL AngFromOn  = eparams->CutOnHBAngSq  - q,
+                    AngFromOff = eparams->CutOffHBAngSq - q,
+                    S, dS;
+               
+               S     = AngFromOff * AngFromOff * eparams->Rua3 *
+                       (AngFromOff - (REAL)3.0 * AngFromOn);
+               dS    = (REAL)6.0 * eparams->Rua3 * AngFromOff * AngFromOn;
+               dEAdq = dEAdq * S + EA * dS;
+               EA   *= S;
+            }
+
+            if((e = R * EA) >= EBest)
+               continue;
+            EBest = e;
+            best  = h;
+
+            /* dE/dx = EA dR/du du/dx + R dEA/dq 2c dc/dx               */
+            K = clamped ? (REAL)0.0 : R * dEAdq * (REAL)2.0 * c;
+            for(k=0; k<3; k++)
+            {
+               REAL dcda = vb[k] / Lab - c * va[k] / LaSq,
+                    dcdb = va[k] / Lab - c * vb[k] / LbSq;
+
+               gD[k] =  EA * dRdu * (REAL)2.0 * DA[k] + K * dcda;
+               gA[k] = -EA * dRdu * (REAL)2.0 * DA[k] + K * dcdb;
+               gH[k] = -K * (dcda + dcdb);
+            }
+         }
+
+         if(best >= 0)
+         {
+            REAL *GD = g + 3*don->Donor[d],
+                 *GA = g + 3*acc->Acceptor[a],
+                 *GH = g + 3*don->DonorH[d][best];
+            
+            for(k=0; k<3; k++)
+            {
+               GD[k] += gD[k];
+               GA[k] += gA[k];
+               GH[k] += gH[k];
+            }
+            ETot += EBest;
+         }
+      }
+   }
+
+   return(ETot);
+}
+
+
+/************************************************************************/
+/*>static int LBFGS(RELAXWORK *work, EPARAMS *eparams)
+   ---------------------------------------------------
+   Minimises RelaxEnergy() from work->x by limited memory BFGS with a
+   backtracking line search. Steps are limited so that no coordinate 
+   moves by more than RLX_MAXSTEP. Returns the number of iterations.
+
+   18.10.26 Original   By: agent
+*/
+static int LBFGS(RELAXWORK *work, EPARAMS *eparams)
+{
+   REAL energy, ENew, gd, step, MaxD, *tmp;
+   int  n     = 3 * work->NAtoms,
+        NMem  = 0,
+        head  = 0,
+        iter, i, k, m, try;
+
+   energy = RelaxEnergy(work, work->x, work->g, eparams, NULL);
+
+   for(iter=0; iter<RLX_MAXITER; iter++)
+   {
+      REAL *x = work->x,
+           *g = work->g,
+           *d = work->d;
+
+      /* Converged?                                                     */
+      for(MaxD=(REAL)0.0, k=0; k<n; k++)
+         MaxD = MAX(MaxD, fabs(g[k]));
+      if(MaxD < RLX_GTOL)
+         break;
+
+      /* Two-loop recursion for d = -H g                               */
+      for(k=0; k<n; k++)
+         d[k] = g[k];
+      for(i=0; i<NMem; i++)
+      {
+         m = (head - 1 - i + RLX_MEMORY) % RLX_MEMORY;
+         work->alpha[m] = work->rho[m] * Dot(work->s + m*n, d, n);
+         for(k=0; k<n; k++)
+            d[k] -= work->alpha[m] * work->y[m*n + k];
+      }
+      if(NMem)
+      {
+         REAL gamma;
+         m     = (head - 1 + RLX_MEMORY) % RLX_MEMORY;
+         gamma = Dot(work->s + m*n, work->y + m*n, n) / 
+                 Dot(work->y + m*n, work->y + m*n, n);
+         for(k=0; k<n; k++)
+            d[k] *= gamma;
+      }
+      for(i=NMem-1; i>=0; i--)
+      {
+         REAL beta;
+         m    = (head - 1 - i + RLX_MEMORY) % RLX_MEMORY;
+         beta = work->rho[m] * Dot(work->y + m*n, d, n);
+         for(k=0; k<n; k++)
+            d[k] += (work->alpha[m] - beta) * work->s[m*n + k];
+      }
+      for(k=0; k<n; k++)
+         d[k] = -d[k];
+
+      /* Fall back to steepest descent if this is not downhill          */
+      if((gd = Dot(g, d, n)) >= (REAL)0.0)
+      {
+         NMem = 0;
+         for(k=0; k<n; k++)
+            d[k] = -g[k];
+         gd = Dot(g, d, n);
+      }
+
+      /* Backtracking line search                                       */
+      for(MaxD=(REAL)0.0, k=0; k<n; k++)
+         MaxD = MAX(MaxD, fabs(d[k]));
+      step = MIN((REAL)1.0, RLX_MAXSTEP / MaxD);
+      for(try=0; try<MAXHALVE; try++)
+      {
+         for(k=0; k<n; k++)
+            work->xnew[k] = x[k] + step * d[k];
+         ENew = RelaxEnergy(work, work->xnew, work->gnew, eparams, NULL);
+         if(ENew <= energy + ARMIJO * step * gd)
+            break;
+         step *= (REAL)0.5;
+      }
+      if(try == MAXHALVE)
+         break;
+
+      /* Store the correction pair                                      */
+      for(k=0; k<n; k++)
+      {
+         work->s[head*n + k] = work->xnew[k] - x[k];
+         work->y[head*n + k] = work->gnew[k] - g[k];
+      }
+      gd = Dot(work->s + head*n, work->y + head*n, n);
+      if(gd > (REAL)1.0e-12)
+      {
+         work->rho[head] = (REAL)1.0 / gd;
+         head = (head + 1) % RLX_MEMORY;
+         if(NMem < RLX_MEMORY)
+            NMem++;
+      }
+
+      tmp = work->x;  work->x = work->xnew;  work->xnew = tmp;
+      tmp = work->g;  work->g = work->gnew;  work->gnew = tmp;
+
+      if(energy - ENew < ETOL)
+      {
+         iter++;
+         break;
+      }
+      energy = ENew;
+   }
+
+   return(iter);
+}
+
+
+/************************************************************************/
+/*>static BOOL LoadPair(RELAXWORK *work, PDB *res1, PDB *res2)
+   -----------------------------------------------------------
+   Copies the coordinates of two residues into the work space and 
+   finds their fixed, donor, hydrogen and acceptor atoms
+
+   18.10.26 Original   By: agent
+*/
+static BOOL LoadPair(RELAXWORK *work, PDB *res1, PDB *res2)
+{
+   PDB *p;
+   int NAtoms = 0,
+       NRes2,
+       i, j;
+
+   for(p=res1; p!=NULL && SAMERES(p, res1); NEXT(p))
+      NAtoms++;
+   for(p=res2; p!=NULL && SAMERES(p, res2); NEXT(p))
+      NAtoms++;
+   if((NAtoms > work->MaxAtoms) && !GrowRelaxWork(work, NAtoms))
+      return(FALSE);
+
+   work->NRes1  = LoadResidue(work, res1, 0);
+   work->NAtoms = work->NRes1 + LoadResidue(work, res2, work->NRes1);
+   NRes2        = work->NAtoms - work->NRes1;
+   
+   for(i=0; i<work->NAtoms; i++)
+      work->Polar[i] = FALSE;
+   MapPolar(work, res1, 0, work->NRes1, &(work->polar[0]));
+   MapPolar(work, res2, work->NRes1, NRes2, &(work->polar[1]));
+
+   /* Repulsion distances                                               */
+   for(i=0; i<work->NRes1; i++)
+   {
+      for(j=work->NRes1; j<work->NAtoms; j++)
+      {
+         REAL r0, rSq;
+         
+         r0  = ((AtomElement(work->Atom[i]) == 'H') || 
+                (AtomElement(work->Atom[j]) == 'H')) ? RLX_VDWRH 
+                                                     : RLX_VDWR;
+         rSq = DISTSQ(work->Atom[i], work->Atom[j]);
+         work->RSq0[i*NRes2 + j-work->NRes1] = MIN(r0*r0, rSq);
+      }
+   }
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static int LoadResidue(RELAXWORK *work, PDB *res, int first)
+   ------------------------------------------------------------
+   Copies one residue into the work space from atom first. Returns the
+   number of atoms.
+
+   18.10.26 Original   By: agent
+*/
+static int LoadResidue(RELAXWORK *work, PDB *res, int first)
+{
+   PDB *p;
+   int i = first;
+
+   for(p=res; p!=NULL && SAMERES(p, res); NEXT(p), i++)
+   {
+      work->Atom[i]  = p;
+      work->Fixed[i] = IsBackbone(p);
+      work->x[3*i]   = work->x0[3*i]   = p->x;
+      work->x[3*i+1] = work->x0[3*i+1] = p->y;
+      work->x[3*i+2] = work->x0[3*i+2] = p->z;
+   }
+
+   return(i - first);
+}
+
+
+/************************************************************************/
+/*>static void MapPolar(RELAXWORK *work, PDB *res, int first, 
+                        int NAtoms, RLXPOLAR *polar)
+   ---------------------------------------------------------
+   Finds the polar atoms of a residue with FindPolarAtoms() and 
+   converts them to atom numbers in the work space
+
+   18.10.26 Original   By: agent
+*/
+static void MapPolar(RELAXWORK *work, PDB *res, int first, int NAtoms,
+                     RLXPOLAR *polar)
+{
+   RESPOLAR rp;
+   int      i, h;
+
+#define ATOMNUM(pdbptr, num)                                          \
+   for(num=first; num<first+NAtoms && work->Atom[num]!=(pdbptr); num++)
+
+   FindPolarAtoms(res, &rp);
+
+   polar->NDonors = rp.NDonors;
+   for(i=0; i<rp.NDonors; i++)
+   {
+      ATOMNUM(rp.Donor[i], polar->Donor[i]);
+      polar->DonorEl[i] = rp.DonorEl[i];
+      polar->NH[i]      = rp.NH[i];
+      work->Polar[polar->Donor[i]] = TRUE;
+      for(h=0; h<rp.NH[i]; h++)
+      {
+         ATOMNUM(rp.DonorH[i][h], polar->DonorH[i][h]);
+         work->Polar[polar->DonorH[i][h]] = TRUE;
+      }
+   }
+
+   polar->NAcceptors = rp.NAcceptors;
+   for(i=0; i<rp.NAcceptors; i++)
+   {
+      ATOMNUM(rp.Acceptor[i], polar->Acceptor[i]);
+      polar->AcceptorEl[i] = rp.AcceptorEl[i];
+      work->Polar[polar->Acceptor[i]] = TRUE;
+   }
+#undef ATOMNUM
+}
+
+
+/************************************************************************/
+/*>static BOOL IsBackbone(PDB *p)
+   ------------------------------
+   Is this a backbone atom (which is held fixed)?
+
+   18.10.26 Original   By: agent
+*/
+static BOOL IsBackbone(PDB *p)
+{
+   int i;
+
+   for(i=0; sBackbone[i]!=NULL; i++)
+   {
+      if(!strncmp(p->atnam, sBackbone[i], 4))
+         return(TRUE);
+   }
+   return(FALSE);
+}
+
+
+/************************************************************************/
+/*>static BOOL GrowRelaxWork(RELAXWORK *work, int NAtoms)
+   ------------------------------------------------------
+   Makes the work space big enough for NAtoms atoms
+
+   18.10.26 Original   By: agent
+*/
+static BOOL GrowRelaxWork(RELAXWORK *work, int NAtoms)
+{
+   void *p;
+   int  max = MAX(NAtoms, 2 * work->MaxAtoms);
+
+#define GROW(field, type, count)                                      \
+   if((p = realloc(work->field, (count) * sizeof(type)))==NULL)        \
+      return(FALSE);                                                   \
+   work->field = (type *)p
+
+   GROW(x,     REAL, 3*max);
+   GROW(x0,    REAL, 3*max);
+   GROW(g,     REAL, 3*max);
+   GROW(xnew,  REAL, 3*max);
+   GROW(gnew,  REAL, 3*max);
+   GROW(d,     REAL, 3*max);
+   GROW(s,     REAL, RLX_MEMORY*3*max);
+   GROW(y,     REAL, RLX_MEMORY*3*max);
+   GROW(RSq0,  REAL, max*max);
+   GROW(Fixed, BOOL, max);
+   GROW(Polar, BOOL, max);
+   GROW(Atom,  PDB *, max);
+#undef GROW
+
+   work->MaxAtoms = max;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static REAL Dot(REAL *a, REAL *b, int n)
+   ----------------------------------------
+   Dot product of two vectors
+
+   18.10.26 Original   By: agent
+*/
+static REAL Dot(REAL *a, REAL *b, int n)
+{
+   REAL sum = (REAL)0.0;
+   int  i;
+
+   for(i=0; i<n; i++)
+      sum += a[i] * b[i];
+   return(sum);
+}
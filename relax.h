@@ -0,0 +1,130 @@
+/*************************************************************************
+
+   Program:    ehb2 / ehb3
+   File:       relax.h
+
+   Version:    V1.1
+   Date:       18.10.26
+   Function:   In-process relaxation of a residue pair
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Relaxes the sidechains of a pair of residues to optimise the 
+   hydrogen bonding between them. The energy is the CHARMM 10-12 
+   hydrogen bond term (hbenergy.c) between the residues, a soft 
+   repulsion between the non-hydrogen-bonding atoms of the two residues
+   and a harmonic restraint holding each sidechain atom near its start 
+   position (which stands in for the covalent terms). Backbone atoms
+   are fixed. Minimisation is by L-BFGS with analytic gradients. The
+   coordinates are copied into a RELAXWORK so the PDB linked list is
+   never changed, and the work space is reused from one pair to the 
+   next.
+
+**************************************************************************
+
+   Usage:
+   ======
+   work = CreateRelaxWork();
+   if((energy = RelaxResPair(work, res1, res2, &eparams, &NIter)) 
+      == RLX_FAILED)
+      ...out of memory...
+   ...
+   FreeRelaxWork(work);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+   V1.1  18.10.26   Added RLX_FAILED   By: agent
+
+*************************************************************************/
+#ifndef _RELAX_H
+#define _RELAX_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "bioplib/pdb.h"
+#include "hbenergy.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define RLX_MEMORY    6     /* L-BFGS correction pairs                  */
+#define RLX_MAXITER   500   /* Max L-BFGS iterations                    */
+#define RLX_GTOL      1e-3  /* Stop when max gradient component < this  */
+#define RLX_RESTRAINT 10.0  /* Positional restraint kcal/mol/A^2        */
+#define RLX_REPULSE   10.0  /* Repulsion force constant                 */
+#define RLX_VDWR      3.0   /* Repulsion distance for heavy atoms       */
+#define RLX_VDWRH     2.2   /* ...and where either atom is a hydrogen   */
+#define RLX_MAXSTEP   0.2   /* Max move of one coordinate in one step   */
+#define RLX_FAILED    (REAL)-99999.999 /* RelaxResPair() failed         */
+
+typedef struct
+{
+   int  Donor[MAXRESATM],
+        DonorH[MAXRESATM][MAXHPERD],
+        Acceptor[MAXRESATM],
+        NH[MAXRESATM],
+        NDonors,
+        NAcceptors;
+   char DonorEl[MAXRESATM],
+        AcceptorEl[MAXRESATM];
+}  RLXPOLAR;
+
+typedef struct
+{
+   REAL     *x,               /* Coordinates (3 per atom)               */
+            *x0,              /* Start coordinates                      */
+            *g,               /* Gradient                               */
+            *xnew,
+            *gnew,
+            *d,               /* Search direction                       */
+            *s,               /* L-BFGS steps   [RLX_MEMORY][3*NAtoms]  */
+            *y,               /* ...and gradient changes                */
+            *RSq0,            /* Start distance squared of atom pairs   */
+            rho[RLX_MEMORY],
+            alpha[RLX_MEMORY];
+   BOOL     *Fixed,
+            *Polar;           /* Donor, polar H or acceptor             */
+   PDB      **Atom;
+   RLXPOLAR polar[2];
+   int      NAtoms,
+            NRes1,            /* Atoms 0..NRes1-1 are the first residue */
+            MaxAtoms;
+}  RELAXWORK;
+
+/************************************************************************/
+/* Prototypes
+*/
+RELAXWORK *CreateRelaxWork(void);
+void FreeRelaxWork(RELAXWORK *work);
+REAL RelaxResPair(RELAXWORK *work, PDB *res1, PDB *res2, 
+                  EPARAMS *eparams, int *NIter);
+REAL RelaxEnergy(RELAXWORK *work, REAL *x, REAL *g, EPARAMS *eparams,
+                 REAL *EHBond);
+
+#endif
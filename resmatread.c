@@ -0,0 +1,252 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       resmatread.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Format of, and reader for, residue HBond energy matrices
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See resmatread.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "resmatread.h"
+
+/************************************************************************/
+/* Prototypes
+*/
+static int SectionOK(uint64_t offset, uint64_t n, size_t size, 
+                     size_t FileSize);
+
+
+/************************************************************************/
+/*>RESMATMAP *MapResMatrix(char *filename)
+   ---------------------------------------
+   Maps a residue energy matrix file. Returns NULL if it cannot be 
+   mapped or is not a valid matrix file for this machine.
+
+   18.10.26 Original   By: agent
+*/
+RESMATMAP *MapResMatrix(char *filename)
+{
+   RESMATMAP   *mat;
+   RESMATHDR   *hdr;
+   struct stat st;
+   size_t      size;
+   long        i;
+   int         fd;
+   void        *map;
+
+   if((fd = open(filename, O_RDONLY)) < 0)
+      return(NULL);
+   if((fstat(fd, &st) < 0) || (st.st_size < (off_t)sizeof(RESMATHDR)))
+   {
+      close(fd);
+      return(NULL);
+   }
+   size = (size_t)st.st_size;
+
+   map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if(map == MAP_FAILED)
+      return(NULL);
+   hdr = (RESMATHDR *)map;
+
+   /* Check the header and that every section lies inside the file    */
+   if(strncmp(hdr->Magic, RESMAT_MAGIC, 8)         ||
+      (hdr->ByteOrder != RESMAT_BYTEORDER)         ||
+      (hdr->Version   != RESMAT_VERSION)           ||
+      !SectionOK(hdr->OffRes,    hdr->NRes,   sizeof(RESMATRES), size) ||
+      !SectionOK(hdr->OffRowPtr, (uint64_t)hdr->NRes+1, sizeof(uint64_t),
+                 size)                                                ||
+      !SectionOK(hdr->OffCol,    hdr->NNZ,    sizeof(uint32_t),  size) ||
+      !SectionOK(hdr->OffEnergy, hdr->NNZ,    sizeof(double),    size) ||
+      !SectionOK(hdr->OffCount,  hdr->NNZ,    sizeof(uint32_t),  size))
+   {
+      munmap(map, size);
+      return(NULL);
+   }
+
+   if((mat = (RESMATMAP *)malloc(sizeof(RESMATMAP)))==NULL)
+   {
+      munmap(map, size);
+      return(NULL);
+   }
+   
+   mat->map    = (char *)map;
+   mat->size   = size;
+   mat->hdr    = hdr;
+   mat->Res    = (RESMATRES *)(mat->map + hdr->OffRes);
+   mat->RowPtr = (uint64_t  *)(mat->map + hdr->OffRowPtr);
+   mat->Col    = (uint32_t  *)(mat->map + hdr->OffCol);
+   mat->Energy = (double    *)(mat->map + hdr->OffEnergy);
+   mat->Count  = (uint32_t  *)(mat->map + hdr->OffCount);
+   mat->NRes   = (long)hdr->NRes;
+   mat->NNZ    = (long)hdr->NNZ;
+
+   /* The rows must run in order through the entries                  */
+   if((mat->RowPtr[0] != 0) || (mat->RowPtr[mat->NRes] != hdr->NNZ))
+   {
+      UnmapResMatrix(mat);
+      return(NULL);
+   }
+   for(i=0; i<mat->NRes; i++)
+   {
+      if(mat->RowPtr[i+1] < mat->RowPtr[i])
+      {
+         UnmapResMatrix(mat);
+         return(NULL);
+      }
+   }
+
+   return(mat);
+}
+
+
+/************************************************************************/
+/*>void UnmapResMatrix(RESMATMAP *mat)
+   -----------------------------------
+   Unmaps a residue energy matrix
+
+   18.10.26 Original   By: agent
+*/
+void UnmapResMatrix(RESMATMAP *mat)
+{
+   if(mat == NULL)
+      return;
+   
+   munmap(mat->map, mat->size);
+   free(mat);
+}
+
+
+/************************************************************************/
+/*>long FindMatrixRes(RESMATMAP *mat, char *ResID)
+   -----------------------------------------------
+   Returns the row (and column) of a residue given its HBPlus residue
+   ID or -1 if it is not in the matrix. The residue table is sorted so
+   this is a binary search.
+
+   18.10.26 Original   By: agent
+*/
+long FindMatrixRes(RESMATMAP *mat, char *ResID)
+{
+   long lo = 0,
+        hi = mat->NRes - 1,
+        mid;
+   int  cmp;
+
+   while(lo <= hi)
+   {
+      mid = (lo + hi) / 2;
+      if((cmp = strncmp(mat->Res[mid].ResID, ResID, RESMAT_IDLEN)) == 0)
+         return(mid);
+      if(cmp < 0)
+         lo = mid + 1;
+      else
+         hi = mid - 1;
+   }
+   return(-1);
+}
+
+
+/************************************************************************/
+/*>double MatrixEnergy(RESMATMAP *mat, long row, long col, 
+                       unsigned int *NHBonds)
+   -------------------------------------------------------
+   Returns the summed energy of the HBonds from donor residue row to
+   acceptor residue col, and the number of them in NHBonds (if not 
+   NULL). Both are 0 if there are none.
+
+   18.10.26 Original   By: agent
+*/
+double MatrixEnergy(RESMATMAP *mat, long row, long col, 
+                    unsigned int *NHBonds)
+{
+   uint64_t lo, hi, mid;
+
+   if(NHBonds != NULL)
+      *NHBonds = 0;
+   if((row < 0) || (row >= mat->NRes) || (col < 0))
+      return(0.0);
+
+   lo = mat->RowPtr[row];
+   hi = mat->RowPtr[row+1];
+   while(lo < hi)
+   {
+      mid = lo + (hi - lo) / 2;
+      if(mat->Col[mid] == (uint32_t)col)
+      {
+         if(NHBonds != NULL)
+            *NHBonds = mat->Count[mid];
+         return(mat->Energy[mid]);
+      }
+      if(mat->Col[mid] < (uint32_t)col)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return(0.0);
+}
+
+
+/************************************************************************/
+/*>static int SectionOK(uint64_t offset, uint64_t n, size_t size, 
+                        size_t FileSize)
+   ------------------------------------------------------------
+   Does a section of n items of size bytes at offset lie inside the
+   file (and is it aligned)?
+
+   18.10.26 Original   By: agent
+*/
+static int SectionOK(uint64_t offset, uint64_t n, size_t size, 
+                     size_t FileSize)
+{
+   if((offset < sizeof(RESMATHDR)) || (offset % 8) || 
+      (offset > FileSize))
+      return(0);
+   if(n > (FileSize - offset) / size)
+      return(0);
+   return(1);
+}
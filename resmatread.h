@@ -0,0 +1,139 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       resmatread.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Format of, and reader for, residue HBond energy matrices
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   A residue x residue HBond energy matrix, as written by ehb and ehb2
+   with --matrix, is held in compressed sparse row (CSR) form. Rows 
+   are donor residues and columns are acceptor residues. Each entry
+   is the sum of the energies of the HBonds from the donor residue to
+   the acceptor residue, with the number of HBonds summed.
+
+   The residues are those which take part in any HBond, sorted by 
+   their HBPlus residue ID (chain, zero-padded residue number and 
+   insert code, e.g. A0030-). Row r (and column r) is residue r. The 
+   entries of row r are RowPtr[r] to RowPtr[r+1]-1, sorted by column.
+
+   This reader only needs the C library so resmatread.[ch] may be 
+   copied into other programs. The file is mapped read-only and the
+   arrays are used in place.
+
+   File layout (native-endian; all offsets are from the start of the 
+   file and are multiples of 8):
+      RESMATHDR
+      RESMATRES[NRes]         Residue table
+      uint64_t[NRes+1]        RowPtr
+      uint32_t[NNZ]           Column of each entry
+      double[NNZ]             Energy of each entry
+      uint32_t[NNZ]           HBonds summed in each entry
+
+   ByteOrder is RESMAT_BYTEORDER as written by the machine that made 
+   the file; a file from a machine of the other byte order is refused.
+
+**************************************************************************
+
+   Usage:
+   ======
+   mat = MapResMatrix("complex.csr");
+   d = FindMatrixRes(mat, "A0030-");
+   a = FindMatrixRes(mat, "B0112-");
+   energy = MatrixEnergy(mat, d, a, &NHBonds);
+   for(k=mat->RowPtr[d]; k<mat->RowPtr[d+1]; k++)
+      ... mat->Col[k], mat->Energy[k], mat->Count[k] ...
+   UnmapResMatrix(mat);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _RESMATREAD_H
+#define _RESMATREAD_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stddef.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define RESMAT_MAGIC     "EHBCSR01"
+#define RESMAT_VERSION   1
+#define RESMAT_BYTEORDER 0x01020304
+#define RESMAT_IDLEN     8    /* Residue ID and name with NUL padding   */
+
+typedef struct
+{
+   char     Magic[8];
+   uint32_t ByteOrder,
+            Version,
+            NRes,
+            Pad;
+   uint64_t NNZ,
+            OffRes,
+            OffRowPtr,
+            OffCol,
+            OffEnergy,
+            OffCount;
+}  RESMATHDR;
+
+typedef struct
+{
+   char ResID[RESMAT_IDLEN],
+        ResNam[RESMAT_IDLEN];
+}  RESMATRES;
+
+typedef struct
+{
+   char      *map;
+   size_t    size;
+   RESMATHDR *hdr;
+   RESMATRES *Res;
+   uint64_t  *RowPtr;
+   uint32_t  *Col;
+   double    *Energy;
+   uint32_t  *Count;
+   long      NRes,
+             NNZ;
+}  RESMATMAP;
+
+/************************************************************************/
+/* Prototypes
+*/
+RESMATMAP *MapResMatrix(char *filename);
+void UnmapResMatrix(RESMATMAP *mat);
+long FindMatrixRes(RESMATMAP *mat, char *ResID);
+double MatrixEnergy(RESMATMAP *mat, long row, long col, 
+                    unsigned int *NHBonds);
+
+#endif
@@ -0,0 +1,436 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       resmatrix.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Build and write residue HBond energy matrices
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See resmatrix.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bioplib/macros.h"
+#include "resmatrix.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define MAXPATH     512
+#define INITENTRIES 1024
+
+/************************************************************************/
+/* Prototypes
+*/
+static BOOL GrowEntries(RESMATRIX *rm);
+static BOOL BuildCSR(RESMATRIX *rm, int *rank, int NRes, uint64_t *RowPtr,
+                     uint32_t *Col, double *Energy, uint32_t *Count,
+                     uint64_t *NNZ);
+static int  CompareResIDs(const void *a, const void *b);
+static BOOL WriteBlock(FILE *fp, void *data, size_t size, 
+                       uint64_t *offset);
+
+
+/************************************************************************/
+/*>RESMATRIX *CreateResMatrix(void)
+   --------------------------------
+   Creates an empty residue energy matrix. Returns NULL if out of 
+   memory.
+
+   18.10.26 Original   By: agent
+*/
+RESMATRIX *CreateResMatrix(void)
+{
+   RESMATRIX *rm;
+
+   if((rm = (RESMATRIX *)calloc(1, sizeof(RESMATRIX)))==NULL)
+      return(NULL);
+
+   if(((rm->Pools = CreateHBTable())==NULL) || !GrowEntries(rm))
+   {
+      FreeResMatrix(rm);
+      return(NULL);
+   }
+   
+   return(rm);
+}
+
+
+/************************************************************************/
+/*>void FreeResMatrix(RESMATRIX *rm)
+   ---------------------------------
+   Frees a residue energy matrix
+
+   18.10.26 Original   By: agent
+*/
+void FreeResMatrix(RESMATRIX *rm)
+{
+   if(rm == NULL)
+      return;
+
+   FreeHBTable(rm->Pools);
+   free(rm->Row);
+   free(rm->Col);
+   free(rm->Energy);
+   free(rm);
+}
+
+
+/************************************************************************/
+/*>BOOL AddResMatrixBond(RESMATRIX *rm, char *ResID_D, char *ResNam_D,
+                         char *ResID_A, char *ResNam_A, REAL energy)
+   -------------------------------------------------------------------
+   Adds the energy of an HBond from the donor to the acceptor residue.
+   Residues are identified by their HBPlus residue IDs. Returns FALSE
+   if out of memory.
+
+   18.10.26 Original   By: agent
+*/
+BOOL AddResMatrixBond(RESMATRIX *rm, char *ResID_D, char *ResNam_D,
+                      char *ResID_A, char *ResNam_A, REAL energy)
+{
+   STRPOOL *res    = &(rm->Pools->Residues),
+           *resnam = &(rm->Pools->ResNames);
+   int     resD,  resA,
+           namD,  namA;
+
+   if((rm->NEntries == rm->MaxEntries) && !GrowEntries(rm))
+      return(FALSE);
+   
+   if(((resD = InternString(res,    ResID_D))  < 0) ||
+      ((resA = InternString(res,    ResID_A))  < 0) ||
+      ((namD = InternString(resnam, ResNam_D)) < 0) ||
+      ((namA = InternString(resnam, ResNam_A)) < 0))
+      return(FALSE);
+
+   res->Aux[resD] = namD;
+   res->Aux[resA] = namA;
+
+   rm->Row[rm->NEntries]    = resD;
+   rm->Col[rm->NEntries]    = resA;
+   rm->Energy[rm->NEntries] = energy;
+   rm->NEntries++;
+
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>BOOL WriteResMatrix(RESMATRIX *rm, char *filename)
+   --------------------------------------------------
+   Writes the matrix in CSR form (see resmatread.h). As with the PDB
+   cache, it is written to a temporary file which is then renamed.
+   Returns FALSE (with a message) on failure.
+
+   18.10.26 Original   By: agent
+*/
+BOOL WriteResMatrix(RESMATRIX *rm, char *filename)
+{
+   STRPOOL   *res     = &(rm->Pools->Residues);
+   RESMATHDR hdr;
+   RESMATRES *table   = NULL;
+   char      **sorted = NULL,
+             TmpFile[MAXPATH+32];
+   int       *rank    = NULL,
+             NRes     = res->NStr,
+             i, idx;
+   uint64_t  *RowPtr  = NULL,
+             offset   = 0;
+   uint32_t  *Col     = NULL,
+             *Count   = NULL;
+   double    *Energy  = NULL;
+   FILE      *fp;
+   BOOL      ok       = FALSE;
+
+   memset(&hdr, 0, sizeof(RESMATHDR));
+   memcpy(hdr.Magic, RESMAT_MAGIC, 8);
+   hdr.ByteOrder = RESMAT_BYTEORDER;
+   hdr.Version   = RESMAT_VERSION;
+   hdr.NRes      = (uint32_t)NRes;
+
+   /* The residues are numbered in order of their IDs                  */
+   if(((sorted = (char **)malloc((NRes+1) * sizeof(char *)))!=NULL)     &&
+      ((rank   = (int *)malloc((NRes+1) * sizeof(int)))!=NULL)          &&
+      ((table  = (RESMATRES *)calloc(NRes+1, sizeof(RESMATRES)))!=NULL) &&
+      ((RowPtr = (uint64_t *)calloc(NRes+1, sizeof(uint64_t)))!=NULL)   &&
+      ((Col    = (uint32_t *)malloc((rm->NEntries+1) * 
+                                    sizeof(uint32_t)))!=NULL)           &&
+      ((Energy = (double *)malloc((rm->NEntries+1) * 
+                                  sizeof(double)))!=NULL)               &&
+      ((Count  = (uint32_t *)malloc((rm->NEntries+1) * 
+                                    sizeof(uint32_t)))!=NULL))
+   {
+      for(i=0; i<NRes; i++)
+         sorted[i] = res->Str[i];
+      qsort(sorted, NRes, sizeof(char *), CompareResIDs);
+      for(i=0; i<NRes; i++)
+      {
+         idx       = (int)((sorted[i] - res->Str[0]) / HBT_MAXSTR);
+         rank[idx] = i;
+         strncpy(table[i].ResID, res->Str[idx], RESMAT_IDLEN-1);
+         strncpy(table[i].ResNam, 
+                 rm->Pools->ResNames.Str[res->Aux[idx]], RESMAT_IDLEN-1);
+      }
+      
+      ok = BuildCSR(rm, rank, NRes, RowPtr, Col, Energy, Count, 
+                    &(hdr.NNZ));
+   }
+   if(!ok)
+      fprintf(stderr,"No memory for residue energy matrix\n");
+
+   /* Write a placeholder header, the sections and then the real header
+      with the offsets filled in
+   */
+   if(ok)
+   {
+      ok = FALSE;
+      sprintf(TmpFile, "%.*s.%d", MAXPATH, filename, (int)getpid());
+      if((fp = fopen(TmpFile, "wb"))!=NULL)
+      {
+         if(WriteBlock(fp, &hdr, sizeof(RESMATHDR), &offset)) 
+         {
+            hdr.OffRes = offset;
+            if(WriteBlock(fp, table, NRes * sizeof(RESMATRES), &offset))
+            {
+               hdr.OffRowPtr = offset;
+               if(WriteBlock(fp, RowPtr, (NRes+1) * sizeof(uint64_t), 
+                             &offset))
+               {
+                  hdr.OffCol = offset;
+                  if(WriteBlock(fp, Col, hdr.NNZ * sizeof(uint32_t), 
+                                &offset))
+                  {
+                     hdr.OffEnergy = offset;
+                     if(WriteBlock(fp, Energy, hdr.NNZ * sizeof(double),
+                                   &offset))
+                     {
+                        hdr.OffCount = offset;
+                        if(WriteBlock(fp, Count, 
+                                      hdr.NNZ * sizeof(uint32_t), 
+                                      &offset))
+                        {
+                           rewind(fp);
+                           ok = (fwrite(&hdr, sizeof(RESMATHDR), 1, fp)
+                                 == 1);
+                        }
+                     }
+                  }
+               }
+            }
+         }
+         
+         if(fclose(fp) || !ok || rename(TmpFile, filename))
+         {
+            unlink(TmpFile);
+            ok = FALSE;
+         }
+      }
+      if(!ok)
+         fprintf(stderr,"Unable to write residue energy matrix: %s\n",
+                 filename);
+   }
+
+   free(sorted);
+   free(rank);
+   free(table);
+   free(RowPtr);
+   free(Col);
+   free(Energy);
+   free(Count);
+   
+   return(ok);
+}
+
+
+/************************************************************************/
+/*>static BOOL BuildCSR(RESMATRIX *rm, int *rank, int NRes, 
+                        uint64_t *RowPtr, uint32_t *Col, double *Energy,
+                        uint32_t *Count, uint64_t *NNZ)
+   ----------------------------------------------------------------------
+   Builds the CSR arrays from the list of entries. rank gives the row
+   of each residue. The entries are bucketed by row (keeping their
+   order), each row is insertion sorted by column (rows are short)
+   and entries for the same column are summed. RowPtr must be zeroed
+   and the other arrays must have space for every entry.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL BuildCSR(RESMATRIX *rm, int *rank, int NRes, uint64_t *RowPtr,
+                     uint32_t *Col, double *Energy, uint32_t *Count,
+                     uint64_t *NNZ)
+{
+   uint64_t *next;
+   uint64_t first, last, i, j, n;
+   int      r, e;
+
+   if((next = (uint64_t *)malloc((NRes+1) * sizeof(uint64_t)))==NULL)
+      return(FALSE);
+
+   /* Bucket the entries by row                                        */
+   for(e=0; e<rm->NEntries; e++)
+      RowPtr[rank[rm->Row[e]] + 1]++;
+   for(r=0; r<NRes; r++)
+   {
+      RowPtr[r+1] += RowPtr[r];
+      next[r]      = RowPtr[r];
+   }
+   for(e=0; e<rm->NEntries; e++)
+   {
+      i         = next[rank[rm->Row[e]]]++;
+      Col[i]    = (uint32_t)rank[rm->Col[e]];
+      Energy[i] = (double)rm->Energy[e];
+      Count[i]  = 1;
+   }
+
+   /* Sort each row by column and sum the duplicates, packing the 
+      entries down as we go
+   */
+   n = 0;
+   for(r=0; r<NRes; r++)
+   {
+      first = RowPtr[r];
+      last  = RowPtr[r+1];
+      
+      for(i=first+1; i<last; i++)
+      {
+         uint32_t c  = Col[i];
+         double   en = Energy[i];
+
+         for(j=i; (j>first) && (Col[j-1] > c); j--)
+         {
+            Col[j]    = Col[j-1];
+            Energy[j] = Energy[j-1];
+         }
+         Col[j]    = c;
+         Energy[j] = en;
+      }
+
+      RowPtr[r] = n;
+      for(i=first; i<last; i++)
+      {
+         if((n > RowPtr[r]) && (Col[n-1] == Col[i]))
+         {
+            Energy[n-1] += Energy[i];
+            Count[n-1]++;
+         }
+         else
+         {
+            Col[n]    = Col[i];
+            Energy[n] = Energy[i];
+            Count[n]  = 1;
+            n++;
+         }
+      }
+   }
+   RowPtr[NRes] = n;
+   *NNZ         = n;
+
+   free(next);
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static BOOL GrowEntries(RESMATRIX *rm)
+   --------------------------------------
+   Doubles the space for entries
+
+   18.10.26 Original   By: agent
+*/
+static BOOL GrowEntries(RESMATRIX *rm)
+{
+   int  max;
+   void *p;
+
+   max = rm->MaxEntries ? 2 * rm->MaxEntries : INITENTRIES;
+
+   if((p = realloc(rm->Row, max * sizeof(int)))==NULL)
+      return(FALSE);
+   rm->Row = (int *)p;
+   if((p = realloc(rm->Col, max * sizeof(int)))==NULL)
+      return(FALSE);
+   rm->Col = (int *)p;
+   if((p = realloc(rm->Energy, max * sizeof(REAL)))==NULL)
+      return(FALSE);
+   rm->Energy = (REAL *)p;
+
+   rm->MaxEntries = max;
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static int CompareResIDs(const void *a, const void *b)
+   ------------------------------------------------------
+   qsort() comparison of pointers to residue IDs
+
+   18.10.26 Original   By: agent
+*/
+static int CompareResIDs(const void *a, const void *b)
+{
+   return(strcmp(*(char **)a, *(char **)b));
+}
+
+
+/************************************************************************/
+/*>static BOOL WriteBlock(FILE *fp, void *data, size_t size, 
+                          uint64_t *offset)
+   -------------------------------------------------------------
+   Writes a block of data padded to a multiple of 8 bytes and updates
+   the offset
+
+   18.10.26 Original   By: agent
+*/
+static BOOL WriteBlock(FILE *fp, void *data, size_t size, 
+                       uint64_t *offset)
+{
+   static char zero[8] = {0,0,0,0,0,0,0,0};
+   size_t      pad     = (8 - (size % 8)) % 8;
+
+   if(size && (fwrite(data, 1, size, fp) != size))
+      return(FALSE);
+   if(pad && (fwrite(zero, 1, pad, fp) != pad))
+      return(FALSE);
+
+   *offset += (uint64_t)(size + pad);
+   return(TRUE);
+}
@@ -0,0 +1,89 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2
+   File:       resmatrix.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Build and write residue HBond energy matrices
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Collects the energy of each HBond against its donor and acceptor 
+   residues and writes the residue x residue energy matrix in the CSR
+   format described in resmatread.h. Residue IDs and names are 
+   interned with the string pools from hbtable.c. Entries are kept as
+   a list until the matrix is written; they are then bucketed by row,
+   sorted by column within each row and the HBonds between the same
+   pair of residues summed (in the order they were added).
+
+**************************************************************************
+
+   Usage:
+   ======
+   rm = CreateResMatrix();
+   AddResMatrixBond(rm, ResID_D, ResNam_D, ResID_A, ResNam_A, energy);
+   WriteResMatrix(rm, filename);
+   FreeResMatrix(rm);
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _RESMATRIX_H
+#define _RESMATRIX_H
+
+/************************************************************************/
+/* Includes
+*/
+#include "bioplib/SysDefs.h"
+#include "bioplib/MathType.h"
+#include "hbtable.h"
+#include "resmatread.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+typedef struct
+{
+   HBTABLE *Pools;            /* Used for its Residues and ResNames     */
+   int     *Row,              /* Donor residue (index into Residues)    */
+           *Col,              /* Acceptor residue                       */
+           NEntries,
+           MaxEntries;
+   REAL    *Energy;
+}  RESMATRIX;
+
+/************************************************************************/
+/* Prototypes
+*/
+RESMATRIX *CreateResMatrix(void);
+void FreeResMatrix(RESMATRIX *rm);
+BOOL AddResMatrixBond(RESMATRIX *rm, char *ResID_D, char *ResNam_D,
+                      char *ResID_A, char *ResNam_A, REAL energy);
+BOOL WriteResMatrix(RESMATRIX *rm, char *filename);
+
+#endif
@@ -0,0 +1,113 @@
+/*************************************************************************
+
+   Program:    failuring
+   File:       failuring.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Makes io_uring_enter() fail, for testing
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Used by t_uring.sh. A shared library which is preloaded into ehb
+   and replaces syscall(). io_uring_enter fails with EIO after the
+   number of calls given in $FAILURING_AFTER (default 0); every other
+   system call is passed on to the C library. This is the hard error
+   which makes BulkReadNext() (bulkread.c) give up with files still in
+   flight.
+
+**************************************************************************
+
+   Usage:
+   ======
+   LD_PRELOAD=./failuring.so FAILURING_AFTER=n ehb -b -p 2 ...
+
+   Build with:
+   cc -shared -fPIC -o failuring.so failuring.c -ldl
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/************************************************************************/
+/* Globals
+*/
+static int sNCalls = 0;
+
+/************************************************************************/
+/* Prototypes
+*/
+long syscall(long number, ...);
+
+
+/************************************************************************/
+/*>long syscall(long number, ...)
+   ------------------------------
+   Replacement for the C library syscall(). Fails io_uring_enter once
+   it has been called $FAILURING_AFTER times.
+
+   18.10.26 Original   By: agent
+*/
+long syscall(long number, ...)
+{
+   static long (*RealSyscall)(long, ...) = NULL;
+   va_list     ap;
+   long        a[6];
+   char        *env;
+   int         i;
+
+   va_start(ap, number);
+   for(i=0; i<6; i++)
+      a[i] = va_arg(ap, long);
+   va_end(ap);
+
+#ifdef SYS_io_uring_enter
+   if(number == SYS_io_uring_enter)
+   {
+      env = getenv("FAILURING_AFTER");
+      if(__atomic_fetch_add(&sNCalls, 1, __ATOMIC_RELAXED) >=
+         ((env == NULL) ? 0 : atoi(env)))
+      {
+         errno = EIO;
+         return(-1);
+      }
+   }
+#endif
+
+   if(RealSyscall == NULL)
+      RealSyscall = (long (*)(long, ...))dlsym(RTLD_NEXT, "syscall");
+   return(RealSyscall(number, a[0], a[1], a[2], a[3], a[4], a[5]));
+}
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Stand-in for HBPlus used by t_run.sh
+# Usage: fakehbplus.sh -o file.pdb
+# The 'PDB file' is really a .hb2 file, which is copied to file.hb2
+# along with an empty file.h as hbplus -o would write. A file which
+# contains a line saying FAIL makes it fail.
+# 18.10.26 Original   By: agent
+
+[ "$1" = "-o" ] && [ -f "$2" ] || exit 2
+grep -q "^FAIL$" "$2" && exit 1
+cp "$2" "${2%.pdb}.hb2" && : > "${2%.pdb}.h"
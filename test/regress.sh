@@ -0,0 +1,50 @@
+#!/bin/sh
+#*************************************************************************
+#
+#   Program:    regress.sh
+#   File:       regress.sh
+#
+#   Version:    V1.1
+#   Date:       18.10.26
+#   Function:   Runs the ehb regression tests
+#
+#   Copyright:  (c) agent 2026
+#   Author:     agent
+#   EMail:      agent@local
+#
+#*************************************************************************
+#
+#   Description:
+#   ============
+#   Runs each t_*.sh test script in this directory with the given ehb.
+#   Each script tests one feature and prints PASS or FAIL for each of
+#   its checks; see testlib.sh for what they share.
+#
+#*************************************************************************
+#
+#   Usage:
+#   ======
+#   regress.sh [path/to/ehb]
+#   The exit status is the total number of checks which failed.
+#
+#*************************************************************************
+#
+#   Revision History:
+#   =================
+#   V1.0  18.10.26   Original                        By: agent
+#   V1.1  18.10.26   The tests are in separate t_*.sh scripts
+#                    By: agent
+#
+#*************************************************************************
+
+EHB=${1:-ehb}
+TESTDIR=$(cd "$(dirname "$0")" && pwd)
+NFAIL=0
+
+for t in "$TESTDIR"/t_*.sh; do
+   [ -f "$t" ] || continue
+   sh "$t" "$EHB"
+   NFAIL=$((NFAIL + $?))
+done
+
+exit $NFAIL
@@ -0,0 +1,179 @@
+/*************************************************************************
+
+   Program:    resmatcheck
+   File:       resmatcheck.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Checks and summarises a residue HBond energy matrix
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   Used by t_matrix.sh to test the matrix written by ehb --matrix 
+   through resmatread.c. The file is mapped, the CSR structure is 
+   checked (RowPtr ascending from 0 to NNZ, columns ascending and in 
+   range within each row, residues sorted, no empty entries) and the 
+   sizes and total energy are printed. If two residue IDs are given,
+   the entry from the first (donor) to the second (acceptor) is also
+   printed.
+
+**************************************************************************
+
+   Usage:
+   ======
+   resmatcheck file.csr [donor acceptor]
+
+   Build with:
+   cc -I.. -o resmatcheck resmatcheck.c ../resmatread.c
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include <string.h>
+#include "resmatread.h"
+
+/************************************************************************/
+/* Prototypes
+*/
+int main(int argc, char **argv);
+static int CheckMatrix(RESMATMAP *mat);
+
+
+/************************************************************************/
+/*>int main(int argc, char **argv)
+   -------------------------------
+   Main program
+
+   18.10.26 Original   By: agent
+*/
+int main(int argc, char **argv)
+{
+   RESMATMAP     *mat;
+   double        total = 0.0,
+                 energy;
+   unsigned long NHBonds = 0;
+   unsigned int  count;
+   long          k, d, a;
+
+   if((argc != 2) && (argc != 4))
+   {
+      fprintf(stderr,"Usage: resmatcheck file.csr [donor acceptor]\n");
+      return(1);
+   }
+
+   if((mat = MapResMatrix(argv[1]))==NULL)
+   {
+      fprintf(stderr,"Unable to map matrix: %s\n", argv[1]);
+      return(1);
+   }
+
+   if(!CheckMatrix(mat))
+   {
+      UnmapResMatrix(mat);
+      return(1);
+   }
+
+   for(k=0; k<mat->NNZ; k++)
+   {
+      total   += mat->Energy[k];
+      NHBonds += mat->Count[k];
+   }
+   printf("NRes %ld NNZ %ld HBonds %lu Energy %.6f\n", mat->NRes, 
+          mat->NNZ, NHBonds, total);
+
+   if(argc == 4)
+   {
+      d      = FindMatrixRes(mat, argv[2]);
+      a      = FindMatrixRes(mat, argv[3]);
+      energy = MatrixEnergy(mat, d, a, &count);
+      printf("%s %s %.6f %u\n", argv[2], argv[3], energy, count);
+   }
+
+   UnmapResMatrix(mat);
+   return(0);
+}
+
+
+/************************************************************************/
+/*>static int CheckMatrix(RESMATMAP *mat)
+   --------------------------------------
+   Checks the CSR structure of a mapped matrix. Returns 0 (with a 
+   message) if it is not valid.
+
+   18.10.26 Original   By: agent
+*/
+static int CheckMatrix(RESMATMAP *mat)
+{
+   long     r;
+   uint64_t k;
+
+   if(mat->RowPtr[0] != 0)
+   {
+      fprintf(stderr,"RowPtr[0] is not 0\n");
+      return(0);
+   }
+   if(mat->RowPtr[mat->NRes] != (uint64_t)mat->NNZ)
+   {
+      fprintf(stderr,"RowPtr[NRes] is not NNZ\n");
+      return(0);
+   }
+
+   for(r=0; r<mat->NRes; r++)
+   {
+      if((r > 0) && 
+         (strncmp(mat->Res[r-1].ResID, mat->Res[r].ResID, 
+                  RESMAT_IDLEN) >= 0))
+      {
+         fprintf(stderr,"Residues not sorted at %ld\n", r);
+         return(0);
+      }
+      if(mat->RowPtr[r] > mat->RowPtr[r+1])
+      {
+         fprintf(stderr,"RowPtr decreases at row %ld\n", r);
+         return(0);
+      }
+      for(k=mat->RowPtr[r]; k<mat->RowPtr[r+1]; k++)
+      {
+         if((mat->Col[k] >= (uint32_t)mat->NRes) ||
+            ((k > mat->RowPtr[r]) && (mat->Col[k] <= mat->Col[k-1])))
+         {
+            fprintf(stderr,"Bad column in row %ld\n", r);
+            return(0);
+         }
+         if(mat->Count[k] == 0)
+         {
+            fprintf(stderr,"Empty entry in row %ld\n", r);
+            return(0);
+         }
+      }
+   }
+
+   return(1);
+}
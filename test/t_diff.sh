@@ -0,0 +1,32 @@
+#!/bin/sh
+# Regression test for ehb --diff (user-050)
+# Usage: t_diff.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# v3 has lost the first 3 bonds of v0. The delta must match the single
+# file energies
+"$EHB" -b $FILES > serial.out 2>&1
+E0=$(awk '$1 == "v0.hb2" { print $5 }' serial.out)
+E3=$(awk '$1 == "v3.hb2" { print $5 }' serial.out)
+"$EHB" --diff v0.hb2 v3.hb2 > diff.out 2>&1
+awk -v e0="$E0" -v e3="$E3" '
+   $1 == "Lost"  { lost++ }
+   $1 == "Delta" { delta = $2 + 0; found = 1 }
+   END { d = (e3 - e0) - delta; if(d < 0) d = -d;
+         exit !(found && (lost == 3) && (d < 2.0e-6)) }' diff.out
+result diff $?
+
+# The blank records at the end of pdb1crn.hb2 are not HBonds, so a
+# copy without them has no gained or lost bonds either way round
+sed '/^ *$/d' "$TESTDIR/pdb1crn.hb2" > noblank.hb2
+"$EHB" --diff "$TESTDIR/pdb1crn.hb2" noblank.hb2 > blank1.out 2>&1
+"$EHB" --diff noblank.hb2 "$TESTDIR/pdb1crn.hb2" > blank2.out 2>&1
+cat blank1.out blank2.out | awk '
+   $1 == "Delta" { n++; if($3 != 0 || $6 != 0 || $12 != 38) bad = 1 }
+   $1 == "Gained" || $1 == "Lost" { bad = 1 }
+   END { exit !((n == 2) && !bad) }'
+result diff-blank $?
+
+exit $NFAIL
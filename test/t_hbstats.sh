@@ -0,0 +1,22 @@
+#!/bin/sh
+# Regression test for ehb --hbstats and ehb hbstats (user-048)
+# Usage: t_hbstats.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# The statistics from two shards merged must be those of one run
+"$EHB" -b --hbstats all.stats $FILES > /dev/null 2>&1
+"$EHB" -b --shard 0/2 --hbstats part.0.stats $FILES > /dev/null 2>&1
+"$EHB" -b --shard 1/2 --hbstats part.1.stats $FILES > /dev/null 2>&1
+"$EHB" hbstats -H all.stats > stats.all.out 2>&1
+"$EHB" hbstats -H part.0.stats part.1.stats > stats.merge.out 2>&1
+[ -s stats.all.out ] && cmp -s stats.merge.out stats.all.out
+result hbstats $?
+
+# The blank records at the end of pdb1crn.hb2 are not HBonds
+"$EHB" --hbstats single.stats "$TESTDIR/pdb1crn.hb2" > single.out 2>&1
+awk '$2 == "energy" { n += $3 } END { exit !(n == 38) }' single.out
+result hbstats-blank $?
+
+exit $NFAIL
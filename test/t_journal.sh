@@ -0,0 +1,18 @@
+#!/bin/sh
+# Regression test for ehb --journal (user-042)
+# Usage: t_journal.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# A run restarted with a journal written over some of the files must
+# only do the rest and give the same report as one serial run
+"$EHB" -b $FILES > serial.out 2>&1
+"$EHB" -b --journal run.jnl v0.hb2 v1.hb2 v2.hb2 > /dev/null 2>&1
+"$EHB" -b --journal run.jnl $FILES > resume.out 2> resume.err
+grep -q "^Total HBond energy" serial.out && 
+   cmp -s resume.out serial.out &&
+   grep -q "(3 structures done)" resume.err
+result journal $?
+
+exit $NFAIL
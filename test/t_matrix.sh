@@ -0,0 +1,28 @@
+#!/bin/sh
+# Regression test for ehb --matrix read by resmatread.c (user-049)
+# Usage: t_matrix.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# The matrix of pdb1crn.hb2 must be valid CSR, total the single file 
+# energy and hold the sum of HBonds 4 and 5 from -0010- to -0002-. 
+# resmatcheck.c reads it through resmatread.c
+if "$CC" -I"$TESTDIR/.." -o resmatcheck "$TESTDIR/resmatcheck.c" \
+         "$TESTDIR/../resmatread.c" > cc.out 2>&1; then
+   "$EHB" --matrix matrix.csr "$TESTDIR/pdb1crn.hb2" > single.out 2>&1
+   ./resmatcheck matrix.csr -0010- -0002- > matrix.out 2>&1
+   E=$(awk '/^HBond energy/ { print $4 }' single.out)
+   awk -v e="$E" '
+      $1 == "NRes"   { total = $8; nb = $6; ok = 1 }
+      $1 == "-0010-" { pair = $3; n = $4 }
+      END { d = total - e; if(d < 0) d = -d;
+            exit !(ok && (d < 2.0e-6) && (nb == 38) &&
+                   (pair == "-5.750980") && (n == 2)) }' matrix.out
+   result matrix $?
+else
+   cat cc.out
+   result matrix 1
+fi
+
+exit $NFAIL
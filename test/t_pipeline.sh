@@ -0,0 +1,14 @@
+#!/bin/sh
+# Regression test for the ehb -b -p pipeline (user-043)
+# Usage: t_pipeline.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# The pipeline must give the same report as a serial run
+"$EHB" -b $FILES > serial.out 2>&1
+"$EHB" -b -p 2 --readers 2 $FILES > pipe.out 2>&1
+grep -q "^Total HBond energy" serial.out && cmp -s pipe.out serial.out
+result pipe $?
+
+exit $NFAIL
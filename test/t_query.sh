@@ -0,0 +1,24 @@
+#!/bin/sh
+# Regression test for ehb --top and --below (user-047)
+# Usage: t_query.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# pdb1crn.hb2 has 38 HBonds and two blank records which must not be
+# listed
+"$EHB" --below 0 "$TESTDIR/pdb1crn.hb2" > below.out 2>&1
+[ "$(grep -c '^Bond' below.out)" -eq 38 ] &&
+   grep -q "^38 of 38 HBonds" below.out
+result below $?
+
+# --top K over several files must list the K strongest of all their
+# bonds, strongest first
+"$EHB" -b --top 5 $FILES > top.out 2>&1
+"$EHB" -b --below 0 $FILES 2>&1 | awk '$1 == "Bond" { print $7 }' |
+   sort -g | head -5 > expect.out
+awk '$1 == "Bond" { print $7 }' top.out > got.out
+[ -s got.out ] && cmp -s got.out expect.out
+result top $?
+
+exit $NFAIL
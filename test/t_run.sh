@@ -0,0 +1,40 @@
+#!/bin/sh
+# Regression test for ehb run (user-046)
+# Usage: t_run.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+HBPLUS="$TESTDIR/fakehbplus.sh"
+PDBS=""
+for k in 0 1 2 3 4 5 6 7; do
+   cp v$k.hb2 v$k.pdb
+   PDBS="$PDBS v$k.pdb"
+done
+echo FAIL > bad.pdb
+mkdir scratch
+
+# Running the stand-in HBPlus on the .hb2 files dressed up as PDB 
+# files must give the same report as -b on the .hb2 files themselves
+"$EHB" -b $FILES 2>&1 | sed 's/\.hb2/.pdb/g' > batch.out
+TMPDIR=$WORK/scratch "$EHB" run -j 3 --hbplus "$HBPLUS" $PDBS \
+   > run.out 2>&1
+status=$?
+[ $status -eq 0 ] && grep -q "^Total HBond energy" run.out &&
+   cmp -s run.out batch.out
+result run $?
+
+# The scratch directories, with the .h files, must all be removed
+[ -z "$(ls -A scratch)" ]
+result run-scratch $?
+
+# A file on which HBPlus fails is reported and left out of the results
+TMPDIR=$WORK/scratch "$EHB" run -j 3 --hbplus "$HBPLUS" \
+   v0.pdb bad.pdb v1.pdb > fail.out 2> fail.err
+status=$?
+"$EHB" -b v0.hb2 v1.hb2 2>/dev/null | sed 's/\.hb2/.pdb/g' > ok.out
+[ $status -eq 1 ] && grep -q "^HBPlus failed on 1 file$" fail.err &&
+   cmp -s fail.out ok.out && [ -z "$(ls -A scratch)" ]
+result run-fail $?
+
+exit $NFAIL
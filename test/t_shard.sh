@@ -0,0 +1,27 @@
+#!/bin/sh
+# Regression test for ehb --shard and ehb merge (user-041)
+# Usage: t_shard.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# Three shards merged must give the same report as one serial run
+"$EHB" -b $FILES > serial.out 2>&1
+for i in 0 1 2; do
+   "$EHB" -b --shard $i/3 --partial part.$i $FILES > /dev/null 2>&1
+done
+"$EHB" merge part.0 part.1 part.2 > merge.out 2>&1
+grep -q "^Total HBond energy" serial.out && cmp -s merge.out serial.out
+result shard $?
+
+# A file given twice within one shard is not a duplicate, but the
+# same structure in two partial files is
+"$EHB" -b --shard 0/1 --partial twice.0 v0.hb2 v0.hb2 > /dev/null 2>&1
+"$EHB" merge twice.0 > /dev/null 2>&1
+result merge-repeat $?
+sed 's|^#shard 0/3|#shard 1/3|' part.0 > dup.1
+"$EHB" merge part.0 dup.1 part.2 > /dev/null 2>&1
+[ $? -ne 0 ]
+result merge-duplicate $?
+
+exit $NFAIL
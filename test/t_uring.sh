@@ -0,0 +1,29 @@
+#!/bin/sh
+# Regression test for an io_uring failure in the ehb -p pipeline
+# (user-044)
+# Usage: t_uring.sh [path/to/ehb]     (see testlib.sh)
+# 18.10.26 Original   By: agent
+
+. "$(dirname "$0")/testlib.sh"
+
+# failuring.so makes io_uring_enter fail with files in flight. ehb must
+# give up with an error rather than wait for them forever
+"$EHB" -b -p 2 --stats $FILES > stats.out 2>&1
+if ! grep -q "^Reading: [1-9][0-9]* with io_uring" stats.out; then
+   echo "SKIP uring (io_uring is not available)"
+elif "$CC" -shared -fPIC -o failuring.so "$TESTDIR/failuring.c" \
+           -ldl > cc.out 2>&1; then
+   for n in 0 1; do
+      LD_PRELOAD=./failuring.so FAILURING_AFTER=$n \
+         timeout 30 "$EHB" -b -p 2 $FILES > uring.out 2>&1
+      status=$?
+      [ $status -ne 0 ] && [ $status -ne 124 ] &&
+         grep -q "^io_uring read failed" uring.out
+      result uring-$n $?
+   done
+else
+   cat cc.out
+   result uring 1
+fi
+
+exit $NFAIL
@@ -0,0 +1,66 @@
+#*************************************************************************
+#
+#   Program:    regress.sh
+#   File:       testlib.sh
+#
+#   Version:    V1.0
+#   Date:       18.10.26
+#   Function:   Set-up shared by the ehb regression tests
+#
+#   Copyright:  (c) agent 2026
+#   Author:     agent
+#   EMail:      agent@local
+#
+#*************************************************************************
+#
+#   Description:
+#   ============
+#   Sourced by each t_*.sh script. Sets:
+#      EHB      The ehb program (the script's first argument; default
+#               ehb on the PATH), made absolute if it is a path
+#      CC       The C compiler (default cc)
+#      TESTDIR  This directory
+#      WORK     A scratch directory, which is the current directory
+#               and is removed on exit
+#      FILES    v0.hb2 ... v7.hb2 in WORK: pdb1crn.hb2 with 0 to 7 of
+#               its first bonds removed, so each has a different energy
+#   and defines result() to report each check.
+#
+#*************************************************************************
+#
+#   Revision History:
+#   =================
+#   V1.0  18.10.26   Original - from regress.sh   By: agent
+#
+#*************************************************************************
+
+EHB=${1:-ehb}
+case "$EHB" in
+   /*)  ;;
+   */*) EHB=$(pwd)/$EHB ;;
+esac
+CC=${CC:-cc}
+TESTDIR=$(cd "$(dirname "$0")" && pwd)
+NSKIP=8                      # Header lines at the start of a .hb2 file
+NFAIL=0
+
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/ehbtest.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' 0
+cd "$WORK" || exit 1
+
+# Report a check. $1 is its name; it passed if $2 is 0
+result()
+{
+   if [ "$2" -eq 0 ]; then
+      echo "PASS $1"
+   else
+      echo "FAIL $1"
+      NFAIL=$((NFAIL + 1))
+   fi
+}
+
+for k in 0 1 2 3 4 5 6 7; do
+   awk -v n=$((NSKIP + k)) "NR <= $NSKIP || NR > n" \
+      "$TESTDIR/pdb1crn.hb2" > v$k.hb2 || exit 1
+done
+FILES="v0.hb2 v1.hb2 v2.hb2 v3.hb2 v4.hb2 v5.hb2 v6.hb2 v7.hb2"
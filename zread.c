@@ -0,0 +1,688 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       zread.c
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Transparent reading of gzip and zstd compressed files
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   See zread.h
+
+**************************************************************************
+
+   Usage:
+   ======
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+/* Includes
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#ifndef NO_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "bioplib/macros.h"
+#include "zread.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define ZCHUNK   65536   /* Size of decompression buffers               */
+#define ZMAXNAME 160     /* Length of file name kept for messages       */
+
+/* Each open compressed file. The decompressor writes into OutFD. If an
+   external program is used, it writes into the pipe itself and OutFD
+   (if any) feeds it with data from memory.
+*/
+typedef struct _zstream
+{
+   FILE            *fp;
+   char            Name[ZMAXNAME],
+                   *Data;        /* Compressed data in memory...        */
+   size_t          Size;
+   int             InFD,         /* ...or in this file                  */
+                   OutFD,
+                   Type,
+                   Error;
+   pid_t           pid;          /* External decompressor               */
+   BOOL            HaveThread;
+   pthread_t       Thread;
+   struct _zstream *next;
+}  ZSTREAM;
+
+/************************************************************************/
+/* Globals
+*/
+static ZSTREAM         *sStreams    = NULL;
+static pthread_mutex_t sStreamMutex = PTHREAD_MUTEX_INITIALIZER;
+extern char            **environ;
+
+/************************************************************************/
+/* Prototypes
+*/
+static FILE *StartStream(ZSTREAM *zs);
+static void *DecompressThread(void *arg);
+static int  MagicType(unsigned char *magic, size_t n);
+static BOOL WriteAll(int fd, unsigned char *data, size_t n);
+#if !defined(NO_ZLIB) || defined(HAVE_ZSTD)
+static long ReadSource(ZSTREAM *zs, unsigned char *buffer, 
+                       unsigned char **data, size_t *offset);
+#endif
+#ifndef NO_ZLIB
+static int  InflateStream(ZSTREAM *zs);
+#endif
+#ifdef HAVE_ZSTD
+static int  ZstdStream(ZSTREAM *zs);
+#endif
+static int  FeedStream(ZSTREAM *zs);
+static BOOL SpawnDecompressor(ZSTREAM *zs, int in, int out);
+
+
+/************************************************************************/
+/*>int ZFileType(char *filename)
+   -----------------------------
+   Returns ZT_GZIP or ZT_ZSTD if a file starts with the magic bytes
+   for that format, otherwise ZT_PLAIN (including if it can't be read)
+
+   18.10.26 Original   By: agent
+*/
+int ZFileType(char *filename)
+{
+   unsigned char magic[4];
+   ssize_t       n;
+   int           fd;
+
+   if((fd = open(filename, O_RDONLY|O_CLOEXEC)) < 0)
+      return(ZT_PLAIN);
+   n = read(fd, magic, 4);
+   close(fd);
+
+   return((n > 0) ? MagicType(magic, (size_t)n) : ZT_PLAIN);
+}
+
+
+/************************************************************************/
+/*>int ZBufferType(char *data, size_t size)
+   ----------------------------------------
+   As ZFileType() for a file in memory
+
+   18.10.26 Original   By: agent
+*/
+int ZBufferType(char *data, size_t size)
+{
+   return(MagicType((unsigned char *)data, size));
+}
+
+
+/************************************************************************/
+/*>FILE *ZOpen(char *filename)
+   ---------------------------
+   Opens a plain, gzip or zstd file for reading. Returns NULL if it 
+   can't be opened.
+
+   18.10.26 Original   By: agent
+*/
+FILE *ZOpen(char *filename)
+{
+   ZSTREAM       *zs;
+   unsigned char magic[4];
+   ssize_t       n;
+   int           fd, type;
+
+   if((fd = open(filename, O_RDONLY|O_CLOEXEC)) < 0)
+      return(NULL);
+   n    = pread(fd, magic, 4, 0);
+   type = (n > 0) ? MagicType(magic, (size_t)n) : ZT_PLAIN;
+   
+   if(type == ZT_PLAIN)
+   {
+      close(fd);
+      return(fopen(filename, "r"));
+   }
+
+   if((zs = (ZSTREAM *)calloc(1, sizeof(ZSTREAM)))==NULL)
+   {
+      close(fd);
+      return(NULL);
+   }
+   strncpy(zs->Name, filename, ZMAXNAME-1);
+   zs->InFD = fd;
+   zs->Type = type;
+
+   return(StartStream(zs));
+}
+
+
+/************************************************************************/
+/*>FILE *ZOpenBuffer(char *data, size_t size, char *name)
+   ------------------------------------------------------
+   Opens a plain, gzip or zstd file which is already in memory for 
+   reading. The data must not be freed until after ZClose(). name is
+   used in messages. Returns NULL on failure.
+
+   18.10.26 Original   By: agent
+*/
+FILE *ZOpenBuffer(char *data, size_t size, char *name)
+{
+   ZSTREAM *zs;
+   int     type;
+
+   if((type = MagicType((unsigned char *)data, size)) == ZT_PLAIN)
+      return((size > 0) ? fmemopen(data, size, "r") : NULL);
+
+   if((zs = (ZSTREAM *)calloc(1, sizeof(ZSTREAM)))==NULL)
+      return(NULL);
+   strncpy(zs->Name, name, ZMAXNAME-1);
+   zs->Data = data;
+   zs->Size = size;
+   zs->InFD = (-1);
+   zs->Type = type;
+
+   return(StartStream(zs));
+}
+
+
+/************************************************************************/
+/*>int ZClose(FILE *fp)
+   --------------------
+   Closes a FILE from ZOpen() or ZOpenBuffer() and waits for its 
+   decompressor. Returns 0 on success or non-zero if the compressed 
+   data were corrupt or could not be decompressed. Closing before the
+   end of the data is not an error.
+
+   18.10.26 Original   By: agent
+*/
+int ZClose(FILE *fp)
+{
+   ZSTREAM **pzs,
+           *zs = NULL;
+   int     status,
+           error;
+
+   if(fp == NULL)
+      return(0);
+   
+   pthread_mutex_lock(&sStreamMutex);
+   for(pzs=&sStreams; *pzs!=NULL; pzs=&((*pzs)->next))
+   {
+      if((*pzs)->fp == fp)
+      {
+         zs   = *pzs;
+         *pzs = zs->next;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&sStreamMutex);
+
+   /* Closing our end first stops a decompressor which is still 
+      writing
+   */
+   error = (fclose(fp) != 0);
+   if(zs == NULL)
+      return(error);
+   
+   if(zs->HaveThread)
+      pthread_join(zs->Thread, NULL);
+   if(zs->pid > 0)
+   {
+      while((waitpid(zs->pid, &status, 0) < 0) && (errno == EINTR));
+      if((WIFEXITED(status) && WEXITSTATUS(status)) ||
+         (WIFSIGNALED(status) && (WTERMSIG(status) != SIGPIPE)))
+      {
+         fprintf(stderr,"Error decompressing %s\n", zs->Name);
+         zs->Error = 1;
+      }
+   }
+   if(zs->InFD >= 0)
+      close(zs->InFD);
+
+   error = zs->Error;
+   free(zs);
+   return(error);
+}
+
+
+/************************************************************************/
+/*>static FILE *StartStream(ZSTREAM *zs)
+   -------------------------------------
+   Creates the pipe and starts the decompressor for a stream. Frees 
+   the stream and returns NULL on failure.
+
+   18.10.26 Original   By: agent
+*/
+static FILE *StartStream(ZSTREAM *zs)
+{
+   int  pipefd[2],
+        feed[2]    = {-1, -1};
+   BOOL external,
+        ok         = TRUE;
+
+#ifdef NO_ZLIB
+   external = TRUE;
+#else
+   external = (zs->Type != ZT_GZIP);
+#endif
+#ifdef HAVE_ZSTD
+   if(zs->Type == ZT_ZSTD)
+      external = FALSE;
+#endif
+
+   zs->OutFD = (-1);
+   if(pipe2(pipefd, O_CLOEXEC) != 0)
+   {
+      if(zs->InFD >= 0)
+         close(zs->InFD);
+      free(zs);
+      return(NULL);
+   }
+   
+   if(external)
+   {
+      /* The program reads the file directly or is fed from memory by
+         a thread through a second pipe
+      */
+      if((zs->InFD < 0) && (pipe2(feed, O_CLOEXEC) != 0))
+         ok = FALSE;
+      else
+         ok = SpawnDecompressor(zs, (zs->InFD >= 0) ? zs->InFD : feed[0],
+                                pipefd[1]);
+      close(pipefd[1]);
+      if(feed[0] >= 0)
+         close(feed[0]);
+      zs->OutFD = feed[1];
+   }
+   else
+   {
+      zs->OutFD = pipefd[1];
+   }
+
+   if(ok && (zs->OutFD >= 0))
+   {
+      zs->HaveThread = (pthread_create(&(zs->Thread), NULL, 
+                                       DecompressThread, zs) == 0);
+      ok = zs->HaveThread;
+   }
+
+   if(ok)
+      zs->fp = fdopen(pipefd[0], "r");
+   if(zs->fp == NULL)
+   {
+      /* Closing the read end makes the decompressor give up           */
+      close(pipefd[0]);
+      if(!zs->HaveThread && (zs->OutFD >= 0))
+         close(zs->OutFD);
+      if(zs->HaveThread)
+         pthread_join(zs->Thread, NULL);
+      if(zs->pid > 0)
+         waitpid(zs->pid, NULL, 0);
+      if(zs->InFD >= 0)
+         close(zs->InFD);
+      free(zs);
+      return(NULL);
+   }
+
+   pthread_mutex_lock(&sStreamMutex);
+   zs->next = sStreams;
+   sStreams = zs;
+   pthread_mutex_unlock(&sStreamMutex);
+
+   return(zs->fp);
+}
+
+
+/************************************************************************/
+/*>static void *DecompressThread(void *arg)
+   ----------------------------------------
+   Thread which decompresses (or feeds an external decompressor) into
+   OutFD and then closes it. SIGPIPE is blocked so that a reader which
+   stops early gives EPIPE rather than killing the program.
+
+   18.10.26 Original   By: agent
+*/
+static void *DecompressThread(void *arg)
+{
+   ZSTREAM  *zs = (ZSTREAM *)arg;
+   sigset_t set;
+   int      error;
+
+   sigemptyset(&set);
+   sigaddset(&set, SIGPIPE);
+   pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+   if(zs->pid > 0)
+      error = FeedStream(zs);
+#ifdef HAVE_ZSTD
+   else if(zs->Type == ZT_ZSTD)
+      error = ZstdStream(zs);
+#endif
+#ifndef NO_ZLIB
+   else if(zs->Type == ZT_GZIP)
+      error = InflateStream(zs);
+#endif
+   else
+      error = 1;
+
+   close(zs->OutFD);
+   if(error)
+   {
+      fprintf(stderr,"Error decompressing %s\n", zs->Name);
+      zs->Error = 1;
+   }
+   return(NULL);
+}
+
+
+#ifndef NO_ZLIB
+/************************************************************************/
+/*>static int InflateStream(ZSTREAM *zs)
+   -------------------------------------
+   Decompresses gzip data with zlib, including files made of several
+   gzip members. Returns 0 on success (or if the reader stopped early)
+
+   18.10.26 Original   By: agent
+*/
+static int InflateStream(ZSTREAM *zs)
+{
+   z_stream      strm;
+   unsigned char *in,
+                 *out,
+                 *data;
+   size_t        offset = 0;
+   long          n;
+   int           ret    = Z_OK;
+   BOOL          ended  = FALSE;
+
+   if(((in  = (unsigned char *)malloc(ZCHUNK))==NULL) ||
+      ((out = (unsigned char *)malloc(ZCHUNK))==NULL))
+   {
+      free(in);
+      return(1);
+   }
+   
+   memset(&strm, 0, sizeof(strm));
+   if(inflateInit2(&strm, 15+32) != Z_OK)     /* 32: gzip header      */
+   {
+      free(in);
+      free(out);
+      return(1);
+   }
+
+   for(;;)
+   {
+      if(strm.avail_in == 0)
+      {
+         if((n = ReadSource(zs, in, &data, &offset)) < 0)
+            break;
+         if(n == 0)
+         {
+            ret = ended ? Z_OK : Z_DATA_ERROR;
+            break;
+         }
+         strm.next_in  = data;
+         strm.avail_in = (uInt)n;
+      }
+
+      /* A new member follows the end of the last one                  */
+      if(ended)
+      {
+         inflateReset(&strm);
+         ended = FALSE;
+      }
+
+      strm.next_out  = out;
+      strm.avail_out = ZCHUNK;
+      ret = inflate(&strm, Z_NO_FLUSH);
+      if((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+         break;
+      if(!WriteAll(zs->OutFD, out, ZCHUNK - strm.avail_out))
+      {
+         ret = Z_OK;          /* Reader has stopped early              */
+         break;
+      }
+      ended = (ret == Z_STREAM_END);
+   }
+
+   inflateEnd(&strm);
+   free(in);
+   free(out);
+   return(((ret == Z_OK) || (ret == Z_STREAM_END)) ? 0 : 1);
+}
+#endif
+
+
+#ifdef HAVE_ZSTD
+/************************************************************************/
+/*>static int ZstdStream(ZSTREAM *zs)
+   ----------------------------------
+   Decompresses zstd data with libzstd. Returns 0 on success (or if the
+   reader stopped early)
+
+   18.10.26 Original   By: agent
+*/
+static int ZstdStream(ZSTREAM *zs)
+{
+   ZSTD_DCtx      *dctx;
+   ZSTD_inBuffer  input;
+   ZSTD_outBuffer output;
+   unsigned char  *in,
+                  *out,
+                  *data;
+   size_t         offset = 0,
+                  ret    = 1;
+   long           n;
+   int            error  = 1;
+
+   if((dctx = ZSTD_createDCtx())==NULL)
+      return(1);
+   if(((in  = (unsigned char *)malloc(ZCHUNK))==NULL) ||
+      ((out = (unsigned char *)malloc(ZCHUNK))==NULL))
+   {
+      free(in);
+      ZSTD_freeDCtx(dctx);
+      return(1);
+   }
+
+   while((n = ReadSource(zs, in, &data, &offset)) > 0)
+   {
+      input.src  = data;
+      input.size = (size_t)n;
+      input.pos  = 0;
+      while(input.pos < input.size)
+      {
+         output.dst  = out;
+         output.size = ZCHUNK;
+         output.pos  = 0;
+         ret = ZSTD_decompressStream(dctx, &output, &input);
+         if(ZSTD_isError(ret))
+            goto done;
+         if(!WriteAll(zs->OutFD, out, output.pos))
+         {
+            error = 0;        /* Reader has stopped early              */
+            goto done;
+         }
+      }
+   }
+   /* ret is 0 at the end of a complete frame                          */
+   if((n == 0) && (ret == 0))
+      error = 0;
+
+done:
+   ZSTD_freeDCtx(dctx);
+   free(in);
+   free(out);
+   return(error);
+}
+#endif
+
+
+/************************************************************************/
+/*>static int FeedStream(ZSTREAM *zs)
+   ----------------------------------
+   Feeds compressed data from memory to an external decompressor.
+   Returns 0 on success (or if the decompressor stopped early)
+
+   18.10.26 Original   By: agent
+*/
+static int FeedStream(ZSTREAM *zs)
+{
+   WriteAll(zs->OutFD, (unsigned char *)zs->Data, zs->Size);
+   return(0);
+}
+
+
+#if !defined(NO_ZLIB) || defined(HAVE_ZSTD)
+/************************************************************************/
+/*>static long ReadSource(ZSTREAM *zs, unsigned char *buffer, 
+                          unsigned char **data, size_t *offset)
+   -------------------------------------------------------------
+   Gets the next block of compressed data, either by reading the file 
+   into buffer or from memory (in blocks of at most 1GB so the length
+   fits zlib's counters). *data is set to the start of the block.
+   Returns the number of bytes, 0 at the end or -1 on error.
+
+   18.10.26 Original   By: agent
+*/
+static long ReadSource(ZSTREAM *zs, unsigned char *buffer, 
+                       unsigned char **data, size_t *offset)
+{
+   ssize_t n;
+
+   if(zs->InFD < 0)
+   {
+      n = (ssize_t)(zs->Size - *offset);
+      if(n > (1L<<30))
+         n = (1L<<30);
+      *data    = (unsigned char *)zs->Data + *offset;
+      *offset += (size_t)n;
+      return((long)n);
+   }
+
+   while(((n = read(zs->InFD, buffer, ZCHUNK)) < 0) && (errno == EINTR));
+   *data = buffer;
+   return((long)n);
+}
+#endif
+
+
+/************************************************************************/
+/*>static BOOL WriteAll(int fd, unsigned char *data, size_t n)
+   -----------------------------------------------------------
+   Writes all of a block to a pipe. Returns FALSE if the other end has
+   been closed.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL WriteAll(int fd, unsigned char *data, size_t n)
+{
+   ssize_t done;
+
+   while(n > 0)
+   {
+      if((done = write(fd, data, n)) < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         return(FALSE);
+      }
+      data += done;
+      n    -= (size_t)done;
+   }
+   return(TRUE);
+}
+
+
+/************************************************************************/
+/*>static int MagicType(unsigned char *magic, size_t n)
+   ----------------------------------------------------
+   Identifies gzip (1f 8b) and zstd (28 b5 2f fd) from the first bytes
+   of a file
+
+   18.10.26 Original   By: agent
+*/
+static int MagicType(unsigned char *magic, size_t n)
+{
+   if((n >= 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b))
+      return(ZT_GZIP);
+   if((n >= 4) && (magic[0] == 0x28) && (magic[1] == 0xb5) &&
+      (magic[2] == 0x2f) && (magic[3] == 0xfd))
+      return(ZT_ZSTD);
+   return(ZT_PLAIN);
+}
+
+
+/************************************************************************/
+/*>static BOOL SpawnDecompressor(ZSTREAM *zs, int in, int out)
+   -----------------------------------------------------------
+   Runs 'gzip -dc' or 'zstd -dc' reading from in and writing to out.
+   posix_spawn() is used as the caller may have other threads.
+
+   18.10.26 Original   By: agent
+*/
+static BOOL SpawnDecompressor(ZSTREAM *zs, int in, int out)
+{
+   posix_spawn_file_actions_t actions;
+   char                       *argv[4];
+   int                        ret;
+
+   argv[0] = (zs->Type == ZT_ZSTD) ? "zstd" : "gzip";
+   argv[1] = "-dc";
+   argv[2] = (zs->Type == ZT_ZSTD) ? "-q" : NULL;
+   argv[3] = NULL;
+
+   posix_spawn_file_actions_init(&actions);
+   posix_spawn_file_actions_adddup2(&actions, in,  0);
+   posix_spawn_file_actions_adddup2(&actions, out, 1);
+   ret = posix_spawnp(&(zs->pid), argv[0], &actions, NULL, argv, 
+                      environ);
+   posix_spawn_file_actions_destroy(&actions);
+
+   if(ret != 0)
+   {
+      fprintf(stderr,"Unable to run %s to decompress %s\n", argv[0],
+              zs->Name);
+      zs->pid = 0;
+      return(FALSE);
+   }
+   return(TRUE);
+}
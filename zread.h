@@ -0,0 +1,92 @@
+/*************************************************************************
+
+   Program:    ehb / ehb2 / ehb3
+   File:       zread.h
+
+   Version:    V1.0
+   Date:       18.10.26
+   Function:   Transparent reading of gzip and zstd compressed files
+
+   Copyright:  (c) agent 2026
+   Author:     agent
+   EMail:      agent@local
+
+**************************************************************************
+
+   This program is not in the public domain, but it may be copied
+   according to the conditions laid out in the accompanying file
+   COPYING.DOC
+
+   The code may be modified as required, but any modifications must be
+   documented so that the person responsible can be identified. If someone
+   else breaks this code, I don't want to be blamed for code that does not
+   work!
+
+   The code may not be sold commercially or included as part of a
+   commercial product except as described in the file COPYING.DOC.
+
+**************************************************************************
+
+   Description:
+   ============
+   ZOpen() opens a file for reading and returns an ordinary FILE. The
+   type of file is found from its first bytes (not its name). A plain
+   file is simply fopen()ed. A gzip or zstd file is decompressed on
+   the fly: the FILE is the read end of a pipe and the decompressed 
+   data are written into the other end as they are needed, so 
+   decompression overlaps parsing and no temporary file is written.
+
+   gzip is decompressed with zlib on a separate thread (or by running
+   'gzip -dc' if compiled with -DNO_ZLIB). zstd is decompressed with 
+   libzstd on a separate thread if compiled with -DHAVE_ZSTD, 
+   otherwise by running 'zstd -dc'.
+
+   ZOpenBuffer() does the same for a file which is already in memory.
+
+   A FILE from ZOpen() or ZOpenBuffer() must be closed with ZClose(),
+   which waits for the decompressor. It may be closed before the end 
+   of the data.
+
+**************************************************************************
+
+   Usage:
+   ======
+   if((fp = ZOpen(filename)) != NULL)
+   {
+      ...read fp...
+      if(ZClose(fp)) ...corrupt compressed file...
+   }
+
+**************************************************************************
+
+   Revision History:
+   =================
+   V1.0  18.10.26   Original   By: agent
+
+*************************************************************************/
+#ifndef _ZREAD_H
+#define _ZREAD_H
+
+/************************************************************************/
+/* Includes
+*/
+#include <stdio.h>
+#include "bioplib/SysDefs.h"
+
+/************************************************************************/
+/* Defines and macros
+*/
+#define ZT_PLAIN 0
+#define ZT_GZIP  1
+#define ZT_ZSTD  2
+
+/************************************************************************/
+/* Prototypes
+*/
+int  ZFileType(char *filename);
+int  ZBufferType(char *data, size_t size);
+FILE *ZOpen(char *filename);
+FILE *ZOpenBuffer(char *data, size_t size, char *name);
+int  ZClose(FILE *fp);
+
+#endif